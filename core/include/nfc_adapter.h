@@ -135,6 +135,19 @@ nfc_adapter_remove_tag(
     NfcAdapter* adapter,
     const char* name);
 
+/*
+ * When the target of an initialized tag disappears, the adapter keeps
+ * the tag around for up to ms milliseconds. If a target with the same
+ * technology, NFCID and poll parameters shows up during that time, the
+ * existing NfcTag gets attached to it, keeping the cached contents and
+ * everything which refers to the tag. Tags with random NFCID1 are never
+ * reattached. Zero (the default) disables this.
+ */
+void
+nfc_adapter_set_reattach_window(
+    NfcAdapter* adapter,
+    guint ms); /* Since 1.0.34 */
+
 gulong
 nfc_adapter_add_target_presence_handler(
     NfcAdapter* adapter,
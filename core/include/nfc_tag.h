@@ -46,6 +46,22 @@ typedef enum nfc_tag_flags {
     NFC_TAG_FLAG_INITIALIZED = 0x01,
 } NFC_TAG_FLAGS;
 
+/*
+ * Initialization stages, in the order in which the tag goes through
+ * them. Stages mark progress rather than success, e.g. NDEF_LOCATED
+ * means that we know where NDEF is or that there's none. Depending
+ * on the tag type, initialization may complete (NFC_TAG_FLAG_INITIALIZED)
+ * some time after NDEF_PARSED. Not every tag reaches the CACHED stage.
+ * Since 1.0.34
+ */
+typedef enum nfc_tag_stage {
+    NFC_TAG_STAGE_NONE,
+    NFC_TAG_STAGE_IDENTIFIED,   /* Type and poll parameters are known */
+    NFC_TAG_STAGE_NDEF_LOCATED, /* NDEF location (if any) is known */
+    NFC_TAG_STAGE_NDEF_PARSED,  /* tag->ndef is valid */
+    NFC_TAG_STAGE_CACHED        /* The entire tag memory is cached */
+} NFC_TAG_STAGE;
+
 struct nfc_tag {
     GObject object;
     NfcTagPriv* priv;
@@ -54,7 +70,7 @@ struct nfc_tag {
     gboolean present;
     NFC_TAG_TYPE type;
     NFC_TAG_FLAGS flags;
-    NfcNdefRec* ndef;  /* Valid only when initialized */
+    NfcNdefRec* ndef;  /* Valid since NFC_TAG_STAGE_NDEF_PARSED */
 };
 
 GType nfc_tag_get_type(void);
@@ -84,6 +100,10 @@ void
 nfc_tag_deactivate(
     NfcTag* tag);
 
+NFC_TAG_STAGE
+nfc_tag_stage(
+    NfcTag* tag); /* Since 1.0.34 */
+
 gulong
 nfc_tag_add_gone_handler(
     NfcTag* tag,
@@ -96,6 +116,24 @@ nfc_tag_add_initialized_handler(
     NfcTagFunc func,
     void* user_data);
 
+/*
+ * The tag has been attached to a new NfcTarget after briefly leaving
+ * the field, see nfc_adapter_set_reattach_window()
+ */
+gulong
+nfc_tag_add_reattached_handler(
+    NfcTag* tag,
+    NfcTagFunc func,
+    void* user_data); /* Since 1.0.34 */
+
+/* Invoked when the tag reaches the specified stage */
+gulong
+nfc_tag_add_stage_handler(
+    NfcTag* tag,
+    NFC_TAG_STAGE stage,
+    NfcTagFunc func,
+    void* user_data); /* Since 1.0.34 */
+
 void
 nfc_tag_remove_handler(
     NfcTag* tag,
@@ -43,7 +43,8 @@ typedef struct nfc_tag_t2_priv NfcTagType2Priv;
 
 typedef enum nfc_tag_t2_flags {
     NFC_TAG_T2_FLAGS_NONE = 0x00,
-    NFC_TAG_T2_FLAG_NFC_FORUM_COMPATIBLE = 0x01
+    NFC_TAG_T2_FLAG_NFC_FORUM_COMPATIBLE = 0x01,
+    NFC_TAG_T2_FLAG_FAST_READ = 0x02 /* Supports FAST_READ. Since 1.0.34 */
 } NFC_TAG_T2_FLAGS;
 
 struct nfc_tag_t2 {
@@ -66,6 +67,20 @@ GType nfc_tag_t2_get_type();
 
 #define NFC_TAG_T2_DATA_BLOCK0  (4) /* Index of the first data block */
 
+/*
+ * Product identified by GET_VERSION during initialization. Memory
+ * layout comes from the datasheet. Block numbers count across sectors
+ * (256 blocks per sector) starting from block 0 of sector 0.
+ * Since 1.0.34
+ */
+typedef struct nfc_tag_t2_product {
+    const char* name;       /* e.g. "NTAG216" */
+    GUtilData version;      /* Raw GET_VERSION response */
+    guint total_blocks;     /* Including header and configuration */
+    guint data_blocks;      /* User memory */
+    guint config_block;     /* First configuration block, zero if none */
+} NfcTagType2Product;
+
 typedef
 void
 (*NfcTagType2ReadFunc)(
@@ -75,6 +90,15 @@ void
     guint len,
     void* user_data);
 
+/* Response is NULL if transmission has failed */
+typedef
+void
+(*NfcTagType2ReadBytesFunc)(
+    NfcTagType2* tag,
+    NFC_TRANSMIT_STATUS status,
+    GBytes* data,
+    void* user_data); /* Since 1.0.34 */
+
 typedef
 void
 (*NfcTagType2WriteFunc)(
@@ -83,6 +107,69 @@ void
     guint written,
     void* user_data);
 
+typedef
+void
+(*NfcTagType2Func)(
+    NfcTagType2* tag,
+    void* user_data); /* Since 1.0.34 */
+
+/*
+ * Once enabled, read-ahead fetches the rest of the tag memory in the
+ * background after initialization, at the lowest priority. When it's
+ * DONE, data reads are served from the cache (unless something has
+ * been written since then). Since 1.0.34
+ */
+typedef enum nfc_tag_t2_read_ahead {
+    NFC_TAG_T2_READ_AHEAD_OFF,      /* Disabled or not started yet */
+    NFC_TAG_T2_READ_AHEAD_ACTIVE,   /* Reading in the background */
+    NFC_TAG_T2_READ_AHEAD_DONE,     /* Everything is cached */
+    NFC_TAG_T2_READ_AHEAD_STOPPED   /* Failed or the tag is gone */
+} NFC_TAG_T2_READ_AHEAD;
+
+/*
+ * GET_VERSION identifies NXP chips but tags which don't support it
+ * (MIFARE Ultralight, Ultralight C, NTAG203) have to be reactivated
+ * after it, which costs time on each tap. Disabled by default.
+ */
+void
+nfc_tag_t2_set_get_version(
+    gboolean enable); /* Since 1.0.34 */
+
+/* NULL if the chip hasn't been identified (or GET_VERSION is disabled) */
+const NfcTagType2Product*
+nfc_tag_t2_product(
+    NfcTagType2* tag); /* Since 1.0.34 */
+
+void
+nfc_tag_t2_set_read_ahead(
+    NfcTagType2* tag,
+    gboolean enable); /* Since 1.0.34 */
+
+NFC_TAG_T2_READ_AHEAD
+nfc_tag_t2_read_ahead_state(
+    NfcTagType2* tag); /* Since 1.0.34 */
+
+/* Use nfc_tag_remove_handler() to remove the handler */
+gulong
+nfc_tag_t2_add_read_ahead_handler(
+    NfcTagType2* tag,
+    NfcTagType2Func func,
+    void* user_data); /* Since 1.0.34 */
+
+/*
+ * Persistent cache of tag contents, shared by all Type 2 tags (disabled
+ * by default). Memory images are keyed by NFCID1, serial number and CC.
+ * When a cached tag shows up again, only the header and the first data
+ * blocks are read to validate the cache. Least recently used images
+ * are deleted to keep the total size of the cache under max_size bytes
+ * (zero means no limit). Any write invalidates the cached image.
+ * NULL dir disables the cache. Since 1.0.34
+ */
+void
+nfc_tag_t2_set_cache(
+    const char* dir,
+    gsize max_size); /* Since 1.0.34 */
+
 guint
 nfc_tag_t2_read(
     NfcTagType2* tag,
@@ -92,6 +179,16 @@ nfc_tag_t2_read(
     GDestroyNotify destroy,
     void* user_data);
 
+guint
+nfc_tag_t2_read_bytes(
+    NfcTagType2* tag,
+    guint sector,
+    guint block,
+    NfcTargetSequence* seq,
+    NfcTagType2ReadBytesFunc resp,
+    GDestroyNotify destroy,
+    void* user_data); /* Since 1.0.34 */
+
 guint
 nfc_tag_t2_write(
     NfcTagType2* tag,
@@ -172,6 +269,18 @@ nfc_tag_t2_read_data_sync(
     guint nbytes,
     void* buffer);
 
+/*
+ * Returns the cached data without copying it, or NULL if the requested
+ * range (truncated at the end of the data area) isn't entirely cached.
+ * The contents of the returned GBytes don't change even if the tag
+ * memory gets updated afterwards.
+ */
+GBytes*
+nfc_tag_t2_read_data_cached(
+    NfcTagType2* tag,
+    guint offset,
+    guint maxbytes); /* Since 1.0.34 */
+
 guint
 nfc_tag_t2_write_data(
     NfcTagType2* tag,
@@ -191,6 +300,27 @@ nfc_tag_t2_write_data_seq(
     GDestroyNotify destroy,
     void* user_data); /* Since 1.0.17 */
 
+/*
+ * With NFC_TAG_T2_WRITE_FLAG_DIFF, blocks which already contain the
+ * data being written are not rewritten. Blocks which aren't cached are
+ * read first. Unchanged bytes are still counted as written.
+ */
+typedef enum nfc_tag_t2_write_flags {
+    NFC_TAG_T2_WRITE_FLAGS_NONE = 0x00,
+    NFC_TAG_T2_WRITE_FLAG_DIFF = 0x01
+} NFC_TAG_T2_WRITE_FLAGS; /* Since 1.0.34 */
+
+guint
+nfc_tag_t2_write_data_seq2(
+    NfcTagType2* tag,
+    guint offset,
+    GBytes* bytes,
+    NfcTargetSequence* seq,
+    NFC_TAG_T2_WRITE_FLAGS flags,
+    NfcTagType2WriteDataFunc complete,
+    GDestroyNotify destroy,
+    void* user_data); /* Since 1.0.34 */
+
 G_END_DECLS
 
 #endif /* NFC_TAG_T2_H */
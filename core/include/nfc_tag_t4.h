@@ -92,6 +92,15 @@ void
     guint len,
     void* user_data);
 
+/* Response data (without SW) is NULL in case of I/O error */
+typedef
+void
+(*NfcTagType4ResponseBytesFunc)(
+    NfcTagType4* tag,
+    guint sw,  /* 16 bits (SW1 << 8)|SW2 */
+    GBytes* data,
+    void* user_data); /* Since 1.0.34 */
+
 guint
 nfc_isodep_transmit(
     NfcTagType4* tag,
@@ -106,6 +115,103 @@ nfc_isodep_transmit(
     GDestroyNotify destroy,
     void* user_data);
 
+/* Same as nfc_isodep_transmit but doesn't copy the response */
+guint
+nfc_isodep_transmit_bytes(
+    NfcTagType4* tag,
+    guint8 cla,             /* Class byte */
+    guint8 ins,             /* Instruction byte */
+    guint8 p1,              /* Parameter byte 1 */
+    guint8 p2,              /* Parameter byte 2 */
+    const GUtilData* data,  /* Command data */
+    guint le,               /* Expected length, zero if none */
+    NfcTargetSequence* seq,
+    NfcTagType4ResponseBytesFunc resp,
+    GDestroyNotify destroy,
+    void* user_data); /* Since 1.0.34 */
+
+/*
+ * Same as nfc_isodep_transmit_bytes but follows 61xx (sends GET RESPONSE
+ * and appends the data to the response) and 6Cxx (repeats the command
+ * with the right Le) within the same sequence. The callback receives the
+ * concatenated response and the final status word. If the total size of
+ * the response exceeds max_len bytes (zero means 65536), the transfer
+ * fails with ISO_SW_IO_ERR. The returned id is not a transmit id, the
+ * transfer gets cancelled when the tag is destroyed.
+ */
+guint
+nfc_isodep_transmit_chain(
+    NfcTagType4* tag,
+    guint8 cla,             /* Class byte */
+    guint8 ins,             /* Instruction byte */
+    guint8 p1,              /* Parameter byte 1 */
+    guint8 p2,              /* Parameter byte 2 */
+    const GUtilData* data,  /* Command data */
+    guint le,               /* Expected length, zero if none */
+    NfcTargetSequence* seq,
+    guint max_len,          /* Maximum total length of the response */
+    NfcTagType4ResponseBytesFunc resp,
+    GDestroyNotify destroy,
+    void* user_data); /* Since 1.0.34 */
+
+typedef enum nfc_tag_t4_io_status {
+    NFC_TAG_T4_IO_STATUS_OK,          /* Done */
+    NFC_TAG_T4_IO_STATUS_FAILURE,     /* Unexpected status word */
+    NFC_TAG_T4_IO_STATUS_IO_ERROR,    /* Transmission error */
+    NFC_TAG_T4_IO_STATUS_NOT_NDEF,    /* No usable NDEF file */
+    NFC_TAG_T4_IO_STATUS_READ_ONLY,   /* NDEF file is not writable */
+    NFC_TAG_T4_IO_STATUS_BAD_SIZE     /* Doesn't fit into the NDEF file */
+} NFC_TAG_T4_IO_STATUS; /* Since 1.0.34 */
+
+typedef
+void
+(*NfcTagType4WriteNdefFunc)(
+    NfcTagType4* tag,
+    NFC_TAG_T4_IO_STATUS status,
+    void* user_data); /* Since 1.0.34 */
+
+/*
+ * Replaces the contents of the NDEF file with the given NDEF message
+ * (without NLEN), following the NDEF Update procedure: NLEN is zeroed
+ * first, then the data are written in chunks no larger than MLc, then
+ * the actual NLEN is written. Everything is done within one sequence
+ * (a temporary one if NULL seq is passed in). The NDEF Tag Application
+ * remains selected afterwards and tag->ndef is not updated.
+ */
+guint
+nfc_tag_t4_write_ndef(
+    NfcTagType4* tag,
+    GBytes* ndef,
+    NfcTargetSequence* seq,
+    NfcTagType4WriteNdefFunc complete,
+    GDestroyNotify destroy,
+    void* user_data); /* Since 1.0.34 */
+
+/*
+ * After reading NDEF, Type 4 tags are reactivated to put the card back
+ * into its initial state, with the default application selected. That
+ * takes a full RF rediscovery, which isn't necessary for cards without
+ * other applications (e.g. plain NFC Forum tags). Rules are matched
+ * against the historical bytes (Type 4A), the first rule whose bytes
+ * are a prefix of the card's historical bytes wins. A rule with empty
+ * historical bytes matches any card, including Type 4B. Cards which
+ * don't match any rule are reactivated. With NFC_TAG_T4_REACTIVATE_NEVER
+ * NDEF is read even if the target doesn't support reactivation.
+ */
+typedef enum nfc_tag_t4_reactivate {
+    NFC_TAG_T4_REACTIVATE_ALWAYS,
+    NFC_TAG_T4_REACTIVATE_NEVER
+} NFC_TAG_T4_REACTIVATE; /* Since 1.0.34 */
+
+void
+nfc_tag_t4_add_reactivate_rule(
+    const GUtilData* hb,
+    NFC_TAG_T4_REACTIVATE policy); /* Since 1.0.34 */
+
+void
+nfc_tag_t4_clear_reactivate_rules(
+    void); /* Since 1.0.34 */
+
 G_END_DECLS
 
 #endif /* NFC_TAG_T4_H */
@@ -60,6 +60,61 @@ struct nfc_target {
     NfcTargetSequence* sequence;
 };
 
+/*
+ * When there's no active sequence, queued requests are submitted in
+ * the order of their priority and then in the order of submission.
+ * Requests associated with a sequence have the priority of the
+ * sequence. Since 1.0.34
+ */
+typedef enum nfc_target_priority {
+    NFC_TARGET_PRIORITY_BULK,           /* Bulk data transfers */
+    NFC_TARGET_PRIORITY_INTERACTIVE,    /* Client requests (default) */
+    NFC_TARGET_PRIORITY_INIT,           /* Tag initialization */
+    NFC_TARGET_PRIORITY_PRESENCE        /* Presence checks, keepalives */
+} NFC_TARGET_PRIORITY;
+
+#define NFC_TARGET_PRIORITY_DEFAULT NFC_TARGET_PRIORITY_INTERACTIVE
+
+/*
+ * Resend policy for transient errors. The frame is resent if the
+ * transmission completes with one of the selected statuses, after
+ * the delay which doubles with each attempt (but doesn't exceed
+ * max_delay_ms). Nothing else is transmitted in between, the request
+ * remains active until it succeeds or runs out of retries. The retry
+ * budget is shared by all frames of the request. Since 1.0.34
+ */
+typedef struct nfc_target_retry_policy {
+    guint retries;          /* Zero disables retries */
+    guint delay_ms;         /* Before the first retry */
+    guint max_delay_ms;
+    guint statuses;         /* NFC_TARGET_RETRY_STATUS() bits */
+} NfcTargetRetryPolicy;
+
+#define NFC_TARGET_RETRY_STATUS(status) (1u << (status))
+
+/*
+ * Per-request transmission options, all of which can be combined.
+ * NULL options are the same as NFC_TARGET_TRANSMIT_OPTIONS_INIT,
+ * which is what nfc_target_transmit() uses.
+ *
+ * Unless the timeout is fixed, it's estimated from the round-trip
+ * times of the previous requests of the same class, i.e. the ones
+ * expected to take similar time (e.g. the same command code). Zero
+ * class means no class, only the overall estimate is used in that
+ * case. Since 1.0.34
+ */
+typedef struct nfc_target_transmit_options {
+    NFC_TARGET_PRIORITY priority;       /* Ignored if there's a sequence */
+    gint64 deadline;                    /* Monotonic, zero if none */
+    const NfcTargetRetryPolicy* retry;  /* Copied, NULL if none */
+    guint timeout_ms;                   /* Fixed, zero to estimate */
+    guint rtt_class;                    /* NFC_TARGET_RTT_CLASS(), or zero */
+} NfcTargetTransmitOptions;
+
+#define NFC_TARGET_TRANSMIT_OPTIONS_INIT \
+    { NFC_TARGET_PRIORITY_DEFAULT, 0, NULL, 0, 0 }
+#define NFC_TARGET_RTT_CLASS(code) (((guint)(code)) + 1)
+
 GType nfc_target_get_type(void);
 #define NFC_TYPE_TARGET (nfc_target_get_type())
 #define NFC_TARGET(obj) (G_TYPE_CHECK_INSTANCE_CAST((obj), \
@@ -80,6 +135,29 @@ void
     guint len,
     void* user_data);
 
+/* Response is NULL if transmission has failed */
+typedef
+void
+(*NfcTargetTransmitBytesFunc)(
+    NfcTarget* target,
+    NFC_TRANSMIT_STATUS status,
+    GBytes* data,
+    void* user_data); /* Since 1.0.34 */
+
+/*
+ * Responses to the frames which have been successfully transmitted,
+ * in the same order. If all frames have been transmitted, status is
+ * NFC_TRANSMIT_STATUS_OK and count matches the number of frames.
+ */
+typedef
+void
+(*NfcTargetTransmitBatchFunc)(
+    NfcTarget* target,
+    NFC_TRANSMIT_STATUS status,
+    GBytes* const* resp,
+    guint count,
+    void* user_data); /* Since 1.0.34 */
+
 NfcTarget*
 nfc_target_ref(
     NfcTarget* target);
@@ -120,13 +198,19 @@ NfcTargetSequence*
 nfc_target_sequence_new(
     NfcTarget* target); /* Since 1.0.17 */
 
+NfcTargetSequence*
+nfc_target_sequence_new2(
+    NfcTarget* target,
+    NFC_TARGET_PRIORITY priority); /* Since 1.0.34 */
+
 void
 nfc_target_sequence_free(
     NfcTargetSequence* seq); /* Since 1.0.17 */
 
 /*
  * These functions can be used for sending internal requests (e.g. presence
- * check) to take advantage of queueing provided by NfcTarget:
+ * check) to take advantage of queueing provided by NfcTarget. The ones
+ * without options are shortcuts for the _full versions:
  */
 
 guint
@@ -139,6 +223,129 @@ nfc_target_transmit(
     GDestroyNotify destroy,
     void* user_data);
 
+/* Priority is ignored if the request belongs to a sequence */
+guint
+nfc_target_transmit2(
+    NfcTarget* target,
+    const void* data,
+    guint len,
+    NfcTargetSequence* seq,
+    NFC_TARGET_PRIORITY priority,
+    NfcTargetTransmitFunc complete,
+    GDestroyNotify destroy,
+    void* user_data); /* Since 1.0.34 */
+
+/*
+ * Deadline is the g_get_monotonic_time() value after which the request
+ * is no longer needed. If it's still queued by then, it's completed
+ * with NFC_TRANSMIT_STATUS_EXPIRED and never gets transmitted. Zero
+ * means no deadline. Deadline can also be set after the request has
+ * been submitted, nfc_target_set_transmit_deadline() returns FALSE if
+ * the request is not (or no longer) queued.
+ */
+guint
+nfc_target_transmit_with_deadline(
+    NfcTarget* target,
+    const void* data,
+    guint len,
+    NfcTargetSequence* seq,
+    gint64 deadline,
+    NfcTargetTransmitFunc complete,
+    GDestroyNotify destroy,
+    void* user_data); /* Since 1.0.34 */
+
+gboolean
+nfc_target_set_transmit_deadline(
+    NfcTarget* target,
+    guint id,
+    gint64 deadline); /* Since 1.0.34 */
+
+/*
+ * Only idempotent commands (such as reads) should be retried, because
+ * the response may have been lost after the command has been executed.
+ * It's up to the caller to decide which ones are. The policy is copied.
+ */
+guint
+nfc_target_transmit_with_retry(
+    NfcTarget* target,
+    const void* data,
+    guint len,
+    NfcTargetSequence* seq,
+    const NfcTargetRetryPolicy* retry,
+    NfcTargetTransmitFunc complete,
+    GDestroyNotify destroy,
+    void* user_data); /* Since 1.0.34 */
+
+/*
+ * Same as nfc_target_transmit but the data is passed around as GBytes,
+ * without making copies of it. Completion callback receives a reference
+ * to the response, which the callback can keep for as long as it needs.
+ */
+
+guint
+nfc_target_transmit_bytes(
+    NfcTarget* target,
+    GBytes* data,
+    NfcTargetSequence* seq,
+    NfcTargetTransmitBytesFunc complete,
+    GDestroyNotify destroy,
+    void* user_data); /* Since 1.0.34 */
+
+/*
+ * Transmits the frames back-to-back, each one as soon as the previous
+ * one has been answered. Nothing else gets transmitted in between.
+ * Stops at the first failure. The whole batch is cancelled with one
+ * nfc_target_cancel_transmit() call.
+ */
+guint
+nfc_target_transmit_batch(
+    NfcTarget* target,
+    GBytes* const* frames,
+    guint count,
+    NfcTargetSequence* seq,
+    NfcTargetTransmitBatchFunc complete,
+    GDestroyNotify destroy,
+    void* user_data); /* Since 1.0.34 */
+
+/*
+ * Same as the above with any combination of options. Deadline is the
+ * same as in nfc_target_transmit_with_deadline(), retry policy is the
+ * same as in nfc_target_transmit_with_retry(). Fixed timeout doesn't
+ * affect (and isn't affected by) round-trip time estimates, it's meant
+ * for frames which are expected to time out, e.g. passively ACKed.
+ */
+guint
+nfc_target_transmit_full(
+    NfcTarget* target,
+    const void* data,
+    guint len,
+    NfcTargetSequence* seq,
+    const NfcTargetTransmitOptions* options,
+    NfcTargetTransmitFunc complete,
+    GDestroyNotify destroy,
+    void* user_data); /* Since 1.0.34 */
+
+guint
+nfc_target_transmit_bytes_full(
+    NfcTarget* target,
+    GBytes* data,
+    NfcTargetSequence* seq,
+    const NfcTargetTransmitOptions* options,
+    NfcTargetTransmitBytesFunc complete,
+    GDestroyNotify destroy,
+    void* user_data); /* Since 1.0.34 */
+
+guint
+nfc_target_transmit_batch_full(
+    NfcTarget* target,
+    GBytes* const* frames,
+    guint count,
+    NfcTargetSequence* seq,
+    const NfcTargetTransmitOptions* options,
+    NfcTargetTransmitBatchFunc complete,
+    GDestroyNotify destroy,
+    void* user_data); /* Since 1.0.34 */
+
 gboolean
 nfc_target_cancel_transmit(
     NfcTarget* target,
@@ -63,6 +63,13 @@ typedef struct nfc_target_class {
      * Reactivation isn't cancellable, it either succeeds or fails. */
     gboolean (*reactivate)(NfcTarget* target);  /* Since 1.0.27 */
 
+    /* Optional zero-copy version of transmit. If it's provided, it's
+     * used instead of transmit. The implementation needs to hold a
+     * reference to the data if it needs it after returning. When
+     * transmission completes, nfc_target_transmit_done() or
+     * nfc_target_transmit_done_bytes() is called. Since 1.0.34 */
+    gboolean (*transmit_bytes)(NfcTarget* target, GBytes* data);
+
     /* Padding for future expansion */
     void (*_reserved1)(void);
     void (*_reserved2)(void);
@@ -72,7 +79,6 @@ typedef struct nfc_target_class {
     void (*_reserved6)(void);
     void (*_reserved7)(void);
     void (*_reserved8)(void);
-    void (*_reserved9)(void);
 } NfcTargetClass;
 
 #define NFC_TARGET_CLASS(klass) G_TYPE_CHECK_CLASS_CAST((klass), \
@@ -85,10 +91,43 @@ nfc_target_transmit_done(
     const void* data,
     guint len);
 
+/* Allows passing the response up the stack without copying it */
+void
+nfc_target_transmit_done_bytes(
+    NfcTarget* target,
+    NFC_TRANSMIT_STATUS status,
+    GBytes* data); /* Since 1.0.34 */
+
 void
 nfc_target_reactivated(
     NfcTarget* target); /* Since 1.0.27 */
 
+/*
+ * By default, transmit timeout is fixed at 500 ms. Setting min_ms below
+ * max_ms lets it adapt to the measured round-trip times, within these
+ * bounds. That works best if requests are submitted with the RTT class
+ * (see NfcTargetTransmitOptions) grouping the commands which take
+ * similar time. Until anything has been measured, 500 ms (or max_ms,
+ * whichever is less) is used. Zero max_ms selects the default, zero
+ * min_ms makes the timeout fixed.
+ */
+void
+nfc_target_set_transmit_timeout(
+    NfcTarget* target,
+    guint min_ms,
+    guint max_ms); /* Since 1.0.34 */
+
+/*
+ * Largest response (payload bytes, excluding CRC) the adapter can
+ * receive in a single frame. Bulk read commands are sized not to
+ * exceed it. Zero (the default) means unknown, in which case a
+ * conservative size is assumed.
+ */
+void
+nfc_target_set_max_response_size(
+    NfcTarget* target,
+    guint size); /* Since 1.0.34 */
+
 void
 nfc_target_gone(
     NfcTarget* target);
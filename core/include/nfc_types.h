@@ -97,7 +97,8 @@ typedef enum nfc_transmit_status {
     NFC_TRANSMIT_STATUS_ERROR,     /* Generic error */
     NFC_TRANSMIT_STATUS_NACK,      /* NACK received */
     NFC_TRANSMIT_STATUS_CORRUPTED, /* CRC mismatch etc. */
-    NFC_TRANSMIT_STATUS_TIMEOUT    /* No response from NFCC */
+    NFC_TRANSMIT_STATUS_TIMEOUT,   /* No response from NFCC */
+    NFC_TRANSMIT_STATUS_EXPIRED    /* Deadline passed, not sent (1.0.34) */
 } NFC_TRANSMIT_STATUS;
 
 /* RF technology specific parameters */
@@ -36,6 +36,8 @@
 #include "nfc_adapter_p.h"
 #include "nfc_tag_p.h"
 #include "nfc_tag_t4_p.h"
+#include "nfc_tag_t2.h"
+#include "nfc_target_p.h"
 #include "nfc_log.h"
 
 #include <gutil_misc.h>
@@ -44,15 +46,23 @@
 
 #define NFC_TAG_NAME_FORMAT "tag%u"
 
+/* Random single-size NFCID1 starts with 0x08 (ISO/IEC 14443-3) */
+#define NFCID1_RANDOM_SIZE (4)
+#define NFCID1_RANDOM_PREFIX (0x08)
+
 typedef struct nfc_adapter_tag_entry {
+    NfcAdapter* adapter;
     NfcTag* tag;
     gulong gone_id;
+    gulong target_gone_id;  /* Non-zero if the tag is being held */
+    guint reattach_id;      /* Waiting for the tag to come back */
 } NfcAdapterTagEntry;
 
 struct nfc_adapter_priv {
     char* name;
     GHashTable* tags;
     guint next_tag_index;
+    guint reattach_ms;
     guint32 pending_signals;
     NFC_MODE mode_submitted;
     gboolean mode_pending;
@@ -263,11 +273,179 @@ nfc_adapter_tag_free(
 {
     NfcAdapterTagEntry* entry = data;
 
+    if (entry->reattach_id) {
+        g_source_remove(entry->reattach_id);
+    }
+    nfc_target_remove_handler(entry->tag->target, entry->target_gone_id);
     nfc_tag_remove_handler(entry->tag, entry->gone_id);
     nfc_tag_unref(entry->tag);
     g_slice_free(NfcAdapterTagEntry, entry);
 }
 
+/*==========================================================================*
+ * Reattaching tags which briefly left the field
+ *==========================================================================*/
+
+static
+gboolean
+nfc_adapter_tag_has_stable_id(
+    NfcTag* tag)
+{
+    const NfcParamPoll* param = nfc_tag_param(tag);
+
+    if (param) {
+        switch (tag->target->technology) {
+        case NFC_TECHNOLOGY_A:
+            return param->a.nfcid1.size &&
+                !(param->a.nfcid1.size == NFCID1_RANDOM_SIZE &&
+                param->a.nfcid1.bytes[0] == NFCID1_RANDOM_PREFIX);
+        case NFC_TECHNOLOGY_B:
+            return param->b.nfcid0.size > 0;
+        case NFC_TECHNOLOGY_F:
+        case NFC_TECHNOLOGY_UNKNOWN:
+            break;
+        }
+    }
+    return FALSE;
+}
+
+static
+gboolean
+nfc_adapter_tag_matches(
+    NfcTag* tag,
+    GType type,
+    NfcTarget* target,
+    const NfcParamPoll* poll)
+{
+    const NfcParamPoll* param = nfc_tag_param(tag);
+
+    if (param && G_TYPE_FROM_INSTANCE(tag) == type &&
+        tag->target->technology == target->technology) {
+        switch (target->technology) {
+        case NFC_TECHNOLOGY_A:
+            return param->a.sel_res == poll->a.sel_res &&
+                gutil_data_equal(&param->a.nfcid1, &poll->a.nfcid1);
+        case NFC_TECHNOLOGY_B:
+            return param->b.fsc == poll->b.fsc &&
+                gutil_data_equal(&param->b.nfcid0, &poll->b.nfcid0);
+        case NFC_TECHNOLOGY_F:
+        case NFC_TECHNOLOGY_UNKNOWN:
+            break;
+        }
+    }
+    return FALSE;
+}
+
+static
+void
+nfc_adapter_tag_release(
+    NfcAdapterTagEntry* entry)
+{
+    NfcTag* tag = entry->tag;
+
+    if (entry->reattach_id) {
+        g_source_remove(entry->reattach_id);
+        entry->reattach_id = 0;
+    }
+    nfc_target_remove_handler(tag->target, entry->target_gone_id);
+    entry->target_gone_id = 0;
+
+    /* This may emit the gone signal and remove the entry */
+    nfc_tag_set_hold(tag, FALSE);
+}
+
+static
+gboolean
+nfc_adapter_tag_reattach_timeout(
+    gpointer data)
+{
+    NfcAdapterTagEntry* entry = data;
+
+    GDEBUG("%s didn't come back", entry->tag->name);
+    entry->reattach_id = 0;
+    nfc_adapter_tag_release(entry);
+    return G_SOURCE_REMOVE;
+}
+
+static
+void
+nfc_adapter_tag_target_gone(
+    NfcTarget* target,
+    void* data)
+{
+    NfcAdapterTagEntry* entry = data;
+    NfcAdapterPriv* priv = entry->adapter->priv;
+    NfcTag* tag = entry->tag;
+
+    /* Only initialized tags are worth waiting for */
+    if (priv->reattach_ms && (tag->flags & NFC_TAG_FLAG_INITIALIZED) &&
+        nfc_adapter_tag_has_stable_id(tag)) {
+        GDEBUG("Waiting %u ms for %s to come back", priv->reattach_ms,
+            tag->name);
+        entry->reattach_id = g_timeout_add(priv->reattach_ms,
+            nfc_adapter_tag_reattach_timeout, entry);
+    } else {
+        nfc_adapter_tag_release(entry);
+    }
+}
+
+static
+void
+nfc_adapter_tag_hold(
+    NfcAdapterTagEntry* entry)
+{
+    NfcTag* tag = entry->tag;
+
+    nfc_tag_set_hold(tag, TRUE);
+    entry->target_gone_id = nfc_target_add_gone_handler(tag->target,
+        nfc_adapter_tag_target_gone, entry);
+}
+
+/* Returns the existing tag if it has been reattached to the target */
+static
+NfcTag*
+nfc_adapter_reattach_tag(
+    NfcAdapter* self,
+    GType type,
+    NfcTarget* target,
+    const NfcParamPoll* poll)
+{
+    NfcAdapterPriv* priv = self->priv;
+
+    if (priv->reattach_ms && target && poll) {
+        NfcAdapterTagEntry* found = NULL;
+        GHashTableIter iter;
+        gpointer value;
+
+        g_hash_table_iter_init(&iter, priv->tags);
+        while (g_hash_table_iter_next(&iter, NULL, &value)) {
+            NfcAdapterTagEntry* entry = value;
+
+            if (entry->reattach_id && nfc_adapter_tag_matches(entry->tag,
+                type, target, poll)) {
+                found = entry;
+                break;
+            }
+        }
+
+        if (found) {
+            NfcTag* tag = found->tag;
+
+            g_source_remove(found->reattach_id);
+            found->reattach_id = 0;
+            nfc_target_remove_handler(tag->target, found->target_gone_id);
+            found->target_gone_id = 0;
+            if (nfc_tag_reattach(tag, target)) {
+                nfc_adapter_tag_hold(found);
+                return tag;
+            }
+            /* The old tag is gone for good */
+            nfc_adapter_tag_release(found);
+        }
+    }
+    return NULL;
+}
+
 static
 void
 nfc_adapter_tag_gone(
@@ -299,9 +477,14 @@ nfc_adapter_add_tag(
 
         GASSERT(!tag->name);
         nfc_tag_set_name(tag, name);
+        memset(entry, 0, sizeof(*entry));
+        entry->adapter = self;
         entry->tag = tag;
         entry->gone_id = nfc_tag_add_gone_handler(tag, nfc_adapter_tag_gone,
             self);
+        if (priv->reattach_ms) {
+            nfc_adapter_tag_hold(entry);
+        }
         g_hash_table_insert(priv->tags, name, entry);
         g_free(self->tags);
         self->tags = nfc_adapter_tags(priv);
@@ -398,8 +581,14 @@ nfc_adapter_add_tag_t2(
     const NfcTagParamT2* params)
 {
     if (G_LIKELY(self)) {
-        NfcTagType2* t2 = nfc_tag_t2_new(target, params);
+        NfcTag* tag = nfc_adapter_reattach_tag(self, NFC_TYPE_TAG_T2, target,
+            (const NfcParamPoll*)params);
+        NfcTagType2* t2;
 
+        if (tag) {
+            return tag;
+        }
+        t2 = nfc_tag_t2_new(target, params);
         if (t2) {
             return nfc_adapter_add_tag(self, NFC_TAG(t2));
         }
@@ -415,8 +604,14 @@ nfc_adapter_add_tag_t4a(
     const NfcParamIsoDepPollA* iso_dep_param) /* Since 1.0.20 */
 {
     if (G_LIKELY(self) && G_LIKELY(target)) {
-        NfcTagType4a* t4a = nfc_tag_t4a_new(target, tech_param, iso_dep_param);
+        NfcTag* tag = nfc_adapter_reattach_tag(self, NFC_TYPE_TAG_T4A, target,
+            (const NfcParamPoll*)tech_param);
+        NfcTagType4a* t4a;
 
+        if (tag) {
+            return tag;
+        }
+        t4a = nfc_tag_t4a_new(target, tech_param, iso_dep_param);
         if (t4a) {
             return nfc_adapter_add_tag(self, NFC_TAG(t4a));
         }
@@ -432,8 +627,14 @@ nfc_adapter_add_tag_t4b(
     const NfcParamIsoDepPollB* iso_dep_param) /* Since 1.0.20 */
 {
     if (G_LIKELY(self) && G_LIKELY(target)) {
-        NfcTagType4b* t4b = nfc_tag_t4b_new(target, tech_param, iso_dep_param);
+        NfcTag* tag = nfc_adapter_reattach_tag(self, NFC_TYPE_TAG_T4B, target,
+            (const NfcParamPoll*)tech_param);
+        NfcTagType4b* t4b;
 
+        if (tag) {
+            return tag;
+        }
+        t4b = nfc_tag_t4b_new(target, tech_param, iso_dep_param);
         if (t4b) {
             return nfc_adapter_add_tag(self, NFC_TAG(t4b));
         }
@@ -456,8 +657,13 @@ nfc_adapter_add_other_tag2(
     const NfcParamPoll* poll) /* Since 1.0.33 */
 {
     if (G_LIKELY(self)) {
-        NfcTag* tag = nfc_tag_new(target, poll);
+        NfcTag* tag = nfc_adapter_reattach_tag(self, NFC_TYPE_TAG, target,
+            poll);
 
+        if (tag) {
+            return tag;
+        }
+        tag = nfc_tag_new(target, poll);
         if (tag) {
             return nfc_adapter_add_tag(self, tag);
         }
@@ -490,6 +696,16 @@ nfc_adapter_remove_tag(
     }
 }
 
+void
+nfc_adapter_set_reattach_window(
+    NfcAdapter* self,
+    guint ms) /* Since 1.0.34 */
+{
+    if (G_LIKELY(self)) {
+        self->priv->reattach_ms = ms;
+    }
+}
+
 gulong
 nfc_adapter_add_target_presence_handler(
     NfcAdapter* self,
@@ -43,6 +43,8 @@
 struct nfc_tag_priv {
     char* name;
     gulong gone_id;
+    gboolean hold;
+    NFC_TAG_STAGE stage;
     NfcParamPoll* param;
 };
 
@@ -51,14 +53,28 @@ G_DEFINE_TYPE(NfcTag, nfc_tag, G_TYPE_OBJECT)
 enum nfc_tag_signal {
     SIGNAL_INITIALIZED,
     SIGNAL_GONE,
+    SIGNAL_REATTACHED,
+    SIGNAL_STAGE,
     SIGNAL_COUNT
 };
 
 #define SIGNAL_INITIALIZED_NAME "nfc-tag-initialized"
 #define SIGNAL_GONE_NAME        "nfc-tag-gone"
+#define SIGNAL_REATTACHED_NAME  "nfc-tag-reattached"
+#define SIGNAL_STAGE_NAME       "nfc-tag-stage"
 
 static guint nfc_tag_signals[SIGNAL_COUNT] = { 0 };
 
+/* Signal details, indexed by NFC_TAG_STAGE */
+static const char* const nfc_tag_stage_names[] = {
+    NULL,
+    "identified",
+    "ndef-located",
+    "ndef-parsed",
+    "cached"
+};
+static GQuark nfc_tag_stage_quarks[G_N_ELEMENTS(nfc_tag_stage_names)];
+
 static
 void
 nfc_tag_gone(
@@ -69,8 +85,12 @@ nfc_tag_gone(
 
     /* NfcTarget makes sure that this signal is only issued once */
     GASSERT(self->present);
-    self->present = FALSE;
-    g_signal_emit(self, nfc_tag_signals[SIGNAL_GONE], 0);
+    if (self->priv->hold) {
+        GDEBUG("%s target is gone, holding on to the tag", self->name);
+    } else {
+        self->present = FALSE;
+        g_signal_emit(self, nfc_tag_signals[SIGNAL_GONE], 0);
+    }
 }
 
 /*==========================================================================*
@@ -126,6 +146,43 @@ nfc_tag_deactivate(
     }
 }
 
+NFC_TAG_STAGE
+nfc_tag_stage(
+    NfcTag* self) /* Since 1.0.34 */
+{
+    return G_LIKELY(self) ? self->priv->stage : NFC_TAG_STAGE_NONE;
+}
+
+gulong
+nfc_tag_add_stage_handler(
+    NfcTag* self,
+    NFC_TAG_STAGE stage,
+    NfcTagFunc func,
+    void* user_data) /* Since 1.0.34 */
+{
+    if (G_LIKELY(self) && G_LIKELY(func) &&
+        stage > NFC_TAG_STAGE_NONE && stage <= NFC_TAG_STAGE_CACHED) {
+        char* signal = g_strconcat(SIGNAL_STAGE_NAME "::",
+            nfc_tag_stage_names[stage], NULL);
+        const gulong id = g_signal_connect(self, signal, G_CALLBACK(func),
+            user_data);
+
+        g_free(signal);
+        return id;
+    }
+    return 0;
+}
+
+gulong
+nfc_tag_add_reattached_handler(
+    NfcTag* self,
+    NfcTagFunc func,
+    void* user_data) /* Since 1.0.34 */
+{
+    return (G_LIKELY(self) && G_LIKELY(func)) ? g_signal_connect(self,
+        SIGNAL_REATTACHED_NAME, G_CALLBACK(func), user_data) : 0;
+}
+
 gulong
 nfc_tag_add_initialized_handler(
     NfcTag* self,
@@ -183,6 +240,8 @@ nfc_tag_init_base(
     self->present = target->present;
     self->target = nfc_target_ref(target);
     priv->gone_id = nfc_target_add_gone_handler(target, nfc_tag_gone, self);
+    /* Nobody can be listening yet, no need to emit anything */
+    priv->stage = NFC_TAG_STAGE_IDENTIFIED;
     if (poll) {
         const gsize aligned_size = G_ALIGN8(sizeof(*poll));
         const GUtilData* src;
@@ -233,20 +292,93 @@ nfc_tag_set_name(
     self->name = priv->name = g_strdup(name);
 }
 
+void
+nfc_tag_set_stage(
+    NfcTag* self,
+    NFC_TAG_STAGE stage)
+{
+    NfcTagPriv* priv = self->priv;
+
+    if (priv->stage < stage) {
+        /* Handlers may drop the last reference */
+        nfc_tag_ref(self);
+        while (priv->stage < stage) {
+            priv->stage++;
+            GDEBUG("%s stage %s", self->name,
+                nfc_tag_stage_names[priv->stage]);
+            g_signal_emit(self, nfc_tag_signals[SIGNAL_STAGE],
+                nfc_tag_stage_quarks[priv->stage]);
+        }
+        nfc_tag_unref(self);
+    }
+}
+
 void
 nfc_tag_set_initialized(
     NfcTag* self)
 {
+    nfc_tag_set_stage(self, NFC_TAG_STAGE_NDEF_PARSED);
     if (!(self->flags & NFC_TAG_FLAG_INITIALIZED)) {
         self->flags |= NFC_TAG_FLAG_INITIALIZED;
         g_signal_emit(self, nfc_tag_signals[SIGNAL_INITIALIZED], 0);
     }
 }
 
+void
+nfc_tag_set_hold(
+    NfcTag* self,
+    gboolean hold)
+{
+    NfcTagPriv* priv = self->priv;
+
+    priv->hold = hold;
+    if (!hold && self->present && !self->target->present) {
+        /* The target has left while we were holding the tag */
+        self->present = FALSE;
+        g_signal_emit(self, nfc_tag_signals[SIGNAL_GONE], 0);
+    }
+}
+
+gboolean
+nfc_tag_reattach(
+    NfcTag* self,
+    NfcTarget* target)
+{
+    GASSERT(self->present);
+    GASSERT(!self->target->present);
+    if (target->present && NFC_TAG_GET_CLASS(self)->reattach(self, target)) {
+        GDEBUG("%s has been reattached", self->name);
+        g_signal_emit(self, nfc_tag_signals[SIGNAL_REATTACHED], 0);
+        return TRUE;
+    }
+    return FALSE;
+}
+
 /*==========================================================================*
  * Internals
  *==========================================================================*/
 
+static
+gboolean
+nfc_tag_default_reattach(
+    NfcTag* self,
+    NfcTarget* target)
+{
+    NfcTagPriv* priv = self->priv;
+    NfcTarget* old = self->target;
+
+    /* Sequences can't be moved to another target */
+    if (old->sequence) {
+        GDEBUG("%s is busy, can't be reattached", self->name);
+        return FALSE;
+    }
+    nfc_target_remove_handler(old, priv->gone_id);
+    self->target = nfc_target_ref(target);
+    priv->gone_id = nfc_target_add_gone_handler(target, nfc_tag_gone, self);
+    nfc_target_unref(old);
+    return TRUE;
+}
+
 static
 void
 nfc_tag_init(
@@ -276,14 +408,28 @@ void
 nfc_tag_class_init(
     NfcTagClass* klass)
 {
+    int i;
+
     g_type_class_add_private(klass, sizeof(NfcTagPriv));
     G_OBJECT_CLASS(klass)->finalize = nfc_tag_finalize;
+    klass->reattach = nfc_tag_default_reattach;
     nfc_tag_signals[SIGNAL_INITIALIZED] =
         g_signal_new(SIGNAL_INITIALIZED_NAME, G_OBJECT_CLASS_TYPE(klass),
             G_SIGNAL_RUN_FIRST, 0, NULL, NULL, NULL, G_TYPE_NONE, 0);
     nfc_tag_signals[SIGNAL_GONE] =
         g_signal_new(SIGNAL_GONE_NAME, G_OBJECT_CLASS_TYPE(klass),
             G_SIGNAL_RUN_FIRST, 0, NULL, NULL, NULL, G_TYPE_NONE, 0);
+    nfc_tag_signals[SIGNAL_REATTACHED] =
+        g_signal_new(SIGNAL_REATTACHED_NAME, G_OBJECT_CLASS_TYPE(klass),
+            G_SIGNAL_RUN_FIRST, 0, NULL, NULL, NULL, G_TYPE_NONE, 0);
+    nfc_tag_signals[SIGNAL_STAGE] =
+        g_signal_new(SIGNAL_STAGE_NAME, G_OBJECT_CLASS_TYPE(klass),
+            G_SIGNAL_RUN_FIRST | G_SIGNAL_DETAILED, 0, NULL, NULL, NULL,
+            G_TYPE_NONE, 0);
+    for (i = NFC_TAG_STAGE_IDENTIFIED; i <= NFC_TAG_STAGE_CACHED; i++) {
+        nfc_tag_stage_quarks[i] =
+            g_quark_from_static_string(nfc_tag_stage_names[i]);
+    }
 }
 
 /*
@@ -39,8 +39,14 @@
 
 typedef struct nfc_tag_class {
     GObjectClass parent;
+    gboolean (*reattach)(NfcTag* tag, NfcTarget* target);
 } NfcTagClass;
 
+#define NFC_TAG_CLASS(klass) G_TYPE_CHECK_CLASS_CAST((klass), \
+        NFC_TYPE_TAG, NfcTagClass)
+#define NFC_TAG_GET_CLASS(obj) G_TYPE_INSTANCE_GET_CLASS((obj), \
+        NFC_TYPE_TAG, NfcTagClass)
+
 NfcTag*
 nfc_tag_new(
     NfcTarget* target,
@@ -66,11 +72,37 @@ nfc_tag_set_name(
     const char* name)
     NFCD_INTERNAL;
 
+/* Emits the stage signal for each stage passed on the way */
+void
+nfc_tag_set_stage(
+    NfcTag* tag,
+    NFC_TAG_STAGE stage)
+    NFCD_INTERNAL;
+
+/* Also advances the stage to at least NFC_TAG_STAGE_NDEF_PARSED */
 void
 nfc_tag_set_initialized(
     NfcTag* tag)
     NFCD_INTERNAL;
 
+/*
+ * A tag which is being held stays present when its target disappears.
+ * It can then be attached to another target (presumably, the same tag
+ * re-discovered after briefly leaving the field). If that doesn't
+ * happen, releasing the tag emits the gone signal.
+ */
+void
+nfc_tag_set_hold(
+    NfcTag* tag,
+    gboolean hold)
+    NFCD_INTERNAL;
+
+gboolean
+nfc_tag_reattach(
+    NfcTag* tag,
+    NfcTarget* target)
+    NFCD_INTERNAL;
+
 #endif /* NFC_TAG_PRIVATE_H */
 
 /*
@@ -34,7 +34,9 @@
 
 #include "nfc_tag_t2.h"
 #include "nfc_tag_p.h"
+#include "nfc_tag_t2_cache.h"
 #include "nfc_target_p.h"
+#include "nfc_target_impl.h"
 #include "nfc_ndef.h"
 #include "nfc_util.h"
 #include "nfc_tlv.h"
@@ -61,9 +63,131 @@
 #define NFC_TAG_T2_CMD_READ (0x30)
 #define NFC_TAG_T2_CMD_WRITE (0xa2)
 
+/* READ always returns 4 blocks */
+#define NFC_TAG_T2_READ_BLOCKS (4)
+
+/*
+ * NXP extension (NTAG21x, MIFARE Ultralight EV1 etc.) returning an
+ * arbitrary range of pages in one frame. The response size is limited
+ * by the reader's buffer, if the adapter doesn't tell us what it is,
+ * we stay on the safe side.
+ */
+#define NFC_TAG_T2_CMD_FAST_READ (0x3a)
+#define NFC_TAG_T2_FAST_READ_DEFAULT_SIZE (64)
+
+/*
+ * Even without GET_VERSION, FAST_READ support can be inferred from
+ * the data area size in the CC of an NXP tag. These sizes are only
+ * used by NTAG215, NTAG216 and NTAG I2C chips, all of which support
+ * FAST_READ. Smaller NTAG21x sizes are shared with older MIFARE
+ * Ultralight chips, which don't.
+ */
+static const guint8 nfc_tag_t2_fast_read_cc_sizes[] = { 0x3e, 0x6d, 0xea };
+
+/*
+ * GET_VERSION is another NXP extension. Tags which don't support it
+ * (e.g. MIFARE Ultralight C) NACK it and fall back to IDLE state, so
+ * it's only sent if enabled and the target can be reactivated afterwards.
+ */
+#define NFC_TAG_T2_CMD_GET_VERSION (0x60)
+#define NFC_TAG_T2_VERSION_SIZE (8)
+
+static gboolean nfc_tag_t2_get_version_enabled = FALSE;
+
+typedef struct nfc_tag_t2_chip {
+    const char* name;
+    guint8 type;            /* Product type */
+    guint8 subtype;         /* Product subtype */
+    guint8 major;           /* Major product version */
+    guint8 minor;           /* Minor product version */
+    guint8 storage;         /* Storage size */
+    guint total_blocks;
+    guint data_blocks;
+    guint config_block;
+    NFC_TAG_T2_FLAGS flags;
+} NfcTagType2Chip;
+
+/*
+ * Known NXP chips. The layout (all numbers in blocks, counting across
+ * sectors) is taken from the respective datasheets:
+ *
+ * NTAG210/212 (NTAG210_212 Rev. 3.2)
+ * NTAG213/215/216 (NTAG213_215_216 Rev. 3.2)
+ * MIFARE Ultralight EV1 (MF0ULX1 Rev. 3.2)
+ * NTAG I2C 1k/2k (NT3H1101_1201 Rev. 3.4)
+ * NTAG I2C plus 1k (NT3H2111_2211 Rev. 3.3)
+ */
+static const NfcTagType2Chip nfc_tag_t2_chips[] = {
+    { "NTAG210",  0x04, 0x01, 0x01, 0x00, 0x0b, 20, 12, 0x10,
+      NFC_TAG_T2_FLAG_FAST_READ },
+    { "NTAG212",  0x04, 0x01, 0x01, 0x00, 0x0e, 41, 32, 0x25,
+      NFC_TAG_T2_FLAG_FAST_READ },
+    { "NTAG213",  0x04, 0x02, 0x01, 0x00, 0x0f, 45, 36, 0x29,
+      NFC_TAG_T2_FLAG_FAST_READ },
+    { "NTAG215",  0x04, 0x02, 0x01, 0x00, 0x11, 135, 126, 0x83,
+      NFC_TAG_T2_FLAG_FAST_READ },
+    { "NTAG216",  0x04, 0x02, 0x01, 0x00, 0x13, 231, 222, 0xe3,
+      NFC_TAG_T2_FLAG_FAST_READ },
+    { "MF0UL11",  0x03, 0x01, 0x01, 0x00, 0x0b, 20, 12, 0x10,
+      NFC_TAG_T2_FLAG_FAST_READ },
+    { "MF0ULH11", 0x03, 0x02, 0x01, 0x00, 0x0b, 20, 12, 0x10,
+      NFC_TAG_T2_FLAG_FAST_READ },
+    { "MF0UL21",  0x03, 0x01, 0x01, 0x00, 0x0e, 41, 32, 0x25,
+      NFC_TAG_T2_FLAG_FAST_READ },
+    { "MF0ULH21", 0x03, 0x02, 0x01, 0x00, 0x0e, 41, 32, 0x25,
+      NFC_TAG_T2_FLAG_FAST_READ },
+    { "NT3H1101", 0x04, 0x05, 0x02, 0x01, 0x13, 234, 222, 0xe8,
+      NFC_TAG_T2_FLAG_FAST_READ },
+    { "NT3H1201", 0x04, 0x05, 0x02, 0x01, 0x15, 490, 476, 0x1e8,
+      NFC_TAG_T2_FLAG_FAST_READ },
+    { "NT3H2111", 0x04, 0x05, 0x02, 0x02, 0x13, 234, 222, 0xe8,
+      NFC_TAG_T2_FLAG_FAST_READ }
+};
+
+/*
+ * The memory of multi-sector tags is addressed in 256-block sectors,
+ * switched with SECTOR_SELECT.
+ *
+ * NFCForum-TS-DigitalProtocol-1.0
+ * Section 9.8 "SECTOR SELECT"
+ */
+#define NFC_TAG_T2_CMD_SECTOR_SELECT (0xc2)
+#define NFC_TAG_T2_SECTOR_BLOCKS (256)
+#define NFC_TAG_T2_SECTOR_UNKNOWN G_MAXUINT
+
+/*
+ * The second SECTOR_SELECT packet is acknowledged passively, i.e. the
+ * tag doesn't respond if it's happy with it. There's no point in waiting
+ * for the full transmit timeout.
+ */
+#define NFC_TAG_T2_SECTOR_SELECT_TIMEOUT_MS (20)
+
+/*
+ * Type 2 commands are few and each of them takes roughly the same time
+ * every time, so the transmit timeout can safely follow the measured
+ * round-trip times (down to this floor).
+ */
+#define NFC_TAG_T2_TIMEOUT_MIN_MS (50)
+
+/*
+ * READ and WRITE are idempotent, so multi-block operations resend
+ * them after transient RF errors rather than failing the whole thing.
+ * Raw reads and writes requested by the clients are not retried.
+ */
+static const NfcTargetRetryPolicy nfc_tag_t2_retry = {
+    2,  /* retries */
+    5,  /* delay_ms */
+    20, /* max_delay_ms */
+    NFC_TARGET_RETRY_STATUS(NFC_TRANSMIT_STATUS_CORRUPTED) |
+    NFC_TARGET_RETRY_STATUS(NFC_TRANSMIT_STATUS_NACK)
+};
+
 typedef struct nfc_tag_t2_cmd_data {
     NfcTagType2* t2;
-    NfcTagType2ReadFunc resp;
+    union nfc_tag_t2_cmd_resp {
+        NfcTagType2ReadFunc raw;
+        NfcTagType2ReadBytesFunc bytes;
+    } resp;
     GDestroyNotify destroy;
     void* user_data;
 } NfcTagType2Cmd;
@@ -86,12 +210,14 @@ typedef struct nfc_tag_t2_read_data {
 typedef struct nfc_tag_t2_write_data {
     NfcTagType2* t2;
     GBytes* bytes;
-    guint sector_number;
     guint offset;
     guint written;
+    guint skipped;
     guint cmd_id;
     guint seq_id;
+    guint complete_id;
     gulong start_id;
+    NFC_TAG_T2_WRITE_FLAGS flags;
     NfcTargetSequence* seq;
     union nfc_tag_t2_write_data_complete {
         GCallback cb;
@@ -102,22 +228,50 @@ typedef struct nfc_tag_t2_write_data {
     void* user_data;
 } NfcTagType2WriteData;
 
-typedef struct nfc_tag_t2_sector {
-    guint size;             /* Number of bytes in the sector */
-    guint8* bytes;          /* Sector's contents (not necessarily valid) */
-    guint8* valid;          /* One bit per block, 1 = cached, 0 = dirty */
-    GUtilData data;         /* Data portion of the sector */
-} NfcTagType2Sector;
+/*
+ * The image buffer is reference counted. GBytes returned by
+ * nfc_tag_t2_read_data_cached() point directly to the image and hold
+ * a reference to the buffer. If the image needs to be updated while
+ * the buffer is shared, it gets copied first.
+ */
+typedef struct nfc_tag_t2_image_buf {
+    gint ref_count;
+    gsize size;
+    guint8* data;
+} NfcTagType2ImageBuf;
 
+/*
+ * The whole chip (header and data area of all sectors) is cached as
+ * one contiguous image, sector after sector. Data area blocks are
+ * numbered across sectors, so data block N is image block
+ * NFC_TAG_T2_DATA_BLOCK0 + N, and image block N is block
+ * N % NFC_TAG_T2_SECTOR_BLOCKS of sector N / NFC_TAG_T2_SECTOR_BLOCKS.
+ */
 struct nfc_tag_t2_priv {
     NfcTargetSequence* init_seq;
     GHashTable* reads;
     GHashTable* writes;
-    GByteArray* cached_blocks;
     guint8 serial[4];
+    NfcTagType2ImageBuf* image_buf;
+    guint8* image;          /* Cached contents (not necessarily valid) */
+    guint8* valid;          /* One bit per block, 1 = cached, 0 = dirty */
+    guint image_blocks;     /* Header and data area */
     guint sector_count;
-    NfcTagType2Sector* sectors;
+    guint sector;           /* Currently selected sector */
+    guint sector_pending;   /* Number of queued SECTOR_SELECTs */
+    NfcTlvScanner init_tlv;
     guint init_id;
+    gboolean read_ahead;
+    NFC_TAG_T2_READ_AHEAD read_ahead_state;
+    guint read_ahead_id;
+    char* cache_key;        /* NULL if the cache is disabled */
+    GMappedFile* cache_map; /* Candidate image, until it's validated */
+    NfcTagType2CacheImage cache;
+    gboolean cache_stored;  /* The image file (probably) exists */
+    gboolean cache_dirty;   /* Image has changed since it was stored */
+    const NfcTagType2Chip* chip;
+    NfcTagType2Product product;
+    guint8 version[NFC_TAG_T2_VERSION_SIZE];
 };
 
 typedef struct nfc_tag_t2_class {
@@ -126,121 +280,309 @@ typedef struct nfc_tag_t2_class {
 
 G_DEFINE_TYPE(NfcTagType2, nfc_tag_t2, NFC_TYPE_TAG)
 
+enum nfc_tag_t2_signal {
+    SIGNAL_READ_AHEAD,
+    SIGNAL_COUNT
+};
+
+#define SIGNAL_READ_AHEAD_NAME "nfc-tag-t2-read-ahead"
+
+static guint nfc_tag_t2_signals[SIGNAL_COUNT] = { 0 };
+
+/*==========================================================================*
+ * Memory image
+ *==========================================================================*/
+
 static
-NfcTagType2Sector*
-nfc_tag_t2_data_block_to_sector(
-    NfcTagType2* self,
-    guint block,
-    guint* bno, /* block number relative to the start of sector */
-    gboolean* cached)
+NfcTagType2ImageBuf*
+nfc_tag_t2_image_buf_new(
+    gsize size,
+    const void* data)
 {
-    guint i;
-    guint sector_start = 0;
-    const guint block_size = self->block_size;
-    NfcTagType2Priv* priv = self->priv;
-
-    for (i = 0; i < priv->sector_count; i++) {
-        NfcTagType2Sector* sector = priv->sectors + i;
-        const GUtilData* data = &sector->data;
-        const guint data_blocks = data->size / block_size;
+    NfcTagType2ImageBuf* buf = g_slice_new(NfcTagType2ImageBuf);
 
-        if (block < (sector_start + data_blocks)) {
-            const guint header = data->bytes - sector->bytes;
-            const guint rel_block = block - sector_start + header / block_size;
+    g_atomic_int_set(&buf->ref_count, 1);
+    buf->size = size;
+    buf->data = data ? g_memdup(data, size) : g_malloc0(size);
+    return buf;
+}
 
-            if (bno) {
-                *bno = rel_block;
-            }
-            if (cached) {
-                const guint8 bit = (1 << (rel_block % 8));
+static
+void
+nfc_tag_t2_image_buf_unref(
+    gpointer user_data)
+{
+    NfcTagType2ImageBuf* buf = user_data;
 
-                *cached = ((sector->valid[rel_block / 8] & bit) != 0);
-            }
-            return sector;
-        }
-        sector_start += data_blocks;
+    if (g_atomic_int_dec_and_test(&buf->ref_count)) {
+        g_free(buf->data);
+        g_slice_free(NfcTagType2ImageBuf, buf);
     }
-    return NULL;
 }
 
 static
 void
-nfc_tag_t2_sector_init(
-    NfcTagType2Sector* sector,
-    guint block_size,
-    guint header_blocks,
-    guint data_blocks,
-    guint trailer_blocks)
+nfc_tag_t2_image_init(
+    NfcTagType2* self,
+    guint data_blocks)
+{
+    NfcTagType2Priv* priv = self->priv;
+    const guint total_blocks = NFC_TAG_T2_DATA_BLOCK0 + data_blocks;
+
+    priv->image_blocks = total_blocks;
+    priv->sector_count = (total_blocks + NFC_TAG_T2_SECTOR_BLOCKS - 1) /
+        NFC_TAG_T2_SECTOR_BLOCKS;
+    priv->image_buf = nfc_tag_t2_image_buf_new(total_blocks *
+        self->block_size, NULL);
+    priv->image = priv->image_buf->data;
+    priv->valid = g_malloc0((total_blocks + 7) / 8);
+}
+
+static
+const guint8*
+nfc_tag_t2_image_data(
+    NfcTagType2* self)
 {
-    const guint total_blocks = header_blocks + data_blocks + trailer_blocks;
+    return self->priv->image + NFC_TAG_T2_DATA_BLOCK0 * self->block_size;
+}
 
-    sector->size = total_blocks * block_size;
-    sector->bytes = g_malloc0(sector->size);
-    sector->valid = g_malloc0((total_blocks + 7) / 8);
-    sector->data.bytes = sector->bytes + (header_blocks * block_size);
-    sector->data.size = data_blocks * block_size;
+static
+gboolean
+nfc_tag_t2_image_cached(
+    NfcTagType2Priv* priv,
+    guint block)
+{
+    return block < priv->image_blocks &&
+        (priv->valid[block / 8] & (1 << (block % 8)));
 }
 
 static
-void
-nfc_tag_t2_sector_deinit(
-    NfcTagType2Sector* sector)
+gboolean
+nfc_tag_t2_image_complete(
+    NfcTagType2Priv* priv)
 {
-    g_free(sector->bytes);
-    g_free(sector->valid);
+    guint i;
+
+    for (i = 0; i < priv->image_blocks; i++) {
+        if (!nfc_tag_t2_image_cached(priv, i)) {
+            return FALSE;
+        }
+    }
+    return priv->image != NULL;
 }
 
 static
 void
-nfc_tag_t2_sector_set_data(
-    NfcTagType2Sector* sector,
-    guint block_size,
+nfc_tag_t2_image_set_data(
+    NfcTagType2* self,
     const guint8* bytes,
     guint block,
     guint num_blocks)
 {
-    const guint total_blocks = sector->size / block_size;
+    NfcTagType2Priv* priv = self->priv;
 
-    if (block < total_blocks) {
+    if (block < priv->image_blocks) {
+        const guint block_size = self->block_size;
         guint i;
 
-        if ((block + num_blocks) > total_blocks) {
-            num_blocks = total_blocks - block;
+        if ((block + num_blocks) > priv->image_blocks) {
+            num_blocks = priv->image_blocks - block;
+        }
+
+        /* Don't touch the data referenced by someone else */
+        if (g_atomic_int_get(&priv->image_buf->ref_count) > 1) {
+            NfcTagType2ImageBuf* buf = priv->image_buf;
+
+            priv->image_buf = nfc_tag_t2_image_buf_new(buf->size, buf->data);
+            priv->image = priv->image_buf->data;
+            nfc_tag_t2_image_buf_unref(buf);
         }
 
-        memcpy(sector->bytes + block * block_size, bytes,
+        memcpy(priv->image + block * block_size, bytes,
             num_blocks * block_size);
 
         /* Mark blocks as valid */
         for (i = 0; i < num_blocks; i++) {
-            sector->valid[(block + i) / 8] |= (1 << ((block + i) % 8));
+            priv->valid[(block + i) / 8] |= (1 << ((block + i) % 8));
         }
+        priv->cache_dirty = TRUE;
     }
 }
 
 static
 void
-nfc_tag_t2_sector_invalidate(
-    NfcTagType2Sector* sector,
-    guint block_size,
+nfc_tag_t2_image_invalidate(
+    NfcTagType2* self,
     guint block,
     guint num_blocks)
 {
 #pragma message("TODO: Invalidate and re-read NDEF")
-    const guint total_blocks = sector->size / block_size;
+    NfcTagType2Priv* priv = self->priv;
 
-    if (block < total_blocks) {
+    if (block < priv->image_blocks) {
         guint i;
 
-        if ((block + num_blocks) > total_blocks) {
-            num_blocks = total_blocks - block;
+        if ((block + num_blocks) > priv->image_blocks) {
+            num_blocks = priv->image_blocks - block;
         }
 
-        memset(sector->bytes + block, 0, num_blocks * block_size);
-
         /* Mark blocks as invalid */
         for (i = 0; i < num_blocks; i++) {
-            sector->valid[(block + i) / 8] &= ~(1 << ((block + i) % 8));
+            priv->valid[(block + i) / 8] &= ~(1 << ((block + i) % 8));
+        }
+
+        /* Whatever is stored on disk is no longer valid */
+        if (priv->cache_stored) {
+            nfc_tag_t2_cache_drop(priv->cache_key);
+            priv->cache_stored = FALSE;
+        }
+        priv->cache_dirty = TRUE;
+    }
+}
+
+/*==========================================================================*
+ * Persistent cache
+ *==========================================================================*/
+
+static
+void
+nfc_tag_t2_cache_close(
+    NfcTagType2* self)
+{
+    NfcTagType2Priv* priv = self->priv;
+
+    if (priv->cache_map) {
+        g_mapped_file_unref(priv->cache_map);
+        priv->cache_map = NULL;
+        memset(&priv->cache, 0, sizeof(priv->cache));
+    }
+}
+
+static
+void
+nfc_tag_t2_cache_discard(
+    NfcTagType2* self)
+{
+    NfcTagType2Priv* priv = self->priv;
+
+    GDEBUG("Cached image is out of date");
+    nfc_tag_t2_cache_close(self);
+    nfc_tag_t2_cache_drop(priv->cache_key);
+    priv->cache_stored = FALSE;
+}
+
+static
+gboolean
+nfc_tag_t2_cache_tlv_complete(
+    NfcTagType2* self,
+    const NfcTagType2CacheImage* cache)
+{
+    const guint block_size = self->block_size;
+    guint block = NFC_TAG_T2_DATA_BLOCK0;
+    NfcTlvScanner tlv;
+
+    /* The entire TLV sequence must be cached */
+    nfc_tlv_scanner_init(&tlv, self->data_size);
+    while (nfc_tag_t2_cache_block_valid(cache, block) &&
+        nfc_tlv_scanner_feed(&tlv, cache->data + block * block_size,
+        block_size) == NFC_TLV_SCAN_NEED_MORE) {
+        block++;
+    }
+    return tlv.result == NFC_TLV_SCAN_COMPLETE;
+}
+
+static
+void
+nfc_tag_t2_cache_open(
+    NfcTagType2* self,
+    const guint8* header)
+{
+    NfcTagType2Priv* priv = self->priv;
+    const guint header_size = NFC_TAG_T2_DATA_BLOCK0 * self->block_size;
+
+    /* The header has been validated and copied to the image */
+    priv->cache_key = nfc_tag_t2_cache_key(&self->nfcid1, header + 4,
+        header + 12);
+    priv->cache_map = nfc_tag_t2_cache_load(priv->cache_key, &priv->cache);
+    if (priv->cache_map) {
+        const NfcTagType2CacheImage* cache = &priv->cache;
+        guint i;
+
+        priv->cache_stored = TRUE;
+        if (cache->block_size == self->block_size &&
+            cache->blocks == priv->image_blocks &&
+            !memcmp(cache->data, header, header_size)) {
+            for (i = 0; i < NFC_TAG_T2_DATA_BLOCK0 &&
+                 nfc_tag_t2_cache_block_valid(cache, i); i++);
+            if (i == NFC_TAG_T2_DATA_BLOCK0 &&
+                nfc_tag_t2_cache_tlv_complete(self, cache)) {
+                GDEBUG("Found cached image");
+                return;
+            }
+        }
+        nfc_tag_t2_cache_discard(self);
+    }
+}
+
+/*
+ * Compares freshly received blocks with the cached image. If they
+ * match, the rest of the image is taken from the cache. Either way,
+ * the candidate image gets released.
+ */
+static
+gboolean
+nfc_tag_t2_cache_apply(
+    NfcTagType2* self,
+    guint block,
+    guint num_blocks)
+{
+    NfcTagType2Priv* priv = self->priv;
+    const NfcTagType2CacheImage* cache = &priv->cache;
+    const guint block_size = self->block_size;
+    const guint end = block + num_blocks;
+    guint i;
+
+    for (i = block; i < end; i++) {
+        if (nfc_tag_t2_cache_block_valid(cache, i) &&
+            memcmp(priv->image + i * block_size, cache->data +
+            i * block_size, block_size)) {
+            nfc_tag_t2_cache_discard(self);
+            return FALSE;
+        }
+    }
+
+    GDEBUG("Using cached image");
+    for (i = 0; i < cache->blocks; i++) {
+        if (nfc_tag_t2_cache_block_valid(cache, i) &&
+            !nfc_tag_t2_image_cached(priv, i)) {
+            nfc_tag_t2_image_set_data(self, cache->data + i * block_size,
+                i, 1);
+        }
+    }
+    nfc_tag_t2_cache_close(self);
+    priv->cache_dirty = FALSE;
+    return TRUE;
+}
+
+static
+void
+nfc_tag_t2_cache_store(
+    NfcTagType2* self)
+{
+    NfcTagType2Priv* priv = self->priv;
+
+    /* Only store the image of a fully initialized tag */
+    if (priv->cache_key && priv->cache_dirty && !priv->cache_map &&
+        !priv->init_seq && priv->image) {
+        NfcTagType2CacheImage image;
+
+        image.block_size = self->block_size;
+        image.blocks = priv->image_blocks;
+        image.valid = priv->valid;
+        image.data = priv->image;
+        if (nfc_tag_t2_cache_save(priv->cache_key, &image)) {
+            priv->cache_stored = TRUE;
+            priv->cache_dirty = FALSE;
         }
     }
 }
@@ -272,7 +614,16 @@ void
 nfc_tag_t2_cmd_destroy(
     void* data)
 {
-    g_slice_free(NfcTagType2Cmd, data);
+    NfcTagType2Cmd* cmd = data;
+    GDestroyNotify destroy = cmd->destroy;
+    void* user_data = cmd->user_data;
+
+    nfc_target_pool_delete(cmd->t2->tag.target, NfcTagType2Cmd, cmd);
+
+    /* The destroy callback may drop the last reference to the tag */
+    if (destroy) {
+        destroy(user_data);
+    }
 }
 
 static
@@ -286,7 +637,36 @@ nfc_tag_t2_cmd_resp(
 {
     NfcTagType2Cmd* cmd = user_data;
 
-    cmd->resp(cmd->t2, status, data, len, cmd->user_data);
+    cmd->resp.raw(cmd->t2, status, data, len, cmd->user_data);
+}
+
+static
+void
+nfc_tag_t2_cmd_resp_bytes(
+    NfcTarget* target,
+    NFC_TRANSMIT_STATUS status,
+    GBytes* data,
+    void* user_data)
+{
+    NfcTagType2Cmd* cmd = user_data;
+
+    cmd->resp.bytes(cmd->t2, status, data, cmd->user_data);
+}
+
+static
+NfcTagType2Cmd*
+nfc_tag_t2_cmd_new(
+    NfcTagType2* self,
+    GDestroyNotify destroy,
+    void* user_data)
+{
+    NfcTagType2Cmd* cmd = nfc_target_pool_new0(self->tag.target,
+        NfcTagType2Cmd);
+
+    cmd->t2 = self;
+    cmd->destroy = destroy;
+    cmd->user_data = user_data;
+    return cmd;
 }
 
 static
@@ -296,77 +676,428 @@ nfc_tag_t2_cmd(
     const void* cmd,
     guint size,
     NfcTargetSequence* seq,
+    const NfcTargetRetryPolicy* retry,
     NfcTagType2ReadFunc resp,
     GDestroyNotify destroy,
     void* user_data)
 {
     NfcTag* tag = &self->tag;
-    NfcTagType2Cmd* data = g_slice_new(NfcTagType2Cmd);
+    NfcTagType2Cmd* data = nfc_tag_t2_cmd_new(self, destroy, user_data);
+    NfcTargetTransmitOptions opt = NFC_TARGET_TRANSMIT_OPTIONS_INIT;
     guint id;
 
-    data->t2 = self;
-    data->resp = resp;
-    data->destroy = destroy;
-    data->user_data = user_data;
-
-    id = nfc_target_transmit(tag->target, cmd, size, seq,
+    opt.retry = retry;
+    opt.rtt_class = NFC_TARGET_RTT_CLASS(((const guint8*)cmd)[0]);
+    data->resp.raw = resp;
+    id = nfc_target_transmit_full(tag->target, cmd, size, seq, &opt,
         resp ? nfc_tag_t2_cmd_resp : NULL, nfc_tag_t2_cmd_destroy, data);
     if (id) {
         return id;
     } else {
-        g_slice_free(NfcTagType2Cmd, data);
+        nfc_target_pool_delete(tag->target, NfcTagType2Cmd, data);
         return 0;
     }
 }
 
+typedef struct nfc_tag_t2_sector_select {
+    NfcTagType2* t2;
+    guint sector;
+    guint packet2_id;
+    guint cmd_id;           /* Request depending on this SECTOR_SELECT */
+    gboolean failed;
+} NfcTagType2SectorSelect;
+
+static
+void
+nfc_tag_t2_sector_select_free(
+    void* user_data)
+{
+    NfcTagType2SectorSelect* select = user_data;
+    NfcTagType2* t2 = select->t2;
+    NfcTagType2Priv* priv = t2->priv;
+
+    GASSERT(priv->sector_pending);
+    priv->sector_pending--;
+    nfc_target_pool_delete(t2->tag.target, NfcTagType2SectorSelect, select);
+    nfc_tag_unref(&t2->tag);
+}
+
+static
+void
+nfc_tag_t2_sector_select_resp1(
+    NfcTarget* target,
+    NFC_TRANSMIT_STATUS status,
+    const void* data,
+    guint len,
+    void* user_data)
+{
+    NfcTagType2SectorSelect* select = user_data;
+
+    if (status != NFC_TRANSMIT_STATUS_OK) {
+        GDEBUG("Sector %u can't be selected", select->sector);
+        select->failed = TRUE;
+        /* Packet 2 fails the dependent request and frees the context */
+        nfc_target_fail_transmit(target, select->packet2_id);
+    }
+}
+
+static
+void
+nfc_tag_t2_sector_select_resp2(
+    NfcTarget* target,
+    NFC_TRANSMIT_STATUS status,
+    const void* data,
+    guint len,
+    void* user_data)
+{
+    NfcTagType2SectorSelect* select = user_data;
+    NfcTagType2Priv* priv = select->t2->priv;
+
+    /*
+     * The tag acknowledges the second packet passively, i.e. by not
+     * responding at all. Only explicit NACK means failure.
+     */
+    if (select->failed || status == NFC_TRANSMIT_STATUS_NACK) {
+        GDEBUG("Failed to select sector %u", select->sector);
+        priv->sector = NFC_TAG_T2_SECTOR_UNKNOWN;
+
+        /* Don't let the request hit the wrong sector */
+        nfc_target_fail_transmit(target, select->cmd_id);
+    } else {
+        GDEBUG("Sector %u selected", select->sector);
+        priv->sector = select->sector;
+    }
+}
+
+/*
+ * Makes sure that the sector containing the specified block gets
+ * selected before the next request of the sequence is transmitted.
+ * SECTOR_SELECT is skipped only if we know which sector is selected
+ * and nothing else can run on the target before our request, i.e. we
+ * are either in the middle of our own sequence or the target is idle.
+ * Only this code sends SECTOR_SELECT and reactivation resets the tag
+ * to sector 0, so the last selected sector stays valid in between.
+ *
+ * If SECTOR_SELECT is queued and the caller didn't provide a sequence,
+ * a temporary one is created. The caller is expected to pass the id of
+ * the request which depends on the sector to nfc_tag_t2_cmd_sector_bind
+ * so that the request fails (rather than hits the wrong sector) if
+ * SECTOR_SELECT fails. Returns FALSE if SECTOR_SELECT can't be sent.
+ */
+static
+gboolean
+nfc_tag_t2_cmd_sector(
+    NfcTagType2* self,
+    guint block,
+    NfcTargetSequence** seq,
+    NfcTargetSequence** tmp_seq,
+    NfcTagType2SectorSelect** select_out)
+{
+    NfcTagType2Priv* priv = self->priv;
+    NfcTarget* target = self->tag.target;
+    const guint sector = block / NFC_TAG_T2_SECTOR_BLOCKS;
+
+    *tmp_seq = NULL;
+    *select_out = NULL;
+    if (priv->sector_count > 1 && (priv->sector_pending ||
+        priv->sector != sector || !(*seq ? (*seq == target->sequence) :
+        nfc_target_idle(target)))) {
+        static const guint8 packet1[] = {
+            NFC_TAG_T2_CMD_SECTOR_SELECT, 0xff
+        };
+        guint8 packet2[4];
+        NfcTargetTransmitOptions opt = NFC_TARGET_TRANSMIT_OPTIONS_INIT;
+        NfcTagType2SectorSelect* select;
+        guint packet1_id;
+
+        if (!*seq) {
+            *seq = *tmp_seq = nfc_target_sequence_new(target);
+        }
+
+        /* Packet 1 is ACKed, packet 2 is not */
+        packet2[0] = (guint8)sector;
+        packet2[1] = packet2[2] = packet2[3] = 0;
+        select = nfc_target_pool_new0(target, NfcTagType2SectorSelect);
+        select->t2 = NFC_TAG_T2(nfc_tag_ref(&self->tag));
+        select->sector = sector;
+        priv->sector_pending++;
+        opt.rtt_class = NFC_TARGET_RTT_CLASS(NFC_TAG_T2_CMD_SECTOR_SELECT);
+        packet1_id = nfc_target_transmit_full(target, packet1,
+            sizeof(packet1), *seq, &opt, nfc_tag_t2_sector_select_resp1,
+            NULL, select);
+        if (packet1_id) {
+            select->packet2_id = nfc_target_transmit_with_timeout(target,
+                packet2, sizeof(packet2), *seq,
+                NFC_TAG_T2_SECTOR_SELECT_TIMEOUT_MS,
+                nfc_tag_t2_sector_select_resp2,
+                nfc_tag_t2_sector_select_free, select);
+            if (select->packet2_id) {
+                *select_out = select;
+                return TRUE;
+            }
+            nfc_target_cancel_transmit(target, packet1_id);
+        }
+        nfc_tag_t2_sector_select_free(select);
+        priv->sector = NFC_TAG_T2_SECTOR_UNKNOWN;
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static
+void
+nfc_tag_t2_cmd_sector_bind(
+    NfcTagType2SectorSelect* select,
+    guint cmd_id)
+{
+    if (select) {
+        select->cmd_id = cmd_id;
+    }
+}
+
+/* Number of blocks from the specified one till the end of its sector */
 static
 guint
-nfc_tag_t2_cmd_read(
+nfc_tag_t2_sector_blocks_left(
+    guint block)
+{
+    return NFC_TAG_T2_SECTOR_BLOCKS - block % NFC_TAG_T2_SECTOR_BLOCKS;
+}
+
+/* Block numbers passed to nfc_tag_t2_cmd_xxx count across sectors */
+static
+gboolean
+nfc_tag_t2_cmd_block_ok(
+    NfcTagType2* self,
+    guint block)
+{
+    return (block / NFC_TAG_T2_SECTOR_BLOCKS) <
+        MAX(self->priv->sector_count, 1);
+}
+
+static
+guint
+nfc_tag_t2_cmd_read_retry(
     NfcTagType2* self,
     guint block,
     NfcTargetSequence* seq,
+    const NfcTargetRetryPolicy* retry,
     NfcTagType2ReadFunc resp,
     GDestroyNotify done,
     void* user_data)
 {
-    if (block <= 0xff) {
+    if (nfc_tag_t2_cmd_block_ok(self, block)) {
+        NfcTagType2SectorSelect* select;
+        NfcTargetSequence* tmp_seq;
         guint8 cmd[2];
+        guint id = 0;
+
         /*
          * NFCForum-TS-DigitalProtocol-1.0
          * Section 9 "Type 2 Tag Platform"
          * 9.6 READ
          */
-        cmd[0] = NFC_TAG_T2_CMD_READ;
-        cmd[1] = block;
-        return nfc_tag_t2_cmd(self, cmd, 2, seq, resp, done, user_data);
+        if (nfc_tag_t2_cmd_sector(self, block, &seq, &tmp_seq, &select)) {
+            cmd[0] = NFC_TAG_T2_CMD_READ;
+            cmd[1] = block % NFC_TAG_T2_SECTOR_BLOCKS;
+            id = nfc_tag_t2_cmd(self, cmd, 2, seq, retry, resp, done,
+                user_data);
+            nfc_tag_t2_cmd_sector_bind(select, id);
+        }
+        nfc_target_sequence_unref(tmp_seq);
+        return id;
     }
     return 0;
 }
 
 static
 guint
-nfc_tag_t2_cmd_write(
+nfc_tag_t2_cmd_read(
     NfcTagType2* self,
     guint block,
-    const guint8* data,
     NfcTargetSequence* seq,
     NfcTagType2ReadFunc resp,
     GDestroyNotify done,
     void* user_data)
 {
-    if (block <= 0xff) {
-        guint8 cmd[2 + NFC_TAG_T2_MAX_BLOCK_SIZE];
+    return nfc_tag_t2_cmd_read_retry(self, block, seq, &nfc_tag_t2_retry,
+        resp, done, user_data);
+}
 
-        /*
+static
+guint
+nfc_tag_t2_fast_read_max_blocks(
+    NfcTagType2* self)
+{
+    const guint max = nfc_target_max_response_size(self->tag.target);
+
+    return (max ? max : NFC_TAG_T2_FAST_READ_DEFAULT_SIZE) / self->block_size;
+}
+
+/* Maximum number of useful blocks returned by a single read command */
+static
+guint
+nfc_tag_t2_read_max_blocks(
+    NfcTagType2* self,
+    guint block)
+{
+    const guint left = nfc_tag_t2_sector_blocks_left(block);
+
+    if (self->t2flags & NFC_TAG_T2_FLAG_FAST_READ) {
+        const guint max = MIN(nfc_tag_t2_fast_read_max_blocks(self), left);
+
+        if (max > NFC_TAG_T2_READ_BLOCKS) {
+            return max;
+        }
+    }
+    return MIN(NFC_TAG_T2_READ_BLOCKS, left);
+}
+
+/*
+ * Reads up to count blocks starting with the specified one. FAST_READ
+ * is used if the tag supports it and more than READ would return is
+ * requested. The caller makes sure that the range doesn't extend past
+ * the end of memory, FAST_READ never crosses the sector boundary. Note
+ * that READ may still return more data than requested (wrapping around
+ * at the end of sector).
+ */
+static
+guint
+nfc_tag_t2_cmd_read_blocks(
+    NfcTagType2* self,
+    guint block,
+    guint count,
+    NfcTargetSequence* seq,
+    NfcTagType2ReadFunc resp,
+    GDestroyNotify done,
+    void* user_data)
+{
+    if (count > NFC_TAG_T2_READ_BLOCKS &&
+        nfc_tag_t2_cmd_block_ok(self, block)) {
+        const guint max = nfc_tag_t2_read_max_blocks(self, block);
+
+        if (count > max) {
+            count = max;
+        }
+        if (count > NFC_TAG_T2_READ_BLOCKS) {
+            NfcTagType2SectorSelect* select;
+            NfcTargetSequence* tmp_seq;
+            guint8 cmd[3];
+            guint id = 0;
+
+            /*
+             * NTAG213/215/216 datasheet
+             * Section 10.3 "FAST_READ"
+             */
+            if (nfc_tag_t2_cmd_sector(self, block, &seq, &tmp_seq,
+                &select)) {
+                cmd[0] = NFC_TAG_T2_CMD_FAST_READ;
+                cmd[1] = block % NFC_TAG_T2_SECTOR_BLOCKS;
+                cmd[2] = cmd[1] + count - 1;    /* End page (inclusive) */
+                id = nfc_tag_t2_cmd(self, cmd, sizeof(cmd), seq,
+                    &nfc_tag_t2_retry, resp, done, user_data);
+                nfc_tag_t2_cmd_sector_bind(select, id);
+            }
+            nfc_target_sequence_unref(tmp_seq);
+            return id;
+        }
+    }
+    return nfc_tag_t2_cmd_read(self, block, seq, resp, done, user_data);
+}
+
+static
+guint
+nfc_tag_t2_cmd_read_bytes(
+    NfcTagType2* self,
+    guint block,
+    NfcTargetSequence* seq,
+    NfcTagType2ReadBytesFunc resp,
+    GDestroyNotify destroy,
+    void* user_data)
+{
+    NfcTagType2SectorSelect* select;
+    NfcTargetSequence* tmp_seq;
+
+    if (nfc_tag_t2_cmd_block_ok(self, block) &&
+        nfc_tag_t2_cmd_sector(self, block, &seq, &tmp_seq, &select)) {
+        NfcTag* tag = &self->tag;
+        NfcTagType2Cmd* data = nfc_tag_t2_cmd_new(self, destroy, user_data);
+        NfcTargetTransmitOptions opt = NFC_TARGET_TRANSMIT_OPTIONS_INIT;
+        GBytes* cmd;
+        guint8 buf[2];
+        guint id;
+
+        /* Same as nfc_tag_t2_cmd_read but the response isn't copied */
+        buf[0] = NFC_TAG_T2_CMD_READ;
+        buf[1] = block % NFC_TAG_T2_SECTOR_BLOCKS;
+        cmd = g_bytes_new(buf, sizeof(buf));
+        data->resp.bytes = resp;
+        opt.rtt_class = NFC_TARGET_RTT_CLASS(NFC_TAG_T2_CMD_READ);
+        id = nfc_target_transmit_bytes_full(tag->target, cmd, seq, &opt,
+            resp ? nfc_tag_t2_cmd_resp_bytes : NULL,
+            nfc_tag_t2_cmd_destroy, data);
+        g_bytes_unref(cmd);
+        nfc_target_sequence_unref(tmp_seq);
+        nfc_tag_t2_cmd_sector_bind(select, id);
+        if (id) {
+            return id;
+        }
+        nfc_target_pool_delete(tag->target, NfcTagType2Cmd, data);
+    }
+    return 0;
+}
+
+static
+GBytes*
+nfc_tag_t2_cmd_write_frame(
+    NfcTagType2* self,
+    guint block,
+    const guint8* data)
+{
+    guint8 cmd[2 + NFC_TAG_T2_MAX_BLOCK_SIZE];
+
+    /*
+     * Same as nfc_tag_t2_cmd_write, block number is relative to the
+     * sector and is checked by the caller.
+     */
+    cmd[0] = NFC_TAG_T2_CMD_WRITE;
+    cmd[1] = block;
+    memcpy(cmd + 2, data, self->block_size);
+    return g_bytes_new(cmd, self->block_size + 2);
+}
+
+static
+guint
+nfc_tag_t2_cmd_write(
+    NfcTagType2* self,
+    guint block,
+    const guint8* data,
+    NfcTargetSequence* seq,
+    NfcTagType2ReadFunc resp,
+    GDestroyNotify done,
+    void* user_data)
+{
+    if (nfc_tag_t2_cmd_block_ok(self, block)) {
+        NfcTagType2SectorSelect* select;
+        NfcTargetSequence* tmp_seq;
+        guint8 cmd[2 + NFC_TAG_T2_MAX_BLOCK_SIZE];
+        guint id = 0;
+
+        /*
          * NFCForum-TS-DigitalProtocol-1.0
          * Section 9 "Type 2 Tag Platform"
          * 9.7 WRITE
          */
-        cmd[0] = NFC_TAG_T2_CMD_WRITE;
-        cmd[1] = block;
-        memcpy(cmd + 2, data, self->block_size);
-        return nfc_tag_t2_cmd(self, cmd, self->block_size + 2, seq,
-            resp, done, user_data);
+        if (nfc_tag_t2_cmd_sector(self, block, &seq, &tmp_seq, &select)) {
+            cmd[0] = NFC_TAG_T2_CMD_WRITE;
+            cmd[1] = block % NFC_TAG_T2_SECTOR_BLOCKS;
+            memcpy(cmd + 2, data, self->block_size);
+            id = nfc_tag_t2_cmd(self, cmd, self->block_size + 2, seq,
+                &nfc_tag_t2_retry, resp, done, user_data);
+            nfc_tag_t2_cmd_sector_bind(select, id);
+        }
+        nfc_target_sequence_unref(tmp_seq);
+        return id;
     }
     return 0;
 }
@@ -381,17 +1112,22 @@ nfc_tag_t2_read_data_free(
     gpointer user_data)
 {
     NfcTagType2ReadData* read = user_data;
+    NfcTarget* target = read->t2->tag.target;
+    GDestroyNotify destroy = read->destroy;
 
     nfc_target_sequence_unref(read->seq);
-    nfc_target_cancel_transmit(read->t2->tag.target, read->cmd_id);
-    if (read->destroy) {
-        read->destroy(read->user_data);
-    }
+    nfc_target_cancel_transmit(target, read->cmd_id);
     if (read->complete_id) {
         g_source_remove(read->complete_id);
     }
     g_free(read->buffer);
-    g_slice_free(NfcTagType2ReadData, read);
+    user_data = read->user_data;
+    nfc_target_pool_delete(target, NfcTagType2ReadData, read);
+
+    /* The destroy callback may drop the last reference to the tag */
+    if (destroy) {
+        destroy(user_data);
+    }
 }
 
 static
@@ -417,6 +1153,92 @@ nfc_tag_t2_read_complete(
     return G_SOURCE_REMOVE;
 }
 
+/*
+ * Returns the number of blocks to read starting with the specified
+ * (uncached) one. Holes separated by cached blocks are merged as long
+ * as they fit into a single read command, the cached blocks in between
+ * cost nothing but a few bytes. The end block is exclusive.
+ */
+static
+guint
+nfc_tag_t2_read_count(
+    NfcTagType2* self,
+    guint start,
+    guint end)
+{
+    NfcTagType2Priv* priv = self->priv;
+    const guint last = MIN(end, start + nfc_tag_t2_read_max_blocks(self,
+        start));
+    guint i, count = 1;
+
+    for (i = start + 1; i < last; i++) {
+        if (!nfc_tag_t2_image_cached(priv, i)) {
+            count = i - start + 1;
+        }
+    }
+    return count;
+}
+
+/*
+ * Copies the cached part of the requested range to the buffer, up to
+ * the first block which isn't cached. Returns TRUE if there's still
+ * something to read.
+ */
+static
+gboolean
+nfc_tag_t2_read_data_copy_cached(
+    NfcTagType2ReadData* read)
+{
+    NfcTagType2* t2 = read->t2;
+    NfcTagType2Priv* priv = t2->priv;
+    const guint block_size = t2->block_size;
+    const guint8* data = nfc_tag_t2_image_data(t2);
+
+    while (read->read < read->size) {
+        const guint pos = read->offset + read->read;
+        const guint n = MIN(block_size - pos % block_size,
+            read->size - read->read);
+
+        if (!nfc_tag_t2_image_cached(priv, NFC_TAG_T2_DATA_BLOCK0 +
+            pos / block_size)) {
+            return TRUE;
+        }
+        memcpy(read->buffer + read->read, data + pos, n);
+        read->read += n;
+    }
+    return FALSE;
+}
+
+static
+void
+nfc_tag_t2_read_resp(
+    NfcTagType2* t2,
+    NFC_TRANSMIT_STATUS status,
+    const void* data,
+    guint len,
+    void* user_data);
+
+/*
+ * Reads the next uncached run of blocks. The rest gets copied from
+ * the cache when the response arrives.
+ */
+static
+guint
+nfc_tag_t2_read_data_submit(
+    NfcTagType2ReadData* read)
+{
+    NfcTagType2* t2 = read->t2;
+    const guint block_size = t2->block_size;
+    const guint start = NFC_TAG_T2_DATA_BLOCK0 +
+        (read->offset + read->read) / block_size;
+    const guint end = NFC_TAG_T2_DATA_BLOCK0 +
+        (read->offset + read->size + block_size - 1) / block_size;
+
+    return (read->cmd_id = nfc_tag_t2_cmd_read_blocks(t2, start,
+        nfc_tag_t2_read_count(t2, start, end), read->seq,
+        nfc_tag_t2_read_resp, NULL, read));
+}
+
 static
 void
 nfc_tag_t2_read_resp(
@@ -435,27 +1257,17 @@ nfc_tag_t2_read_resp(
     nfc_tag_ref(tag);
     if (status == NFC_TRANSMIT_STATUS_OK && len > 0) {
         const guint block_size = t2->block_size;
-        const guint8* bytes = data;
-        guint rel_block;
-        NfcTagType2Sector* sector = nfc_tag_t2_data_block_to_sector(t2,
-            (read->offset + read->read) / block_size, &rel_block, NULL);
-
-        if (sector) {
-            const guint nb = len / block_size;
-            const guint offset = (read->offset + read->read) % block_size;
-
-            nfc_tag_t2_sector_set_data(sector, block_size, bytes,
-                rel_block, nb);
-            if (len > (read->size - read->read)) {
-                len = read->size - read->read;
-            }
-            memcpy(read->buffer + read->read, bytes + offset, len);
-            read->read += len;
-            if (read->read < read->size) {
-                /* Submit the next read */
-                read->cmd_id = nfc_tag_t2_cmd_read(t2, rel_block + nb,
-                    read->seq, nfc_tag_t2_read_resp, NULL, read);
-            }
+        const guint block = NFC_TAG_T2_DATA_BLOCK0 +
+            (read->offset + read->read) / block_size;
+        /* READ wraps around at the end of sector, ignore that part */
+        const guint nb = MIN(len / block_size,
+            nfc_tag_t2_sector_blocks_left(block));
+
+        /* Received blocks go to the cache and from there to the buffer */
+        nfc_tag_t2_image_set_data(t2, data, block, nb);
+        if (nfc_tag_t2_read_data_copy_cached(read) && nb) {
+            /* Submit the next read */
+            nfc_tag_t2_read_data_submit(read);
         }
     } else {
         GDEBUG("Oops, read failed!");
@@ -472,6 +1284,169 @@ nfc_tag_t2_read_resp(
     nfc_tag_unref(tag);
 }
 
+/*==========================================================================*
+ * Read-ahead
+ *==========================================================================*/
+
+static
+void
+nfc_tag_t2_read_ahead_set_state(
+    NfcTagType2* self,
+    NFC_TAG_T2_READ_AHEAD state)
+{
+    NfcTagType2Priv* priv = self->priv;
+
+    if (priv->read_ahead_state != state) {
+        priv->read_ahead_state = state;
+        g_signal_emit(self, nfc_tag_t2_signals[SIGNAL_READ_AHEAD], 0);
+        if (state == NFC_TAG_T2_READ_AHEAD_DONE &&
+            (self->tag.flags & NFC_TAG_FLAG_INITIALIZED)) {
+            nfc_tag_set_stage(&self->tag, NFC_TAG_STAGE_CACHED);
+        }
+    }
+}
+
+static
+void
+nfc_tag_t2_read_ahead_next(
+    NfcTagType2* self,
+    guint block);
+
+static
+void
+nfc_tag_t2_read_ahead_resp(
+    NfcTagType2* self,
+    NFC_TRANSMIT_STATUS status,
+    const void* data,
+    guint len,
+    void* user_data)
+{
+    NfcTagType2Priv* priv = self->priv;
+    const guint block = GPOINTER_TO_UINT(user_data);
+    const guint nb = MIN(len / self->block_size,
+        nfc_tag_t2_sector_blocks_left(block));
+
+    priv->read_ahead_id = 0;
+    if (status == NFC_TRANSMIT_STATUS_OK && nb) {
+        nfc_tag_t2_image_set_data(self, data, block, nb);
+        nfc_tag_t2_read_ahead_next(self, block + nb);
+    } else {
+        GDEBUG("Read-ahead failed at block %u", block);
+        nfc_tag_t2_read_ahead_set_state(self, NFC_TAG_T2_READ_AHEAD_STOPPED);
+    }
+}
+
+/*
+ * Each read is a separate low priority sequence (which also covers
+ * SECTOR_SELECT if one is needed) so that anything else submitted
+ * in the meantime gets ahead of the next chunk.
+ */
+static
+void
+nfc_tag_t2_read_ahead_next(
+    NfcTagType2* self,
+    guint block)
+{
+    NfcTagType2Priv* priv = self->priv;
+    const guint end = priv->image_blocks;
+
+    while (block < end && nfc_tag_t2_image_cached(priv, block)) {
+        block++;
+    }
+    if (block < end) {
+        NfcTargetSequence* seq = nfc_target_sequence_new2(self->tag.target,
+            NFC_TARGET_PRIORITY_BULK);
+
+        priv->read_ahead_id = nfc_tag_t2_cmd_read_blocks(self, block,
+            nfc_tag_t2_read_count(self, block, end), seq,
+            nfc_tag_t2_read_ahead_resp, NULL, GUINT_TO_POINTER(block));
+        nfc_target_sequence_unref(seq);
+        if (priv->read_ahead_id) {
+            nfc_tag_t2_read_ahead_set_state(self,
+                NFC_TAG_T2_READ_AHEAD_ACTIVE);
+        } else {
+            nfc_tag_t2_read_ahead_set_state(self,
+                NFC_TAG_T2_READ_AHEAD_STOPPED);
+        }
+    } else {
+        GDEBUG("Tag memory is fully cached");
+        nfc_tag_t2_read_ahead_set_state(self, NFC_TAG_T2_READ_AHEAD_DONE);
+    }
+}
+
+static
+void
+nfc_tag_t2_read_ahead_start(
+    NfcTagType2* self)
+{
+    NfcTagType2Priv* priv = self->priv;
+
+    /* The image gets allocated during initialization */
+    if (priv->read_ahead && priv->image && !priv->init_seq &&
+        self->tag.present &&
+        priv->read_ahead_state == NFC_TAG_T2_READ_AHEAD_OFF) {
+        nfc_tag_t2_read_ahead_next(self, NFC_TAG_T2_DATA_BLOCK0);
+    }
+}
+
+static
+void
+nfc_tag_t2_read_ahead_stop(
+    NfcTagType2* self,
+    NFC_TAG_T2_READ_AHEAD state)
+{
+    NfcTagType2Priv* priv = self->priv;
+
+    if (priv->read_ahead_id) {
+        nfc_target_cancel_transmit(self->tag.target, priv->read_ahead_id);
+        priv->read_ahead_id = 0;
+    }
+    if (priv->read_ahead_state == NFC_TAG_T2_READ_AHEAD_ACTIVE) {
+        nfc_tag_t2_read_ahead_set_state(self, state);
+    }
+}
+
+static
+void
+nfc_tag_t2_gone(
+    NfcTag* tag,
+    void* user_data)
+{
+    NfcTagType2* self = NFC_TAG_T2(tag);
+
+    nfc_tag_t2_read_ahead_stop(self, NFC_TAG_T2_READ_AHEAD_STOPPED);
+    nfc_tag_t2_cache_store(self);
+}
+
+static
+gboolean
+nfc_tag_t2_reattach(
+    NfcTag* tag,
+    NfcTarget* target)
+{
+    NfcTagType2* self = NFC_TAG_T2(tag);
+    NfcTagType2Priv* priv = self->priv;
+
+    if (priv->sector_pending) {
+        GDEBUG("%s is selecting sector", tag->name);
+        return FALSE;
+    }
+
+    /* Requests to the old target are failing anyway */
+    nfc_tag_t2_read_ahead_stop(self, NFC_TAG_T2_READ_AHEAD_OFF);
+    if (priv->read_ahead_state == NFC_TAG_T2_READ_AHEAD_STOPPED) {
+        nfc_tag_t2_read_ahead_set_state(self, NFC_TAG_T2_READ_AHEAD_OFF);
+    }
+    if (NFC_TAG_CLASS(nfc_tag_t2_parent_class)->reattach(tag, target)) {
+        /* Freshly activated tag has sector 0 selected */
+        priv->sector = 0;
+        nfc_target_set_transmit_timeout(target, NFC_TAG_T2_TIMEOUT_MIN_MS, 0);
+        nfc_tag_t2_read_ahead_start(self);
+        return TRUE;
+    }
+    return FALSE;
+}
+
 /*==========================================================================*
  * Write
  *==========================================================================*/
@@ -485,6 +1460,15 @@ nfc_tag_t2_write_data_resp(
     guint len,
     void* user_data);
 
+static
+void
+nfc_tag_t2_write_data_fetch_resp(
+    NfcTagType2* t2,
+    NFC_TRANSMIT_STATUS status,
+    const void* data,
+    guint len,
+    void* user_data);
+
 static
 void
 nfc_tag_t2_write_data_free(
@@ -492,22 +1476,30 @@ nfc_tag_t2_write_data_free(
 {
     NfcTagType2WriteData* write = data;
     NfcTarget* target = write->t2->tag.target;
+    GDestroyNotify destroy;
+    void* user_data;
 
     nfc_target_remove_handler(target, write->start_id);
     nfc_target_sequence_unref(write->seq);
     nfc_target_cancel_transmit(target, write->cmd_id);
-    if (write->destroy) {
-        write->destroy(write->user_data);
+    if (write->complete_id) {
+        g_source_remove(write->complete_id);
     }
+    destroy = write->destroy;
+    user_data = write->user_data;
     g_bytes_unref(write->bytes);
-    g_slice_free(NfcTagType2WriteData, write);
+    nfc_target_pool_delete(target, NfcTagType2WriteData, write);
+
+    /* The destroy callback may drop the last reference to the tag */
+    if (destroy) {
+        destroy(user_data);
+    }
 }
 
 static
 NfcTagType2WriteData*
 nfc_tag_t2_write_data_new(
     NfcTagType2* self,
-    guint sector_number,
     guint offset,
     GBytes* bytes,
     NfcTargetSequence* seq,
@@ -516,12 +1508,12 @@ nfc_tag_t2_write_data_new(
     void* user_data)
 {
     NfcTagType2Priv* priv = self->priv;
-    NfcTagType2WriteData* write = g_slice_new0(NfcTagType2WriteData);
+    NfcTagType2WriteData* write = nfc_target_pool_new0(self->tag.target,
+        NfcTagType2WriteData);
 
     write->t2 = self;
     write->bytes = g_bytes_ref(bytes);
     write->offset = offset;
-    write->sector_number = sector_number;
     write->seq = seq ? nfc_target_sequence_ref(seq) :
         nfc_target_sequence_new(self->tag.target);
     write->seq_id = nfc_tag_t2_generate_id(self);
@@ -533,87 +1525,184 @@ nfc_tag_t2_write_data_new(
         priv->writes = g_hash_table_new_full(g_direct_hash, g_direct_equal,
             NULL, nfc_tag_t2_write_data_free);
     }
-    g_hash_table_insert(priv->writes, GUINT_TO_POINTER(write->seq_id), write);
-    return write;
+    g_hash_table_insert(priv->writes, GUINT_TO_POINTER(write->seq_id), write);
+    return write;
+}
+
+static
+void
+nfc_tag_t2_write_data_error(
+    NfcTagType2WriteData* write)
+{
+    NfcTagType2* t2 = write->t2;
+    NfcTagType2Priv* priv = t2->priv;
+    NfcTagType2WriteDataFunc complete = write->complete.write_data_cb;
+
+    GDEBUG("Wrote %u bytes out of %u", write->written, (guint)
+        g_bytes_get_size(write->bytes));
+    if (complete) {
+        write->complete.write_cb = NULL;
+        complete(write->t2, NFC_TAG_T2_IO_STATUS_IO_ERROR, write->written,
+            write->user_data);
+    }
+    g_hash_table_remove(priv->writes, GUINT_TO_POINTER(write->seq_id));
+}
+
+static
+void
+nfc_tag_t2_write_batch_resp(
+    NfcTarget* target,
+    NFC_TRANSMIT_STATUS status,
+    GBytes* const* resp,
+    guint count,
+    void* user_data)
+{
+    NfcTagType2WriteData* write = user_data;
+    NfcTagType2* t2 = write->t2;
+    NfcTag* tag = &t2->tag;
+    NfcTagType2Priv* priv = t2->priv;
+    NfcTagType2WriteFunc complete = write->complete.write_cb;
+
+    write->cmd_id = 0;
+    write->written = count * t2->block_size;
+
+    nfc_tag_ref(tag);
+    if (status == NFC_TRANSMIT_STATUS_OK) {
+        GDEBUG("Wrote %u byte(s)", write->written);
+    } else {
+        GDEBUG("Oops, write failed!");
+    }
+    if (complete) {
+        write->complete.write_cb = NULL;
+        complete(t2, status, write->written, write->user_data);
+    }
+    g_hash_table_remove(priv->writes, GUINT_TO_POINTER(write->seq_id));
+    nfc_tag_unref(tag);
+}
+
+/*
+ * Submits the next WRITE (or READ if the current contents of the block
+ * is needed but isn't cached). With NFC_TAG_T2_WRITE_FLAG_DIFF, blocks
+ * which already contain the right data are skipped. Skipped bytes are
+ * counted as written. Returns FALSE if nothing has been submitted, i.e.
+ * the write is finished (or failed to submit the command).
+ */
+static
+gboolean
+nfc_tag_t2_write_data_step(
+    NfcTagType2WriteData* write)
+{
+    NfcTagType2* t2 = write->t2;
+    NfcTagType2Priv* priv = t2->priv;
+    const guint block_size = t2->block_size;
+    gsize total_size;
+    const guint8* data = g_bytes_get_data(write->bytes, &total_size);
+
+    GASSERT(!write->cmd_id);
+    while (write->written < total_size) {
+        const guint pos = write->offset + write->written;
+        const guint block = NFC_TAG_T2_DATA_BLOCK0 + pos / block_size;
+        const guint block_offset = pos % block_size;
+        const guint n = MIN(block_size - block_offset,
+            total_size - write->written);
+        const guint8* cached = priv->image + block * block_size;
+        guint8 b[NFC_TAG_T2_MAX_BLOCK_SIZE];
+
+        if (n < block_size || (write->flags & NFC_TAG_T2_WRITE_FLAG_DIFF)) {
+            if (!nfc_tag_t2_image_cached(priv, block)) {
+                /* Have to fetch it first */
+                write->cmd_id = nfc_tag_t2_cmd_read(t2, block, write->seq,
+                    nfc_tag_t2_write_data_fetch_resp, NULL, write);
+                return write->cmd_id != 0;
+            }
+
+            /* Mix the contents */
+            memcpy(b, cached, block_size);
+            memcpy(b + block_offset, data + write->written, n);
+            if ((write->flags & NFC_TAG_T2_WRITE_FLAG_DIFF) &&
+                !memcmp(b, cached, block_size)) {
+                GVERBOSE("Block %u is unchanged", block);
+                write->written += n;
+                write->skipped += n;
+                continue;
+            }
+        } else {
+            memcpy(b, data + write->written, block_size);
+        }
+
+        nfc_tag_t2_image_invalidate(t2, block, 1);
+        write->cmd_id = nfc_tag_t2_cmd_write(t2, block, b, write->seq,
+            nfc_tag_t2_write_data_resp, NULL, write);
+        return write->cmd_id != 0;
+    }
+    return FALSE;
+}
+
+static
+void
+nfc_tag_t2_write_data_finish(
+    NfcTagType2WriteData* write)
+{
+    gsize total_size;
+
+    g_bytes_get_data(write->bytes, &total_size);
+    if (write->written < total_size) {
+        nfc_tag_t2_write_data_error(write);
+    } else {
+        NfcTagType2* t2 = write->t2;
+        NfcTagType2WriteDataFunc complete = write->complete.write_data_cb;
+
+        if (write->skipped) {
+            GDEBUG("Wrote %u byte(s), %u unchanged", (guint)total_size,
+                write->skipped);
+        } else {
+            GDEBUG("Wrote %u byte(s)", (guint)total_size);
+        }
+        if (complete) {
+            write->complete.write_cb = NULL;
+            complete(t2, NFC_TAG_T2_IO_STATUS_OK, total_size,
+                write->user_data);
+        }
+        g_hash_table_remove(t2->priv->writes,
+            GUINT_TO_POINTER(write->seq_id));
+    }
 }
 
 static
 void
-nfc_tag_t2_write_data_error(
+nfc_tag_t2_write_data_next(
     NfcTagType2WriteData* write)
 {
-    NfcTagType2* t2 = write->t2;
-    NfcTagType2Priv* priv = t2->priv;
-    NfcTagType2WriteDataFunc complete = write->complete.write_data_cb;
-
-    GDEBUG("Wrote %u bytes out of %u", write->written, (guint)
-        g_bytes_get_size(write->bytes));
-    if (complete) {
-        write->complete.write_cb = NULL;
-        complete(write->t2, NFC_TAG_T2_IO_STATUS_IO_ERROR, write->written,
-            write->user_data);
+    if (!nfc_tag_t2_write_data_step(write)) {
+        nfc_tag_t2_write_data_finish(write);
     }
-    g_hash_table_remove(priv->writes, GUINT_TO_POINTER(write->seq_id));
 }
 
 static
-void
-nfc_tag_t2_write_resp(
-    NfcTagType2* t2,
-    NFC_TRANSMIT_STATUS status,
-    const void* resp,
-    guint len,
-    void* user_data)
+gboolean
+nfc_tag_t2_write_data_complete(
+    gpointer user_data)
 {
-    NfcTag* tag = &t2->tag;
     NfcTagType2WriteData* write = user_data;
-    NfcTagType2Priv* priv = t2->priv;
-    gsize total_size = 0;
-    const guint block_size = t2->block_size;
-    const guint8* data = g_bytes_get_data(write->bytes, &total_size);
-
-    write->cmd_id = 0;
-
-    /* Round total size down to the nearest block boundary.
-     * Offset is rounded too (see nfc_tag_t2_write) */
-    total_size -= total_size % block_size;
+    NfcTag* tag = &write->t2->tag;
 
+    write->complete_id = 0;
     nfc_tag_ref(tag);
-    if (status != NFC_TRANSMIT_STATUS_OK) {
-        NfcTagType2WriteFunc complete = write->complete.write_cb;
-
-        GDEBUG("Oops, write failed!");
-        if (complete) {
-            write->complete.write_cb = NULL;
-            complete(write->t2, status, write->written, write->user_data);
-        }
-        g_hash_table_remove(priv->writes, GUINT_TO_POINTER(write->seq_id));
-    } else if ((write->written + block_size) >= total_size) {
-        /* Last write succeeded */
-        guint written = write->written;
-        NfcTagType2WriteFunc complete = write->complete.write_cb;
-
-        written += block_size;
-        GDEBUG("Wrote %u byte(s)", written);
-        GASSERT(written == total_size);
-        if (complete) {
-            write->complete.write_cb = NULL;
-            complete(write->t2, status, written, write->user_data);
-        }
-        g_hash_table_remove(priv->writes, GUINT_TO_POINTER(write->seq_id));
-    } else {
-        /* Write the next block */
-        NfcTagType2Sector* sector = priv->sectors + write->sector_number;
-        guint next_block;
+    nfc_tag_t2_write_data_finish(write);
+    nfc_tag_unref(tag);
+    return G_SOURCE_REMOVE;
+}
 
-        write->written += block_size;
-        next_block = (write->offset + write->written)/block_size;
-        nfc_tag_t2_sector_invalidate(sector, block_size, next_block, 1);
-        write->cmd_id = nfc_tag_t2_cmd_write(t2, next_block,
-            data + write->written, write->seq, nfc_tag_t2_write_resp,
-            NULL, write);
+static
+void
+nfc_tag_t2_write_data_start(
+    NfcTagType2WriteData* write)
+{
+    if (!nfc_tag_t2_write_data_step(write)) {
+        /* Call completion on a fresh stack */
+        write->complete_id = g_idle_add(nfc_tag_t2_write_data_complete,
+            write);
     }
-    nfc_tag_unref(tag);
 }
 
 static
@@ -627,48 +1716,18 @@ nfc_tag_t2_write_data_fetch_resp(
 {
     NfcTagType2WriteData* write = user_data;
     NfcTag* tag = &t2->tag;
+    const guint block_size = t2->block_size;
+    const guint block = NFC_TAG_T2_DATA_BLOCK0 +
+        (write->offset + write->written) / block_size;
+    const guint nb = MIN(len / block_size,
+        nfc_tag_t2_sector_blocks_left(block));
 
     write->cmd_id = 0;
     nfc_tag_ref(tag);
-
-    if (status == NFC_TRANSMIT_STATUS_OK && len > 0) {
-        const guint block_size = t2->block_size;
-        const guint8* bytes = data;
-        const guint nb = len / block_size;
-        guint8 b[NFC_TAG_T2_MAX_BLOCK_SIZE];
-        guint next_block;
-        gsize write_size;
-        const guint8* write_data = g_bytes_get_data(write->bytes, &write_size);
-        NfcTagType2Sector* sector = nfc_tag_t2_data_block_to_sector(t2,
-            (write->offset + write->written) / block_size, &next_block, NULL);
-        /* Sector must be there, the initiator of fetch has checked that. */
-
-        nfc_tag_t2_sector_set_data(sector, block_size, bytes, next_block, nb);
-
-        /* Mix the contents */
-        if (!write->written) {
-            const guint block_offset = write->offset % block_size;
-
-            /* First block (and possibly the last one) */
-            GASSERT(block_offset);
-            GASSERT(!write->written);
-            memcpy(b, sector->data.bytes + (write->offset - block_offset),
-                block_size);
-            memcpy(b + block_offset, write_data, MIN(block_size - block_offset,
-                write_size));
-            write->cmd_id = nfc_tag_t2_cmd_write(t2, next_block, b,
-                write->seq, nfc_tag_t2_write_data_resp, NULL, write);
-        } else {
-            const guint remaining = write_size - write->written;
-
-            /* Last block */
-            GASSERT(remaining < block_size);
-            memcpy(b, write_data + write->written, remaining);
-            memcpy(b + remaining, sector->bytes + (next_block * block_size +
-                remaining), block_size - remaining);
-            write->cmd_id = nfc_tag_t2_cmd_write(t2, next_block, b,
-                write->seq, nfc_tag_t2_write_data_resp, NULL, write);
-        }
+    if (status == NFC_TRANSMIT_STATUS_OK && nb) {
+        /* Now the block is cached */
+        nfc_tag_t2_image_set_data(t2, data, block, nb);
+        nfc_tag_t2_write_data_next(write);
     } else {
         GDEBUG("Oops, fetch failed!");
         nfc_tag_t2_write_data_error(write);
@@ -686,117 +1745,31 @@ nfc_tag_t2_write_data_resp(
     void* user_data)
 {
     NfcTagType2WriteData* write = user_data;
-    NfcTagType2Priv* priv = t2->priv;
     NfcTag* tag = &t2->tag;
-    gsize total_size = 0;
-    const guint8* data = g_bytes_get_data(write->bytes, &total_size);
-    const guint block_size = t2->block_size;
-    const guint written = block_size - /* Adjust for first unaligned block */
-        (write->written + write->offset) % block_size;
 
     write->cmd_id = 0;
     nfc_tag_ref(tag);
-    if (status != NFC_TRANSMIT_STATUS_OK) {
+    if (status == NFC_TRANSMIT_STATUS_OK) {
+        const guint block_size = t2->block_size;
+        const guint block_offset = (write->offset + write->written) %
+            block_size;
+
+        /* Don't count more bytes than requested (even though we could
+         * have actually written more due to unaligned offset and/or
+         * size) */
+        write->written = MIN(write->written + block_size - block_offset,
+            g_bytes_get_size(write->bytes));
+        nfc_tag_t2_write_data_next(write);
+    } else {
         GDEBUG("Oops, write failed!");
         nfc_tag_t2_write_data_error(write);
-    } else if ((write->written + written) >= total_size) {
-        /* Last write succeeded */
-        guint total = write->written + written;
-        NfcTagType2WriteDataFunc complete = write->complete.write_data_cb;
-
-        if (total > total_size) {
-            /* Don't report more bytes written than requested (even
-             * though we could have actually written more due to
-             * unaligned offset and/or size) */
-            total = total_size;
-        }
-
-        GDEBUG("Wrote %u byte(s)", total);
-        if (complete) {
-            write->complete.write_cb = NULL;
-            complete(write->t2, NFC_TAG_T2_IO_STATUS_OK, total,
-                write->user_data);
-        }
-        g_hash_table_remove(priv->writes, GUINT_TO_POINTER(write->seq_id));
-    } else {
-        /* Write the next block */
-        guint remaining;
-        guint next_block;
-        gboolean next_block_cached;
-        NfcTagType2Sector* sector;
-
-        write->written += written;
-        remaining = total_size - write->written;
-        sector = nfc_tag_t2_data_block_to_sector(t2, (write->offset +
-            write->written) / block_size, &next_block, &next_block_cached);
-
-        nfc_tag_t2_sector_invalidate(sector, block_size, next_block, 1);
-        if (remaining < block_size) {
-            if (next_block_cached) {
-                guint8 b[NFC_TAG_T2_MAX_BLOCK_SIZE];
-
-                /* Mix the contents */
-                memcpy(b, data + write->written, remaining);
-                memcpy(b + remaining, sector->bytes +
-                    (next_block * block_size + remaining),
-                    block_size - remaining);
-                write->cmd_id = nfc_tag_t2_cmd_write(t2, next_block, b,
-                    write->seq, nfc_tag_t2_write_data_resp, NULL, write);
-            } else {
-                /* Have to fetch it first */
-                write->cmd_id = nfc_tag_t2_cmd_read(t2, next_block,
-                   write->seq, nfc_tag_t2_write_data_fetch_resp, NULL, write);
-            }
-        } else{
-            write->cmd_id = nfc_tag_t2_cmd_write(t2, next_block,
-                data + write->written, write->seq, nfc_tag_t2_write_data_resp,
-                NULL, write);
-        }
     }
     nfc_tag_unref(tag);
 }
 
 static
 void
-nfc_tag_t2_write_data_unaligned_start(
-    NfcTagType2WriteData* write)
-{
-    NfcTagType2* t2 = write->t2;
-    const guint block_size = t2->block_size;
-    const guint block_offset = write->offset % block_size;
-    gsize write_size;
-    const guint8* write_data = g_bytes_get_data(write->bytes, &write_size);
-    guint start_block;
-    gboolean start_block_cached;
-    NfcTagType2Sector* sector = nfc_tag_t2_data_block_to_sector(t2,
-        write->offset / block_size, &start_block, &start_block_cached);
-
-    GASSERT(block_offset);
-    GASSERT(!write->cmd_id);
-
-    /* For unaligned writes we have to first read the block that
-     * we are going to (partially) overwrite. */
-    nfc_tag_t2_sector_invalidate(sector, block_size, start_block, 1);
-    if (start_block_cached) {
-        guint8 b[NFC_TAG_T2_MAX_BLOCK_SIZE];
-
-        /* Mix the contents */
-        memcpy(b, sector->data.bytes + (write->offset - block_offset),
-            block_size);
-        memcpy(b + block_offset, write_data, MIN(block_size - block_offset,
-            write_size));
-        write->cmd_id = nfc_tag_t2_cmd_write(t2, start_block, b, write->seq,
-            nfc_tag_t2_write_data_resp, NULL, write);
-    } else {
-        /* Have to fetch it first */
-        write->cmd_id = nfc_tag_t2_cmd_read(t2, start_block, write->seq,
-            nfc_tag_t2_write_data_fetch_resp, NULL, write);
-    }
-}
-
-static
-void
-nfc_tag_t2_write_data_unaligned_wait(
+nfc_tag_t2_write_data_wait(
     NfcTarget* target,
     void* user_data)
 {
@@ -806,7 +1779,7 @@ nfc_tag_t2_write_data_unaligned_wait(
         GDEBUG("Starting write #%u", write->seq_id);
         nfc_target_remove_handler(target, write->start_id);
         write->start_id = 0;
-        nfc_tag_t2_write_data_unaligned_start(write);
+        nfc_tag_t2_write_data_start(write);
     }
 }
 
@@ -826,7 +1799,16 @@ nfc_tag_t2_initialized(
         nfc_target_sequence_unref(priv->init_seq);
         priv->init_seq = NULL;
     }
+    /* Drop the cached image if it hasn't been used */
+    nfc_tag_t2_cache_close(self);
+    /* Start read-ahead before announcing that we are initialized */
+    nfc_tag_t2_read_ahead_start(self);
+    nfc_tag_ref(tag);
     nfc_tag_set_initialized(tag);
+    if (nfc_tag_t2_image_complete(priv)) {
+        nfc_tag_set_stage(tag, NFC_TAG_STAGE_CACHED);
+    }
+    nfc_tag_unref(tag);
 }
 
 static
@@ -843,43 +1825,60 @@ nfc_tag_t2_init_read_resp(
 
     priv->init_id = 0;
     if (status == NFC_TRANSMIT_STATUS_OK) {
-        NfcTagType2Sector* sector = priv->sectors; /* sector 0 */
         const guint block_size = self->block_size;
-        const guint total_blocks = sector->size / block_size;
+        const guint total_blocks = priv->image_blocks;
         guint nb = len / block_size;
+        gboolean complete;
         GUtilData data;
 
-        /* Handle reads beyond the end of data */
+        /* Handle reads beyond the end of data or sector */
         GASSERT(!(len % block_size));
+        nb = MIN(nb, nfc_tag_t2_sector_blocks_left(block));
         if ((block + nb) > total_blocks) {
             nb = total_blocks - block;
         }
-        nfc_tag_t2_sector_set_data(sector, block_size, bytes, block, nb);
-        block += nb;
-        data.bytes = sector->data.bytes;
+        nfc_tag_t2_image_set_data(self, bytes, block, nb);
+        if (priv->cache_map && nfc_tag_t2_cache_apply(self, block, nb)) {
+            /* The whole TLV sequence is in the cache */
+            while (nfc_tag_t2_image_cached(priv, block)) {
+                block++;
+            }
+            complete = TRUE;
+        } else {
+            /* Stop reading when we have fetched the entire TLV sequence.
+             * That should be enough to parse the NDEF (if there's any)
+             * which all we really need in most cases. Only the newly
+             * received blocks are fed to the scanner. */
+            complete = nfc_tlv_scanner_feed(&priv->init_tlv, bytes,
+                nb * block_size) != NFC_TLV_SCAN_NEED_MORE;
+            block += nb;
+        }
+        data.bytes = nfc_tag_t2_image_data(self);
         data.size = (block - NFC_TAG_T2_DATA_BLOCK0) * block_size;
 
-        /* Stop reading when we have fetched the entire TLV sequence.
-         * That should be enough to parse the NDEF (if there's any)
-         * which all we really need in most cases. */
-        if ((block * block_size) < sector->size &&
-            len >= block_size && !nfc_tlv_check(&data)) {
+        if (!complete && block < total_blocks && len >= block_size) {
+            const guint need = (priv->init_tlv.need + block_size - 1) /
+                block_size;
+
+            GVERBOSE("TLV sequence needs %u more block(s)", need);
             /* Continue reading the data */
-            priv->init_id = nfc_tag_t2_cmd_read(self, block, priv->init_seq,
+            priv->init_id = nfc_tag_t2_cmd_read_blocks(self, block,
+                MIN(need, total_blocks - block), priv->init_seq,
                 nfc_tag_t2_init_read_resp, NULL, GUINT_TO_POINTER(block));
         } else {
             NfcTag* tag = &self->tag;
 
             GDEBUG("Tag data:");
             nfc_hexdump_data(&data);
-            if ((block * block_size) < sector->size) {
+            if (block < total_blocks) {
                 /* Inficate that data wasn't fully read */
                 gutil_log(&nfc_dump_log, GLOG_LEVEL_DEBUG, "  %04X: ...",
-                    block * block_size);
+                    (block - NFC_TAG_T2_DATA_BLOCK0) * block_size);
             }
 
             /* Find NDEF */
-            tag->ndef = nfc_ndef_rec_new_tlv(&sector->data);
+            data.size = self->data_size;
+            tag->ndef = nfc_ndef_rec_new_tlv(&data);
             nfc_tag_t2_initialized(self);
         }
     } else {
@@ -888,6 +1887,24 @@ nfc_tag_t2_init_read_resp(
     }
 }
 
+static
+gboolean
+nfc_tag_t2_cc_fast_read(
+    NfcTagType2* self,
+    guint8 size)
+{
+    if (self->tag.type == NFC_TAG_TYPE_MIFARE_ULTRALIGHT) {
+        guint i;
+
+        for (i = 0; i < G_N_ELEMENTS(nfc_tag_t2_fast_read_cc_sizes); i++) {
+            if (nfc_tag_t2_fast_read_cc_sizes[i] == size) {
+                return TRUE;
+            }
+        }
+    }
+    return FALSE;
+}
+
 static
 void
 nfc_tag_t2_control_area_read_resp(
@@ -900,7 +1917,7 @@ nfc_tag_t2_control_area_read_resp(
     NfcTagType2Priv* priv = self->priv;
 
     priv->init_id = 0;
-    if (status == NFC_TRANSMIT_STATUS_OK && len == 16) {
+    if (status == NFC_TRANSMIT_STATUS_OK && len >= 16) {
         const guint8* bytes = data;
         const guint8* serial = bytes + 4;
         const guint8* cc = bytes + 12;
@@ -921,26 +1938,43 @@ nfc_tag_t2_control_area_read_resp(
 
         if (cc[0] == NFC_TAG_T2_CC_NFC_FORUM_MAGIC &&
             cc[1] >= NFC_TAG_T2_CC_MIN_VERSION) {
-            NfcTagType2Sector* sector0;
-
             self->data_size = cc[2] * 8;
             GDEBUG("Data size: %u bytes", self->data_size);
-            /* Allocate sector descriptors (only one sector for now) */
-            priv->sector_count = 1;
-            priv->sectors = g_new0(NfcTagType2Sector, priv->sector_count);
-
-            sector0 = priv->sectors;
-            nfc_tag_t2_sector_init(sector0, self->block_size,
-                NFC_TAG_T2_DATA_BLOCK0, self->data_size / self->block_size, 0);
-            nfc_tag_t2_sector_set_data(sector0, self->block_size, data, 0,
-                len / self->block_size);
+            if (!priv->chip && nfc_tag_t2_cc_fast_read(self, cc[2])) {
+                GDEBUG("Assuming FAST_READ support");
+                self->t2flags |= NFC_TAG_T2_FLAG_FAST_READ;
+            }
+            /* Allocate the memory image (all sectors) */
+            nfc_tag_t2_image_init(self, self->data_size / self->block_size);
+            nfc_tag_t2_image_set_data(self, data, 0, NFC_TAG_T2_DATA_BLOCK0);
+            if (priv->sector_count > 1) {
+                GDEBUG("%u sectors", priv->sector_count);
+            }
 
             /* We can already mark it as NFC Forum compatible */
             self->t2flags |= NFC_TAG_T2_FLAG_NFC_FORUM_COMPATIBLE;
-            /* Start reading the data */
-            priv->init_id = nfc_tag_t2_cmd_read(self, NFC_TAG_T2_DATA_BLOCK0,
-                priv->init_seq, nfc_tag_t2_init_read_resp, NULL,
-                GUINT_TO_POINTER(NFC_TAG_T2_DATA_BLOCK0));
+            /* TLV sequence can't extend beyond the data area */
+            nfc_tlv_scanner_init(&priv->init_tlv, self->data_size);
+            /* NDEF is somewhere in the data area, if anywhere */
+            nfc_tag_set_stage(&self->tag, NFC_TAG_STAGE_NDEF_LOCATED);
+            /* Check if we have seen this tag before */
+            nfc_tag_t2_cache_open(self, bytes);
+            if (len >= (NFC_TAG_T2_DATA_BLOCK0 + 1) * self->block_size) {
+                /* FAST_READ has already fetched some data blocks */
+                const guint skip = NFC_TAG_T2_DATA_BLOCK0 * self->block_size;
+
+                nfc_tag_t2_init_read_resp(self, status, bytes + skip,
+                    (len - skip) / self->block_size * self->block_size,
+                    GUINT_TO_POINTER(NFC_TAG_T2_DATA_BLOCK0));
+            } else {
+                /* Start reading the data. Once we see the first TLVs,
+                 * we will know how much more we need. */
+                priv->init_id = nfc_tag_t2_cmd_read_blocks(self,
+                    NFC_TAG_T2_DATA_BLOCK0, self->data_size /
+                    self->block_size, priv->init_seq,
+                    nfc_tag_t2_init_read_resp, NULL,
+                    GUINT_TO_POINTER(NFC_TAG_T2_DATA_BLOCK0));
+            }
         } else {
             GDEBUG("Tag is not NFC Forum compatible");
             nfc_tag_t2_initialized(self);
@@ -951,6 +1985,123 @@ nfc_tag_t2_control_area_read_resp(
     }
 }
 
+static
+void
+nfc_tag_t2_init_start(
+    NfcTagType2* self)
+{
+    NfcTagType2Priv* priv = self->priv;
+    const NfcTagType2Chip* chip = priv->chip;
+
+    /*
+     * Start initialization by reading first blocks of sector 0. If
+     * we know the chip and it supports FAST_READ, grab as much of the
+     * data area as we can in the same round trip.
+     */
+    priv->init_id = nfc_tag_t2_cmd_read_blocks(self, 0, chip ?
+        (NFC_TAG_T2_DATA_BLOCK0 + chip->data_blocks) : NFC_TAG_T2_READ_BLOCKS,
+        priv->init_seq, nfc_tag_t2_control_area_read_resp, NULL, NULL);
+}
+
+static
+void
+nfc_tag_t2_init_reactivated(
+    NfcTarget* target,
+    void* user_data)
+{
+    NfcTagType2* self = NFC_TAG_T2(user_data);
+    NfcTagType2Priv* priv = self->priv;
+
+    priv->init_seq = nfc_target_sequence_new2(target,
+        NFC_TARGET_PRIORITY_INIT);
+    nfc_tag_t2_init_start(self);
+}
+
+static
+const NfcTagType2Chip*
+nfc_tag_t2_find_chip(
+    const guint8* version)
+{
+    /*
+     * GET_VERSION response:
+     *
+     * 0: Fixed header (0x00)
+     * 1: Vendor ID
+     * 2: Product type
+     * 3: Product subtype
+     * 4: Major product version
+     * 5: Minor product version
+     * 6: Storage size
+     * 7: Protocol type
+     */
+    if (version[1] == NXP_MANUFACTURER_ID) {
+        guint i;
+
+        for (i = 0; i < G_N_ELEMENTS(nfc_tag_t2_chips); i++) {
+            const NfcTagType2Chip* chip = nfc_tag_t2_chips + i;
+
+            if (chip->type == version[2] && chip->subtype == version[3] &&
+                chip->major == version[4] && chip->minor == version[5] &&
+                chip->storage == version[6]) {
+                return chip;
+            }
+        }
+    }
+    return NULL;
+}
+
+static
+void
+nfc_tag_t2_get_version_resp(
+    NfcTagType2* self,
+    NFC_TRANSMIT_STATUS status,
+    const void* data,
+    guint len,
+    void* user_data)
+{
+    NfcTagType2Priv* priv = self->priv;
+
+    priv->init_id = 0;
+    if (status == NFC_TRANSMIT_STATUS_OK && len == NFC_TAG_T2_VERSION_SIZE) {
+        const NfcTagType2Chip* chip = nfc_tag_t2_find_chip(data);
+
+        memcpy(priv->version, data, len);
+        if (chip) {
+            NfcTagType2Product* product = &priv->product;
+
+            GDEBUG("%s", chip->name);
+            priv->chip = chip;
+            product->name = chip->name;
+            product->version.bytes = priv->version;
+            product->version.size = len;
+            product->total_blocks = chip->total_blocks;
+            product->data_blocks = chip->data_blocks;
+            product->config_block = chip->config_block;
+            self->t2flags |= chip->flags;
+        } else {
+            GDEBUG("Unknown chip");
+            nfc_hexdump(data, len);
+        }
+        nfc_tag_t2_init_start(self);
+    } else {
+        NfcTarget* target = self->tag.target;
+
+        /*
+         * The tag is back to IDLE state, wake it up. Release the
+         * sequence so that it doesn't block presence checks if
+         * reactivation times out.
+         */
+        GDEBUG("No GET_VERSION support, reactivating");
+        nfc_target_sequence_unref(priv->init_seq);
+        priv->init_seq = NULL;
+        if (!nfc_target_reactivate(target, nfc_tag_t2_init_reactivated,
+            self)) {
+            GDEBUG("Oops. Failed to reactivate, trying to go on anyway");
+            nfc_tag_t2_init_reactivated(target, self);
+        }
+    }
+}
+
 static
 void
 nfc_tag_t2_init2(
@@ -974,7 +2125,10 @@ nfc_tag_t2_init2(
     } else {
         nfc_tag_init_base(tag, target, NULL);
     }
-    priv->init_seq = nfc_target_sequence_new(target);
+    priv->init_seq = nfc_target_sequence_new2(target,
+        NFC_TARGET_PRIORITY_INIT);
+    nfc_target_set_transmit_timeout(target, NFC_TAG_T2_TIMEOUT_MIN_MS, 0);
+    nfc_tag_add_gone_handler(tag, nfc_tag_t2_gone, NULL);
 }
 
 /*==========================================================================*
@@ -1042,9 +2196,20 @@ nfc_tag_t2_new(
         GDEBUG("Type 2 tag%s", desc);
         nfc_tag_t2_init2(self, target, param);
 
-        /* Start initialization by reading first blocks of sector 0 */
-        priv->init_id = nfc_tag_t2_cmd_read(self, 0, priv->init_seq,
-            nfc_tag_t2_control_area_read_resp, NULL, NULL);
+        if (tag->type == NFC_TAG_TYPE_MIFARE_ULTRALIGHT &&
+            nfc_tag_t2_get_version_enabled &&
+            nfc_target_can_reactivate(target)) {
+            static const guint8 cmd_get_version[] = {
+                NFC_TAG_T2_CMD_GET_VERSION
+            };
+
+            /* Identify the chip first */
+            priv->init_id = nfc_tag_t2_cmd(self, cmd_get_version,
+                sizeof(cmd_get_version), priv->init_seq, NULL,
+                nfc_tag_t2_get_version_resp, NULL, NULL);
+        } else {
+            nfc_tag_t2_init_start(self);
+        }
         return self;
     }
     return NULL;
@@ -1054,6 +2219,58 @@ nfc_tag_t2_new(
  * Interface
  *==========================================================================*/
 
+void
+nfc_tag_t2_set_get_version(
+    gboolean enable) /* Since 1.0.34 */
+{
+    nfc_tag_t2_get_version_enabled = enable;
+}
+
+const NfcTagType2Product*
+nfc_tag_t2_product(
+    NfcTagType2* self) /* Since 1.0.34 */
+{
+    return (G_LIKELY(self) && self->priv->chip) ? &self->priv->product : NULL;
+}
+
+void
+nfc_tag_t2_set_read_ahead(
+    NfcTagType2* self,
+    gboolean enable) /* Since 1.0.34 */
+{
+    if (G_LIKELY(self)) {
+        NfcTagType2Priv* priv = self->priv;
+
+        if (enable) {
+            if (!priv->read_ahead) {
+                priv->read_ahead = TRUE;
+                nfc_tag_t2_read_ahead_start(self);
+            }
+        } else if (priv->read_ahead) {
+            priv->read_ahead = FALSE;
+            nfc_tag_t2_read_ahead_stop(self, NFC_TAG_T2_READ_AHEAD_OFF);
+        }
+    }
+}
+
+NFC_TAG_T2_READ_AHEAD
+nfc_tag_t2_read_ahead_state(
+    NfcTagType2* self) /* Since 1.0.34 */
+{
+    return G_LIKELY(self) ? self->priv->read_ahead_state :
+        NFC_TAG_T2_READ_AHEAD_OFF;
+}
+
+gulong
+nfc_tag_t2_add_read_ahead_handler(
+    NfcTagType2* self,
+    NfcTagType2Func func,
+    void* user_data) /* Since 1.0.34 */
+{
+    return (G_LIKELY(self) && G_LIKELY(func)) ? g_signal_connect(self,
+        SIGNAL_READ_AHEAD_NAME, G_CALLBACK(func), user_data) : 0;
+}
+
 guint
 nfc_tag_t2_read(
     NfcTagType2* self,
@@ -1063,9 +2280,29 @@ nfc_tag_t2_read(
     GDestroyNotify done,
     void* user_data)
 {
-#pragma message("TODO: Support more than one sector")
-    if (G_LIKELY(self) && sector == 0) {
-        return nfc_tag_t2_cmd_read(self, block, NULL, resp, done, user_data);
+    if (G_LIKELY(self) && sector < MAX(self->priv->sector_count, 1) &&
+        block < NFC_TAG_T2_SECTOR_BLOCKS) {
+        return nfc_tag_t2_cmd_read_retry(self, sector *
+            NFC_TAG_T2_SECTOR_BLOCKS + block, NULL, NULL, resp, done,
+            user_data);
+    }
+    return 0;
+}
+
+guint
+nfc_tag_t2_read_bytes(
+    NfcTagType2* self,
+    guint sector,
+    guint block,
+    NfcTargetSequence* seq,
+    NfcTagType2ReadBytesFunc resp,
+    GDestroyNotify done,
+    void* user_data) /* Since 1.0.34 */
+{
+    if (G_LIKELY(self) && sector < MAX(self->priv->sector_count, 1) &&
+        block < NFC_TAG_T2_SECTOR_BLOCKS) {
+        return nfc_tag_t2_cmd_read_bytes(self, sector *
+            NFC_TAG_T2_SECTOR_BLOCKS + block, seq, resp, done, user_data);
     }
     return 0;
 }
@@ -1093,22 +2330,16 @@ nfc_tag_t2_read_data_seq(
     GDestroyNotify destroy,
     void* user_data) /* Since 1.0.17 */
 {
-#pragma message("TODO: Support more than one sector and cross-sector reads")
     if (G_LIKELY(self) && (self->tag.flags & NFC_TAG_FLAG_INITIALIZED)) {
         NfcTagType2Priv* priv = self->priv;
-        NfcTagType2Sector* sector = priv->sectors;
-        const GUtilData* data = &sector->data;
-
-        if (offset < data->size) {
-            NfcTagType2ReadData* read = g_slice_new0(NfcTagType2ReadData);
-            const guint block_size = self->block_size;
-            const guint header_bytes = data->bytes - sector->bytes;
-            const guint header_blocks = header_bytes / block_size;
-            guint end_block, start_block = offset / block_size;
-            gboolean valid;
-
-            if (maxbytes > (data->size - offset)) {
-                maxbytes = (data->size - offset);
+        const guint data_size = priv->image ? self->data_size : 0;
+
+        if (offset < data_size) {
+            NfcTagType2ReadData* read = nfc_target_pool_new0
+                (self->tag.target, NfcTagType2ReadData);
+
+            if (maxbytes > (data_size - offset)) {
+                maxbytes = (data_size - offset);
             }
 
             read->t2 = self;
@@ -1127,38 +2358,15 @@ nfc_tag_t2_read_data_seq(
             g_hash_table_insert(priv->reads, GUINT_TO_POINTER(read->seq_id),
                 read);
 
-            end_block = (offset + read->size + block_size - 1) / block_size;
-            nfc_tag_t2_data_block_to_sector(self, start_block, NULL, &valid);
-            if (valid) {
-                guint i, cached_bytes = block_size - (offset % block_size);
-
-                for (i = start_block + 1; i < end_block; i++) {
-                    nfc_tag_t2_data_block_to_sector(self, i, NULL, &valid);
-                    if (valid) {
-                        cached_bytes += block_size;
-                    } else {
-                        break;
-                    }
-                }
-
-                /* Copy cached data */
-                if (cached_bytes > maxbytes) {
-                    cached_bytes = maxbytes;
-                }
-                memcpy(read->buffer, data->bytes + offset, cached_bytes);
-                read->read = cached_bytes;
-                start_block = i;
-            }
-
-            if (start_block == end_block) {
+            if (!nfc_tag_t2_read_data_copy_cached(read)) {
                 /* Everything was cached - call completion on a fresh stack */
                 read->complete_id = g_idle_add(nfc_tag_t2_read_complete, read);
             } else {
                 /* We actually need to read something */
                 read->seq = seq ? nfc_target_sequence_ref(seq) :
-                    nfc_target_sequence_new(self->tag.target);
-                read->cmd_id = nfc_tag_t2_cmd_read(self, header_blocks +
-                    start_block, read->seq, nfc_tag_t2_read_resp, NULL, read);
+                    nfc_target_sequence_new2(self->tag.target,
+                        NFC_TARGET_PRIORITY_BULK);
+                nfc_tag_t2_read_data_submit(read);
             }
             return read->seq_id;
         }
@@ -1174,52 +2382,28 @@ nfc_tag_t2_read_data_sync(
     void* buffer)
 {
     if (G_LIKELY(self)) {
+        NfcTagType2Priv* priv = self->priv;
         const guint block_size = self->block_size;
+        const guint data_size = priv->image ? self->data_size : 0;
         const guint start_block = offset / block_size;
         const guint end_block = (offset + size + block_size - 1) / block_size;
-        gboolean valid;
-        NfcTagType2Sector* sector = nfc_tag_t2_data_block_to_sector(self,
-            start_block, NULL, &valid);
 
-        if (!sector) {
+        if (offset >= data_size) {
             return NFC_TAG_T2_IO_STATUS_BAD_BLOCK;
-        } else if (!nfc_tag_t2_data_block_to_sector(self, end_block - 1,
-            NULL, NULL)) {
+        } else if ((offset + size) > data_size) {
             return NFC_TAG_T2_IO_STATUS_BAD_SIZE;
-        } else if (!valid) {
-            /* The very first block is invalid, we are done */
-            return NFC_TAG_T2_IO_STATUS_NOT_CACHED;
         } else {
             guint i;
-            guint sect_offset = offset;
-            guint sect_bytes = block_size - (offset % block_size);
-            const GUtilData* data = &sector->data;
-
-            /* Check the remaining blocks */
-            for (i = start_block + 1; i < end_block; i++) {
-                /* Since we have checked the range, sector must be found */
-                NfcTagType2Sector* next = nfc_tag_t2_data_block_to_sector
-                    (self, i, NULL, &valid);
-                if (!valid) {
+
+            /* The image is contiguous, just check the blocks */
+            for (i = start_block; i < end_block; i++) {
+                if (!nfc_tag_t2_image_cached(priv,
+                    NFC_TAG_T2_DATA_BLOCK0 + i)) {
                     return NFC_TAG_T2_IO_STATUS_NOT_CACHED;
-                } else if (sector == next) {
-                    /* Count bytes in this sector */
-                    sect_bytes += block_size;
-                } else {
-                    /* Copy bytes from this sector and switch to the next */
-                    if (buffer) {
-                        memcpy(buffer, data->bytes + sect_offset, sect_bytes);
-                        buffer += sect_bytes;
-                    }
-                    sect_offset = 0;
-                    sect_bytes = 0;
-                    sector = next;
-                    data = &sector->data;
                 }
             }
-
             if (buffer) {
-                memcpy(buffer, data->bytes + sect_offset, sect_bytes);
+                memcpy(buffer, nfc_tag_t2_image_data(self) + offset, size);
             }
             return NFC_TAG_T2_IO_STATUS_OK;
         }
@@ -1227,7 +2411,34 @@ nfc_tag_t2_read_data_sync(
     return NFC_TAG_T2_IO_STATUS_FAILURE;
 }
 
-/* Primitive write, absolute block number withint a sector, only writes
+GBytes*
+nfc_tag_t2_read_data_cached(
+    NfcTagType2* self,
+    guint offset,
+    guint maxbytes) /* Since 1.0.34 */
+{
+    if (G_LIKELY(self) && (self->tag.flags & NFC_TAG_FLAG_INITIALIZED)) {
+        NfcTagType2Priv* priv = self->priv;
+        const guint data_size = priv->image ? self->data_size : 0;
+
+        if (offset < data_size) {
+            if (maxbytes > (data_size - offset)) {
+                maxbytes = (data_size - offset);
+            }
+            if (nfc_tag_t2_read_data_sync(self, offset, maxbytes, NULL) ==
+                NFC_TAG_T2_IO_STATUS_OK) {
+                NfcTagType2ImageBuf* buf = priv->image_buf;
+
+                g_atomic_int_inc(&buf->ref_count);
+                return g_bytes_new_with_free_func(nfc_tag_t2_image_data(self)
+                    + offset, maxbytes, nfc_tag_t2_image_buf_unref, buf);
+            }
+        }
+    }
+    return NULL;
+}
+
+/* Primitive write, absolute block number within a sector, only writes
  * entire blocks, can be used to write special areas, i.e. lock bytes. */
 guint
 nfc_tag_t2_write(
@@ -1254,29 +2465,59 @@ nfc_tag_t2_write_seq(
     GDestroyNotify destroy,
     void* user_data) /* Since 1.0.17 */
 {
-#pragma message("TODO: Support more than one sector and cross-sector writes")
-    if (G_LIKELY(self) && bytes && sector_number == 0 &&
+    if (G_LIKELY(self) && bytes &&
         (self->tag.flags & NFC_TAG_FLAG_INITIALIZED)) {
         gsize size;
         const guint block_size = self->block_size;
-        gsize offset = block * block_size;
+        const guint abs_block = sector_number * NFC_TAG_T2_SECTOR_BLOCKS +
+            block;
         const guint8* data = g_bytes_get_data(bytes, &size);
         NfcTagType2Priv* priv = self->priv;
-        NfcTagType2Sector* sector = priv->sectors + sector_number;
 
         /* Round total size down to the nearest block boundary */
         size -= size % block_size;
-        if (sector && size > 0 && (offset + size) <= sector->size) {
+        if (size > 0 && sector_number < MAX(priv->sector_count, 1) &&
+            (abs_block + size / block_size) <= priv->image_blocks &&
+            (block + size / block_size) <= NFC_TAG_T2_SECTOR_BLOCKS) {
+            const guint nb = size / block_size;
             NfcTagType2WriteData* write = nfc_tag_t2_write_data_new(self,
-                sector_number, offset, bytes, seq, G_CALLBACK(complete),
+                abs_block * block_size, bytes, seq, G_CALLBACK(complete),
                 destroy, user_data);
-
-            GDEBUG("Writing %u blocks starting at %u", (guint)
-                (size / block_size), block);
-            nfc_tag_t2_sector_invalidate(sector, block_size, block, 1);
-            write->cmd_id = nfc_tag_t2_cmd_write(self, block, data,
-                write->seq, nfc_tag_t2_write_resp, NULL, write);
-            return write->seq_id;
+            NfcTagType2SectorSelect* select;
+            NfcTargetSequence* tmp_seq;
+
+            /* All blocks are written back-to-back as one batch, after
+             * selecting the sector (if necessary) */
+            GDEBUG("Writing %u blocks starting at %u", nb, block);
+            if (nfc_tag_t2_cmd_sector(self, abs_block, &write->seq, &tmp_seq,
+                &select)) {
+                NfcTargetTransmitOptions opt =
+                    NFC_TARGET_TRANSMIT_OPTIONS_INIT;
+                GBytes** frames = g_new(GBytes*, nb);
+                guint i;
+
+                GASSERT(!tmp_seq); /* write->seq is never NULL */
+                for (i = 0; i < nb; i++) {
+                    frames[i] = nfc_tag_t2_cmd_write_frame(self, block + i,
+                        data + i * block_size);
+                }
+                nfc_tag_t2_image_invalidate(self, abs_block, nb);
+                opt.rtt_class = NFC_TARGET_RTT_CLASS(NFC_TAG_T2_CMD_WRITE);
+                write->cmd_id = nfc_target_transmit_batch_full(
+                    self->tag.target, frames, nb, write->seq, &opt,
+                    nfc_tag_t2_write_batch_resp, NULL, write);
+                nfc_tag_t2_cmd_sector_bind(select, write->cmd_id);
+                for (i = 0; i < nb; i++) {
+                    g_bytes_unref(frames[i]);
+                }
+                g_free(frames);
+                if (write->cmd_id) {
+                    return write->seq_id;
+                }
+            }
+            write->destroy = NULL;
+            g_hash_table_remove(self->priv->writes,
+                GUINT_TO_POINTER(write->seq_id));
         }
     }
     return 0;
@@ -1305,50 +2546,53 @@ nfc_tag_t2_write_data_seq(
     NfcTagType2WriteDataFunc complete,
     GDestroyNotify destroy,
     void* user_data) /* Since 1.0.17 */
+{
+    return nfc_tag_t2_write_data_seq2(self, offset, bytes, seq,
+        NFC_TAG_T2_WRITE_FLAGS_NONE, complete, destroy, user_data);
+}
+
+guint
+nfc_tag_t2_write_data_seq2(
+    NfcTagType2* self,
+    guint offset,
+    GBytes* bytes,
+    NfcTargetSequence* seq,
+    NFC_TAG_T2_WRITE_FLAGS flags,
+    NfcTagType2WriteDataFunc complete,
+    GDestroyNotify destroy,
+    void* user_data) /* Since 1.0.34 */
 {
     if (G_LIKELY(self) && bytes &&
        (self->tag.flags & NFC_TAG_FLAG_INITIALIZED)) {
         gsize size;
         const guint block_size = self->block_size;
-        const guint8* data = g_bytes_get_data(bytes, &size);
-        NfcTagType2Priv* priv = self->priv;
-        guint start_block;
-        gboolean start_block_cached;
-        NfcTagType2Sector* sector = nfc_tag_t2_data_block_to_sector(self,
-            offset / block_size, &start_block, &start_block_cached);
-
-#pragma message("TODO: Support more than one sector and cross-sector writes")
-        if (sector && size > 0 && (offset + size) <= sector->size) {
-            const guint block_offset = offset % block_size;
+        const guint data_size = self->priv->image ? self->data_size : 0;
+
+        g_bytes_get_data(bytes, &size);
+        if (size > 0 && (offset + size) <= data_size) {
+            NfcTarget* target = self->tag.target;
             NfcTagType2WriteData* write = nfc_tag_t2_write_data_new(self,
-                sector - priv->sectors, offset, bytes, seq,
-                G_CALLBACK(complete), destroy, user_data);
+                offset, bytes, seq, G_CALLBACK(complete), destroy, user_data);
 
             GDEBUG("Writing %u data byte(s) starting at offset %u",
                 (guint)size, offset);
 
-            if (block_offset) {
-                NfcTarget* target = self->tag.target;
-
-                if (target->sequence == write->seq) {
-                    /* Our sequence has started right away */
-                    nfc_tag_t2_write_data_unaligned_start(write);
-                } else {
-                    /* Even if the block is cached, we can't really do
-                     * anything until our sequence starts, because the
-                     * block can be overwritten, invalidated or whatever
-                     * between now and then. */
-                    GDEBUG("Write #%u is pending", write->seq_id);
-                    write->start_id = nfc_target_add_sequence_handler(target,
-                        nfc_tag_t2_write_data_unaligned_wait, write);
-                }
+            write->flags = flags;
+            if (target->sequence == write->seq ||
+                (!(offset % block_size) && size >= block_size &&
+                !(flags & NFC_TAG_T2_WRITE_FLAG_DIFF))) {
+                /* Either our sequence has started right away or the
+                 * first write doesn't depend on the cache */
+                nfc_tag_t2_write_data_start(write);
             } else {
-                nfc_tag_t2_sector_invalidate(sector, block_size,
-                    start_block, 1);
-                write->cmd_id = nfc_tag_t2_cmd_write(self, start_block,
-                    data, write->seq, nfc_tag_t2_write_data_resp, NULL, write);
+                /* Even if the block is cached, we can't really do
+                 * anything until our sequence starts, because the
+                 * block can be overwritten, invalidated or whatever
+                 * between now and then. */
+                GDEBUG("Write #%u is pending", write->seq_id);
+                write->start_id = nfc_target_add_sequence_handler(target,
+                    nfc_tag_t2_write_data_wait, write);
             }
-
             return write->seq_id;
         }
     }
@@ -1383,14 +2627,13 @@ nfc_tag_t2_finalize(
     if (priv->writes) {
         g_hash_table_destroy(priv->writes);
     }
-    if (priv->sectors) {
-        guint i;
-
-        for (i = 0; i < priv->sector_count; i++) {
-            nfc_tag_t2_sector_deinit(priv->sectors + i);
-        }
-        g_free(priv->sectors);
+    nfc_tag_t2_cache_close(self);
+    g_free(priv->cache_key);
+    if (priv->image_buf) {
+        nfc_tag_t2_image_buf_unref(priv->image_buf);
     }
+    g_free(priv->valid);
+    nfc_target_cancel_transmit(self->tag.target, priv->read_ahead_id);
     nfc_target_cancel_transmit(self->tag.target, priv->init_id);
     nfc_target_sequence_unref(priv->init_seq);
     G_OBJECT_CLASS(nfc_tag_t2_parent_class)->finalize(object);
@@ -1403,6 +2646,10 @@ nfc_tag_t2_class_init(
 {
     g_type_class_add_private(klass, sizeof(NfcTagType2Priv));
     G_OBJECT_CLASS(klass)->finalize = nfc_tag_t2_finalize;
+    NFC_TAG_CLASS(klass)->reattach = nfc_tag_t2_reattach;
+    nfc_tag_t2_signals[SIGNAL_READ_AHEAD] =
+        g_signal_new(SIGNAL_READ_AHEAD_NAME, G_OBJECT_CLASS_TYPE(klass),
+            G_SIGNAL_RUN_FIRST, 0, NULL, NULL, NULL, G_TYPE_NONE, 0);
 }
 
 /*
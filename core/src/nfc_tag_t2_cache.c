@@ -0,0 +1,380 @@
+/*
+ * Copyright (C) 2020 Jolla Ltd.
+ * Copyright (C) 2020 Slava Monich <slava.monich@jolla.com>
+ *
+ * You may use this file under the terms of BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *   3. Neither the names of the copyright holders nor the names of its
+ *      contributors may be used to endorse or promote products derived from
+ *      this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "nfc_tag_t2_cache.h"
+#include "nfc_tag_t2.h"
+#include "nfc_log.h"
+
+#include <glib/gstdio.h>
+
+/*
+ * File format (all numbers are little-endian):
+ *
+ * Bytes 0..3 - Magic "NT2C"
+ * Byte  4    - Format version
+ * Byte  5    - Block size
+ * Bytes 6..7 - Number of blocks (N)
+ * Then       - Validity bitmap, (N + 7)/8 bytes, one bit per block
+ * Then       - N blocks of data
+ */
+#define NFC_TAG_T2_CACHE_MAGIC "NT2C"
+#define NFC_TAG_T2_CACHE_MAGIC_SIZE (4)
+#define NFC_TAG_T2_CACHE_VERSION (1)
+#define NFC_TAG_T2_CACHE_HEADER_SIZE (8)
+
+/*
+ * The index of cache files is built when the cache is enabled and then
+ * kept up to date by load, save and drop, so that the directory doesn't
+ * have to be scanned every time a file is saved. Access time is in
+ * microseconds since the epoch, for files found in the directory it's
+ * their modification time.
+ */
+typedef struct nfc_tag_t2_cache_file {
+    char* name;
+    gsize size;
+    gint64 atime;
+} NfcTagType2CacheFile;
+
+static char* nfc_tag_t2_cache_dir = NULL;
+static gsize nfc_tag_t2_cache_max_size = 0;
+static gsize nfc_tag_t2_cache_total = 0;
+static GHashTable* nfc_tag_t2_cache_index = NULL;
+
+static
+char*
+nfc_tag_t2_cache_path(
+    const char* key)
+{
+    return g_build_filename(nfc_tag_t2_cache_dir, key, NULL);
+}
+
+static
+void
+nfc_tag_t2_cache_file_free(
+    gpointer data)
+{
+    NfcTagType2CacheFile* file = data;
+
+    GASSERT(nfc_tag_t2_cache_total >= file->size);
+    nfc_tag_t2_cache_total -= file->size;
+    g_free(file->name);
+    g_slice_free(NfcTagType2CacheFile, file);
+}
+
+static
+void
+nfc_tag_t2_cache_index_put(
+    const char* name,
+    gsize size,
+    gint64 atime)
+{
+    NfcTagType2CacheFile* file = g_slice_new(NfcTagType2CacheFile);
+
+    file->name = g_strdup(name);
+    file->size = size;
+    file->atime = atime;
+    nfc_tag_t2_cache_total += size;
+    g_hash_table_replace(nfc_tag_t2_cache_index, file->name, file);
+}
+
+static
+void
+nfc_tag_t2_cache_index_remove(
+    const char* name)
+{
+    if (nfc_tag_t2_cache_index) {
+        g_hash_table_remove(nfc_tag_t2_cache_index, name);
+    }
+}
+
+static
+void
+nfc_tag_t2_cache_index_touch(
+    const char* name)
+{
+    NfcTagType2CacheFile* file = nfc_tag_t2_cache_index ?
+        g_hash_table_lookup(nfc_tag_t2_cache_index, name) : NULL;
+
+    if (file) {
+        file->atime = g_get_real_time();
+    }
+}
+
+static
+void
+nfc_tag_t2_cache_index_build(
+    void)
+{
+    GDir* dir = g_dir_open(nfc_tag_t2_cache_dir, 0, NULL);
+
+    nfc_tag_t2_cache_index = g_hash_table_new_full(g_str_hash, g_str_equal,
+        NULL, nfc_tag_t2_cache_file_free);
+    if (dir) {
+        const char* name;
+
+        while ((name = g_dir_read_name(dir)) != NULL) {
+            /* Skip temporary files left behind by g_file_set_contents */
+            if (!strchr(name, '.')) {
+                char* path = nfc_tag_t2_cache_path(name);
+                GStatBuf st;
+
+                if (!g_stat(path, &st) && S_ISREG(st.st_mode)) {
+                    nfc_tag_t2_cache_index_put(name, st.st_size,
+                        (gint64)st.st_mtime * G_USEC_PER_SEC);
+                }
+                g_free(path);
+            }
+        }
+        g_dir_close(dir);
+    }
+    GDEBUG("%u file(s) in the cache, %u bytes",
+        g_hash_table_size(nfc_tag_t2_cache_index),
+        (guint)nfc_tag_t2_cache_total);
+}
+
+static
+gint
+nfc_tag_t2_cache_file_compare(
+    gconstpointer a,
+    gconstpointer b)
+{
+    const NfcTagType2CacheFile* f1 = *(NfcTagType2CacheFile**)a;
+    const NfcTagType2CacheFile* f2 = *(NfcTagType2CacheFile**)b;
+
+    /* Oldest first */
+    return (f1->atime < f2->atime) ? -1 : (f1->atime > f2->atime) ? 1 : 0;
+}
+
+static
+void
+nfc_tag_t2_cache_evict(
+    const char* keep)
+{
+    GPtrArray* files = g_ptr_array_sized_new
+        (g_hash_table_size(nfc_tag_t2_cache_index));
+    GHashTableIter it;
+    gpointer value;
+    guint i;
+
+    g_hash_table_iter_init(&it, nfc_tag_t2_cache_index);
+    while (g_hash_table_iter_next(&it, NULL, &value)) {
+        NfcTagType2CacheFile* file = value;
+
+        /* The file we have just saved stays */
+        if (strcmp(file->name, keep)) {
+            g_ptr_array_add(files, file);
+        }
+    }
+
+    /* Delete least recently used files */
+    g_ptr_array_sort(files, nfc_tag_t2_cache_file_compare);
+    for (i = 0; i < files->len &&
+         nfc_tag_t2_cache_total > nfc_tag_t2_cache_max_size; i++) {
+        const NfcTagType2CacheFile* file = files->pdata[i];
+        char* path = nfc_tag_t2_cache_path(file->name);
+
+        GDEBUG("Evicting %s", path);
+        if (!g_unlink(path)) {
+            g_hash_table_remove(nfc_tag_t2_cache_index, file->name);
+        }
+        g_free(path);
+    }
+    g_ptr_array_free(files, TRUE);
+}
+
+char*
+nfc_tag_t2_cache_key(
+    const GUtilData* nfcid1,
+    const guint8* serial,
+    const guint8* cc)
+{
+    if (nfc_tag_t2_cache_dir && nfcid1 && nfcid1->size) {
+        GString* key = g_string_sized_new(2 * nfcid1->size + 18);
+        guint i;
+
+        for (i = 0; i < nfcid1->size; i++) {
+            g_string_append_printf(key, "%02x", nfcid1->bytes[i]);
+        }
+        g_string_append_printf(key, "-%02x%02x%02x%02x-%02x%02x%02x%02x",
+            serial[0], serial[1], serial[2], serial[3],
+            cc[0], cc[1], cc[2], cc[3]);
+        return g_string_free(key, FALSE);
+    }
+    return NULL;
+}
+
+GMappedFile*
+nfc_tag_t2_cache_load(
+    const char* key,
+    NfcTagType2CacheImage* image)
+{
+    if (nfc_tag_t2_cache_dir && key) {
+        char* path = nfc_tag_t2_cache_path(key);
+        GMappedFile* map = g_mapped_file_new(path, FALSE, NULL);
+
+        if (map) {
+            const guint8* data = (guint8*)g_mapped_file_get_contents(map);
+            const gsize size = g_mapped_file_get_length(map);
+
+            if (size >= NFC_TAG_T2_CACHE_HEADER_SIZE &&
+                !memcmp(data, NFC_TAG_T2_CACHE_MAGIC,
+                NFC_TAG_T2_CACHE_MAGIC_SIZE) &&
+                data[4] == NFC_TAG_T2_CACHE_VERSION) {
+                const guint block_size = data[5];
+                const guint blocks = data[6] + (((guint)data[7]) << 8);
+                const gsize bitmap_size = (blocks + 7) / 8;
+
+                if (size == NFC_TAG_T2_CACHE_HEADER_SIZE + bitmap_size +
+                    blocks * block_size) {
+                    GDEBUG("Loaded %s", path);
+                    image->block_size = block_size;
+                    image->blocks = blocks;
+                    image->valid = data + NFC_TAG_T2_CACHE_HEADER_SIZE;
+                    image->data = image->valid + bitmap_size;
+                    /* Update the access time for LRU eviction (the file
+                     * time is only needed after restart) */
+                    g_utime(path, NULL);
+                    nfc_tag_t2_cache_index_touch(key);
+                    g_free(path);
+                    return map;
+                }
+            }
+            GWARN("Invalid cache file %s", path);
+            g_mapped_file_unref(map);
+            g_unlink(path);
+            nfc_tag_t2_cache_index_remove(key);
+        }
+        g_free(path);
+    }
+    memset(image, 0, sizeof(*image));
+    return NULL;
+}
+
+gboolean
+nfc_tag_t2_cache_save(
+    const char* key,
+    const NfcTagType2CacheImage* image)
+{
+    if (nfc_tag_t2_cache_dir && key && image->blocks <= 0xffff &&
+        image->block_size <= 0xff &&
+        !g_mkdir_with_parents(nfc_tag_t2_cache_dir, 0700)) {
+        const gsize bitmap_size = (image->blocks + 7) / 8;
+        const gsize data_size = image->blocks * image->block_size;
+        const gsize size = NFC_TAG_T2_CACHE_HEADER_SIZE + bitmap_size +
+            data_size;
+        guint8* buf = g_malloc(size);
+        char* path = nfc_tag_t2_cache_path(key);
+        GError* error = NULL;
+        gboolean ok;
+
+        memcpy(buf, NFC_TAG_T2_CACHE_MAGIC, NFC_TAG_T2_CACHE_MAGIC_SIZE);
+        buf[4] = NFC_TAG_T2_CACHE_VERSION;
+        buf[5] = (guint8)image->block_size;
+        buf[6] = (guint8)image->blocks;
+        buf[7] = (guint8)(image->blocks >> 8);
+        memcpy(buf + NFC_TAG_T2_CACHE_HEADER_SIZE, image->valid,
+            bitmap_size);
+        memcpy(buf + NFC_TAG_T2_CACHE_HEADER_SIZE + bitmap_size,
+            image->data, data_size);
+        ok = g_file_set_contents(path, (char*)buf, size, &error);
+        if (ok) {
+            GDEBUG("Saved %s", path);
+            nfc_tag_t2_cache_index_put(key, size, g_get_real_time());
+            if (nfc_tag_t2_cache_max_size &&
+                nfc_tag_t2_cache_total > nfc_tag_t2_cache_max_size) {
+                nfc_tag_t2_cache_evict(key);
+            }
+        } else {
+            GWARN("%s", GERRMSG(error));
+            g_error_free(error);
+        }
+        g_free(path);
+        g_free(buf);
+        return ok;
+    }
+    return FALSE;
+}
+
+void
+nfc_tag_t2_cache_drop(
+    const char* key)
+{
+    if (nfc_tag_t2_cache_dir && key) {
+        char* path = nfc_tag_t2_cache_path(key);
+
+        if (!g_unlink(path)) {
+            GDEBUG("Deleted %s", path);
+        }
+        nfc_tag_t2_cache_index_remove(key);
+        g_free(path);
+    }
+}
+
+gboolean
+nfc_tag_t2_cache_block_valid(
+    const NfcTagType2CacheImage* image,
+    guint block)
+{
+    return block < image->blocks &&
+        (image->valid[block / 8] & (1 << (block % 8)));
+}
+
+/*==========================================================================*
+ * API
+ *==========================================================================*/
+
+void
+nfc_tag_t2_set_cache(
+    const char* dir,
+    gsize max_size) /* Since 1.0.34 */
+{
+    if (nfc_tag_t2_cache_index) {
+        g_hash_table_destroy(nfc_tag_t2_cache_index);
+        nfc_tag_t2_cache_index = NULL;
+    }
+    GASSERT(!nfc_tag_t2_cache_total);
+    g_free(nfc_tag_t2_cache_dir);
+    nfc_tag_t2_cache_dir = g_strdup(dir);
+    nfc_tag_t2_cache_max_size = max_size;
+    if (dir) {
+        GDEBUG("Type 2 tag cache %s, up to %u bytes", dir, (guint)max_size);
+        nfc_tag_t2_cache_index_build();
+    }
+}
+
+/*
+ * Local Variables:
+ * mode: C
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2020 Jolla Ltd.
+ * Copyright (C) 2020 Slava Monich <slava.monich@jolla.com>
+ *
+ * You may use this file under the terms of BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *   3. Neither the names of the copyright holders nor the names of its
+ *      contributors may be used to endorse or promote products derived from
+ *      this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef NFC_TAG_T2_CACHE_H
+#define NFC_TAG_T2_CACHE_H
+
+#include "nfc_types_p.h"
+
+/*
+ * Persistent cache of Type 2 tag memory images, one file per tag.
+ * Images are keyed by NFCID1, serial number and CC. The cache is
+ * enabled with nfc_tag_t2_set_cache(), which is declared in the
+ * public nfc_tag_t2.h header.
+ *
+ * The files get memory-mapped when they are loaded. Least recently
+ * used files (modification time is the last access time) are deleted
+ * when the total size of the cache exceeds the limit. Sizes and access
+ * times are tracked in memory, the directory is only scanned when the
+ * cache gets enabled.
+ */
+typedef struct nfc_tag_t2_cache_image {
+    guint block_size;
+    guint blocks;           /* Header and data area */
+    const guint8* valid;    /* One bit per block, 1 = cached */
+    const guint8* data;     /* blocks * block_size bytes */
+} NfcTagType2CacheImage;
+
+/* Returns NULL if the cache is disabled */
+char*
+nfc_tag_t2_cache_key(
+    const GUtilData* nfcid1,
+    const guint8* serial,
+    const guint8* cc)
+    NFCD_INTERNAL;
+
+/* The image points to the mapped file which must be kept around */
+GMappedFile*
+nfc_tag_t2_cache_load(
+    const char* key,
+    NfcTagType2CacheImage* image)
+    NFCD_INTERNAL;
+
+gboolean
+nfc_tag_t2_cache_save(
+    const char* key,
+    const NfcTagType2CacheImage* image)
+    NFCD_INTERNAL;
+
+void
+nfc_tag_t2_cache_drop(
+    const char* key)
+    NFCD_INTERNAL;
+
+gboolean
+nfc_tag_t2_cache_block_valid(
+    const NfcTagType2CacheImage* image,
+    guint block)
+    NFCD_INTERNAL;
+
+#endif /* NFC_TAG_T2_CACHE_H */
+
+/*
+ * Local Variables:
+ * mode: C
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -35,6 +35,7 @@
 #include "nfc_tag_t4_p.h"
 #include "nfc_tag_p.h"
 #include "nfc_target_p.h"
+#include "nfc_target_impl.h"
 #include "nfc_ndef.h"
 #include "nfc_util.h"
 #include "nfc_log.h"
@@ -42,6 +43,7 @@
 typedef struct nfc_isodep_tx {
     NfcTagType4* t4;
     NfcTagType4ResponseFunc resp;
+    NfcTagType4ResponseBytesFunc resp_bytes;
     GDestroyNotify destroy;
     void* user_data;
 } NfcIsoDepTx;
@@ -50,18 +52,76 @@ typedef struct nfc_iso_dep_ndef_read {
     NfcTagType4* t4;
     guint8 fid[2];
     guint data_len;
-    guint max_read;
+    guint max_read;     /* MLe */
+    guint max_write;    /* MLc */
+    guint max_size;     /* Maximum NDEF file size, including NLEN */
+    gboolean writable;
+    gboolean probe;     /* Extended READ BINARY is being probed */
+    guint8 sfi;         /* Short EF identifier, zero if none */
     GByteArray* data;
 } NfcIsoDepNdefRead;
 
+typedef struct nfc_tag_t4_ndef_write {
+    NfcTagType4* t4;
+    guint id;
+    guint cmd_id;
+    NfcTargetSequence* seq;
+    GBytes* ndef;
+    NfcIsoDepNdefRead* file;
+    guint written;      /* Bytes of the NDEF message written so far */
+    guint chunk;        /* Size of the chunk being written */
+    NfcTagType4WriteNdefFunc complete;
+    GDestroyNotify destroy;
+    void* user_data;
+} NfcTagType4NdefWrite;
+
+typedef struct nfc_isodep_chain {
+    NfcTagType4* t4;
+    guint id;
+    guint cmd_id;
+    NfcTargetSequence* seq;
+    guint8 cla;
+    guint8 ins;
+    guint8 p1;
+    guint8 p2;
+    GBytes* data;           /* Command data of the original APDU */
+    gboolean get_response;  /* The last command was GET RESPONSE */
+    gboolean resent;        /* The last command was repeated after 6Cxx */
+    guint max_len;
+    GByteArray* resp_data;
+    NfcTagType4ResponseBytesFunc resp;
+    GDestroyNotify destroy;
+    void* user_data;
+} NfcIsoDepChain;
+
+typedef enum nfc_tag_t4_ext_len {
+    NFC_TAG_T4_EXT_LEN_UNKNOWN,
+    NFC_TAG_T4_EXT_LEN_SUPPORTED,
+    NFC_TAG_T4_EXT_LEN_UNSUPPORTED
+} NFC_TAG_T4_EXT_LEN;
+
 struct nfc_tag_t4_priv {
     guint mtu;  /* FSC (Type 4A) or FSD (Type 4B) */
+    NFC_TAG_T4_EXT_LEN ext_len; /* Extended Lc and Le fields */
+    gboolean no_sfi;    /* READ BINARY with short EF identifier failed */
+    NFC_TAG_T4_REACTIVATE reactivate;
     GByteArray* buf;
     NfcTargetSequence* init_seq;
     NfcIsoDepNdefRead* init_read;
     guint init_id;
+    GSList* writes;
+    guint last_write_id;
+    GSList* chains;
+    guint last_chain_id;
 };
 
+typedef struct nfc_tag_t4_reactivate_rule {
+    GBytes* hb;
+    NFC_TAG_T4_REACTIVATE policy;
+} NfcTagType4ReactivateRule;
+
+static GSList* nfc_tag_t4_reactivate_rules = NULL;
+
 G_DEFINE_ABSTRACT_TYPE(NfcTagType4, nfc_tag_t4, NFC_TYPE_TAG)
 
 /*
@@ -77,18 +137,49 @@ static const GUtilData ndef_cc_ef_data = { ndef_cc_ef, sizeof(ndef_cc_ef) };
 #define ISO_SW_NDEF_NOT_FOUND (0x6a82)
 #define NDEF_CC_LEN (15)
 #define NDEF_DATA_OFFSET (2)
+#define NDEF_MAX_FILE_SIZE (0x7fff) /* 15-bit offset in P1-P2 */
+#define NDEF_MAX_SHORT_LC (0xff)
+#define NDEF_MAX_SHORT_LE (0x100)
+#define NDEF_MAX_EXT_LC (0xffff)
+#define NDEF_MAX_EXT_LE (0x10000)
+#define ISODEP_CHAIN_MAX_LEN (0x10000) /* Default for chained responses */
+
+/*
+ * Transmit timeout follows the measured round-trip times of each
+ * instruction (INS). The floor is higher than for Type 2 tags because
+ * the same instruction may take noticeably different time depending
+ * on its parameters.
+ */
+#define ISODEP_TIMEOUT_MIN_MS (100)
+
+/* SELECT and READ BINARY issued by the NDEF read procedure are
+ * idempotent and can be resent after a transient RF error */
+static const NfcTargetRetryPolicy nfc_tag_t4_retry = {
+    2,  /* retries */
+    5,  /* delay_ms */
+    20, /* max_delay_ms */
+    NFC_TARGET_RETRY_STATUS(NFC_TRANSMIT_STATUS_CORRUPTED) |
+    NFC_TARGET_RETRY_STATUS(NFC_TRANSMIT_STATUS_NACK)
+};
 
 /* ISO/IEC 7816-4 */
 
 #define ISO_MF (0x3F00)
 
 #define ISO_CLA (0x00) /* Basic channel */
+#define ISO_CLA_CHAINING (0x10) /* Command chaining */
 
 #define ISO_SHORT_FID_MASK (0x1f) /* Short File ID mask */
 
 /* Instruction byte */
 #define ISO_INS_SELECT (0xA4)
 #define ISO_INS_READ_BINARY (0xB0)
+#define ISO_INS_UPDATE_BINARY (0xD6)
+#define ISO_INS_GET_RESPONSE (0xC0)
+
+/* Status bytes */
+#define ISO_SW1_MORE_DATA (0x61)        /* SW2 bytes are still available */
+#define ISO_SW1_WRONG_LE (0x6C)         /* SW2 is the exact Le */
 
 /* Selection by file identifier */
 #define ISO_P1_SELECT_BY_ID (0x00)      /* Select MF, DF or EF */
@@ -101,6 +192,11 @@ static const GUtilData ndef_cc_ef_data = { ndef_cc_ef, sizeof(ndef_cc_ef) };
 #define ISO_P1_SELECT_ABS_PATH (0x08)   /* Select from the MF */
 #define ISO_P1_SELECT_REL_PATH (0x09)   /* Select from the current DF */
 
+/* READ BINARY with short EF identifier in P1, offset in P2 */
+#define ISO_P1_READ_SFI (0x80)
+#define ISO_SFI_MIN (0x01)
+#define ISO_SFI_MAX (0x1e)
+
 /* File occurrence */
 #define ISO_P2_SELECT_FILE_FIRST (0x00) /* First or only occurrence */
 #define ISO_P2_SELECT_FILE_LAST (0x01)  /* Last occurrence */
@@ -112,6 +208,11 @@ static const GUtilData ndef_cc_ef_data = { ndef_cc_ef, sizeof(ndef_cc_ef) };
 #define ISO_P2_RESPONSE_FMD (0x08)      /* Return FMD template */
 #define ISO_P2_RESPONSE_NONE (0x0C)     /* No response data */
 
+/* Historical bytes */
+#define ISO_HB_COMPACT_TLV (0x80)       /* Category indicator */
+#define ISO_HB_CARD_CAPS (0x07)         /* Card capabilities tag */
+#define ISO_HB_CAPS_EXT_LC_LE (0x40)    /* Extended Lc and Le fields */
+
 /*==========================================================================*
  * Implementation
  *==========================================================================*/
@@ -143,13 +244,16 @@ nfc_tag_t4_build_apdu(
      * LC must not be 0x00 and LC1|LC2 must not be 0x00|0x00
      */
     if (len <= 0xffff && exp <= 0x10000) {
+        /* Lc and Le must be either both short or both extended */
+        const gboolean ext = (len > 0xff || exp > 0x100);
+
         g_byte_array_set_size(buf, 4);
         buf->data[0] = cla;
         buf->data[1] = ins;
         buf->data[2] = p1;
         buf->data[3] = p2;
         if (len > 0) {
-            if (len < 0x100) {
+            if (!ext) {
                 /* Short Lc field */
                 guint8 lc = (guint8)len;
 
@@ -166,22 +270,28 @@ nfc_tag_t4_build_apdu(
             g_byte_array_append(buf, data, len);
         }
         if (exp > 0) {
-            if (exp <= 0x100) {
+            if (!ext) {
                 /* Short Le field */
                 guint8 le = (exp == 0x100) ? 0 : ((guint8)exp);
 
                 g_byte_array_append(buf, &le, 1);
             } else {
                 /* Extended Le field */
-                guint8 le[2];
+                guint8 le[3];
+                guint8* ptr = le;
 
+                if (!len) {
+                    /* Case 2e, there's no Lc */
+                    *ptr++ = 0;
+                }
                 if (exp == 0x10000) {
-                    le[0] = le[1] = 0;
+                    *ptr++ = 0;
+                    *ptr++ = 0;
                 } else {
-                    le[0] = (guint8)(exp >> 8);
-                    le[1] = (guint8)exp;
+                    *ptr++ = (guint8)(exp >> 8);
+                    *ptr++ = (guint8)exp;
                 }
-                g_byte_array_append(buf, le, sizeof(le));
+                g_byte_array_append(buf, le, ptr - le);
             }
         }
         return TRUE;
@@ -197,12 +307,14 @@ nfc_tag_t4_tx_free(
     NfcIsoDepTx* tx)
 {
     GDestroyNotify destroy = tx->destroy;
+    void* user_data = tx->user_data;
 
+    nfc_target_pool_delete(tx->t4->tag.target, NfcIsoDepTx, tx);
+
+    /* The destroy callback may drop the last reference to the tag */
     if (destroy) {
-        tx->destroy = NULL;
-        destroy(tx->user_data);
+        destroy(user_data);
     }
-    g_slice_free1(sizeof(*tx), tx);
 }
 
 static
@@ -242,6 +354,39 @@ nfc_tag_t4_tx_resp(
     }
 }
 
+static
+void
+nfc_tag_t4_tx_resp_bytes(
+    NfcTarget* target,
+    NFC_TRANSMIT_STATUS status,
+    GBytes* bytes,
+    void* user_data)
+{
+    NfcIsoDepTx* tx = user_data;
+    gsize len = 0;
+    const guint8* data = bytes ? g_bytes_get_data(bytes, &len) : NULL;
+
+    if (status == NFC_TRANSMIT_STATUS_OK && data) {
+        if (len < 2) {
+            GWARN("Type 4 response too short, %u bytes(s)", (guint)len);
+            tx->resp_bytes(tx->t4, ISO_SW_IO_ERR, NULL, tx->user_data);
+        } else if (len > 0x10000) {
+            GWARN("Type 4 response too long, %u bytes(s)", (guint)len);
+            tx->resp_bytes(tx->t4, ISO_SW_IO_ERR, NULL, tx->user_data);
+        } else {
+            const guint8* sw = data + len - 2;
+            /* Response data without SW, shares the buffer with bytes */
+            GBytes* resp = g_bytes_new_from_bytes(bytes, 0, len - 2);
+
+            tx->resp_bytes(tx->t4, (((guint)sw[0]) << 8) | sw[1], resp,
+                tx->user_data);
+            g_bytes_unref(resp);
+        }
+    } else {
+        tx->resp_bytes(tx->t4, ISO_SW_IO_ERR, NULL, tx->user_data);
+    }
+}
+
 static
 guint
 nfc_isodep_submit(
@@ -253,7 +398,9 @@ nfc_isodep_submit(
     const GUtilData* data,  /* Command data */
     guint le,               /* Expected length */
     NfcTargetSequence* seq,
+    const NfcTargetRetryPolicy* retry,
     NfcTagType4ResponseFunc resp,
+    NfcTagType4ResponseBytesFunc resp_bytes,
     GDestroyNotify destroy,
     void* user_data)
 {
@@ -272,15 +419,29 @@ nfc_isodep_submit(
 
     if (nfc_tag_t4_build_apdu(buf, cla, ins, p1, p2, len, bytes, le)) {
         NfcTag* tag = &self->tag;
-        NfcIsoDepTx* tx = g_slice_new0(NfcIsoDepTx);
+        NfcIsoDepTx* tx = nfc_target_pool_new0(tag->target, NfcIsoDepTx);
+        NfcTargetTransmitOptions opt = NFC_TARGET_TRANSMIT_OPTIONS_INIT;
         guint id;
 
+        opt.retry = retry;
+        opt.rtt_class = NFC_TARGET_RTT_CLASS(ins);
         tx->t4 = self;
         tx->resp = resp;
+        tx->resp_bytes = resp_bytes;
         tx->destroy = destroy;
         tx->user_data = user_data;
-        id = nfc_target_transmit(tag->target, buf->data, buf->len, seq,
-            resp ? nfc_tag_t4_tx_resp : NULL, nfc_tag_t4_tx_free1, tx);
+        if (resp_bytes) {
+            /* The APDU gets copied, only the response is zero-copy */
+            GBytes* apdu = g_bytes_new(buf->data, buf->len);
+
+            id = nfc_target_transmit_bytes_full(tag->target, apdu, seq,
+                &opt, nfc_tag_t4_tx_resp_bytes, nfc_tag_t4_tx_free1, tx);
+            g_bytes_unref(apdu);
+        } else {
+            id = nfc_target_transmit_full(tag->target, buf->data, buf->len,
+                seq, &opt, resp ? nfc_tag_t4_tx_resp : NULL,
+                nfc_tag_t4_tx_free1, tx);
+        }
         if (id) {
             return id;
         } else {
@@ -291,6 +452,21 @@ nfc_isodep_submit(
     return 0;
 }
 
+static
+guint8
+nfc_tag_t4_sfi(
+    const guint8* fid)
+{
+    /*
+     * ISO/IEC 7816-4 doesn't define how short EF identifiers are
+     * assigned, but cards normally derive them from the five lowest
+     * bits of the file identifier (e.g. E103h => 03h).
+     */
+    const guint8 sfi = fid[1] & ISO_SHORT_FID_MASK;
+
+    return (sfi >= ISO_SFI_MIN && sfi <= ISO_SFI_MAX) ? sfi : 0;
+}
+
 static
 NfcIsoDepNdefRead*
 nfc_iso_dep_ndef_read_new(
@@ -328,11 +504,17 @@ nfc_iso_dep_ndef_read_new(
                     NfcIsoDepNdefRead* read = g_slice_new0(NfcIsoDepNdefRead);
 
                     read->max_read = max_read;
+                    read->max_write = ((((guint)(cc[5])) << 8) | cc[6]);
+                    read->max_size = ((((guint)(v[2])) << 8) | v[3]);
+                    read->writable = (v[5] == 0 /* write access granted */);
                     read->fid[0] = v[0];
                     read->fid[1] = v[1];
+                    read->sfi = nfc_tag_t4_sfi(read->fid);
                     read->t4 = self;
                     GDEBUG("NDEF file: %04X", fid);
                     GVERBOSE("Max read: %u bytes", read->max_read);
+                    GVERBOSE("Max write: %u bytes", read->max_write);
+                    GVERBOSE("Max NDEF size: %u bytes", read->max_size);
                     return read;
                 } else {
                     GDEBUG("MLe too small (%u)", max_read);
@@ -401,6 +583,14 @@ nfc_tag_t4_ndef_read_done(
      */
     nfc_target_sequence_unref(priv->init_seq);
     priv->init_seq = NULL;
+
+    /* NDEF can be used while the tag is being reactivated */
+    nfc_tag_set_stage(&self->tag, NFC_TAG_STAGE_NDEF_PARSED);
+    if (priv->reactivate == NFC_TAG_T4_REACTIVATE_NEVER) {
+        GDEBUG("Type 4 tag doesn't need to be reactivated");
+        nfc_tag_t4_initialized(self);
+        return;
+    }
     GDEBUG("Reactivating Type 4 tag");
     if (!nfc_target_reactivate(self->tag.target, nfc_tag_t4_init_done, self)) {
         GDEBUG("Oops. Failed to reactivate, leaving the tag as is");
@@ -408,6 +598,91 @@ nfc_tag_t4_ndef_read_done(
     }
 }
 
+static
+NFC_TAG_T4_EXT_LEN
+nfc_tag_t4_parse_hb(
+    const GUtilData* hb)
+{
+    /*
+     * ISO/IEC 7816-4
+     * Section 8.1.1 Historical bytes
+     *
+     * Only compact-TLV format is supported. The third byte of
+     * the card capabilities tells whether the card understands
+     * extended Lc and Le fields.
+     */
+    if (hb && hb->size > 0 && hb->bytes[0] == ISO_HB_COMPACT_TLV) {
+        const guint8* ptr = hb->bytes + 1;
+        const guint8* end = hb->bytes + hb->size;
+
+        while (ptr < end) {
+            const guint tag = ptr[0] >> 4;
+            const guint len = ptr[0] & 0x0f;
+
+            ptr++;
+            if (ptr + len > end) {
+                break;
+            } else if (tag == ISO_HB_CARD_CAPS && len >= 3) {
+                return (ptr[2] & ISO_HB_CAPS_EXT_LC_LE) ?
+                    NFC_TAG_T4_EXT_LEN_SUPPORTED :
+                    NFC_TAG_T4_EXT_LEN_UNSUPPORTED;
+            }
+            ptr += len;
+        }
+    }
+    return NFC_TAG_T4_EXT_LEN_UNKNOWN;
+}
+
+static
+NFC_TAG_T4_REACTIVATE
+nfc_tag_t4_reactivate_policy(
+    const GUtilData* hb)
+{
+    GSList* l;
+
+    for (l = nfc_tag_t4_reactivate_rules; l; l = l->next) {
+        const NfcTagType4ReactivateRule* rule = l->data;
+        gsize size;
+        const void* prefix = g_bytes_get_data(rule->hb, &size);
+
+        if (!size || (hb && hb->size >= size &&
+            !memcmp(hb->bytes, prefix, size))) {
+            return rule->policy;
+        }
+    }
+    return NFC_TAG_T4_REACTIVATE_ALWAYS;
+}
+
+static
+void
+nfc_tag_t4_reactivate_rule_free(
+    gpointer data)
+{
+    NfcTagType4ReactivateRule* rule = data;
+
+    g_bytes_unref(rule->hb);
+    g_slice_free(NfcTagType4ReactivateRule, rule);
+}
+
+static
+guint
+nfc_tag_t4_max_le(
+    NfcTagType4* self)
+{
+    return (self->priv->ext_len == NFC_TAG_T4_EXT_LEN_UNSUPPORTED) ?
+        NDEF_MAX_SHORT_LE : NDEF_MAX_EXT_LE;
+}
+
+static
+guint
+nfc_tag_t4_max_lc(
+    NfcTagType4* self)
+{
+    /* Extended Lc is only used if the card has explicitly declared it */
+    return (self->priv->ext_len == NFC_TAG_T4_EXT_LEN_SUPPORTED) ?
+        NDEF_MAX_EXT_LC : NDEF_MAX_SHORT_LC;
+}
+
 static
 guint
 nfc_isodep_init_read_binary(
@@ -418,7 +693,34 @@ nfc_isodep_init_read_binary(
 {
     return nfc_isodep_submit(self, ISO_CLA, ISO_INS_READ_BINARY,
         (guint8)(offset >> 8), (guint8)offset, NULL, le,
-        self->priv->init_seq, resp, NULL, NULL);
+        self->priv->init_seq, &nfc_tag_t4_retry, resp, NULL, NULL, NULL);
+}
+
+static
+guint
+nfc_isodep_init_read_sfi(
+    NfcTagType4* self,
+    guint8 sfi,
+    guint le,
+    NfcTagType4ResponseFunc resp)
+{
+    /* Implicitly selects the file (and makes it the current EF) */
+    return nfc_isodep_submit(self, ISO_CLA, ISO_INS_READ_BINARY,
+        ISO_P1_READ_SFI | sfi, 0, NULL, le, self->priv->init_seq,
+        &nfc_tag_t4_retry, resp, NULL, NULL, NULL);
+}
+
+static
+void
+nfc_tag_t4_init_parse_ndef(
+    NfcTagType4* self)
+{
+    GByteArray* buf = self->priv->init_read->data;
+    GUtilData ndef;
+
+    ndef.bytes = buf->data;
+    ndef.size = buf->len;
+    self->tag.ndef = nfc_ndef_rec_new(&ndef);
 }
 
 static
@@ -428,32 +730,71 @@ nfc_tag_t4_init_read_ndef_data_resp(
     guint sw,
     const void* data,
     guint len,
-    void* user_data)
+    void* user_data);
+
+static
+gboolean
+nfc_tag_t4_init_read_ndef_data(
+    NfcTagType4* self)
 {
     NfcTagType4Priv* priv = self->priv;
+    NfcIsoDepNdefRead* read = priv->init_read;
+    const guint remaining = read->data_len - read->data->len;
+    guint le = MIN(remaining, MIN(read->max_read, nfc_tag_t4_max_le(self)));
+
+    /*
+     * Each READ BINARY fetches as much as MLe and the card allow. There's
+     * no point in limiting it to FSC, responses which don't fit into a
+     * single ISO-DEP frame are chained by the NFCC without involving us.
+     * If we don't know whether the card supports extended Le, we try it
+     * and fall back to short APDUs if the card doesn't like it.
+     */
+    read->probe = (le > NDEF_MAX_SHORT_LE &&
+        priv->ext_len == NFC_TAG_T4_EXT_LEN_UNKNOWN);
+    if (read->probe) {
+        GDEBUG("Probing extended Le");
+    }
+    GVERBOSE("Reading %u NDEF byte(s) at %u", le, read->data->len);
+    priv->init_id = nfc_isodep_init_read_binary(self, read->data->len +
+        NDEF_DATA_OFFSET, le, nfc_tag_t4_init_read_ndef_data_resp);
+    return priv->init_id != 0;
+}
 
+static
+void
+nfc_tag_t4_init_read_ndef_data_resp(
+    NfcTagType4* self,
+    guint sw,
+    const void* data,
+    guint len,
+    void* user_data)
+{
+    NfcTagType4Priv* priv = self->priv;
+    NfcIsoDepNdefRead* read = priv->init_read;
+
+    if (read->probe) {
+        if (sw == ISO_SW_OK) {
+            GDEBUG("Extended Le is supported");
+            priv->ext_len = NFC_TAG_T4_EXT_LEN_SUPPORTED;
+        } else if (sw != ISO_SW_IO_ERR) {
+            GDEBUG("Extended Le is not supported (%04X)", sw);
+            priv->ext_len = NFC_TAG_T4_EXT_LEN_UNSUPPORTED;
+            if (nfc_tag_t4_init_read_ndef_data(self)) {
+                return;
+            }
+        }
+    }
     if (sw == ISO_SW_OK) {
         if (len > 0) {
-            NfcIsoDepNdefRead* read = priv->init_read;
             GByteArray* buf = read->data;
 
             g_byte_array_append(buf, data, len);
             if (buf->len < read->data_len) {
-                const guint remaining = read->data_len - buf->len;
-
-                if ((priv->init_id = nfc_isodep_init_read_binary(self,
-                    buf->len + NDEF_DATA_OFFSET,
-                    MIN(remaining, read->max_read),
-                    nfc_tag_t4_init_read_ndef_data_resp)) != 0) {
+                if (nfc_tag_t4_init_read_ndef_data(self)) {
                     return;
                 }
             } else {
-                GUtilData ndef;
-
-                /* Parse the NDEF */
-                ndef.bytes = buf->data;
-                ndef.size = buf->len;
-                self->tag.ndef = nfc_ndef_rec_new(&ndef);
+                nfc_tag_t4_init_parse_ndef(self);
             }
         } else {
             GDEBUG("Empty NDEF read");
@@ -467,6 +808,53 @@ nfc_tag_t4_init_read_ndef_data_resp(
     nfc_tag_t4_ndef_read_done(self);
 }
 
+static
+gboolean
+nfc_tag_t4_init_ndef_head(
+    NfcTagType4* self,
+    const guint8* data,
+    guint len)
+{
+    NfcTagType4Priv* priv = self->priv;
+    NfcIsoDepNdefRead* read = priv->init_read;
+
+    /* NLEN followed by the beginning of the NDEF message */
+    if (len >= NDEF_DATA_OFFSET) {
+        read->data_len = ((((guint)(data[0])) << 8) | data[1]);
+        if (read->data_len > 0) {
+            GDEBUG("Reading %u bytes of NDEF data", read->data_len);
+            read->data = g_byte_array_sized_new(read->data_len);
+            g_byte_array_append(read->data, data + NDEF_DATA_OFFSET,
+                MIN(len - NDEF_DATA_OFFSET, read->data_len));
+            if (read->data->len < read->data_len) {
+                return nfc_tag_t4_init_read_ndef_data(self);
+            }
+            nfc_tag_t4_init_parse_ndef(self);
+        } else {
+            GDEBUG("NDEF is empty");
+        }
+    } else {
+        GDEBUG("Unexpected number of bytes from NDEF file (%u)", len);
+    }
+    return FALSE;
+}
+
+static
+guint
+nfc_tag_t4_init_head_le(
+    NfcTagType4* self)
+{
+    NfcIsoDepNdefRead* read = self->priv->init_read;
+    guint le = MIN(read->max_read, read->max_size);
+
+    /* Don't probe extended Le here, it would get in the way of fallbacks */
+    if (le > NDEF_MAX_SHORT_LE &&
+        self->priv->ext_len != NFC_TAG_T4_EXT_LEN_SUPPORTED) {
+        le = NDEF_MAX_SHORT_LE;
+    }
+    return MAX(le, NDEF_DATA_OFFSET);
+}
+
 static
 void
 nfc_tag_t4_init_read_ndef_len_resp(
@@ -487,9 +875,7 @@ nfc_tag_t4_init_read_ndef_len_resp(
             if (read->data_len > 0) {
                 GDEBUG("Reading %u bytes of NDEF data", read->data_len);
                 read->data = g_byte_array_sized_new(read->data_len);
-                if ((priv->init_id = nfc_isodep_init_read_binary(self,
-                    NDEF_DATA_OFFSET, MIN(read->data_len, read->max_read),
-                    nfc_tag_t4_init_read_ndef_data_resp)) != 0) {
+                if (nfc_tag_t4_init_read_ndef_data(self)) {
                     return;
                 }
             } else {
@@ -507,6 +893,35 @@ nfc_tag_t4_init_read_ndef_len_resp(
     nfc_tag_t4_ndef_read_done(self);
 }
 
+static
+void
+nfc_tag_t4_init_read_ndef_head_resp(
+    NfcTagType4* self,
+    guint sw,
+    const void* data,
+    guint len,
+    void* user_data)
+{
+    NfcTagType4Priv* priv = self->priv;
+
+    priv->init_id = 0;
+    if (sw == ISO_SW_OK) {
+        if (nfc_tag_t4_init_ndef_head(self, data, len)) {
+            return;
+        }
+    } else if (sw != ISO_SW_IO_ERR) {
+        GDEBUG("NDEF read error %04X, reading NLEN only", sw);
+        /* Read first 2 bytes of the NDEF file (record size) */
+        if ((priv->init_id = nfc_isodep_init_read_binary(self, 0,
+            NDEF_DATA_OFFSET, nfc_tag_t4_init_read_ndef_len_resp)) != 0) {
+            return;
+        }
+    } else {
+        GDEBUG("NDEF read I/O error");
+    }
+    nfc_tag_t4_ndef_read_done(self);
+}
+
 static
 void
 nfc_tag_t4_init_select_ndef_resp(
@@ -522,9 +937,11 @@ nfc_tag_t4_init_select_ndef_resp(
         NfcIsoDepNdefRead* read = priv->init_read;
 
         GDEBUG("Selected %02X%02X", read->fid[0], read->fid[1]);
-        /* Read first 2 bytes of the NDEF file (record size) */
+        nfc_tag_set_stage(&self->tag, NFC_TAG_STAGE_NDEF_LOCATED);
+        /* NLEN and as much of the NDEF message as MLe allows */
         if ((priv->init_id = nfc_isodep_init_read_binary(self, 0,
-            NDEF_DATA_OFFSET, nfc_tag_t4_init_read_ndef_len_resp)) != 0) {
+            nfc_tag_t4_init_head_le(self),
+            nfc_tag_t4_init_read_ndef_head_resp)) != 0) {
             return;
         }
     } else if (sw != ISO_SW_IO_ERR) {
@@ -536,6 +953,114 @@ nfc_tag_t4_init_select_ndef_resp(
     nfc_tag_t4_ndef_read_done(self);
 }
 
+static
+gboolean
+nfc_tag_t4_init_select_ndef(
+    NfcTagType4* self)
+{
+    NfcTagType4Priv* priv = self->priv;
+    GUtilData fid;
+
+    /*
+     * Table 18: NDEF Select Command C-APDU
+     * 00A4000C02xxxx
+     */
+    fid.bytes = priv->init_read->fid;
+    fid.size = 2;
+    priv->init_id = nfc_isodep_submit(self, ISO_CLA, ISO_INS_SELECT,
+        ISO_P1_SELECT_BY_ID, ISO_P2_SELECT_FILE_FIRST | ISO_P2_RESPONSE_NONE,
+        &fid, 0, priv->init_seq, &nfc_tag_t4_retry,
+        nfc_tag_t4_init_select_ndef_resp, NULL, NULL, NULL);
+    return priv->init_id != 0;
+}
+
+static
+gboolean
+nfc_tag_t4_init_sfi_ndef_len_ok(
+    NfcTagType4* self,
+    const guint8* data,
+    guint len)
+{
+    const NfcIsoDepNdefRead* read = self->priv->init_read;
+
+    /*
+     * Nothing has been selected, make sure that it actually looks
+     * like the NDEF file described by the CC. NLEN can't exceed the
+     * maximum NDEF file size (which includes NLEN itself).
+     */
+    if (len >= NDEF_DATA_OFFSET) {
+        const guint nlen = ((((guint)(data[0])) << 8) | data[1]);
+
+        if (nlen + NDEF_DATA_OFFSET <= read->max_size) {
+            return TRUE;
+        }
+        GDEBUG("NLEN %u doesn't fit into %u bytes", nlen, read->max_size);
+    }
+    return FALSE;
+}
+
+static
+void
+nfc_tag_t4_init_read_sfi_ndef_resp(
+    NfcTagType4* self,
+    guint sw,
+    const void* data,
+    guint len,
+    void* user_data)
+{
+    NfcTagType4Priv* priv = self->priv;
+
+    priv->init_id = 0;
+    if (sw == ISO_SW_OK && nfc_tag_t4_init_sfi_ndef_len_ok(self, data, len)) {
+        nfc_tag_set_stage(&self->tag, NFC_TAG_STAGE_NDEF_LOCATED);
+        if (nfc_tag_t4_init_ndef_head(self, data, len)) {
+            return;
+        }
+    } else if (sw != ISO_SW_IO_ERR) {
+        GDEBUG("NDEF read by SFI failed (%04X), selecting the file", sw);
+        priv->no_sfi = TRUE;
+        if (nfc_tag_t4_init_select_ndef(self)) {
+            return;
+        }
+    } else {
+        GDEBUG("NDEF read I/O error");
+    }
+    nfc_tag_t4_ndef_read_done(self);
+}
+
+static
+gboolean
+nfc_tag_t4_init_ndef_cc(
+    NfcTagType4* self,
+    const void* data,
+    guint len)
+{
+    NfcTagType4Priv* priv = self->priv;
+
+    if (len < NDEF_CC_LEN) {
+        GDEBUG("Not enough data for NDEF Capability Container");
+    } else {
+        GDEBUG("NDEF Capability Container");
+        nfc_hexdump(data, len);
+        priv->init_read = nfc_iso_dep_ndef_read_new(self, data);
+        if (priv->init_read) {
+            NfcIsoDepNdefRead* read = priv->init_read;
+
+            if (read->sfi && !priv->no_sfi) {
+                /* Skip SELECT, read NLEN and the data right away */
+                GDEBUG("Reading NDEF file by SFI %02X", read->sfi);
+                priv->init_id = nfc_isodep_init_read_sfi(self, read->sfi,
+                    nfc_tag_t4_init_head_le(self),
+                    nfc_tag_t4_init_read_sfi_ndef_resp);
+                return priv->init_id != 0;
+            } else {
+                return nfc_tag_t4_init_select_ndef(self);
+            }
+        }
+    }
+    return FALSE;
+}
+
 static
 void
 nfc_tag_t4_init_read_ndef_cc_resp(
@@ -548,29 +1073,8 @@ nfc_tag_t4_init_read_ndef_cc_resp(
     NfcTagType4Priv* priv = self->priv;
 
     if (sw == ISO_SW_OK) {
-        if (len < NDEF_CC_LEN) {
-            GDEBUG("Not enough data for NDEF Capability Container");
-        } else {
-            GDEBUG("NDEF Capability Container");
-            nfc_hexdump(data, len);
-            priv->init_read = nfc_iso_dep_ndef_read_new(self, data);
-            if (priv->init_read) {
-                GUtilData fid;
-
-                /*
-                 * Table 18: NDEF Select Command C-APDU
-                 * 00A4000C02xxxx
-                 */
-                fid.bytes = priv->init_read->fid;
-                fid.size = 2;
-                if ((priv->init_id = nfc_isodep_submit(self, ISO_CLA,
-                    ISO_INS_SELECT, ISO_P1_SELECT_BY_ID,
-                    ISO_P2_SELECT_FILE_FIRST | ISO_P2_RESPONSE_NONE,
-                    &fid, 0, priv->init_seq,
-                    nfc_tag_t4_init_select_ndef_resp, NULL, NULL)) != 0) {
-                    return;
-                }
-            }
+        if (nfc_tag_t4_init_ndef_cc(self, data, len)) {
+            return;
         }
     } else if (sw != ISO_SW_IO_ERR) {
         GDEBUG("NDEF Capability Container read error %04X", sw);
@@ -618,9 +1122,64 @@ nfc_tag_t4_init_select_ndef_cc_resp(
     nfc_tag_t4_ndef_read_done(self);
 }
 
+static
+gboolean
+nfc_tag_t4_init_select_ndef_cc(
+    NfcTagType4* self)
+{
+    NfcTagType4Priv* priv = self->priv;
+
+    /*
+     * Table 12: Capability Container Select Command C-APDU
+     * 00A4000C02E103
+     */
+    priv->init_id = nfc_isodep_submit(self, ISO_CLA, ISO_INS_SELECT,
+        ISO_P1_SELECT_BY_ID, ISO_P2_SELECT_FILE_FIRST | ISO_P2_RESPONSE_NONE,
+        &ndef_cc_ef_data, 0, priv->init_seq, &nfc_tag_t4_retry,
+        nfc_tag_t4_init_select_ndef_cc_resp, NULL, NULL, NULL);
+    return priv->init_id != 0;
+}
+
 static
 void
-nfc_tag_t4_init_select_ndef_app_resp(
+nfc_tag_t4_init_read_sfi_cc_resp(
+    NfcTagType4* self,
+    guint sw,
+    const void* data,
+    guint len,
+    void* user_data)
+{
+    NfcTagType4Priv* priv = self->priv;
+
+    priv->init_id = 0;
+    if (sw == ISO_SW_OK && len >= NDEF_CC_LEN) {
+        if (nfc_tag_t4_init_ndef_cc(self, data, len)) {
+            return;
+        }
+        if (!priv->init_read) {
+            /* Whatever we have read, it's not a valid CC */
+            GDEBUG("Invalid CC read by SFI, selecting the file");
+            priv->no_sfi = TRUE;
+            if (nfc_tag_t4_init_select_ndef_cc(self)) {
+                return;
+            }
+        }
+    } else if (sw != ISO_SW_IO_ERR) {
+        /* Short EF identifiers don't seem to be supported */
+        GDEBUG("CC read by SFI failed (%04X), selecting the file", sw);
+        priv->no_sfi = TRUE;
+        if (nfc_tag_t4_init_select_ndef_cc(self)) {
+            return;
+        }
+    } else {
+        GDEBUG("NDEF Capability Container read I/O error");
+    }
+    nfc_tag_t4_ndef_read_done(self);
+}
+
+static
+void
+nfc_tag_t4_init_select_ndef_app_resp(
     NfcTagType4* self,
     guint sw,
     const void* data,
@@ -640,14 +1199,14 @@ nfc_tag_t4_init_select_ndef_app_resp(
     if (sw == ISO_SW_OK) {
         GDEBUG("Found NDEF Tag Application");
         /*
-         * Table 12: Capability Container Select Command C-APDU
-         * 00A4000C02E103
+         * Try to read the CC without selecting it first. The NDEF
+         * file is then read the same way (if its FID allows that).
+         * If the card doesn't support short EF identifiers, fall
+         * back to explicit SELECT commands.
          */
-        if ((priv->init_id = nfc_isodep_submit(self, ISO_CLA,
-            ISO_INS_SELECT, ISO_P1_SELECT_BY_ID,
-            ISO_P2_SELECT_FILE_FIRST | ISO_P2_RESPONSE_NONE,
-            &ndef_cc_ef_data, 0, priv->init_seq,
-            nfc_tag_t4_init_select_ndef_cc_resp, NULL, NULL)) != 0) {
+        if ((priv->init_id = nfc_isodep_init_read_sfi(self,
+            nfc_tag_t4_sfi(ndef_cc_ef), NDEF_CC_LEN,
+            nfc_tag_t4_init_read_sfi_cc_resp)) != 0) {
             return;
         }
     } else if (sw == ISO_SW_NDEF_NOT_FOUND) {
@@ -663,6 +1222,467 @@ nfc_tag_t4_init_select_ndef_app_resp(
     nfc_tag_t4_initialized(self);
 }
 
+/*==========================================================================*
+ * NDEF write
+ *==========================================================================*/
+
+static
+void
+nfc_tag_t4_ndef_write_free(
+    NfcTagType4NdefWrite* write)
+{
+    NfcTarget* target = write->t4->tag.target;
+
+    nfc_target_cancel_transmit(target, write->cmd_id);
+    nfc_target_sequence_unref(write->seq);
+    nfc_iso_dep_ndef_read_free(write->file);
+    g_bytes_unref(write->ndef);
+    if (write->destroy) {
+        write->destroy(write->user_data);
+    }
+    g_slice_free1(sizeof(*write), write);
+}
+
+static
+void
+nfc_tag_t4_ndef_write_free1(
+    gpointer write)
+{
+    nfc_tag_t4_ndef_write_free((NfcTagType4NdefWrite*)write);
+}
+
+static
+void
+nfc_tag_t4_ndef_write_done(
+    NfcTagType4NdefWrite* write,
+    NFC_TAG_T4_IO_STATUS status)
+{
+    NfcTagType4* self = write->t4;
+    NfcTagType4Priv* priv = self->priv;
+    NfcTag* tag = &self->tag;
+
+    GDEBUG("NDEF write #%u %s", write->id, status == NFC_TAG_T4_IO_STATUS_OK ?
+        "done" : "failed");
+    write->cmd_id = 0;
+    priv->writes = g_slist_remove(priv->writes, write);
+    nfc_tag_ref(tag);
+    if (write->complete) {
+        write->complete(self, status, write->user_data);
+    }
+    nfc_tag_t4_ndef_write_free(write);
+    nfc_tag_unref(tag);
+}
+
+static
+void
+nfc_tag_t4_ndef_write_error(
+    NfcTagType4NdefWrite* write,
+    guint sw,
+    const char* what)
+{
+    if (sw == ISO_SW_IO_ERR) {
+        GDEBUG("%s I/O error", what);
+        nfc_tag_t4_ndef_write_done(write, NFC_TAG_T4_IO_STATUS_IO_ERROR);
+    } else if (sw == ISO_SW_NDEF_NOT_FOUND) {
+        GDEBUG("%s not found", what);
+        nfc_tag_t4_ndef_write_done(write, NFC_TAG_T4_IO_STATUS_NOT_NDEF);
+    } else {
+        GDEBUG("%s error %04X", what, sw);
+        nfc_tag_t4_ndef_write_done(write, NFC_TAG_T4_IO_STATUS_FAILURE);
+    }
+}
+
+static
+void
+nfc_tag_t4_ndef_write_submit(
+    NfcTagType4NdefWrite* write,
+    guint8 ins,
+    guint8 p1,
+    guint8 p2,
+    const GUtilData* data,
+    guint le,
+    NfcTagType4ResponseFunc resp)
+{
+    /* All commands of the NDEF Update procedure can be safely repeated */
+    write->cmd_id = nfc_isodep_submit(write->t4, ISO_CLA, ins, p1, p2,
+        data, le, write->seq, &nfc_tag_t4_retry, resp, NULL, NULL, write);
+    if (!write->cmd_id) {
+        nfc_tag_t4_ndef_write_done(write, NFC_TAG_T4_IO_STATUS_IO_ERROR);
+    }
+}
+
+static
+void
+nfc_tag_t4_ndef_write_update(
+    NfcTagType4NdefWrite* write,
+    guint offset,
+    const void* bytes,
+    guint len,
+    NfcTagType4ResponseFunc resp)
+{
+    GUtilData data;
+
+    data.bytes = bytes;
+    data.size = len;
+    nfc_tag_t4_ndef_write_submit(write, ISO_INS_UPDATE_BINARY,
+        (guint8)(offset >> 8), (guint8)offset, &data, 0, resp);
+}
+
+static
+void
+nfc_tag_t4_ndef_write_nlen_resp(
+    NfcTagType4* self,
+    guint sw,
+    const void* data,
+    guint len,
+    void* user_data)
+{
+    NfcTagType4NdefWrite* write = user_data;
+
+    write->cmd_id = 0;
+    if (sw == ISO_SW_OK) {
+        nfc_tag_t4_ndef_write_done(write, NFC_TAG_T4_IO_STATUS_OK);
+    } else {
+        nfc_tag_t4_ndef_write_error(write, sw, "NLEN update");
+    }
+}
+
+static
+void
+nfc_tag_t4_ndef_write_data_resp(
+    NfcTagType4* self,
+    guint sw,
+    const void* data,
+    guint len,
+    void* user_data);
+
+static
+void
+nfc_tag_t4_ndef_write_next(
+    NfcTagType4NdefWrite* write)
+{
+    gsize size;
+    const guint8* ndef = g_bytes_get_data(write->ndef, &size);
+
+    if (write->written < size) {
+        /* MLc limits the size of each chunk */
+        write->chunk = MIN(MIN(write->file->max_write,
+            nfc_tag_t4_max_lc(write->t4)), size - write->written);
+        GVERBOSE("Writing %u NDEF byte(s) at %u", write->chunk,
+            write->written);
+        nfc_tag_t4_ndef_write_update(write, NDEF_DATA_OFFSET +
+            write->written, ndef + write->written, write->chunk,
+            nfc_tag_t4_ndef_write_data_resp);
+    } else {
+        guint8 nlen[NDEF_DATA_OFFSET];
+
+        /* The data are in place, now make them visible */
+        nlen[0] = (guint8)(size >> 8);
+        nlen[1] = (guint8)size;
+        nfc_tag_t4_ndef_write_update(write, 0, nlen, sizeof(nlen),
+            nfc_tag_t4_ndef_write_nlen_resp);
+    }
+}
+
+static
+void
+nfc_tag_t4_ndef_write_data_resp(
+    NfcTagType4* self,
+    guint sw,
+    const void* data,
+    guint len,
+    void* user_data)
+{
+    NfcTagType4NdefWrite* write = user_data;
+
+    write->cmd_id = 0;
+    if (sw == ISO_SW_OK) {
+        write->written += write->chunk;
+        nfc_tag_t4_ndef_write_next(write);
+    } else {
+        nfc_tag_t4_ndef_write_error(write, sw, "NDEF update");
+    }
+}
+
+static
+void
+nfc_tag_t4_ndef_write_clear_resp(
+    NfcTagType4* self,
+    guint sw,
+    const void* data,
+    guint len,
+    void* user_data)
+{
+    NfcTagType4NdefWrite* write = user_data;
+
+    write->cmd_id = 0;
+    if (sw == ISO_SW_OK) {
+        nfc_tag_t4_ndef_write_next(write);
+    } else {
+        nfc_tag_t4_ndef_write_error(write, sw, "NLEN reset");
+    }
+}
+
+static
+void
+nfc_tag_t4_ndef_write_select_file_resp(
+    NfcTagType4* self,
+    guint sw,
+    const void* data,
+    guint len,
+    void* user_data)
+{
+    NfcTagType4NdefWrite* write = user_data;
+
+    write->cmd_id = 0;
+    if (sw == ISO_SW_OK) {
+        static const guint8 zero[NDEF_DATA_OFFSET] = { 0, 0 };
+
+        /* Invalidate the NDEF while it's being written */
+        nfc_tag_t4_ndef_write_update(write, 0, zero, sizeof(zero),
+            nfc_tag_t4_ndef_write_clear_resp);
+    } else {
+        nfc_tag_t4_ndef_write_error(write, sw, "NDEF file");
+    }
+}
+
+static
+void
+nfc_tag_t4_ndef_write_read_cc_resp(
+    NfcTagType4* self,
+    guint sw,
+    const void* data,
+    guint len,
+    void* user_data)
+{
+    NfcTagType4NdefWrite* write = user_data;
+
+    write->cmd_id = 0;
+    if (sw == ISO_SW_OK) {
+        if (len >= NDEF_CC_LEN &&
+            (write->file = nfc_iso_dep_ndef_read_new(self, data)) != NULL) {
+            NfcIsoDepNdefRead* file = write->file;
+            const guint size = NDEF_DATA_OFFSET +
+                g_bytes_get_size(write->ndef);
+
+            if (!file->writable) {
+                GDEBUG("NDEF file is read-only");
+                nfc_tag_t4_ndef_write_done(write,
+                    NFC_TAG_T4_IO_STATUS_READ_ONLY);
+            } else if (!file->max_write) {
+                GDEBUG("Invalid MLc");
+                nfc_tag_t4_ndef_write_done(write,
+                    NFC_TAG_T4_IO_STATUS_NOT_NDEF);
+            } else if (size > MIN(file->max_size, NDEF_MAX_FILE_SIZE)) {
+                GDEBUG("NDEF is too large (%u > %u)", size, file->max_size);
+                nfc_tag_t4_ndef_write_done(write,
+                    NFC_TAG_T4_IO_STATUS_BAD_SIZE);
+            } else {
+                GUtilData fid;
+
+                fid.bytes = file->fid;
+                fid.size = sizeof(file->fid);
+                nfc_tag_t4_ndef_write_submit(write, ISO_INS_SELECT,
+                    ISO_P1_SELECT_BY_ID, ISO_P2_SELECT_FILE_FIRST |
+                    ISO_P2_RESPONSE_NONE, &fid, 0,
+                    nfc_tag_t4_ndef_write_select_file_resp);
+            }
+        } else {
+            GDEBUG("Unusable NDEF Capability Container");
+            nfc_tag_t4_ndef_write_done(write, NFC_TAG_T4_IO_STATUS_NOT_NDEF);
+        }
+    } else {
+        nfc_tag_t4_ndef_write_error(write, sw, "NDEF Capability Container");
+    }
+}
+
+static
+void
+nfc_tag_t4_ndef_write_select_cc_resp(
+    NfcTagType4* self,
+    guint sw,
+    const void* data,
+    guint len,
+    void* user_data)
+{
+    NfcTagType4NdefWrite* write = user_data;
+
+    write->cmd_id = 0;
+    if (sw == ISO_SW_OK) {
+        nfc_tag_t4_ndef_write_submit(write, ISO_INS_READ_BINARY, 0, 0,
+            NULL, NDEF_CC_LEN, nfc_tag_t4_ndef_write_read_cc_resp);
+    } else {
+        nfc_tag_t4_ndef_write_error(write, sw, "NDEF Capability Container");
+    }
+}
+
+static
+void
+nfc_tag_t4_ndef_write_select_app_resp(
+    NfcTagType4* self,
+    guint sw,
+    const void* data,
+    guint len,
+    void* user_data)
+{
+    NfcTagType4NdefWrite* write = user_data;
+
+    write->cmd_id = 0;
+    if (sw == ISO_SW_OK) {
+        nfc_tag_t4_ndef_write_submit(write, ISO_INS_SELECT,
+            ISO_P1_SELECT_BY_ID, ISO_P2_SELECT_FILE_FIRST |
+            ISO_P2_RESPONSE_NONE, &ndef_cc_ef_data, 0,
+            nfc_tag_t4_ndef_write_select_cc_resp);
+    } else {
+        nfc_tag_t4_ndef_write_error(write, sw, "NDEF Tag Application");
+    }
+}
+
+/*==========================================================================*
+ * Response chaining
+ *==========================================================================*/
+
+static
+void
+nfc_isodep_chain_free(
+    NfcIsoDepChain* chain)
+{
+    NfcTarget* target = chain->t4->tag.target;
+
+    nfc_target_cancel_transmit(target, chain->cmd_id);
+    nfc_target_sequence_unref(chain->seq);
+    if (chain->data) {
+        g_bytes_unref(chain->data);
+    }
+    if (chain->resp_data) {
+        g_byte_array_free(chain->resp_data, TRUE);
+    }
+    if (chain->destroy) {
+        chain->destroy(chain->user_data);
+    }
+    g_slice_free1(sizeof(*chain), chain);
+}
+
+static
+void
+nfc_isodep_chain_free1(
+    gpointer chain)
+{
+    nfc_isodep_chain_free((NfcIsoDepChain*)chain);
+}
+
+static
+void
+nfc_isodep_chain_done(
+    NfcIsoDepChain* chain,
+    guint sw)
+{
+    NfcTagType4* self = chain->t4;
+    NfcTagType4Priv* priv = self->priv;
+    NfcTag* tag = &self->tag;
+
+    chain->cmd_id = 0;
+    priv->chains = g_slist_remove(priv->chains, chain);
+    nfc_tag_ref(tag);
+    if (sw == ISO_SW_IO_ERR) {
+        GDEBUG("APDU chain #%u failed", chain->id);
+        chain->resp(self, ISO_SW_IO_ERR, NULL, chain->user_data);
+    } else {
+        GBytes* data = g_byte_array_free_to_bytes(chain->resp_data);
+
+        chain->resp_data = NULL;
+        GDEBUG("APDU chain #%u done, %u byte(s) %04X", chain->id,
+            (guint)g_bytes_get_size(data), sw);
+        chain->resp(self, sw, data, chain->user_data);
+        g_bytes_unref(data);
+    }
+    nfc_isodep_chain_free(chain);
+    nfc_tag_unref(tag);
+}
+
+static
+void
+nfc_isodep_chain_resp(
+    NfcTagType4* self,
+    guint sw,
+    const void* data,
+    guint len,
+    void* user_data);
+
+static
+guint
+nfc_isodep_chain_submit(
+    NfcIsoDepChain* chain,
+    guint le)
+{
+    /* Arbitrary APDUs are not necessarily safe to repeat, hence no retry */
+    if (chain->get_response) {
+        return nfc_isodep_submit(chain->t4, chain->cla & ~ISO_CLA_CHAINING,
+            ISO_INS_GET_RESPONSE, 0, 0, NULL, le, chain->seq, NULL,
+            nfc_isodep_chain_resp, NULL, NULL, chain);
+    } else {
+        GUtilData data;
+
+        data.bytes = g_bytes_get_data(chain->data, &data.size);
+        return nfc_isodep_submit(chain->t4, chain->cla, chain->ins,
+            chain->p1, chain->p2, &data, le, chain->seq, NULL,
+            nfc_isodep_chain_resp, NULL, NULL, chain);
+    }
+}
+
+static
+void
+nfc_isodep_chain_next(
+    NfcIsoDepChain* chain,
+    guint8 sw2)
+{
+    /* Zero SW2 means 256 bytes */
+    chain->cmd_id = nfc_isodep_chain_submit(chain, sw2 ? sw2 : 0x100);
+    if (!chain->cmd_id) {
+        nfc_isodep_chain_done(chain, ISO_SW_IO_ERR);
+    }
+}
+
+static
+void
+nfc_isodep_chain_resp(
+    NfcTagType4* self,
+    guint sw,
+    const void* data,
+    guint len,
+    void* user_data)
+{
+    NfcIsoDepChain* chain = user_data;
+    const guint8 sw1 = (guint8)(sw >> 8);
+    const guint8 sw2 = (guint8)sw;
+
+    chain->cmd_id = 0;
+    if (sw == ISO_SW_IO_ERR) {
+        nfc_isodep_chain_done(chain, ISO_SW_IO_ERR);
+    } else if (sw1 == ISO_SW1_WRONG_LE && !chain->resent) {
+        /* Repeat the same command once with the exact Le */
+        GDEBUG("APDU chain #%u resending with Le %u", chain->id, sw2);
+        chain->resent = TRUE;
+        nfc_isodep_chain_next(chain, sw2);
+    } else if (chain->resp_data->len + len > chain->max_len) {
+        GDEBUG("APDU chain #%u response is too long", chain->id);
+        nfc_isodep_chain_done(chain, ISO_SW_IO_ERR);
+    } else {
+        g_byte_array_append(chain->resp_data, data, len);
+
+        /* GET RESPONSE without any data would most likely loop forever */
+        if (sw1 == ISO_SW1_MORE_DATA && (len || !chain->get_response)) {
+            GDEBUG("APDU chain #%u %u byte(s) so far, requesting more",
+                chain->id, chain->resp_data->len);
+            chain->get_response = TRUE;
+            chain->resent = FALSE;
+            nfc_isodep_chain_next(chain, sw2);
+        } else {
+            nfc_isodep_chain_done(chain, sw);
+        }
+    }
+}
+
 /*==========================================================================*
  * Internal interface
  *==========================================================================*/
@@ -672,16 +1692,25 @@ nfc_tag_t4_init_base(
     NfcTagType4* self,
     NfcTarget* target,
     guint mtu,
+    const GUtilData* hb,
     const NfcParamPoll* poll)
 {
     NfcTag* tag = &self->tag;
     NfcTagType4Priv* priv = self->priv;
 
     nfc_tag_init_base(tag, target, poll);
+    nfc_target_set_transmit_timeout(target, ISODEP_TIMEOUT_MIN_MS, 0);
     priv->mtu = mtu;
+    priv->ext_len = nfc_tag_t4_parse_hb(hb);
+    GDEBUG("Extended length %s", (priv->ext_len ==
+        NFC_TAG_T4_EXT_LEN_SUPPORTED) ? "supported" :
+        (priv->ext_len == NFC_TAG_T4_EXT_LEN_UNSUPPORTED) ?
+        "not supported" : "unknown");
+    priv->reactivate = nfc_tag_t4_reactivate_policy(hb);
 
     /*
-     * We only try to read NDEF Tag file if the target can be reactivated.
+     * We only try to read NDEF Tag file if the target can be reactivated
+     * (unless it's known that the card doesn't need to be reactivated).
      * Reactivation is supported by most commonly used NCI-based adapter
      * implementations.
      *
@@ -693,8 +1722,10 @@ nfc_tag_t4_init_base(
      * selection of a non-default application may be an irreversible
      * action (which of course depends on how the card is programmed).
      */
-    if (nfc_target_can_reactivate(tag->target)) {
-        priv->init_seq = nfc_target_sequence_new(target);
+    if (priv->reactivate == NFC_TAG_T4_REACTIVATE_NEVER ||
+        nfc_target_can_reactivate(tag->target)) {
+        priv->init_seq = nfc_target_sequence_new2(target,
+            NFC_TARGET_PRIORITY_INIT);
 
         /*
          * NFCForum-TS-Type-4-Tag_2.0
@@ -705,8 +1736,8 @@ nfc_tag_t4_init_base(
          */
         if ((priv->init_id = nfc_isodep_submit(self, ISO_CLA, ISO_INS_SELECT,
             ISO_P1_SELECT_DF_BY_NAME, ISO_P2_SELECT_FILE_FIRST, &ndef_aid_data,
-            0x100, priv->init_seq, nfc_tag_t4_init_select_ndef_app_resp,
-            NULL, NULL)) != 0) {
+            0x100, priv->init_seq, &nfc_tag_t4_retry,
+            nfc_tag_t4_init_select_ndef_app_resp, NULL, NULL, NULL)) != 0) {
             return;
         }
     }
@@ -732,7 +1763,139 @@ nfc_isodep_transmit(
     void* user_data)
 {
     return G_LIKELY(self) ? nfc_isodep_submit(self, cla, ins, p1, p2,
-        data, le, seq, resp, destroy, user_data) : 0;
+        data, le, seq, NULL, resp, NULL, destroy, user_data) : 0;
+}
+
+guint
+nfc_isodep_transmit_bytes(
+    NfcTagType4* self,
+    guint8 cla,             /* Class byte */
+    guint8 ins,             /* Instruction byte */
+    guint8 p1,              /* Parameter byte 1 */
+    guint8 p2,              /* Parameter byte 2 */
+    const GUtilData* data,  /* Command data */
+    guint le,               /* Expected length, zero if none */
+    NfcTargetSequence* seq,
+    NfcTagType4ResponseBytesFunc resp,
+    GDestroyNotify destroy,
+    void* user_data) /* Since 1.0.34 */
+{
+    return (G_LIKELY(self) && G_LIKELY(resp)) ? nfc_isodep_submit(self,
+        cla, ins, p1, p2, data, le, seq, NULL, NULL, resp, destroy,
+        user_data) : 0;
+}
+
+guint
+nfc_isodep_transmit_chain(
+    NfcTagType4* self,
+    guint8 cla,             /* Class byte */
+    guint8 ins,             /* Instruction byte */
+    guint8 p1,              /* Parameter byte 1 */
+    guint8 p2,              /* Parameter byte 2 */
+    const GUtilData* data,  /* Command data */
+    guint le,               /* Expected length, zero if none */
+    NfcTargetSequence* seq,
+    guint max_len,          /* Maximum total length of the response */
+    NfcTagType4ResponseBytesFunc resp,
+    GDestroyNotify destroy,
+    void* user_data) /* Since 1.0.34 */
+{
+    if (G_LIKELY(self) && G_LIKELY(resp)) {
+        NfcTagType4Priv* priv = self->priv;
+        NfcIsoDepChain* chain = g_slice_new0(NfcIsoDepChain);
+        guint id;
+
+        /* Follow-up commands must not be interleaved with anything else */
+        chain->t4 = self;
+        chain->seq = seq ? nfc_target_sequence_ref(seq) :
+            nfc_target_sequence_new(self->tag.target);
+        chain->cla = cla;
+        chain->ins = ins;
+        chain->p1 = p1;
+        chain->p2 = p2;
+        chain->data = (data && data->size) ?
+            g_bytes_new(data->bytes, data->size) :
+            g_bytes_new_static(NULL, 0);
+        chain->max_len = max_len ? max_len : ISODEP_CHAIN_MAX_LEN;
+        chain->resp_data = g_byte_array_new();
+        chain->cmd_id = nfc_isodep_chain_submit(chain, le);
+        if (chain->cmd_id) {
+            do { id = ++(priv->last_chain_id); } while (!id);
+            chain->id = id;
+            chain->resp = resp;
+            chain->destroy = destroy;
+            chain->user_data = user_data;
+            priv->chains = g_slist_append(priv->chains, chain);
+            GDEBUG("APDU chain #%u", id);
+            return id;
+        }
+        nfc_isodep_chain_free(chain);
+    }
+    return 0;
+}
+
+guint
+nfc_tag_t4_write_ndef(
+    NfcTagType4* self,
+    GBytes* ndef,
+    NfcTargetSequence* seq,
+    NfcTagType4WriteNdefFunc complete,
+    GDestroyNotify destroy,
+    void* user_data) /* Since 1.0.34 */
+{
+    if (G_LIKELY(self) && G_LIKELY(ndef) && self->tag.present) {
+        NfcTagType4Priv* priv = self->priv;
+        NfcTagType4NdefWrite* write = g_slice_new0(NfcTagType4NdefWrite);
+        guint id;
+
+        write->t4 = self;
+        write->ndef = g_bytes_ref(ndef);
+        write->seq = seq ? nfc_target_sequence_ref(seq) :
+            nfc_target_sequence_new(self->tag.target);
+        do { id = ++(priv->last_write_id); } while (!id);
+        write->id = id;
+        priv->writes = g_slist_append(priv->writes, write);
+        GDEBUG("NDEF write #%u, %u byte(s)", id,
+            (guint)g_bytes_get_size(ndef));
+
+        /* Start with selecting the NDEF Tag Application */
+        write->cmd_id = nfc_isodep_submit(self, ISO_CLA, ISO_INS_SELECT,
+            ISO_P1_SELECT_DF_BY_NAME, ISO_P2_SELECT_FILE_FIRST,
+            &ndef_aid_data, 0x100, write->seq, &nfc_tag_t4_retry,
+            nfc_tag_t4_ndef_write_select_app_resp, NULL, NULL, write);
+        if (write->cmd_id) {
+            write->complete = complete;
+            write->destroy = destroy;
+            write->user_data = user_data;
+            return id;
+        }
+        priv->writes = g_slist_remove(priv->writes, write);
+        nfc_tag_t4_ndef_write_free(write);
+    }
+    return 0;
+}
+
+void
+nfc_tag_t4_add_reactivate_rule(
+    const GUtilData* hb,
+    NFC_TAG_T4_REACTIVATE policy) /* Since 1.0.34 */
+{
+    NfcTagType4ReactivateRule* rule = g_slice_new(NfcTagType4ReactivateRule);
+
+    rule->hb = (hb && hb->size) ? g_bytes_new(hb->bytes, hb->size) :
+        g_bytes_new_static(NULL, 0);
+    rule->policy = policy;
+    nfc_tag_t4_reactivate_rules = g_slist_append(nfc_tag_t4_reactivate_rules,
+        rule);
+}
+
+void
+nfc_tag_t4_clear_reactivate_rules(
+    void) /* Since 1.0.34 */
+{
+    g_slist_free_full(nfc_tag_t4_reactivate_rules,
+        nfc_tag_t4_reactivate_rule_free);
+    nfc_tag_t4_reactivate_rules = NULL;
 }
 
 /*==========================================================================*
@@ -759,6 +1922,8 @@ nfc_tag_t4_finalize(
     NfcTagType4* self = NFC_TAG_T4(object);
     NfcTagType4Priv* priv = self->priv;
 
+    g_slist_free_full(priv->writes, nfc_tag_t4_ndef_write_free1);
+    g_slist_free_full(priv->chains, nfc_isodep_chain_free1);
     nfc_target_cancel_transmit(self->tag.target, priv->init_id);
     nfc_target_sequence_unref(priv->init_seq);
     nfc_iso_dep_ndef_read_free(priv->init_read);
@@ -59,6 +59,7 @@ nfc_tag_t4_init_base(
     NfcTagType4* tag,
     NfcTarget* target,
     guint mtu,
+    const GUtilData* hb,  /* Historical bytes, if known */
     const NfcParamPoll* poll)
     NFCD_INTERNAL;
 
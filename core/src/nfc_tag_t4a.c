@@ -64,9 +64,11 @@ nfc_tag_t4a_new(
             GASSERT(target->technology == NFC_TECHNOLOGY_A);
             memset(&poll, 0, sizeof(poll));
             poll.a = *poll_a;
-            nfc_tag_t4_init_base(&self->t4, target, iso_dep_param->fsc, &poll);
+            nfc_tag_t4_init_base(&self->t4, target, iso_dep_param->fsc,
+                &iso_dep_param->t1, &poll);
         } else {
-            nfc_tag_t4_init_base(&self->t4, target, iso_dep_param->fsc, NULL);
+            nfc_tag_t4_init_base(&self->t4, target, iso_dep_param->fsc,
+                &iso_dep_param->t1, NULL);
         }
         return self;
     }
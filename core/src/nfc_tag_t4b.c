@@ -62,7 +62,7 @@ nfc_tag_t4b_new(
         GASSERT(target->technology == NFC_TECHNOLOGY_B);
         memset(&poll, 0, sizeof(poll));
         poll.b = *poll_b;
-        nfc_tag_t4_init_base(&self->t4, target, poll_b->fsc, &poll);
+        nfc_tag_t4_init_base(&self->t4, target, poll_b->fsc, NULL, &poll);
         return self;
     }
     return NULL;
@@ -38,19 +38,57 @@
 
 #include <gutil_misc.h>
 
-#define TRANSMIT_TIMEOUT_MS (500)
+#define TRANSMIT_TIMEOUT_MS (500)     /* Default, also until RTT is measured */
+#define TRANSMIT_MAX_BACKOFF (4)
+#define RTT_GRANULARITY_US (1000)
 #define DEFAULT_REACTIVATION_TIMEOUT_MS (1000)
+#define PRIORITY_COUNT (NFC_TARGET_PRIORITY_PRESENCE + 1)
+#define POOL_UNIT sizeof(gpointer)
+#define POOL_BUCKETS (32)               /* Up to 32 pointers in size */
+#define POOL_MAX_FREE (8)               /* Per bucket */
+
+/*
+ * Round-trip time estimate (RFC 6298 style). All times are in
+ * microseconds. The class is provided by the submitter of the
+ * request, typically it's derived from the command code.
+ */
+typedef struct nfc_target_rtt {
+    guint samples;
+    guint srtt;         /* Smoothed round-trip time */
+    guint rttvar;       /* Round-trip time variation */
+    guint backoff;      /* Number of consecutive timeouts */
+} NfcTargetRtt;
+
+typedef struct nfc_target_batch {
+    GBytes** frames;
+    guint count;
+    guint index;                    /* Frame being transmitted */
+    GPtrArray* resp;                /* Responses received so far */
+    NfcTargetTransmitBatchFunc complete;
+} NfcTargetBatch;
 
 typedef struct nfc_target_request NfcTargetRequest;
 struct nfc_target_request {
-    NfcTargetRequest* next;
+    NfcTargetRequest* next;         /* All queued requests */
+    NfcTargetRequest* prev;
+    NfcTargetRequest* seq_next;     /* Requests queued for the sequence */
+    NfcTargetRequest* seq_prev;
     NfcTargetSequence* seq;
     NfcTarget* target;
     guint id;
-    void* data;
-    guint len;
-    guint timeout;
+    NFC_TARGET_PRIORITY priority;
+    GBytes* data;
+    NfcTargetRequest* dl_next;      /* Queued requests with a deadline */
+    NfcTargetRequest* dl_prev;
+    gint64 deadline;                /* Monotonic, zero if none */
+    gint64 sent;                    /* Monotonic time of submission */
+    NfcTargetRtt* rtt;              /* Estimate for the command class */
+    guint timeout_ms;               /* Fixed timeout, not estimated */
     NfcTargetTransmitFunc complete;
+    NfcTargetTransmitBytesFunc complete_bytes;
+    NfcTargetBatch* batch;
+    NfcTargetRetryPolicy* retry;    /* NULL if errors aren't retried */
+    guint retry_count;              /* Retries made so far */
     GDestroyNotify destroy;
     void* user_data;
 };
@@ -62,8 +100,11 @@ typedef struct nfc_target_request_queue {
 
 struct nfc_target_sequence {
     NfcTargetSequence* next;
+    NfcTargetSequence* prev;
     gint refcount;
     NfcTarget* target;
+    NFC_TARGET_PRIORITY priority;
+    NfcTargetRequestQueue req_queue;
 };
 
 typedef struct nfc_target_sequence_queue {
@@ -71,12 +112,62 @@ typedef struct nfc_target_sequence_queue {
     NfcTargetSequence* last;
 } NfcTargetSequenceQueue;
 
+/*
+ * Free lists for small short-lived objects (requests and whatever
+ * the tags attach to them), one per size class. Objects are linked
+ * through their first pointer while they are on the list.
+ */
+typedef struct nfc_target_pool_bucket {
+    gpointer free;
+    guint count;
+} NfcTargetPoolBucket;
+
+typedef struct nfc_target_pool {
+    NfcTargetPoolBucket bucket[POOL_BUCKETS];
+    guint allocs;           /* Number of actual allocations */
+    guint reuses;           /* Objects taken from the free lists */
+} NfcTargetPool;
+
+/*
+ * The active request only needs one timer at a time (either transmit
+ * timeout or a retry delay). This one is attached once and re-armed
+ * in place, without allocating a new source for each request. The
+ * same source also wakes up for the earliest deadline of the queued
+ * requests.
+ */
+typedef enum nfc_target_timer_type {
+    TIMER_TRANSMIT,
+    TIMER_RETRY
+} NFC_TARGET_TIMER_TYPE;
+
+typedef struct nfc_target_timer {
+    GSource source;
+    NfcTarget* target;
+    NFC_TARGET_TIMER_TYPE type;
+    gint64 expires;         /* Active request, zero if not armed */
+} NfcTargetTimer;
+
 struct nfc_target_priv {
     guint last_req_id;
     guint continue_id;
+    guint dispatch_depth;   /* Non-zero while calling out */
+    gint64 dispatch_time;   /* When the next request became ready */
+    guint dispatch_count;   /* Dispatch latency statistics */
+    guint dispatch_max_us;
+    guint64 dispatch_total_us;
     NfcTargetRequest* req_active;
     NfcTargetSequenceQueue seq_queue;
-    NfcTargetRequestQueue req_queue;
+    NfcTargetRequestQueue req_queue[PRIORITY_COUNT]; /* One per priority */
+    GHashTable* req_table;  /* Queued requests by id */
+    NfcTargetRequest* deadlines; /* Sorted by deadline, earliest first */
+    NfcTargetPool pool;
+    NfcTargetTimer* timer;
+    /* Transmit timeout */
+    NfcTargetRtt rtt;       /* All commands */
+    GHashTable* rtt_table;  /* Per command class */
+    guint tx_timeout_min_ms;
+    guint tx_timeout_max_ms;
+    guint max_response_size;    /* Zero if unknown */
     /* Reactivation */
     NfcTargetFunc ra_func;
     void* ra_data;
@@ -104,12 +195,57 @@ void
 nfc_target_schedule_next_transmit(
     NfcTarget* self);
 
+static
+void
+nfc_target_dispatch_next_transmit(
+    NfcTarget* self);
+
 static
 void
 nfc_target_set_sequence(
     NfcTarget* self,
     NfcTargetSequence* seq);
 
+static
+gboolean
+nfc_target_retry_request(
+    NfcTarget* self,
+    NfcTargetRequest* req,
+    NFC_TRANSMIT_STATUS status);
+
+static
+void
+nfc_target_transmit_timeout(
+    NfcTarget* self);
+
+static
+void
+nfc_target_retry_timer(
+    NfcTarget* self);
+
+static
+void
+nfc_target_expire_requests(
+    NfcTarget* self,
+    gint64 now);
+
+static
+NfcTargetRequest*
+nfc_target_first_request(
+    NfcTargetPriv* priv,
+    NFC_TARGET_PRIORITY min_priority)
+{
+    int i;
+
+    /* The oldest request of the highest priority */
+    for (i = PRIORITY_COUNT - 1; i >= (int)min_priority; i--) {
+        if (priv->req_queue[i].first) {
+            return priv->req_queue[i].first;
+        }
+    }
+    return NULL;
+}
+
 /*==========================================================================*
  * Sequence
  *==========================================================================*/
@@ -125,37 +261,35 @@ nfc_target_sequence_dealloc(
         NfcTargetPriv* priv = target->priv;
         NfcTargetSequenceQueue* queue = &priv->seq_queue;
 
-        if (queue->first == self) {
-            /* Typically sequences are being deallocated in the order
-             * they were created and that's optimal */
-            if (!(queue->first = self->next)) {
-                queue->last = NULL;
-            }
-        } else {
-            /* In any case it must be on the list */
-            NfcTargetSequence* prev = queue->first;
+        /* Queued requests hold a reference to their sequence */
+        GASSERT(!self->req_queue.first);
 
-            /* And there shouldn't be too many sequences in the list */
-            while (prev->next != self) {
-                prev = prev->next;
-            }
-
-            if (!(prev->next = self->next)) {
-                queue->last = prev;
-            }
+        /* Remove the sequence from the list */
+        if (self->prev) {
+            self->prev->next = self->next;
+        } else {
+            GASSERT(queue->first == self);
+            queue->first = self->next;
+        }
+        if (self->next) {
+            self->next->prev = self->prev;
+        } else {
+            GASSERT(queue->last == self);
+            queue->last = self->prev;
         }
         if (target->sequence == self) {
-            NfcTargetRequest* req = priv->req_queue.first;
+            NfcTargetRequest* req = nfc_target_first_request(priv,
+                NFC_TARGET_PRIORITY_BULK);
 
             /*
              * The last reference to the current sequence is gone.
              * We need to clear the pointer to it.
              *
              * Also, we need to ensure that requests are processed
-             * in the order they were submitted. If the next request
-             * doesn't belong to a sequence, then we will clear the
-             * current sequence and submit the request anyway (even
-             * though there may be some sequences in the queue).
+             * in the order of their priority and submission. If the
+             * next request doesn't belong to a sequence, then we will
+             * clear the current sequence and submit the request anyway
+             * (even though there may be some sequences in the queue).
              */
             nfc_target_set_sequence(target, req ? req->seq : queue->first);
 
@@ -163,7 +297,7 @@ nfc_target_sequence_dealloc(
             nfc_target_schedule_next_transmit(target);
         }
         self->target = NULL;
-        self->next = NULL;
+        self->next = self->prev = NULL;
     }
     g_slice_free(NfcTargetSequence, self);
 }
@@ -206,6 +340,14 @@ nfc_target_set_sequence(
 NfcTargetSequence*
 nfc_target_sequence_new(
     NfcTarget* target)
+{
+    return nfc_target_sequence_new2(target, NFC_TARGET_PRIORITY_DEFAULT);
+}
+
+NfcTargetSequence*
+nfc_target_sequence_new2(
+    NfcTarget* target,
+    NFC_TARGET_PRIORITY priority) /* Since 1.0.34 */
 {
     if (G_LIKELY(target)) {
         NfcTargetSequence* self = g_slice_new0(NfcTargetSequence);
@@ -214,8 +356,10 @@ nfc_target_sequence_new(
 
         g_atomic_int_set(&self->refcount, 1);
         self->target = target;
+        self->priority = MIN(priority, NFC_TARGET_PRIORITY_PRESENCE);
 
         /* Insert it to the queue */
+        self->prev = queue->last;
         if (queue->last) {
             queue->last->next = self;
         } else {
@@ -226,8 +370,11 @@ nfc_target_sequence_new(
 
         /* If there's no active sequence yet, this one automatically
          * becomes active even though it doesn't yet have any requests
-         * associated with it */
-        if (!target->sequence) {
+         * associated with it (unless something more important is
+         * waiting to be submitted) */
+        if (!target->sequence &&
+            (self->priority == NFC_TARGET_PRIORITY_PRESENCE ||
+             !nfc_target_first_request(priv, self->priority + 1))) {
             nfc_target_set_sequence(target, self);
         }
         return self;
@@ -242,6 +389,183 @@ nfc_target_sequence_free(
     nfc_target_sequence_unref(self);
 }
 
+/*==========================================================================*
+ * Pool
+ *==========================================================================*/
+
+static
+gsize
+nfc_target_pool_size(
+    gsize size)
+{
+    /* Objects from the same bucket must be interchangeable */
+    const gsize units = (size + POOL_UNIT - 1) / POOL_UNIT;
+
+    return (units && units <= POOL_BUCKETS) ? (units * POOL_UNIT) : size;
+}
+
+static
+NfcTargetPoolBucket*
+nfc_target_pool_bucket(
+    NfcTargetPool* pool,
+    gsize size)
+{
+    const gsize units = (size + POOL_UNIT - 1) / POOL_UNIT;
+
+    return (units && units <= POOL_BUCKETS) ? (pool->bucket + units - 1) :
+        NULL;
+}
+
+static
+void
+nfc_target_pool_clear(
+    NfcTargetPool* pool)
+{
+    guint i;
+
+    for (i = 0; i < POOL_BUCKETS; i++) {
+        NfcTargetPoolBucket* bucket = pool->bucket + i;
+
+        while (bucket->free) {
+            gpointer* mem = bucket->free;
+
+            bucket->free = *mem;
+            g_slice_free1((i + 1) * POOL_UNIT, mem);
+        }
+        bucket->count = 0;
+    }
+}
+
+/*==========================================================================*
+ * Timer
+ *==========================================================================*/
+
+static
+gint64
+nfc_target_timer_expires(
+    NfcTargetTimer* timer)
+{
+    const NfcTargetRequest* req = timer->target->priv->deadlines;
+
+    /* Whichever comes first */
+    if (req && (!timer->expires || req->deadline < timer->expires)) {
+        return req->deadline;
+    }
+    return timer->expires;
+}
+
+static
+gboolean
+nfc_target_timer_prepare(
+    GSource* source,
+    gint* timeout)
+{
+    const gint64 expires = nfc_target_timer_expires((NfcTargetTimer*)source);
+
+    if (expires) {
+        const gint64 now = g_source_get_time(source);
+
+        if (now < expires) {
+            const gint64 ms = (expires - now + 999) / 1000;
+
+            *timeout = (gint)MIN(ms, G_MAXINT);
+            return FALSE;
+        }
+        *timeout = 0;
+        return TRUE;
+    }
+    *timeout = -1;
+    return FALSE;
+}
+
+static
+gboolean
+nfc_target_timer_check(
+    GSource* source)
+{
+    const gint64 expires = nfc_target_timer_expires((NfcTargetTimer*)source);
+
+    return expires && g_source_get_time(source) >= expires;
+}
+
+static
+gboolean
+nfc_target_timer_dispatch(
+    GSource* source,
+    GSourceFunc callback,
+    gpointer user_data)
+{
+    NfcTargetTimer* timer = (NfcTargetTimer*)source;
+    NfcTarget* self = nfc_target_ref(timer->target);
+    const gint64 now = g_source_get_time(source);
+
+    if (timer->expires && now >= timer->expires) {
+        /* Disarm it first, the handler may re-arm it */
+        timer->expires = 0;
+        switch (timer->type) {
+        case TIMER_TRANSMIT:
+            nfc_target_transmit_timeout(self);
+            break;
+        case TIMER_RETRY:
+            nfc_target_retry_timer(self);
+            break;
+        }
+    }
+    nfc_target_expire_requests(self, now);
+    nfc_target_unref(self);
+    return G_SOURCE_CONTINUE;
+}
+
+static GSourceFuncs nfc_target_timer_funcs = {
+    nfc_target_timer_prepare,
+    nfc_target_timer_check,
+    nfc_target_timer_dispatch,
+    NULL
+};
+
+static
+NfcTargetTimer*
+nfc_target_timer(
+    NfcTarget* self)
+{
+    NfcTargetPriv* priv = self->priv;
+    NfcTargetTimer* timer = priv->timer;
+
+    if (!timer) {
+        /* Created on demand and then reused */
+        priv->timer = timer = (NfcTargetTimer*)
+            g_source_new(&nfc_target_timer_funcs, sizeof(NfcTargetTimer));
+        timer->target = self;
+        g_source_attach(&timer->source, NULL);
+    }
+    return timer;
+}
+
+static
+void
+nfc_target_timer_start(
+    NfcTarget* self,
+    NFC_TARGET_TIMER_TYPE type,
+    guint ms)
+{
+    NfcTargetTimer* timer = nfc_target_timer(self);
+
+    timer->type = type;
+    timer->expires = g_get_monotonic_time() + (gint64)ms * 1000;
+}
+
+static
+void
+nfc_target_timer_stop(
+    NfcTarget* self)
+{
+    NfcTargetTimer* timer = self->priv->timer;
+
+    if (timer) {
+        timer->expires = 0;
+    }
+}
+
 /*==========================================================================*
  * Implementation
  *==========================================================================*/
@@ -251,15 +575,86 @@ void
 nfc_target_free_request(
     NfcTargetRequest* req)
 {
+    NfcTarget* self = req->target;
+    GDestroyNotify destroy = req->destroy;
+    void* user_data = req->user_data;
+
     nfc_target_sequence_unref(req->seq);
-    if (req->timeout) {
-        g_source_remove(req->timeout);
+    if (req->data) {
+        g_bytes_unref(req->data);
+    }
+    if (req->batch) {
+        NfcTargetBatch* batch = req->batch;
+        guint i;
+
+        for (i = 0; i < batch->count; i++) {
+            g_bytes_unref(batch->frames[i]);
+        }
+        g_free(batch->frames);
+        g_ptr_array_free(batch->resp, TRUE);
+        nfc_target_pool_delete(self, NfcTargetBatch, batch);
     }
-    if (req->destroy) {
-        req->destroy(req->user_data);
+    if (req->retry) {
+        nfc_target_pool_delete(self, NfcTargetRetryPolicy, req->retry);
+    }
+    nfc_target_pool_delete(self, NfcTargetRequest, req);
+
+    /* This may drop the last reference to the target, call it last */
+    if (destroy) {
+        destroy(user_data);
+    }
+}
+
+static
+void
+nfc_target_batch_add_resp(
+    NfcTargetBatch* batch,
+    GBytes* bytes,
+    const void* data,
+    guint len)
+{
+    g_ptr_array_add(batch->resp, bytes ? g_bytes_ref(bytes) :
+        g_bytes_new(data, len));
+}
+
+static
+void
+nfc_target_complete_request(
+    NfcTargetRequest* req,
+    NFC_TRANSMIT_STATUS status,
+    GBytes* bytes,
+    const void* data,
+    guint len)
+{
+    /* Either data or bytes (or neither) is provided, not both */
+    if (req->batch) {
+        NfcTargetBatch* batch = req->batch;
+
+        if (status == NFC_TRANSMIT_STATUS_OK) {
+            nfc_target_batch_add_resp(batch, bytes, data, len);
+        }
+        if (batch->complete) {
+            batch->complete(req->target, status, (GBytes**)
+                batch->resp->pdata, batch->resp->len, req->user_data);
+        }
+    } else if (req->complete) {
+        if (bytes) {
+            gsize size;
+
+            data = g_bytes_get_data(bytes, &size);
+            len = (guint)size;
+        }
+        req->complete(req->target, status, data, len, req->user_data);
+    } else if (req->complete_bytes) {
+        if (bytes || !data) {
+            req->complete_bytes(req->target, status, bytes, req->user_data);
+        } else {
+            /* The data must be copied to survive the callback */
+            bytes = g_bytes_new(data, len);
+            req->complete_bytes(req->target, status, bytes, req->user_data);
+            g_bytes_unref(bytes);
+        }
     }
-    g_free(req->data);
-    g_slice_free(NfcTargetRequest, req);
 }
 
 static
@@ -268,51 +663,323 @@ nfc_target_fail_request(
     NfcTarget* self,
     NfcTargetRequest* req)
 {
-    if (req->complete) {
-        req->complete(req->target, NFC_TRANSMIT_STATUS_ERROR, NULL, 0,
-            req->user_data);
-    }
+    nfc_target_complete_request(req, NFC_TRANSMIT_STATUS_ERROR, NULL, NULL, 0);
     nfc_target_free_request(req);
 }
 
 static
-gboolean
+void
+nfc_target_rtt_sample(
+    NfcTargetRtt* rtt,
+    guint r)
+{
+    if (rtt->samples) {
+        const guint delta = (rtt->srtt > r) ? (rtt->srtt - r) :
+            (r - rtt->srtt);
+
+        rtt->rttvar = (3 * rtt->rttvar + delta) / 4;
+        rtt->srtt = (7 * rtt->srtt + r) / 8;
+    } else {
+        rtt->srtt = r;
+        rtt->rttvar = r / 2;
+    }
+    rtt->samples++;
+    rtt->backoff = 0;
+}
+
+static
+NfcTargetRtt*
+nfc_target_rtt_class(
+    NfcTarget* self,
+    guint rtt_class)
+{
+    NfcTargetPriv* priv = self->priv;
+    gpointer key = GUINT_TO_POINTER(rtt_class);
+    NfcTargetRtt* rtt = g_hash_table_lookup(priv->rtt_table, key);
+
+    if (!rtt) {
+        rtt = g_slice_new0(NfcTargetRtt);
+        g_hash_table_insert(priv->rtt_table, key, rtt);
+    }
+    return rtt;
+}
+
+static
+void
+nfc_target_rtt_free(
+    gpointer rtt)
+{
+    g_slice_free(NfcTargetRtt, rtt);
+}
+
+static
+guint
+nfc_target_transmit_timeout_ms(
+    NfcTarget* self,
+    const NfcTargetRtt* rtt)
+{
+    NfcTargetPriv* priv = self->priv;
+    guint ms;
+
+    /* Fall back to the estimate for all commands */
+    if (!rtt || !rtt->samples) {
+        rtt = &priv->rtt;
+    }
+    if (rtt->samples) {
+        /* RTO = SRTT + max(G, 4*RTTVAR), doubled after each timeout */
+        ms = (rtt->srtt + MAX(RTT_GRANULARITY_US, 4 * rtt->rttvar) +
+            999) / 1000;
+        ms <<= rtt->backoff;
+    } else {
+        ms = TRANSMIT_TIMEOUT_MS;
+    }
+    return CLAMP(ms, priv->tx_timeout_min_ms, priv->tx_timeout_max_ms);
+}
+
+static
+void
 nfc_target_transmit_timeout(
-    gpointer user_data)
+    NfcTarget* self)
 {
-    NfcTargetRequest* req = user_data;
-    NfcTarget* self = nfc_target_ref(req->target);
     NfcTargetPriv* priv = self->priv;
+    NfcTargetRequest* req = priv->req_active;
 
     GDEBUG("Timeout out");
-    GASSERT(req->timeout);
-    req->timeout = 0;
+    GASSERT(req);
+    nfc_target_ref(self);
+    if (!req->timeout_ms) {
+        if (priv->rtt.backoff < TRANSMIT_MAX_BACKOFF) {
+            priv->rtt.backoff++;
+        }
+        if (req->rtt && req->rtt->backoff < TRANSMIT_MAX_BACKOFF) {
+            req->rtt->backoff++;
+        }
+    }
 
-    GASSERT(req == priv->req_active);
     priv->req_active = NULL;
     NFC_TARGET_GET_CLASS(self)->cancel_transmit(self);
-    if (req->complete) {
-        req->complete(req->target, NFC_TRANSMIT_STATUS_TIMEOUT, NULL, 0,
-            req->user_data);
+    if (!nfc_target_retry_request(self, req, NFC_TRANSMIT_STATUS_TIMEOUT)) {
+        priv->dispatch_depth++;
+        nfc_target_complete_request(req, NFC_TRANSMIT_STATUS_TIMEOUT,
+            NULL, NULL, 0);
+        nfc_target_free_request(req);
+        priv->dispatch_depth--;
+        nfc_target_dispatch_next_transmit(self);
     }
-    nfc_target_free_request(req);
-    nfc_target_schedule_next_transmit(self);
     nfc_target_unref(self);
-    return G_SOURCE_REMOVE;
 }
 
 static
-NfcTargetRequest*
-nfc_target_transmit_find_req(
-    NfcTargetRequestQueue* queue,
-    NfcTargetSequence* seq)
+void
+nfc_target_deadline_insert(
+    NfcTarget* self,
+    NfcTargetRequest* req)
 {
-    NfcTargetRequest* req = queue->first;
+    NfcTargetPriv* priv = self->priv;
+    NfcTargetRequest* prev = NULL;
+    NfcTargetRequest* next = priv->deadlines;
 
-    while ((req && req->seq != seq)) {
-        req = req->next;
+    /* Requests with the same deadline stay in the order of submission */
+    while (next && next->deadline <= req->deadline) {
+        prev = next;
+        next = next->dl_next;
     }
-    return req;
+    req->dl_prev = prev;
+    req->dl_next = next;
+    if (prev) {
+        prev->dl_next = req;
+    } else {
+        priv->deadlines = req;
+    }
+    if (next) {
+        next->dl_prev = req;
+    }
+
+    /* The timer will pick it up */
+    nfc_target_timer(self);
+}
+
+static
+void
+nfc_target_deadline_remove(
+    NfcTarget* self,
+    NfcTargetRequest* req)
+{
+    NfcTargetPriv* priv = self->priv;
+
+    if (req->dl_prev || priv->deadlines == req) {
+        if (req->dl_prev) {
+            req->dl_prev->dl_next = req->dl_next;
+        } else {
+            priv->deadlines = req->dl_next;
+        }
+        if (req->dl_next) {
+            req->dl_next->dl_prev = req->dl_prev;
+        }
+        req->dl_next = req->dl_prev = NULL;
+    }
+}
+
+static
+void
+nfc_target_queue_request(
+    NfcTarget* self,
+    NfcTargetRequest* req)
+{
+    NfcTargetPriv* priv = self->priv;
+    NfcTargetRequestQueue* queue = priv->req_queue + req->priority;
+    NfcTargetSequence* seq = req->seq;
+
+    /* Priority queues keep requests in the order of submission */
+    req->prev = queue->last;
+    if (queue->last) {
+        queue->last->next = req;
+    } else {
+        GASSERT(!queue->first);
+        queue->first = req;
+    }
+    queue->last = req;
+
+    /* And the sequence has its own queue */
+    if (seq) {
+        NfcTargetRequestQueue* seq_queue = &seq->req_queue;
+
+        req->seq_prev = seq_queue->last;
+        if (seq_queue->last) {
+            seq_queue->last->seq_next = req;
+        } else {
+            GASSERT(!seq_queue->first);
+            seq_queue->first = req;
+        }
+        seq_queue->last = req;
+    }
+    g_hash_table_insert(priv->req_table, GUINT_TO_POINTER(req->id), req);
+}
+
+static
+void
+nfc_target_unqueue_request(
+    NfcTarget* self,
+    NfcTargetRequest* req)
+{
+    NfcTargetPriv* priv = self->priv;
+    NfcTargetRequestQueue* queue = priv->req_queue + req->priority;
+    NfcTargetSequence* seq = req->seq;
+
+    if (req->prev) {
+        req->prev->next = req->next;
+    } else {
+        GASSERT(queue->first == req);
+        queue->first = req->next;
+    }
+    if (req->next) {
+        req->next->prev = req->prev;
+    } else {
+        GASSERT(queue->last == req);
+        queue->last = req->prev;
+    }
+    req->next = req->prev = NULL;
+
+    if (seq) {
+        NfcTargetRequestQueue* seq_queue = &seq->req_queue;
+
+        if (req->seq_prev) {
+            req->seq_prev->seq_next = req->seq_next;
+        } else {
+            GASSERT(seq_queue->first == req);
+            seq_queue->first = req->seq_next;
+        }
+        if (req->seq_next) {
+            req->seq_next->seq_prev = req->seq_prev;
+        } else {
+            GASSERT(seq_queue->last == req);
+            seq_queue->last = req->seq_prev;
+        }
+        req->seq_next = req->seq_prev = NULL;
+    }
+    nfc_target_deadline_remove(self, req);
+    g_hash_table_remove(priv->req_table, GUINT_TO_POINTER(req->id));
+}
+
+static
+gboolean
+nfc_target_request_expired(
+    NfcTargetRequest* req)
+{
+    return req->deadline && g_get_monotonic_time() >= req->deadline;
+}
+
+static
+void
+nfc_target_expire_request(
+    NfcTarget* self,
+    NfcTargetRequest* req)
+{
+    NfcTargetPriv* priv = self->priv;
+
+    GDEBUG("Request %u has expired", req->id);
+    priv->dispatch_depth++;
+    nfc_target_complete_request(req, NFC_TRANSMIT_STATUS_EXPIRED,
+        NULL, NULL, 0);
+    nfc_target_free_request(req);
+    priv->dispatch_depth--;
+}
+
+static
+void
+nfc_target_expire_requests(
+    NfcTarget* self,
+    gint64 now)
+{
+    NfcTargetPriv* priv = self->priv;
+    NfcTargetRequest* req;
+    gboolean expired = FALSE;
+
+    /* The callbacks may cancel other requests, re-check the head */
+    while ((req = priv->deadlines) != NULL && req->deadline <= now) {
+        GASSERT(req != priv->req_active);
+        nfc_target_unqueue_request(self, req);
+        nfc_target_expire_request(self, req);
+        expired = TRUE;
+    }
+    if (expired) {
+        nfc_target_schedule_next_transmit(self);
+    }
+}
+
+static
+void
+nfc_target_request_set_deadline(
+    NfcTargetRequest* req,
+    gint64 deadline)
+{
+    NfcTarget* self = req->target;
+
+    /* Only for queued requests */
+    nfc_target_deadline_remove(self, req);
+    req->deadline = deadline;
+    if (deadline) {
+        nfc_target_deadline_insert(self, req);
+    }
+}
+
+static
+NfcTargetSequence*
+nfc_target_waiting_sequence(
+    NfcTarget* self)
+{
+    NfcTargetPriv* priv = self->priv;
+    NfcTargetSequence* seq = priv->seq_queue.first;
+
+    /*
+     * nfc_target_sequence_new2() doesn't activate the new sequence if
+     * more important requests are queued. Sequences with requests get
+     * activated by their first request, but an empty one (e.g. a lock
+     * held by a D-Bus client) has to be activated once those requests
+     * are gone, by the same rule.
+     */
+    return (!self->sequence && seq && !seq->req_queue.first &&
+        !nfc_target_first_request(priv, seq->priority + 1)) ? seq : NULL;
 }
 
 static
@@ -320,34 +987,28 @@ NfcTargetRequest*
 nfc_target_transmit_dequeue_req(
     NfcTarget* self)
 {
-    NfcTargetPriv* priv = self->priv;
-    NfcTargetRequestQueue* queue = &priv->req_queue;
-    NfcTargetRequest* req = queue->first;
     NfcTargetSequence* seq = self->sequence;
+    NfcTargetRequest* req;
 
-    if (req) {
-        if (!seq || req->seq == seq) {
-            if (!(queue->first = req->next)) {
-                queue->last = NULL;
-            }
-            req->next = NULL;
-        } else {
-            NfcTargetRequest* prev = req;
-
-            /* Scan the queue */
-            req = req->next;
-            while (req) {
-                if (!seq || req->seq == seq) {
-                    if (!(prev->next = req->next)) {
-                        queue->last = prev;
-                    }
-                    req->next = NULL;
-                    break;
-                }
-                prev = req;
-                req = req->next;
-            }
+    if (!seq && (seq = nfc_target_waiting_sequence(self)) != NULL) {
+        /* The handlers may submit something or drop the sequence */
+        nfc_target_set_sequence(self, seq);
+        if (self->priv->req_active) {
+            return NULL;
         }
+        seq = self->sequence;
+    }
+
+    /*
+     * If there's no active sequence, the oldest request of the highest
+     * priority goes first. Otherwise only the requests associated with
+     * the current sequence can be submitted.
+     */
+    req = seq ? seq->req_queue.first :
+        nfc_target_first_request(self->priv, NFC_TARGET_PRIORITY_BULK);
+
+    if (req) {
+        nfc_target_unqueue_request(self, req);
     }
     return req;
 }
@@ -357,19 +1018,40 @@ gboolean
 nfc_target_submit_request(
     NfcTarget* self,
     NfcTargetRequest* req,
+    GBytes* bytes,
     const void* data,
     guint len)
 {
     NfcTargetPriv* priv = self->priv;
+    NfcTargetClass* klass = NFC_TARGET_GET_CLASS(self);
+    gboolean ok;
 
     priv->req_active = req;
     if (!self->sequence && req->seq) {
         nfc_target_set_sequence(self, req->seq);
     }
-    if (NFC_TARGET_GET_CLASS(self)->transmit(self, data, len)) {
-        GASSERT(!req->timeout);
-        req->timeout = g_timeout_add(TRANSMIT_TIMEOUT_MS,
-            nfc_target_transmit_timeout, req);
+    priv->dispatch_depth++;
+    if (klass->transmit_bytes) {
+        if (bytes) {
+            ok = klass->transmit_bytes(self, bytes);
+        } else {
+            bytes = g_bytes_new(data, len);
+            ok = klass->transmit_bytes(self, bytes);
+            g_bytes_unref(bytes);
+        }
+    } else if (bytes) {
+        gsize size;
+
+        data = g_bytes_get_data(bytes, &size);
+        ok = klass->transmit(self, data, (guint)size);
+    } else {
+        ok = klass->transmit(self, data, len);
+    }
+    priv->dispatch_depth--;
+    if (ok) {
+        req->sent = g_get_monotonic_time();
+        nfc_target_timer_start(self, TIMER_TRANSMIT, req->timeout_ms ?
+            req->timeout_ms : nfc_target_transmit_timeout_ms(self, req->rtt));
         return TRUE;
     } else {
         priv->req_active = NULL;
@@ -378,41 +1060,299 @@ nfc_target_submit_request(
 }
 
 static
-gboolean
-nfc_target_next_transmit(
-    gpointer user_data)
+gboolean
+nfc_target_next_transmit(
+    gpointer user_data)
+{
+    NfcTarget* self = NFC_TARGET(user_data);
+    NfcTargetPriv* priv = self->priv;
+
+    priv->continue_id = 0;
+    if (!priv->req_active) {
+        NfcTargetRequest* req;
+
+        nfc_target_ref(self);
+        req = nfc_target_transmit_dequeue_req(self);
+        if (req && priv->dispatch_time) {
+            const gint64 dt = g_get_monotonic_time() - priv->dispatch_time;
+            const guint us = (guint)MAX(dt, 0);
+
+            GVERBOSE("Dispatch latency %u us", us);
+            priv->dispatch_count++;
+            priv->dispatch_total_us += us;
+            if (priv->dispatch_max_us < us) {
+                priv->dispatch_max_us = us;
+            }
+        }
+        priv->dispatch_time = 0;
+        while (req) {
+            if (nfc_target_request_expired(req)) {
+                /* Nobody needs it anymore, don't even bother */
+                nfc_target_expire_request(self, req);
+            } else if (nfc_target_submit_request(self, req, req->data,
+                NULL, 0)) {
+                /* Request submitted, wait for nfc_target_transmit_done() */
+                break;
+            } else {
+                priv->dispatch_depth++;
+                nfc_target_fail_request(self, req);
+                priv->dispatch_depth--;
+            }
+            if (priv->req_active) {
+                /* Something has been submitted in the meantime */
+                break;
+            }
+            req = nfc_target_transmit_dequeue_req(self);
+        }
+        nfc_target_unref(self);
+    }
+    return G_SOURCE_REMOVE;
+}
+
+static
+void
+nfc_target_schedule_next_transmit(
+    NfcTarget* self)
+{
+    NfcTargetPriv* priv = self->priv;
+
+    if (!priv->continue_id &&
+        (nfc_target_first_request(priv, NFC_TARGET_PRIORITY_BULK) ||
+         nfc_target_waiting_sequence(self))) {
+        /* Don't let RF I/O wait behind D-Bus traffic and such */
+        if (!priv->dispatch_time) {
+            priv->dispatch_time = g_get_monotonic_time();
+        }
+        priv->continue_id = g_idle_add_full(G_PRIORITY_HIGH,
+            nfc_target_next_transmit, self, NULL);
+    }
+}
+
+static
+void
+nfc_target_dispatch_next_transmit(
+    NfcTarget* self)
+{
+    NfcTargetPriv* priv = self->priv;
+
+    if (priv->dispatch_depth || priv->req_active) {
+        /* Nested call, can't submit the next request from here */
+        nfc_target_schedule_next_transmit(self);
+    } else if (nfc_target_first_request(priv, NFC_TARGET_PRIORITY_BULK) ||
+        nfc_target_waiting_sequence(self)) {
+        if (priv->continue_id) {
+            g_source_remove(priv->continue_id);
+            priv->continue_id = 0;
+        }
+        if (!priv->dispatch_time) {
+            priv->dispatch_time = g_get_monotonic_time();
+        }
+        nfc_target_next_transmit(self);
+    }
+}
+
+static
+void
+nfc_target_retry_timer(
+    NfcTarget* self)
+{
+    NfcTargetPriv* priv = self->priv;
+    NfcTargetRequest* req = priv->req_active;
+    GBytes* frame = req->batch ? req->batch->frames[req->batch->index] :
+        req->data;
+
+    nfc_target_ref(self);
+    if (!nfc_target_submit_request(self, req, frame, NULL, 0)) {
+        priv->dispatch_depth++;
+        nfc_target_fail_request(self, req);
+        priv->dispatch_depth--;
+        nfc_target_dispatch_next_transmit(self);
+    }
+    nfc_target_unref(self);
+}
+
+static
+gboolean
+nfc_target_retry_request(
+    NfcTarget* self,
+    NfcTargetRequest* req,
+    NFC_TRANSMIT_STATUS status)
+{
+    const NfcTargetRetryPolicy* retry = req->retry;
+
+    if (retry && self->present && req->retry_count < retry->retries &&
+        (retry->statuses & NFC_TARGET_RETRY_STATUS(status))) {
+        const guint max_delay = MAX(retry->max_delay_ms, retry->delay_ms);
+        guint delay = retry->delay_ms;
+        guint i;
+
+        for (i = 0; i < req->retry_count && delay < max_delay; i++) {
+            delay *= 2;
+        }
+        delay = MIN(delay, max_delay);
+        req->retry_count++;
+        GDEBUG("Retry #%u of request %u in %u ms", req->retry_count,
+            req->id, delay);
+
+        /* The request remains active while we are waiting */
+        self->priv->req_active = req;
+        nfc_target_timer_start(self, TIMER_RETRY, delay);
+        return TRUE;
+    }
+    return FALSE;
+}
+
+static
+void
+nfc_target_finish_request(
+    NfcTarget* self,
+    NFC_TRANSMIT_STATUS status,
+    GBytes* bytes,
+    const void* data,
+    guint len)
+{
+    NfcTargetPriv* priv = self->priv;
+    NfcTargetRequest* req = priv->req_active;
+
+    GASSERT(req);
+    if (req) {
+        nfc_target_ref(self);
+        nfc_target_timer_stop(self);
+        priv->req_active = NULL;
+        if (status != NFC_TRANSMIT_STATUS_TIMEOUT && !req->timeout_ms) {
+            /* Something has been received, update the estimates */
+            const gint64 rtt = g_get_monotonic_time() - req->sent;
+            const guint r = (guint)MAX(rtt, 0);
+
+            nfc_target_rtt_sample(&priv->rtt, r);
+            if (req->rtt) {
+                nfc_target_rtt_sample(req->rtt, r);
+            }
+        }
+        if (status != NFC_TRANSMIT_STATUS_OK &&
+            nfc_target_retry_request(self, req, status)) {
+            nfc_target_unref(self);
+            return;
+        }
+        if (req->batch && status == NFC_TRANSMIT_STATUS_OK &&
+            (req->batch->index + 1) < req->batch->count) {
+            NfcTargetBatch* batch = req->batch;
+
+            /* Send the next frame right away, without an idle callback */
+            nfc_target_batch_add_resp(batch, bytes, data, len);
+            batch->index++;
+            if (nfc_target_submit_request(self, req,
+                batch->frames[batch->index], NULL, 0)) {
+                nfc_target_unref(self);
+                return;
+            }
+            status = NFC_TRANSMIT_STATUS_ERROR;
+            bytes = NULL;
+            data = NULL;
+            len = 0;
+        }
+        priv->dispatch_depth++;
+        nfc_target_complete_request(req, status, bytes, data, len);
+        nfc_target_free_request(req);
+        priv->dispatch_depth--;
+        nfc_target_dispatch_next_transmit(self);
+        nfc_target_unref(self);
+    }
+}
+
+static
+NfcTargetRequest*
+nfc_target_request_new(
+    NfcTarget* self,
+    NfcTargetSequence* seq,
+    const NfcTargetTransmitOptions* opt,
+    GDestroyNotify destroy,
+    void* user_data)
 {
-    NfcTarget* self = NFC_TARGET(user_data);
-    NfcTargetPriv* priv = self->priv;
-
-    priv->continue_id = 0;
-    if (!priv->req_active) {
-        NfcTargetRequest* req = nfc_target_transmit_dequeue_req(self);
+    static const NfcTargetTransmitOptions default_options =
+        NFC_TARGET_TRANSMIT_OPTIONS_INIT;
+    NfcTargetRequest* req = nfc_target_pool_new0(self, NfcTargetRequest);
+    const NfcTargetRetryPolicy* retry;
 
-        nfc_target_ref(self);
-        while (req) {
-            if (nfc_target_submit_request(self, req, req->data, req->len)) {
-                /* Request submitted, wait for nfc_target_transmit_done() */
-                break;
-            }
-            nfc_target_fail_request(self, req);
-            req = nfc_target_transmit_dequeue_req(self);
-        }
-        nfc_target_unref(self);
+    if (!opt) {
+        opt = &default_options;
     }
-    return G_SOURCE_REMOVE;
+    GASSERT(!seq || seq->target == self);
+    if (seq && seq->target == self) {
+        /* Requests inherit the priority of their sequence */
+        req->seq = nfc_target_sequence_ref(seq);
+        req->priority = seq->priority;
+    } else {
+        req->priority = MIN(opt->priority, NFC_TARGET_PRIORITY_PRESENCE);
+    }
+    req->id = nfc_target_generate_id(self);
+    req->target = self;
+    req->deadline = MAX(opt->deadline, 0);
+    req->timeout_ms = opt->timeout_ms;
+    if (opt->rtt_class && !opt->timeout_ms) {
+        req->rtt = nfc_target_rtt_class(self, opt->rtt_class);
+    }
+    retry = opt->retry;
+    if (retry && retry->retries && retry->statuses) {
+        req->retry = nfc_target_pool_new0(self, NfcTargetRetryPolicy);
+        *req->retry = *retry;
+    }
+    req->destroy = destroy;
+    req->user_data = user_data;
+    return req;
 }
 
 static
-void
-nfc_target_schedule_next_transmit(
-    NfcTarget* self)
+guint
+nfc_target_submit(
+    NfcTarget* self,
+    NfcTargetRequest* req,
+    GBytes* bytes,
+    const void* data,
+    guint len)
 {
     NfcTargetPriv* priv = self->priv;
+    guint id = req->id;
 
-    if (priv->req_queue.first && !priv->continue_id) {
-        priv->continue_id = g_idle_add(nfc_target_next_transmit, self);
+    /*
+     * Check if the request can be submitted right away. Requests
+     * submitted by the callbacks are always queued, the caller of
+     * the callback picks them up when it's done.
+     */
+    if (!priv->req_active && !priv->dispatch_depth &&
+        !nfc_target_request_expired(req) &&
+        ((!req->seq && !self->sequence &&
+          !nfc_target_first_request(priv, req->priority)) ||
+         (req->seq && req->seq == self->sequence &&
+          !req->seq->req_queue.first))) {
+        /* The data will be copied by the transmit method, no need
+         * to make another copy and attach it to the request (unless
+         * it may have to be resent). */
+        if (req->retry && !req->batch) {
+            req->data = bytes ? g_bytes_ref(bytes) : g_bytes_new(data, len);
+            bytes = req->data;
+        }
+        if (!nfc_target_submit_request(self, req, bytes, data, len)) {
+            nfc_target_set_sequence(self, NULL);
+            id = 0;
+            req->destroy = NULL;
+            nfc_target_free_request(req);
+        }
+    } else {
+        /* Queue the request */
+        nfc_target_queue_request(self, req);
+        if (!priv->req_active) {
+            /* Nothing is going to pick it up otherwise */
+            nfc_target_schedule_next_transmit(self);
+        }
+        /* Can't pass the data pointer to the transmit implementation
+         * right away, make a copy (unless it's already refcounted). */
+        req->data = bytes ? g_bytes_ref(bytes) : g_bytes_new(data, len);
+        if (req->deadline) {
+            nfc_target_request_set_deadline(req, req->deadline);
+        }
     }
+    return id;
 }
 
 static
@@ -478,6 +1418,60 @@ nfc_target_generate_id(
     return id;
 }
 
+gpointer
+nfc_target_pool_alloc0(
+    NfcTarget* self,
+    gsize size)
+{
+    const gsize n = nfc_target_pool_size(size);
+
+    if (G_LIKELY(self)) {
+        NfcTargetPool* pool = &self->priv->pool;
+        NfcTargetPoolBucket* bucket = nfc_target_pool_bucket(pool, size);
+
+        if (bucket && bucket->free) {
+            gpointer* mem = bucket->free;
+
+            bucket->free = *mem;
+            bucket->count--;
+            pool->reuses++;
+            memset(mem, 0, n);
+            return mem;
+        }
+        pool->allocs++;
+    }
+    return g_slice_alloc0(n);
+}
+
+void
+nfc_target_pool_free(
+    NfcTarget* self,
+    gsize size,
+    gpointer mem)
+{
+    if (G_LIKELY(mem)) {
+        if (G_LIKELY(self)) {
+            NfcTargetPoolBucket* bucket =
+                nfc_target_pool_bucket(&self->priv->pool, size);
+
+            if (bucket && bucket->count < POOL_MAX_FREE) {
+                *((gpointer*)mem) = bucket->free;
+                bucket->free = mem;
+                bucket->count++;
+                return;
+            }
+        }
+        g_slice_free1(nfc_target_pool_size(size), mem);
+    }
+}
+
+guint
+nfc_target_pool_allocs(
+    NfcTarget* self)
+{
+    return G_LIKELY(self) ? self->priv->pool.allocs : 0;
+}
+
 guint
 nfc_target_transmit(
     NfcTarget* self,
@@ -488,54 +1482,188 @@ nfc_target_transmit(
     GDestroyNotify destroy,
     void* user_data)
 {
-    guint id = 0;
+    return nfc_target_transmit_full(self, data, len, seq, NULL,
+        complete, destroy, user_data);
+}
 
-    if (G_LIKELY(self)) {
-        NfcTargetPriv* priv = self->priv;
-        NfcTargetRequest* req = g_slice_new0(NfcTargetRequest);
+guint
+nfc_target_transmit2(
+    NfcTarget* self,
+    const void* data,
+    guint len,
+    NfcTargetSequence* seq,
+    NFC_TARGET_PRIORITY priority,
+    NfcTargetTransmitFunc complete,
+    GDestroyNotify destroy,
+    void* user_data) /* Since 1.0.34 */
+{
+    NfcTargetTransmitOptions opt = NFC_TARGET_TRANSMIT_OPTIONS_INIT;
+
+    opt.priority = priority;
+    return nfc_target_transmit_full(self, data, len, seq, &opt,
+        complete, destroy, user_data);
+}
+
+guint
+nfc_target_transmit_with_deadline(
+    NfcTarget* self,
+    const void* data,
+    guint len,
+    NfcTargetSequence* seq,
+    gint64 deadline,
+    NfcTargetTransmitFunc complete,
+    GDestroyNotify destroy,
+    void* user_data) /* Since 1.0.34 */
+{
+    NfcTargetTransmitOptions opt = NFC_TARGET_TRANSMIT_OPTIONS_INIT;
+
+    opt.deadline = deadline;
+    return nfc_target_transmit_full(self, data, len, seq, &opt,
+        complete, destroy, user_data);
+}
+
+gboolean
+nfc_target_set_transmit_deadline(
+    NfcTarget* self,
+    guint id,
+    gint64 deadline) /* Since 1.0.34 */
+{
+    if (G_LIKELY(self) && G_LIKELY(id)) {
+        NfcTargetRequest* req = g_hash_table_lookup(self->priv->req_table,
+            GUINT_TO_POINTER(id));
 
-        GASSERT(!seq || seq->target == self);
-        if (seq && seq->target == self) {
-            req->seq = nfc_target_sequence_ref(seq);
+        /* Only queued requests can expire */
+        if (req) {
+            nfc_target_request_set_deadline(req, MAX(deadline, 0));
+            return TRUE;
         }
+    }
+    return FALSE;
+}
+
+guint
+nfc_target_transmit_with_retry(
+    NfcTarget* self,
+    const void* data,
+    guint len,
+    NfcTargetSequence* seq,
+    const NfcTargetRetryPolicy* retry,
+    NfcTargetTransmitFunc complete,
+    GDestroyNotify destroy,
+    void* user_data) /* Since 1.0.34 */
+{
+    NfcTargetTransmitOptions opt = NFC_TARGET_TRANSMIT_OPTIONS_INIT;
+
+    opt.retry = retry;
+    return nfc_target_transmit_full(self, data, len, seq, &opt,
+        complete, destroy, user_data);
+}
+
+guint
+nfc_target_transmit_bytes(
+    NfcTarget* self,
+    GBytes* data,
+    NfcTargetSequence* seq,
+    NfcTargetTransmitBytesFunc complete,
+    GDestroyNotify destroy,
+    void* user_data) /* Since 1.0.34 */
+{
+    return nfc_target_transmit_bytes_full(self, data, seq, NULL,
+        complete, destroy, user_data);
+}
+
+guint
+nfc_target_transmit_batch(
+    NfcTarget* self,
+    GBytes* const* frames,
+    guint count,
+    NfcTargetSequence* seq,
+    NfcTargetTransmitBatchFunc complete,
+    GDestroyNotify destroy,
+    void* user_data) /* Since 1.0.34 */
+{
+    return nfc_target_transmit_batch_full(self, frames, count, seq, NULL,
+        complete, destroy, user_data);
+}
+
+guint
+nfc_target_transmit_full(
+    NfcTarget* self,
+    const void* data,
+    guint len,
+    NfcTargetSequence* seq,
+    const NfcTargetTransmitOptions* options,
+    NfcTargetTransmitFunc complete,
+    GDestroyNotify destroy,
+    void* user_data) /* Since 1.0.34 */
+{
+    if (G_LIKELY(self)) {
+        NfcTargetRequest* req = nfc_target_request_new(self, seq,
+            options, destroy, user_data);
 
-        req->id = id = nfc_target_generate_id(self);
-        req->target = self;
         req->complete = complete;
-        req->destroy = destroy;
-        req->user_data = user_data;
-
-        /* Check if the request can be submitted right away */
-        if (!priv->req_active &&
-            ((!req->seq && !self->sequence) ||
-             (req->seq && req->seq == self->sequence &&
-              !nfc_target_transmit_find_req(&priv->req_queue, req->seq)))) {
-            /* The data will be copied by the transmit method, no need
-             * to make another copy and attach it to the request. */
-            if (!nfc_target_submit_request(self, req, data, len)) {
-                nfc_target_set_sequence(self, NULL);
-                id = 0;
-                req->destroy = NULL;
-                nfc_target_free_request(req);
-            }
-        } else {
-            NfcTargetRequestQueue* queue = &priv->req_queue;
+        return nfc_target_submit(self, req, NULL, data, len);
+    }
+    return 0;
+}
 
-            /* Queue the request */
-            if (queue->last) {
-                queue->last->next = req;
-            } else {
-                GASSERT(!queue->first);
-                queue->first = req;
+guint
+nfc_target_transmit_bytes_full(
+    NfcTarget* self,
+    GBytes* data,
+    NfcTargetSequence* seq,
+    const NfcTargetTransmitOptions* options,
+    NfcTargetTransmitBytesFunc complete,
+    GDestroyNotify destroy,
+    void* user_data) /* Since 1.0.34 */
+{
+    if (G_LIKELY(self) && G_LIKELY(data)) {
+        NfcTargetRequest* req = nfc_target_request_new(self, seq,
+            options, destroy, user_data);
+
+        req->complete_bytes = complete;
+        return nfc_target_submit(self, req, data, NULL, 0);
+    }
+    return 0;
+}
+
+guint
+nfc_target_transmit_batch_full(
+    NfcTarget* self,
+    GBytes* const* frames,
+    guint count,
+    NfcTargetSequence* seq,
+    const NfcTargetTransmitOptions* options,
+    NfcTargetTransmitBatchFunc complete,
+    GDestroyNotify destroy,
+    void* user_data) /* Since 1.0.34 */
+{
+    if (G_LIKELY(self) && G_LIKELY(frames) && G_LIKELY(count)) {
+        NfcTargetRequest* req;
+        NfcTargetBatch* batch;
+        guint i;
+
+        for (i = 0; i < count; i++) {
+            if (!frames[i]) {
+                return 0;
             }
-            queue->last = req;
-            /* Can't pass the data pointer to the transmit implementation
-             * right away, make a copy. */
-            req->data = g_memdup(data, len);
-            req->len = len;
         }
+
+        batch = nfc_target_pool_new0(self, NfcTargetBatch);
+        batch->frames = g_new(GBytes*, count);
+        batch->count = count;
+        batch->resp = g_ptr_array_new_full(count, (GDestroyNotify)
+            g_bytes_unref);
+        batch->complete = complete;
+        for (i = 0; i < count; i++) {
+            batch->frames[i] = g_bytes_ref(frames[i]);
+        }
+
+        req = nfc_target_request_new(self, seq, options, destroy, user_data);
+        req->batch = batch;
+        return nfc_target_submit(self, req, batch->frames[0], NULL, 0);
     }
-    return id;
+    return 0;
 }
 
 gboolean
@@ -543,50 +1671,87 @@ nfc_target_cancel_transmit(
     NfcTarget* self,
     guint id)
 {
+    gboolean cancelled = FALSE;
+
     if (G_LIKELY(self) && G_LIKELY(id)) {
         NfcTargetPriv* priv = self->priv;
         NfcTargetRequest* req = priv->req_active;
 
+        /* The destroy callback may drop the last reference */
+        nfc_target_ref(self);
         if (req && req->id == id) {
             req->complete = NULL;
             priv->req_active = NULL;
+            nfc_target_timer_stop(self);
             NFC_TARGET_GET_CLASS(self)->cancel_transmit(self);
             nfc_target_free_request(req);
             nfc_target_schedule_next_transmit(self);
-            return TRUE;
+            cancelled = TRUE;
         } else {
-            NfcTargetRequestQueue* queue = &priv->req_queue;
-
-            req = queue->first;
+            req = g_hash_table_lookup(priv->req_table, GUINT_TO_POINTER(id));
             if (req) {
-                if (req->id == id) {
-                    /* The first queued request is cancelled */
-                    req->complete = NULL;
-                    if (!(queue->first = req->next)) {
-                        queue->last = NULL;
-                    }
-                    nfc_target_free_request(req);
-                    return TRUE;
-                } else {
-                    NfcTargetRequest* prev = req;
-
-                    /* Scan the queue */
-                    req = req->next;
-                    while (req) {
-                        if (req->id == id) {
-                            req->complete = NULL;
-                            if (!(prev->next = req->next)) {
-                                queue->last = prev;
-                            }
-                            nfc_target_free_request(req);
-                            return TRUE;
-                        }
-                        prev = req;
-                        req = req->next;
-                    }
-                }
+                req->complete = NULL;
+                nfc_target_unqueue_request(self, req);
+                nfc_target_free_request(req);
+                cancelled = TRUE;
             }
         }
+        nfc_target_unref(self);
+    }
+    return cancelled;
+}
+
+guint
+nfc_target_transmit_with_timeout(
+    NfcTarget* self,
+    const void* data,
+    guint len,
+    NfcTargetSequence* seq,
+    guint timeout_ms,
+    NfcTargetTransmitFunc complete,
+    GDestroyNotify destroy,
+    void* user_data)
+{
+    NfcTargetTransmitOptions opt = NFC_TARGET_TRANSMIT_OPTIONS_INIT;
+
+    opt.timeout_ms = timeout_ms;
+    return nfc_target_transmit_full(self, data, len, seq, &opt,
+        complete, destroy, user_data);
+}
+
+gboolean
+nfc_target_fail_transmit(
+    NfcTarget* self,
+    guint id)
+{
+    if (G_LIKELY(self) && G_LIKELY(id)) {
+        NfcTargetPriv* priv = self->priv;
+        NfcTargetRequest* req = g_hash_table_lookup(priv->req_table,
+            GUINT_TO_POINTER(id));
+
+        /* Only queued requests, the active one is already on its way */
+        if (req) {
+            nfc_target_ref(self);
+            nfc_target_unqueue_request(self, req);
+            priv->dispatch_depth++;
+            nfc_target_fail_request(self, req);
+            priv->dispatch_depth--;
+            nfc_target_unref(self);
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+gboolean
+nfc_target_idle(
+    NfcTarget* self)
+{
+    if (G_LIKELY(self)) {
+        NfcTargetPriv* priv = self->priv;
+
+        return !priv->req_active && !self->sequence &&
+            !nfc_target_first_request(priv, NFC_TARGET_PRIORITY_BULK);
     }
     return FALSE;
 }
@@ -639,6 +1804,39 @@ nfc_target_reactivate(
     return FALSE;
 }
 
+void
+nfc_target_set_transmit_timeout(
+    NfcTarget* self,
+    guint min_ms,
+    guint max_ms) /* Since 1.0.34 */
+{
+    if (G_LIKELY(self)) {
+        NfcTargetPriv* priv = self->priv;
+
+        /* Zero max selects the default, zero min disables adaptation */
+        priv->tx_timeout_max_ms = max_ms ? max_ms : TRANSMIT_TIMEOUT_MS;
+        priv->tx_timeout_min_ms = min_ms ? MIN(min_ms,
+            priv->tx_timeout_max_ms) : priv->tx_timeout_max_ms;
+    }
+}
+
+void
+nfc_target_set_max_response_size(
+    NfcTarget* self,
+    guint size) /* Since 1.0.34 */
+{
+    if (G_LIKELY(self)) {
+        self->priv->max_response_size = size;
+    }
+}
+
+guint
+nfc_target_max_response_size(
+    NfcTarget* self)
+{
+    return G_LIKELY(self) ? self->priv->max_response_size : 0;
+}
+
 void
 nfc_target_set_reactivate_timeout(
     NfcTarget* self,
@@ -721,20 +1919,18 @@ nfc_target_transmit_done(
     guint len)
 {
     if (G_LIKELY(self)) {
-        NfcTargetPriv* priv = self->priv;
-        NfcTargetRequest* req = priv->req_active;
+        nfc_target_finish_request(self, status, NULL, data, len);
+    }
+}
 
-        GASSERT(req);
-        if (req) {
-            nfc_target_ref(self);
-            priv->req_active = NULL;
-            if (req->complete) {
-                req->complete(req->target, status, data, len, req->user_data);
-            }
-            nfc_target_free_request(req);
-            nfc_target_schedule_next_transmit(self);
-            nfc_target_unref(self);
-        }
+void
+nfc_target_transmit_done_bytes(
+    NfcTarget* self,
+    NFC_TRANSMIT_STATUS status,
+    GBytes* data) /* Since 1.0.34 */
+{
+    if (G_LIKELY(self)) {
+        nfc_target_finish_request(self, status, data, NULL, 0);
     }
 }
 
@@ -797,6 +1993,12 @@ nfc_target_init(
     self->present = TRUE;
     self->priv = priv;
     priv->ra_timeout_ms = DEFAULT_REACTIVATION_TIMEOUT_MS;
+    priv->req_table = g_hash_table_new(g_direct_hash, g_direct_equal);
+    priv->rtt_table = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+        NULL, nfc_target_rtt_free);
+    /* Fixed timeout until the user of the target enables adaptation */
+    priv->tx_timeout_min_ms = TRANSMIT_TIMEOUT_MS;
+    priv->tx_timeout_max_ms = TRANSMIT_TIMEOUT_MS;
 }
 
 static
@@ -806,26 +2008,36 @@ nfc_target_dispose(
 {
     NfcTarget* self = NFC_TARGET(object);
     NfcTargetPriv* priv = self->priv;
-    NfcTargetRequestQueue* queue = &priv->req_queue;
+    NfcTargetRequest* req;
 
     if (priv->continue_id) {
         g_source_remove(priv->continue_id);
         priv->continue_id = 0;
     }
+    if (priv->dispatch_count) {
+        GDEBUG("Dispatch latency %u us average, %u us max",
+            (guint)(priv->dispatch_total_us / priv->dispatch_count),
+            priv->dispatch_max_us);
+        priv->dispatch_count = 0;
+    }
+    if (priv->pool.allocs) {
+        GDEBUG("%u allocation(s), %u object(s) reused", priv->pool.allocs,
+            priv->pool.reuses);
+    }
+    if (priv->timer) {
+        g_source_destroy(&priv->timer->source);
+        g_source_unref(&priv->timer->source);
+        priv->timer = NULL;
+    }
     if (priv->req_active) {
-        NfcTargetRequest* req = priv->req_active;
-
+        req = priv->req_active;
         priv->req_active = NULL;
         NFC_TARGET_GET_CLASS(self)->cancel_transmit(self);
         nfc_target_fail_request(self, req);
     }
-    while (queue->first) {
-        NfcTargetRequest* req = queue->first;
-
-        if (!(queue->first = req->next)) {
-            queue->last = NULL;
-        }
-        req->next = NULL;
+    while ((req = nfc_target_first_request(priv,
+        NFC_TARGET_PRIORITY_BULK)) != NULL) {
+        nfc_target_unqueue_request(self, req);
         nfc_target_fail_request(self, req);
     }
     if (priv->ra_timeout) {
@@ -855,10 +2067,13 @@ nfc_target_finalize(
         NfcTargetSequence* next = seq->next;
 
         seq->target = NULL;
-        seq->next = NULL;
+        seq->next = seq->prev = NULL;
         seq = next;
     }
     queue->first = queue->last = NULL;
+    g_hash_table_destroy(priv->req_table);
+    g_hash_table_destroy(priv->rtt_table);
+    nfc_target_pool_clear(&priv->pool);
     G_OBJECT_CLASS(nfc_target_parent_class)->finalize(object);
 }
 
@@ -60,11 +60,76 @@ nfc_target_set_reactivate_timeout(
     guint ms)
     NFCD_INTERNAL;
 
+/* Zero if unknown */
+guint
+nfc_target_max_response_size(
+    NfcTarget* target)
+    NFCD_INTERNAL;
+
 guint
 nfc_target_generate_id(
     NfcTarget* target)
     NFCD_INTERNAL;
 
+/*
+ * Free lists for small objects which come and go with each request.
+ * Objects must not outlive the target and must be returned with the
+ * same size they were allocated with.
+ */
+gpointer
+nfc_target_pool_alloc0(
+    NfcTarget* target,
+    gsize size)
+    NFCD_INTERNAL;
+
+void
+nfc_target_pool_free(
+    NfcTarget* target,
+    gsize size,
+    gpointer mem)
+    NFCD_INTERNAL;
+
+/* Number of times the pool had to actually allocate memory */
+guint
+nfc_target_pool_allocs(
+    NfcTarget* target)
+    NFCD_INTERNAL;
+
+#define nfc_target_pool_new0(target,type) \
+    ((type*)nfc_target_pool_alloc0(target, sizeof(type)))
+#define nfc_target_pool_delete(target,type,mem) \
+    nfc_target_pool_free(target, sizeof(type), mem)
+
+/* Shortcut for nfc_target_transmit_full() with a fixed timeout */
+guint
+nfc_target_transmit_with_timeout(
+    NfcTarget* target,
+    const void* data,
+    guint len,
+    NfcTargetSequence* seq,
+    guint timeout_ms,
+    NfcTargetTransmitFunc complete,
+    GDestroyNotify destroy,
+    void* user_data)
+    NFCD_INTERNAL;
+
+/*
+ * Completes a queued (not yet transmitted) request with
+ * NFC_TRANSMIT_STATUS_ERROR. Returns FALSE if there's no such
+ * request in the queue.
+ */
+gboolean
+nfc_target_fail_transmit(
+    NfcTarget* target,
+    guint id)
+    NFCD_INTERNAL;
+
+/* TRUE if nothing is being transmitted or waiting to be */
+gboolean
+nfc_target_idle(
+    NfcTarget* target)
+    NFCD_INTERNAL;
+
 gulong
 nfc_target_add_gone_handler(
     NfcTarget* target,
@@ -118,6 +118,106 @@ nfc_tlv_check(
     return it.bytes > buf->bytes && it.bytes[-1] == TLV_TERMINATOR;
 }
 
+/*==========================================================================*
+ * Incremental scanner
+ *==========================================================================*/
+
+static
+NFC_TLV_SCAN_RESULT
+nfc_tlv_scanner_update(
+    NfcTlvScanner* scanner,
+    guint need)
+{
+    if (scanner->limit && (scanner->offset + need) > scanner->limit) {
+        /* Sequence can't possibly fit */
+        scanner->need = 0;
+        return (scanner->result = NFC_TLV_SCAN_BROKEN);
+    } else {
+        scanner->need = need;
+        return NFC_TLV_SCAN_NEED_MORE;
+    }
+}
+
+void
+nfc_tlv_scanner_init(
+    NfcTlvScanner* scanner,
+    guint limit)
+{
+    memset(scanner, 0, sizeof(*scanner));
+    scanner->result = NFC_TLV_SCAN_NEED_MORE;
+    scanner->limit = limit;
+    scanner->need = 1;
+}
+
+NFC_TLV_SCAN_RESULT
+nfc_tlv_scanner_feed(
+    NfcTlvScanner* scanner,
+    const void* data,
+    guint len)
+{
+    const guint8* ptr = data;
+    const guint8* end = ptr + len;
+
+    if (scanner->result != NFC_TLV_SCAN_NEED_MORE) {
+        return scanner->result;
+    }
+
+    while (ptr < end) {
+        if (scanner->skip) {
+            /* Skip (the rest of) the value */
+            const guint n = MIN(scanner->skip, (guint)(end - ptr));
+
+            ptr += n;
+            scanner->offset += n;
+            scanner->skip -= n;
+        } else {
+            const guint8 b = *ptr++;
+
+            scanner->offset++;
+            if (!scanner->hdr_len) {
+                switch (b) {
+                case TLV_NULL:
+                    /* No L, no V */
+                    continue;
+                case TLV_TERMINATOR:
+                    scanner->need = 0;
+                    return (scanner->result = NFC_TLV_SCAN_COMPLETE);
+                }
+            }
+
+            scanner->hdr[scanner->hdr_len++] = b;
+            if (scanner->hdr_len == 2 && scanner->hdr[1] != 0xff) {
+                /* One byte format */
+                scanner->skip = scanner->hdr[1];
+                scanner->hdr_len = 0;
+            } else if (scanner->hdr_len == 4) {
+                /* Three consecutive bytes format, big endian */
+                const guint vlen = (((guint)scanner->hdr[2]) << 8) |
+                    scanner->hdr[3];
+
+                if (vlen == 0xffff) {
+                    /* Reserved by NFCForum-TS-Type-2-Tag */
+                    scanner->need = 0;
+                    return (scanner->result = NFC_TLV_SCAN_BROKEN);
+                }
+                scanner->skip = vlen;
+                scanner->hdr_len = 0;
+            }
+        }
+    }
+
+    /* Bytes still missing in the current TLV plus the terminator */
+    if (scanner->skip) {
+        return nfc_tlv_scanner_update(scanner, scanner->skip + 1);
+    } else if (!scanner->hdr_len) {
+        return nfc_tlv_scanner_update(scanner, 1);
+    } else if (scanner->hdr_len == 1) {
+        return nfc_tlv_scanner_update(scanner, 2);
+    } else {
+        return nfc_tlv_scanner_update(scanner, 4 - scanner->hdr_len + 1);
+    }
+}
+
 /*
  * Local Variables:
  * mode: C
@@ -69,6 +69,47 @@ gint
 nfc_tlv_check(
     const GUtilData* buf);
 
+/*
+ * Incremental TLV scanner. Consumes the TLV sequence in chunks as they
+ * arrive from the tag, without rescanning the data it has already seen.
+ * After each nfc_tlv_scanner_feed() call:
+ *
+ * NFC_TLV_SCAN_NEED_MORE - at least scanner->need more bytes are
+ *                          required to reach the terminator
+ * NFC_TLV_SCAN_COMPLETE  - scanner->offset is the size of the sequence
+ *                          including TLV_TERMINATOR
+ * NFC_TLV_SCAN_BROKEN    - the sequence is malformed or runs past the
+ *                          limit passed to nfc_tlv_scanner_init()
+ *
+ * Once COMPLETE or BROKEN is returned, the scanner ignores further input.
+ */
+typedef enum nfc_tlv_scan_result {
+    NFC_TLV_SCAN_NEED_MORE,
+    NFC_TLV_SCAN_COMPLETE,
+    NFC_TLV_SCAN_BROKEN
+} NFC_TLV_SCAN_RESULT;
+
+typedef struct nfc_tlv_scanner {
+    NFC_TLV_SCAN_RESULT result;
+    guint limit;        /* Zero if unlimited */
+    guint offset;       /* Bytes consumed so far */
+    guint need;         /* Minimum number of bytes still needed */
+    guint skip;         /* Bytes of the current value left to skip */
+    guint8 hdr[4];      /* Partially received T and L */
+    guint hdr_len;
+} NfcTlvScanner;
+
+void
+nfc_tlv_scanner_init(
+    NfcTlvScanner* scanner,
+    guint limit);
+
+NFC_TLV_SCAN_RESULT
+nfc_tlv_scanner_feed(
+    NfcTlvScanner* scanner,
+    const void* data,
+    guint len);
+
 #endif /* NFC_TLV_H */
 
 /*
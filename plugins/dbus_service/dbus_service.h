@@ -63,6 +63,13 @@ typedef enum dbus_service_error {
     DBUS_SERVICE_NUM_ERRORS
 } DBusServiceError;
 
+/*
+ * Both libdbus and GDBus clients give up on a method call after 25 seconds
+ * by default. The actual timeout isn't passed over the bus, so that's our
+ * best guess of when nobody is waiting for the reply anymore.
+ */
+#define DBUS_SERVICE_CALL_TIMEOUT_MS (25000)
+
 #define NFC_DBUS_TAG_T2_INTERFACE "org.sailfishos.nfc.TagType2"
 #define NFC_DBUS_ISODEP_INTERFACE "org.sailfishos.nfc.IsoDep"
 
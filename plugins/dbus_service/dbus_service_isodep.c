@@ -34,6 +34,7 @@
 #include "dbus_service/org.sailfishos.nfc.IsoDep.h"
 
 #include <nfc_tag_t4.h>
+#include <nfc_target.h>
 
 #include <gutil_misc.h>
 
@@ -41,6 +42,8 @@ enum {
     CALL_GET_ALL,
     CALL_GET_INTERFACE_VERSION,
     CALL_TRANSMIT,
+    CALL_WRITE_NDEF,
+    CALL_TRANSMIT_CHAIN,
     CALL_COUNT
 };
 
@@ -51,7 +54,7 @@ struct dbus_service_isodep {
     gulong call_id[CALL_COUNT];
 };
 
-#define NFC_DBUS_ISODEP_INTERFACE_VERSION  (1)
+#define NFC_DBUS_ISODEP_INTERFACE_VERSION  (2)
 
 typedef struct dbus_service_isodep_async_call {
     OrgSailfishosNfcIsoDep* iface;
@@ -60,14 +63,15 @@ typedef struct dbus_service_isodep_async_call {
 
 static
 GVariant*
-dbus_service_isodep_dup_data_as_variant(
-    const void* data,
-    guint size)
+dbus_service_isodep_bytes_as_variant(
+    GBytes* bytes)
 {
-    return size ?
-        g_variant_new_fixed_array(G_VARIANT_TYPE_BYTE, data, size, 1) :
-        g_variant_new_from_data(G_VARIANT_TYPE("ay"), NULL, 0, TRUE,
-            NULL, NULL);
+    gsize size;
+    const void* data = g_bytes_get_data(bytes, &size);
+
+    /* The variant shares the buffer, returns floating reference */
+    return g_variant_new_from_data(G_VARIANT_TYPE("ay"), data, size,
+        TRUE, (GDestroyNotify) g_bytes_unref, g_bytes_ref(bytes));
 }
 
 static
@@ -154,8 +158,7 @@ void
 dbus_service_isodep_handle_transmit_done(
     NfcTagType4* tag,
     guint sw,  /* 16 bits (SW1 << 8)|SW2 */
-    const void* data,
-    guint len,
+    GBytes* data,
     void* user_data)
 {
     DBusServiceIsoDepAsyncCall* async = user_data;
@@ -163,7 +166,7 @@ dbus_service_isodep_handle_transmit_done(
     if (sw) {
         GDEBUG("%04X", sw);
         org_sailfishos_nfc_iso_dep_complete_transmit(async->iface, async->call,
-            dbus_service_isodep_dup_data_as_variant(data, len),
+            dbus_service_isodep_bytes_as_variant(data),
             sw >> 8, sw & 0xff);
     } else {
         GDEBUG("oops");
@@ -187,6 +190,7 @@ dbus_service_isodep_handle_transmit(
     DBusServiceIsoDep* self)
 {
     GUtilData data;
+    guint id;
     DBusServiceIsoDepAsyncCall* async =
         dbus_service_isodep_async_call_new(iface, call);
 
@@ -194,9 +198,141 @@ dbus_service_isodep_handle_transmit(
     data.bytes = g_variant_get_data(data_var);
     GDEBUG("%02X %02X %02X %02X (%u bytes) %02X", cla, ins, p1, p2, (guint)
         data.size, le);
-    if (!nfc_isodep_transmit(self->t4, cla, ins, p1, p2, &data, le,
+    id = nfc_isodep_transmit_bytes(self->t4, cla, ins, p1, p2, &data, le,
         dbus_service_isodep_sequence(self, call),
         dbus_service_isodep_handle_transmit_done,
+        dbus_service_isodep_async_call_free1, async);
+    if (id) {
+        /* Don't send the APDU if the caller has already given up */
+        nfc_target_set_transmit_deadline(self->t4->tag.target, id,
+            g_get_monotonic_time() + DBUS_SERVICE_CALL_TIMEOUT_MS * 1000);
+    } else {
+        dbus_service_isodep_async_call_free(async);
+        g_dbus_method_invocation_return_error_literal(call,
+            DBUS_SERVICE_ERROR, DBUS_SERVICE_ERROR_FAILED,
+            "Failed to submit APDU");
+    }
+    return TRUE;
+}
+
+/* WriteNdef */
+
+static
+void
+dbus_service_isodep_handle_write_ndef_done(
+    NfcTagType4* tag,
+    NFC_TAG_T4_IO_STATUS status,
+    void* user_data)
+{
+    DBusServiceIsoDepAsyncCall* async = user_data;
+
+    switch (status) {
+    case NFC_TAG_T4_IO_STATUS_OK:
+        org_sailfishos_nfc_iso_dep_complete_write_ndef(async->iface,
+            async->call);
+        return;
+    case NFC_TAG_T4_IO_STATUS_NOT_NDEF:
+        g_dbus_method_invocation_return_error_literal(async->call,
+            DBUS_SERVICE_ERROR, DBUS_SERVICE_ERROR_NOT_SUPPORTED,
+            "Not an NDEF tag");
+        return;
+    case NFC_TAG_T4_IO_STATUS_READ_ONLY:
+        g_dbus_method_invocation_return_error_literal(async->call,
+            DBUS_SERVICE_ERROR, DBUS_SERVICE_ERROR_ACCESS_DENIED,
+            "NDEF file is read-only");
+        return;
+    case NFC_TAG_T4_IO_STATUS_BAD_SIZE:
+        g_dbus_method_invocation_return_error_literal(async->call,
+            DBUS_SERVICE_ERROR, DBUS_SERVICE_ERROR_INVALID_ARGS,
+            "NDEF message is too large");
+        return;
+    case NFC_TAG_T4_IO_STATUS_FAILURE:
+    case NFC_TAG_T4_IO_STATUS_IO_ERROR:
+        break;
+    }
+    g_dbus_method_invocation_return_error_literal(async->call,
+        DBUS_SERVICE_ERROR, DBUS_SERVICE_ERROR_FAILED,
+        "NDEF write failed");
+}
+
+static
+gboolean
+dbus_service_isodep_handle_write_ndef(
+    OrgSailfishosNfcIsoDep* iface,
+    GDBusMethodInvocation* call,
+    GVariant* data_var,
+    DBusServiceIsoDep* self)
+{
+    GBytes* ndef = g_bytes_new(g_variant_get_data(data_var),
+        g_variant_get_size(data_var));
+    DBusServiceIsoDepAsyncCall* async =
+        dbus_service_isodep_async_call_new(iface, call);
+
+    GDEBUG("Writing %u byte(s) of NDEF", (guint)g_bytes_get_size(ndef));
+    if (!nfc_tag_t4_write_ndef(self->t4, ndef,
+        dbus_service_isodep_sequence(self, call),
+        dbus_service_isodep_handle_write_ndef_done,
+        dbus_service_isodep_async_call_free1, async)) {
+        dbus_service_isodep_async_call_free(async);
+        g_dbus_method_invocation_return_error_literal(call,
+            DBUS_SERVICE_ERROR, DBUS_SERVICE_ERROR_FAILED,
+            "Failed to start NDEF write");
+    }
+    g_bytes_unref(ndef);
+    return TRUE;
+}
+
+/* TransmitChain */
+
+static
+void
+dbus_service_isodep_handle_transmit_chain_done(
+    NfcTagType4* tag,
+    guint sw,  /* 16 bits (SW1 << 8)|SW2 */
+    GBytes* data,
+    void* user_data)
+{
+    DBusServiceIsoDepAsyncCall* async = user_data;
+
+    if (sw) {
+        GDEBUG("%04X", sw);
+        org_sailfishos_nfc_iso_dep_complete_transmit_chain(async->iface,
+            async->call, dbus_service_isodep_bytes_as_variant(data),
+            sw >> 8, sw & 0xff);
+    } else {
+        GDEBUG("oops");
+        g_dbus_method_invocation_return_error_literal(async->call,
+            DBUS_SERVICE_ERROR, DBUS_SERVICE_ERROR_FAILED,
+            "APDU command failed");
+    }
+}
+
+static
+gboolean
+dbus_service_isodep_handle_transmit_chain(
+    OrgSailfishosNfcIsoDep* iface,
+    GDBusMethodInvocation* call,
+    guchar cla,
+    guchar ins,
+    guchar p1,
+    guchar p2,
+    GVariant* data_var,
+    guint le,
+    DBusServiceIsoDep* self)
+{
+    GUtilData data;
+    DBusServiceIsoDepAsyncCall* async =
+        dbus_service_isodep_async_call_new(iface, call);
+
+    data.size = g_variant_get_size(data_var);
+    data.bytes = g_variant_get_data(data_var);
+    GDEBUG("%02X %02X %02X %02X (%u bytes) %02X", cla, ins, p1, p2, (guint)
+        data.size, le);
+
+    /* The whole response has to fit into a single D-Bus reply */
+    if (!nfc_isodep_transmit_chain(self->t4, cla, ins, p1, p2, &data, le,
+        dbus_service_isodep_sequence(self, call), 0,
+        dbus_service_isodep_handle_transmit_chain_done,
         dbus_service_isodep_async_call_free1, async)) {
         dbus_service_isodep_async_call_free(async);
         g_dbus_method_invocation_return_error_literal(call,
@@ -246,6 +382,12 @@ dbus_service_isodep_new(
     self->call_id[CALL_TRANSMIT] =
         g_signal_connect(self->iface, "handle-transmit",
         G_CALLBACK(dbus_service_isodep_handle_transmit), self);
+    self->call_id[CALL_WRITE_NDEF] =
+        g_signal_connect(self->iface, "handle-write-ndef",
+        G_CALLBACK(dbus_service_isodep_handle_write_ndef), self);
+    self->call_id[CALL_TRANSMIT_CHAIN] =
+        g_signal_connect(self->iface, "handle-transmit-chain",
+        G_CALLBACK(dbus_service_isodep_handle_transmit_chain), self);
 
     if (g_dbus_interface_skeleton_export(G_DBUS_INTERFACE_SKELETON
         (self->iface), connection, path, &error)) {
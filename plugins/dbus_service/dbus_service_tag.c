@@ -48,10 +48,23 @@ enum {
 };
 
 enum {
+    TAG_NDEF_PARSED,
     TAG_INITIALIZED,
+    TAG_REATTACHED,
+    TAG_STAGE_IDENTIFIED,
+    TAG_STAGE_NDEF_LOCATED,
+    TAG_STAGE_NDEF_PARSED,
+    TAG_STAGE_CACHED,
     TAG_EVENT_COUNT
 };
 
+/* What has been exported so far */
+typedef enum dbus_service_tag_state {
+    TAG_STATE_NONE,
+    TAG_STATE_NDEF,     /* NDEF records */
+    TAG_STATE_READY     /* Everything */
+} DBUS_SERVICE_TAG_STATE;
+
 enum {
     CALL_GET_ALL,
     CALL_GET_INTERFACE_VERSION,
@@ -64,6 +77,7 @@ enum {
     CALL_DEACTIVATE,
     CALL_ACQUIRE,
     CALL_RELEASE,
+    CALL_GET_STAGE,
     CALL_COUNT
 };
 
@@ -78,6 +92,7 @@ struct dbus_service_tag_call {
     DBusServiceTagCall* next;
     GDBusMethodInvocation* invocation;
     DBusServiceTagCallFunc func;
+    DBUS_SERVICE_TAG_STATE state;   /* Required to complete the call */
 };
 
 typedef struct dbus_service_tag_call_queue {
@@ -106,8 +121,10 @@ struct dbus_service_tag {
     GSList* lock_waters;
     DBusServiceTagLock* lock;
     DBusServiceTagCallQueue queue;
+    DBUS_SERVICE_TAG_STATE state;
     GSList* ndefs;
     NfcTag* tag;
+    NfcTarget* target;  /* Changes when the tag gets reattached */
     gulong target_event_id[TARGET_EVENT_COUNT];
     gulong tag_event_id[TAG_EVENT_COUNT];
     gulong call_id[CALL_COUNT];
@@ -117,7 +134,7 @@ struct dbus_service_tag {
 };
 
 #define NFC_DBUS_TAG_INTERFACE "org.sailfishos.nfc.Tag"
-#define NFC_DBUS_TAG_INTERFACE_VERSION  (2)
+#define NFC_DBUS_TAG_INTERFACE_VERSION  (3)
 
 static const char* const dbus_service_tag_default_interfaces[] = {
     NFC_DBUS_TAG_INTERFACE, NULL
@@ -309,14 +326,13 @@ dbus_service_tag_lock_peer_vanished(
 
 static
 void
-dbus_service_tag_export_all(
+dbus_service_tag_export_ndef(
     DBusServiceTag* self)
 {
-    NfcTag* tag = self->tag;
-    NfcNdefRec* rec = tag->ndef;
-    GPtrArray* interfaces = g_ptr_array_new();
+    NfcNdefRec* rec = self->tag->ndef;
 
-    /* Export NDEF records */
+    GASSERT(self->state < TAG_STATE_NDEF);
+    self->state = TAG_STATE_NDEF;
     if (rec) {
         GString* buf = g_string_new(self->path);
         guint base_len, i;
@@ -337,8 +353,23 @@ dbus_service_tag_export_all(
         }
         g_string_free(buf, TRUE);
     }
+}
+
+static
+void
+dbus_service_tag_export_all(
+    DBusServiceTag* self)
+{
+    NfcTag* tag = self->tag;
+    GPtrArray* interfaces = g_ptr_array_new();
+
+    /* NDEF records may have already been exported */
+    if (self->state < TAG_STATE_NDEF) {
+        dbus_service_tag_export_ndef(self);
+    }
 
     /* Export sub-interfaces */
+    self->state = TAG_STATE_READY;
     g_ptr_array_add(interfaces, (gpointer)NFC_DBUS_TAG_INTERFACE);
     if (NFC_IS_TAG_T2(tag)) {
         self->t2 = dbus_service_tag_t2_new(NFC_TAG_T2(tag), self);
@@ -398,23 +429,35 @@ dbus_service_tag_free_call(
     g_slice_free(DBusServiceTagCall, call);
 }
 
+static
+void
+dbus_service_tag_append_call(
+    DBusServiceTagCallQueue* queue,
+    DBusServiceTagCall* call)
+{
+    call->next = NULL;
+    if (queue->last) {
+        queue->last->next = call;
+    } else {
+        queue->first = call;
+    }
+    queue->last = call;
+}
+
 static
 void
 dbus_service_tag_queue_call(
     DBusServiceTagCallQueue* queue,
     GDBusMethodInvocation* invocation,
+    DBUS_SERVICE_TAG_STATE state,
     DBusServiceTagCallFunc func)
 {
     DBusServiceTagCall* call = g_slice_new0(DBusServiceTagCall);
 
     g_object_ref(call->invocation = invocation);
     call->func = func;
-    if (queue->last) {
-        queue->last->next = call;
-    } else {
-        queue->first = call;
-    }
-    queue->last = call;
+    call->state = state;
+    dbus_service_tag_append_call(queue, call);
 }
 
 static
@@ -438,12 +481,13 @@ gboolean
 dbus_service_tag_handle_call(
     DBusServiceTag* self,
     GDBusMethodInvocation* call,
+    DBUS_SERVICE_TAG_STATE state,
     DBusServiceTagCallFunc func)
 {
-    if (self->tag->flags & NFC_TAG_FLAG_INITIALIZED) {
+    if (self->state >= state) {
         func(call, self);
     } else {
-        dbus_service_tag_queue_call(&self->queue, call, func);
+        dbus_service_tag_queue_call(&self->queue, call, state, func);
     }
     return TRUE;
 }
@@ -453,11 +497,18 @@ void
 dbus_service_tag_complete_pending_calls(
     DBusServiceTag* self)
 {
+    DBusServiceTagCallQueue pending = self->queue;
     DBusServiceTagCall* call;
 
-    while ((call = dbus_service_tag_dequeue_call(&self->queue)) != NULL) {
-        call->func(call->invocation, self);
-        dbus_service_tag_free_call(call);
+    /* Calls which still have to wait go back to the queue */
+    self->queue.first = self->queue.last = NULL;
+    while ((call = dbus_service_tag_dequeue_call(&pending)) != NULL) {
+        if (self->state >= call->state) {
+            call->func(call->invocation, self);
+            dbus_service_tag_free_call(call);
+        } else {
+            dbus_service_tag_append_call(&self->queue, call);
+        }
     }
 }
 
@@ -465,6 +516,20 @@ dbus_service_tag_complete_pending_calls(
  * NfcTag events
  *==========================================================================*/
 
+static
+void
+dbus_service_tag_ndef_parsed(
+    NfcTag* tag,
+    void* user_data)
+{
+    DBusServiceTag* self = user_data;
+
+    if (self->state < TAG_STATE_NDEF) {
+        dbus_service_tag_export_ndef(self);
+        dbus_service_tag_complete_pending_calls(self);
+    }
+}
+
 static
 void
 dbus_service_tag_initialized(
@@ -477,6 +542,37 @@ dbus_service_tag_initialized(
     dbus_service_tag_complete_pending_calls(self);
 }
 
+static
+void
+dbus_service_tag_stage_changed(
+    NfcTag* tag,
+    void* user_data)
+{
+    DBusServiceTag* self = user_data;
+
+    org_sailfishos_nfc_tag_emit_stage_changed(self->iface, nfc_tag_stage(tag));
+}
+
+static
+void
+dbus_service_tag_reattached(
+    NfcTag* tag,
+    void* user_data)
+{
+    DBusServiceTag* self = user_data;
+
+    /* Sequences queued for the old target will never start */
+    g_slist_free_full(self->lock_waters, dbus_service_tag_lock_waiter_free1);
+    self->lock_waters = NULL;
+
+    nfc_target_remove_all_handlers(self->target, self->target_event_id);
+    nfc_target_unref(self->target);
+    self->target = nfc_target_ref(tag->target);
+    self->target_event_id[TARGET_SEQUENCE] =
+        nfc_target_add_sequence_handler(self->target,
+            dbus_service_tag_target_sequence_changed, self);
+}
+
 /*==========================================================================*
  * D-Bus calls
  *==========================================================================*/
@@ -507,7 +603,7 @@ dbus_service_tag_handle_get_all(
     DBusServiceTag* self)
 {
     /* Queue the call if the tag is not initialized yet */
-    return dbus_service_tag_handle_call(self, call,
+    return dbus_service_tag_handle_call(self, call, TAG_STATE_READY,
         dbus_service_tag_complete_get_all);
 }
 
@@ -601,7 +697,7 @@ dbus_service_tag_handle_get_interfaces(
     GDBusMethodInvocation* call,
     DBusServiceTag* self)
 {
-    return dbus_service_tag_handle_call(self, call,
+    return dbus_service_tag_handle_call(self, call, TAG_STATE_READY,
         dbus_service_tag_complete_get_interfaces);
 }
 
@@ -624,12 +720,26 @@ dbus_service_tag_handle_get_ndef_records(
     GDBusMethodInvocation* call,
     DBusServiceTag* self)
 {
-    /* Queue the call if the tag is not initialized yet */
-    dbus_service_tag_handle_call(self, call,
+    /* Queue the call if NDEF hasn't been parsed yet */
+    dbus_service_tag_handle_call(self, call, TAG_STATE_NDEF,
         dbus_service_tag_complete_get_ndef_records);
     return TRUE;
 }
 
+/* GetStage */
+
+static
+gboolean
+dbus_service_tag_handle_get_stage(
+    OrgSailfishosNfcTag* iface,
+    GDBusMethodInvocation* call,
+    DBusServiceTag* self)
+{
+    org_sailfishos_nfc_tag_complete_get_stage(iface, call,
+        nfc_tag_stage(self->tag));
+    return TRUE;
+}
+
 /* Deactivate */
 
 static
@@ -696,8 +806,13 @@ dbus_service_tag_handle_acquire(
                 GDEBUG("%s owns %s", name, self->path);
                 org_sailfishos_nfc_tag_complete_acquire(iface, call);
             } else {
-                /* We actually have to wait */
-                GASSERT(wait);
+                /*
+                 * We actually have to wait. Even if the caller didn't
+                 * want to, there may be higher priority requests (e.g.
+                 * presence checks) queued ahead of the new sequence.
+                 * Those are not going to hold the target for long, and
+                 * nothing else can get in between once they are done.
+                 */
                 waiter = g_slice_new0(DBusServiceTagLockWaiter);
                 waiter->lock = lock;
                 waiter->pending_calls = g_slist_append(waiter->pending_calls,
@@ -772,7 +887,7 @@ dbus_service_tag_free_unexported(
 {
     DBusServiceTagCall* call;
 
-    nfc_target_remove_all_handlers(self->tag->target, self->target_event_id);
+    nfc_target_remove_all_handlers(self->target, self->target_event_id);
     nfc_tag_remove_all_handlers(self->tag, self->tag_event_id);
 
     g_slist_free_full(self->ndefs, dbus_service_tag_free_ndef_rec);
@@ -781,6 +896,7 @@ dbus_service_tag_free_unexported(
     dbus_service_tag_t2_free(self->t2);
     dbus_service_tag_lock_free(self->lock);
 
+    nfc_target_unref(self->target);
     nfc_tag_unref(self->tag);
 
     gutil_disconnect_handlers(self->iface, self->call_id, CALL_COUNT);
@@ -825,18 +941,25 @@ dbus_service_tag_new(
 {
     DBusServiceTag* self = g_new0(DBusServiceTag, 1);
     GError* error = NULL;
+    int stage;
 
     g_object_ref(self->connection = connection);
     self->path = g_strconcat(parent_path, "/", tag->name, NULL);
     self->tag = nfc_tag_ref(tag);
+    self->target = nfc_target_ref(tag->target);
     self->pool = gutil_idle_pool_new();
     self->iface = org_sailfishos_nfc_tag_skeleton_new();
 
     /* NfcTarget events */
     self->target_event_id[TARGET_SEQUENCE] =
-        nfc_target_add_sequence_handler(tag->target,
+        nfc_target_add_sequence_handler(self->target,
             dbus_service_tag_target_sequence_changed, self);
 
+    /* NfcTag events */
+    self->tag_event_id[TAG_REATTACHED] =
+        nfc_tag_add_reattached_handler(tag,
+            dbus_service_tag_reattached, self);
+
     /* D-Bus calls */
     self->call_id[CALL_GET_ALL] =
         g_signal_connect(self->iface, "handle-get-all",
@@ -871,15 +994,36 @@ dbus_service_tag_new(
     self->call_id[CALL_RELEASE] =
         g_signal_connect(self->iface, "handle-release",
         G_CALLBACK(dbus_service_tag_handle_release), self);
+    self->call_id[CALL_GET_STAGE] =
+        g_signal_connect(self->iface, "handle-get-stage",
+        G_CALLBACK(dbus_service_tag_handle_get_stage), self);
 
     if (tag->flags & NFC_TAG_FLAG_INITIALIZED) {
         dbus_service_tag_export_all(self);
     } else {
-        /* Otherwise have to wait until the tag is initialized */
+        /*
+         * Otherwise have to wait until the tag is initialized. NDEF
+         * records can be exported earlier, as soon as they get parsed.
+         */
+        if (nfc_tag_stage(tag) >= NFC_TAG_STAGE_NDEF_PARSED) {
+            dbus_service_tag_export_ndef(self);
+        } else {
+            self->tag_event_id[TAG_NDEF_PARSED] =
+                nfc_tag_add_stage_handler(tag, NFC_TAG_STAGE_NDEF_PARSED,
+                    dbus_service_tag_ndef_parsed, self);
+        }
         self->tag_event_id[TAG_INITIALIZED] =
             nfc_tag_add_initialized_handler(tag,
                 dbus_service_tag_initialized, self);
     }
+
+    /* Stages which haven't been reached yet */
+    for (stage = nfc_tag_stage(tag) + 1; stage <= NFC_TAG_STAGE_CACHED;
+         stage++) {
+        self->tag_event_id[TAG_STAGE_IDENTIFIED + stage -
+            NFC_TAG_STAGE_IDENTIFIED] = nfc_tag_add_stage_handler(tag,
+                stage, dbus_service_tag_stage_changed, self);
+    }
     if (g_dbus_interface_skeleton_export(G_DBUS_INTERFACE_SKELETON
         (self->iface), connection, self->path, &error)) {
         GDEBUG("Created D-Bus object %s", self->path);
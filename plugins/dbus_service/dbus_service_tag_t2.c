@@ -34,6 +34,7 @@
 #include "dbus_service/org.sailfishos.nfc.TagType2.h"
 
 #include <nfc_tag_t2.h>
+#include <nfc_target.h>
 
 #include <gutil_misc.h>
 
@@ -68,10 +69,21 @@ struct dbus_service_tag_t2 {
 
 #define NFC_DBUS_TAG_T2_INTERFACE_VERSION  (1)
 
-typedef struct dbus_service_tag_t2_async_call {
+typedef struct dbus_service_tag_t2_async_call DBusServiceTagType2AsyncCall;
+struct dbus_service_tag_t2_async_call {
+    DBusServiceTagType2AsyncCall* next; /* Only used by the free list */
     OrgSailfishosNfcTagType2* iface;
     GDBusMethodInvocation* call;
-} DBusServiceTagType2AsyncCall;
+};
+
+/*
+ * Async call contexts are recycled as long as there are any Type2
+ * objects around. Everything runs on the main thread.
+ */
+#define DBUS_SERVICE_TAG_T2_MAX_FREE_CALLS (4)
+static guint dbus_service_tag_t2_count = 0;
+static guint dbus_service_tag_t2_free_call_count = 0;
+static DBusServiceTagType2AsyncCall* dbus_service_tag_t2_free_calls = NULL;
 
 /* g_variant_get_data_as_bytes() function appeared in glib 2.36 */
 #define g_variant_get_data_as_bytes(data) \
@@ -106,6 +118,19 @@ dbus_service_tag_t2_bytes_as_variant(
             TRUE, NULL, NULL);
 }
 
+static
+GVariant*
+dbus_service_tag_t2_gbytes_as_variant(
+    GBytes* bytes)
+{
+    gsize size;
+    const void* data = g_bytes_get_data(bytes, &size);
+
+    /* The variant shares the buffer, returns floating reference */
+    return g_variant_new_from_data(G_VARIANT_TYPE("ay"), data, size,
+        TRUE, (GDestroyNotify) g_bytes_unref, g_bytes_ref(bytes));
+}
+
 static
 GVariant*
 dbus_service_tag_t2_get_serial(
@@ -140,9 +165,15 @@ dbus_service_tag_t2_async_call_new(
     OrgSailfishosNfcTagType2* iface,
     GDBusMethodInvocation* call)
 {
-    DBusServiceTagType2AsyncCall* async =
-        g_slice_new(DBusServiceTagType2AsyncCall);
+    DBusServiceTagType2AsyncCall* async = dbus_service_tag_t2_free_calls;
 
+    if (async) {
+        dbus_service_tag_t2_free_calls = async->next;
+        dbus_service_tag_t2_free_call_count--;
+    } else {
+        async = g_slice_new(DBusServiceTagType2AsyncCall);
+    }
+    async->next = NULL;
     g_object_ref(async->iface = iface);
     g_object_ref(async->call = call);
     return async;
@@ -155,7 +186,29 @@ dbus_service_tag_t2_async_call_free1(
 {
     g_object_unref(async->iface);
     g_object_unref(async->call);
-    g_slice_free(DBusServiceTagType2AsyncCall, async);
+    if (dbus_service_tag_t2_count &&
+        dbus_service_tag_t2_free_call_count <
+        DBUS_SERVICE_TAG_T2_MAX_FREE_CALLS) {
+        async->next = dbus_service_tag_t2_free_calls;
+        dbus_service_tag_t2_free_calls = async;
+        dbus_service_tag_t2_free_call_count++;
+    } else {
+        g_slice_free(DBusServiceTagType2AsyncCall, async);
+    }
+}
+
+static
+void
+dbus_service_tag_t2_async_call_clear(
+    void)
+{
+    while (dbus_service_tag_t2_free_calls) {
+        DBusServiceTagType2AsyncCall* async = dbus_service_tag_t2_free_calls;
+
+        dbus_service_tag_t2_free_calls = async->next;
+        g_slice_free(DBusServiceTagType2AsyncCall, async);
+    }
+    dbus_service_tag_t2_free_call_count = 0;
 }
 
 static
@@ -251,15 +304,14 @@ void
 dbus_service_tag_t2_handle_read_done(
     NfcTagType2* tag,
     NFC_TRANSMIT_STATUS status,
-    const void* data,
-    guint len,
+    GBytes* data,
     void* user_data)
 {
     DBusServiceTagType2AsyncCall* read = user_data;
 
-    if (status == NFC_TRANSMIT_STATUS_OK) {
+    if (status == NFC_TRANSMIT_STATUS_OK && data) {
         org_sailfishos_nfc_tag_type2_complete_read(read->iface,
-            read->call, dbus_service_tag_t2_dup_data_as_variant(data, len));
+            read->call, dbus_service_tag_t2_gbytes_as_variant(data));
     } else {
         g_dbus_method_invocation_return_error_literal(read->call,
             DBUS_SERVICE_ERROR, DBUS_SERVICE_ERROR_FAILED,
@@ -284,9 +336,16 @@ dbus_service_tag_t2_handle_read(
         DBusServiceTagType2AsyncCall* read =
             dbus_service_tag_t2_async_call_new(iface, call);
 
-        if (!nfc_tag_t2_read(self->t2, sector, block,
+        const guint id = nfc_tag_t2_read_bytes(self->t2, sector, block,
+            dbus_service_tag_t2_sequence(self, call),
             dbus_service_tag_t2_handle_read_done,
-            dbus_service_tag_t2_async_call_free, read)) {
+            dbus_service_tag_t2_async_call_free, read);
+
+        if (id) {
+            /* Don't read anything if the caller has already given up */
+            nfc_target_set_transmit_deadline(self->t2->tag.target, id,
+                g_get_monotonic_time() + DBUS_SERVICE_CALL_TIMEOUT_MS * 1000);
+        } else {
             dbus_service_tag_t2_async_call_free1(read);
             g_dbus_method_invocation_return_error_literal(call,
                 DBUS_SERVICE_ERROR, DBUS_SERVICE_ERROR_FAILED,
@@ -394,17 +453,33 @@ dbus_service_tag_t2_handle_read_data(
     DBusServiceTagType2* self)
 {
     NfcTagType2* t2 = self->t2;
-    DBusServiceTagType2AsyncCall* read =
-        dbus_service_tag_t2_async_call_new(iface, call);
+    GBytes* cached = nfc_tag_t2_read_data_cached(t2, offset, maxbytes);
 
-    if (!nfc_tag_t2_read_data_seq(t2, offset, maxbytes,
-        dbus_service_tag_t2_sequence(self, call),
-        dbus_service_tag_t2_handle_read_data_done,
-        dbus_service_tag_t2_async_call_free, read)) {
-        dbus_service_tag_t2_async_call_free1(read);
-        g_dbus_method_invocation_return_error_literal(call,
-            DBUS_SERVICE_ERROR, DBUS_SERVICE_ERROR_FAILED,
-            "Failed to read tag data");
+    if (cached) {
+        /* Reply right away, without copying the data */
+        org_sailfishos_nfc_tag_type2_complete_read_data(iface, call,
+            dbus_service_tag_t2_gbytes_as_variant(cached));
+        g_bytes_unref(cached);
+    } else {
+        DBusServiceTagType2AsyncCall* read =
+            dbus_service_tag_t2_async_call_new(iface, call);
+
+        if (nfc_tag_t2_read_data_seq(t2, offset, maxbytes,
+            dbus_service_tag_t2_sequence(self, call),
+            dbus_service_tag_t2_handle_read_data_done,
+            dbus_service_tag_t2_async_call_free, read)) {
+            /*
+             * Whoever reads the data piece by piece is likely to come
+             * back for more, prefetch the rest in the background (behind
+             * this read). ReadAllData fetches everything by itself.
+             */
+            nfc_tag_t2_set_read_ahead(t2, TRUE);
+        } else {
+            dbus_service_tag_t2_async_call_free1(read);
+            g_dbus_method_invocation_return_error_literal(call,
+                DBUS_SERVICE_ERROR, DBUS_SERVICE_ERROR_FAILED,
+                "Failed to read tag data");
+        }
     }
     return TRUE;
 }
@@ -440,17 +515,26 @@ dbus_service_tag_t2_handle_read_all_data(
     DBusServiceTagType2* self)
 {
     NfcTagType2* t2 = self->t2;
-    DBusServiceTagType2AsyncCall* read =
-        dbus_service_tag_t2_async_call_new(iface, call);
+    GBytes* cached = nfc_tag_t2_read_data_cached(t2, 0, t2->data_size);
 
-    if (!nfc_tag_t2_read_data_seq(t2, 0, t2->data_size,
-        dbus_service_tag_t2_sequence(self, call),
-        dbus_service_tag_t2_handle_read_all_data_done,
-        dbus_service_tag_t2_async_call_free, read)) {
-        dbus_service_tag_t2_async_call_free1(read);
-        g_dbus_method_invocation_return_error_literal(call,
-            DBUS_SERVICE_ERROR, DBUS_SERVICE_ERROR_FAILED,
-            "Failed to read tag data");
+    if (cached) {
+        /* Reply right away, without copying the data */
+        org_sailfishos_nfc_tag_type2_complete_read_all_data(iface, call,
+            dbus_service_tag_t2_gbytes_as_variant(cached));
+        g_bytes_unref(cached);
+    } else {
+        DBusServiceTagType2AsyncCall* read =
+            dbus_service_tag_t2_async_call_new(iface, call);
+
+        if (!nfc_tag_t2_read_data_seq(t2, 0, t2->data_size,
+            dbus_service_tag_t2_sequence(self, call),
+            dbus_service_tag_t2_handle_read_all_data_done,
+            dbus_service_tag_t2_async_call_free, read)) {
+            dbus_service_tag_t2_async_call_free1(read);
+            g_dbus_method_invocation_return_error_literal(call,
+                DBUS_SERVICE_ERROR, DBUS_SERVICE_ERROR_FAILED,
+                "Failed to read tag data");
+        }
     }
     return TRUE;
 }
@@ -490,8 +574,9 @@ dbus_service_tag_t2_handle_write_data(
     DBusServiceTagType2AsyncCall* write =
         dbus_service_tag_t2_async_call_new(iface, call);
 
-    if (!nfc_tag_t2_write_data_seq(self->t2, offset, bytes,
-        dbus_service_tag_t2_sequence(self, call),
+    /* Don't rewrite the blocks which already contain the right data */
+    if (!nfc_tag_t2_write_data_seq2(self->t2, offset, bytes,
+        dbus_service_tag_t2_sequence(self, call), NFC_TAG_T2_WRITE_FLAG_DIFF,
         dbus_service_tag_t2_handle_write_data_done,
         dbus_service_tag_t2_async_call_free, write)) {
         dbus_service_tag_t2_async_call_free1(write);
@@ -521,6 +606,11 @@ dbus_service_tag_t2_free_unexported(
         g_variant_unref(self->serial);
     }
     g_free(self);
+
+    /* Don't keep anything in the free list when it's not needed */
+    if (!--dbus_service_tag_t2_count) {
+        dbus_service_tag_t2_async_call_clear();
+    }
 }
 
 DBusServiceTagType2*
@@ -533,6 +623,7 @@ dbus_service_tag_t2_new(
     DBusServiceTagType2* self = g_new0(DBusServiceTagType2, 1);
     GError* error = NULL;
 
+    dbus_service_tag_t2_count++;
     nfc_tag_ref(&(self->t2 = t2)->tag);
     self->iface = org_sailfishos_nfc_tag_type2_skeleton_new();
     self->owner = owner;
@@ -31,6 +31,9 @@
  */
 
 #include "internal/nfc_manager_i.h"
+#include "nfc_adapter.h"
+#include "nfc_tag_t2.h"
+#include "nfc_tag_t4.h"
 
 #include "dbus_handlers/plugin.h"
 #include "dbus_log/plugin.h"
@@ -39,6 +42,7 @@
 #include "settings/plugin.h"
 
 #include <gutil_log.h>
+#include <gutil_misc.h>
 #include <gutil_strv.h>
 
 #include <gio/gio.h>
@@ -63,9 +67,12 @@ static FILE* nfcd_log_file = NULL;
 typedef struct nfcd_opt {
     char* plugin_dir;
     gboolean dont_unload;
+    int reattach_ms;
 } NfcdOpt;
 
 #define DEFAULT_PLUGIN_DIR "/usr/lib/nfcd/plugins"
+#define DEFAULT_TAG_CACHE_DIR "/var/lib/nfcd/t2cache"
+#define DEFAULT_TAG_CACHE_SIZE (1024 * 1024)
 
 #define RET_OK      (0)
 #define RET_CMDLINE (1)
@@ -93,6 +100,16 @@ nfcd_stopped(
     g_main_loop_quit(loop);
 }
 
+static
+void
+nfcd_adapter_added(
+    NfcManager* manager,
+    NfcAdapter* adapter,
+    void* opts)
+{
+    nfc_adapter_set_reattach_window(adapter, ((NfcdOpt*)opts)->reattach_ms);
+}
+
 static
 int
 nfcd_run(
@@ -107,6 +124,9 @@ nfcd_run(
         .flags = opts->dont_unload ? NFC_PLUGINS_DONT_UNLOAD : 0
     };
     NfcManager* nfc = nfc_manager_new(&plugins_info);
+    gulong adapter_id = (opts->reattach_ms > 0) ?
+        nfc_manager_add_adapter_added_handler(nfc, nfcd_adapter_added,
+            opts) : 0;
 
     if (nfc_manager_start(nfc)) {
         if (!nfc->stopped) {
@@ -127,6 +147,7 @@ nfcd_run(
         }
         ret = RET_OK;
     }
+    nfc_manager_remove_handler(nfc, adapter_id);
     nfc_manager_unref(nfc);
     return ret;
 }
@@ -257,6 +278,59 @@ nfcd_opt_log_type(
     }
 }
 
+static
+gboolean
+nfcd_opt_tag_cache(
+    const gchar* name,
+    const gchar* value,
+    gpointer data,
+    GError** error)
+{
+    nfc_tag_t2_set_cache((value && value[0]) ? value : DEFAULT_TAG_CACHE_DIR,
+        DEFAULT_TAG_CACHE_SIZE);
+    return TRUE;
+}
+
+static
+gboolean
+nfcd_opt_t4_no_reactivate(
+    const gchar* name,
+    const gchar* value,
+    gpointer data,
+    GError** error)
+{
+    GBytes* bytes = NULL;
+    GUtilData hb;
+
+    memset(&hb, 0, sizeof(hb));
+    if (value && value[0]) {
+        bytes = gutil_hex2bytes(value, -1);
+        if (!bytes) {
+            *error = g_error_new(G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE,
+                "Invalid historical bytes \'%s\'", value);
+            return FALSE;
+        }
+        hb.bytes = g_bytes_get_data(bytes, &hb.size);
+    }
+    nfc_tag_t4_add_reactivate_rule(&hb, NFC_TAG_T4_REACTIVATE_NEVER);
+    if (bytes) {
+        g_bytes_unref(bytes);
+    }
+    return TRUE;
+}
+
+static
+gboolean
+nfcd_opt_t2_get_version(
+    const gchar* name,
+    const gchar* value,
+    gpointer data,
+    GError** error)
+{
+    nfc_tag_t2_set_get_version(TRUE);
+    return TRUE;
+}
+
 static
 gboolean
 nfcd_opt_debug(
@@ -292,6 +366,19 @@ nfcd_opt_parse(
           "Disable plugins (repeatable)", "PLUGINS"},
         { "dont-unload", 'U', 0, G_OPTION_ARG_NONE, &opt->dont_unload,
           "Don't unload external plugins on exit", NULL },
+        { "tag-cache", 'c', G_OPTION_FLAG_OPTIONAL_ARG, G_OPTION_ARG_CALLBACK,
+          nfcd_opt_tag_cache, "Cache Type 2 tag contents ["
+          DEFAULT_TAG_CACHE_DIR "]", "DIR" },
+        { "t4-no-reactivate", 'r', G_OPTION_FLAG_OPTIONAL_ARG,
+          G_OPTION_ARG_CALLBACK, nfcd_opt_t4_no_reactivate,
+          "Don't reactivate Type 4 tags starting with these historical "
+          "bytes, all if none (repeatable)", "HEX" },
+        { "reattach-window", 'w', 0, G_OPTION_ARG_INT, &opt->reattach_ms,
+          "Keep tags around for up to MS milliseconds after they leave "
+          "the field, in case they come back [0]", "MS" },
+        { "t2-get-version", 'g', G_OPTION_FLAG_NO_ARG, G_OPTION_ARG_CALLBACK,
+          nfcd_opt_t2_get_version, "Identify Type 2 chips with GET_VERSION "
+          "(costs a reactivation for chips which don't support it)", NULL },
         { NULL }
     };
     GOptionContext* options = g_option_context_new("- NFC daemon");
@@ -327,6 +414,9 @@ nfcd_opt_cleanup(
     g_free(opts->plugin_dir);
     g_strfreev(nfcd_enable_plugins);
     g_strfreev(nfcd_disable_plugins);
+    nfc_tag_t2_set_cache(NULL, 0);
+    nfc_tag_t2_set_get_version(FALSE);
+    nfc_tag_t4_clear_reactivate_rules();
 }
 
 int main(int argc, char* argv[])
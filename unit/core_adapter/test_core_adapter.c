@@ -36,6 +36,7 @@
 #include "nfc_adapter_p.h"
 #include "nfc_adapter_impl.h"
 #include "nfc_target_impl.h"
+#include "nfc_tag_p.h"
 #include "nfc_tag_t2.h"
 
 #include <gutil_log.h>
@@ -243,6 +244,7 @@ test_null(
     nfc_adapter_set_enabled(NULL, TRUE);
     nfc_adapter_request_power(NULL, TRUE);
     nfc_adapter_remove_tag(NULL, NULL);
+    nfc_adapter_set_reattach_window(NULL, 0);
     nfc_adapter_remove_handler(NULL, 0);
     nfc_adapter_remove_handlers(NULL, NULL, 0);
     nfc_adapter_unref(NULL);
@@ -650,6 +652,152 @@ test_tags(
     nfc_target_unref(target1);
 }
 
+/*==========================================================================*
+ * reattach
+ *==========================================================================*/
+
+static
+void
+test_reattach_tag_inc(
+    NfcTag* tag,
+    void* user_data)
+{
+    (*(int*)user_data)++;
+}
+
+static
+void
+test_reattach_removed(
+    NfcAdapter* adapter,
+    NfcTag* tag,
+    void* loop)
+{
+    g_main_loop_quit((GMainLoop*)loop);
+}
+
+static
+void
+test_reattach(
+    void)
+{
+    static const guint8 uid[] = { 0x04, 0x9b, 0xfb, 0x4a, 0xeb, 0x2b, 0x80 };
+    static const guint8 other_uid[] = { 0x04, 0x9b, 0xfb, 0x4a, 0xeb, 0x2b };
+    static const guint8 random_uid[] = { 0x08, 0x01, 0x02, 0x03 };
+    TestAdapter* test = test_adapter_new();
+    NfcAdapter* adapter = &test->adapter;
+    NfcTarget* target0 = test_target_new_tech(NFC_TECHNOLOGY_A);
+    NfcTarget* target1 = test_target_new_tech(NFC_TECHNOLOGY_A);
+    NfcTarget* target2 = test_target_new_tech(NFC_TECHNOLOGY_A);
+    NfcTarget* target3 = test_target_new_tech(NFC_TECHNOLOGY_A);
+    GMainLoop* loop = g_main_loop_new(NULL, TRUE);
+    NfcParamPoll poll;
+    NfcTag* tag;
+    NfcTag* tag2;
+    gulong id[3];
+    gulong reattached_id;
+    int tag_added = 0, tag_removed = 0, reattached = 0;
+
+    id[0] = nfc_adapter_add_tag_added_handler(adapter,
+        test_adapter_tag_inc, &tag_added);
+    id[1] = nfc_adapter_add_tag_removed_handler(adapter,
+        test_adapter_tag_inc, &tag_removed);
+    id[2] = 0;
+    nfc_adapter_set_name(adapter, "test");
+    nfc_adapter_set_reattach_window(adapter, 100);
+
+    memset(&poll, 0, sizeof(poll));
+    poll.a.nfcid1.bytes = uid;
+    poll.a.nfcid1.size = sizeof(uid);
+    tag = nfc_tag_ref(nfc_adapter_add_other_tag2(adapter, target0, &poll));
+    g_assert(tag);
+    g_assert_cmpint(tag_added, == ,1);
+    reattached_id = nfc_tag_add_reattached_handler(tag,
+        test_reattach_tag_inc, &reattached);
+    g_assert(reattached_id);
+
+    /* Tag which is not initialized yet isn't worth waiting for */
+    nfc_target_gone(target0);
+    g_assert(!tag->present);
+    g_assert_cmpint(tag_removed, == ,1);
+    nfc_tag_remove_handler(tag, reattached_id);
+    nfc_tag_unref(tag);
+
+    /* Initialized tag outlives its target */
+    tag = nfc_tag_ref(nfc_adapter_add_other_tag2(adapter, target1, &poll));
+    g_assert(tag);
+    g_assert_cmpint(tag_added, == ,2);
+    nfc_tag_set_initialized(tag);
+    reattached_id = nfc_tag_add_reattached_handler(tag,
+        test_reattach_tag_inc, &reattached);
+    nfc_target_gone(target1);
+    g_assert(tag->present);
+    g_assert_cmpint(tag_removed, == ,1);
+
+    /* Different NFCID1 means a different tag */
+    poll.a.nfcid1.bytes = other_uid;
+    poll.a.nfcid1.size = sizeof(other_uid);
+    tag2 = nfc_adapter_add_other_tag2(adapter, target2, &poll);
+    g_assert(tag2);
+    g_assert(tag2 != tag);
+    g_assert_cmpint(tag_added, == ,3);
+    nfc_adapter_remove_tag(adapter, tag2->name);
+    g_assert_cmpint(tag_removed, == ,2);
+
+    /* The same one comes back */
+    poll.a.nfcid1.bytes = uid;
+    poll.a.nfcid1.size = sizeof(uid);
+    g_assert(nfc_adapter_add_other_tag2(adapter, target3, &poll) == tag);
+    g_assert(tag->target == target3);
+    g_assert(tag->present);
+    g_assert_cmpint(tag_added, == ,3);
+    g_assert_cmpint(reattached, == ,1);
+
+    /* And leaves for good */
+    id[2] = nfc_adapter_add_tag_removed_handler(adapter,
+        test_reattach_removed, loop);
+    nfc_target_gone(target3);
+    g_assert(tag->present);
+    test_run(&test_opt, loop);
+    g_assert(!tag->present);
+    g_assert_cmpint(tag_removed, == ,3);
+    nfc_tag_remove_handler(tag, reattached_id);
+    nfc_tag_unref(tag);
+    nfc_adapter_remove_handler(adapter, id[2]);
+    id[2] = 0;
+
+    /* Random NFCID1 can't be used to recognize the tag */
+    poll.a.nfcid1.bytes = random_uid;
+    poll.a.nfcid1.size = sizeof(random_uid);
+    nfc_target_unref(target0);
+    target0 = test_target_new_tech(NFC_TECHNOLOGY_A);
+    tag = nfc_tag_ref(nfc_adapter_add_other_tag2(adapter, target0, &poll));
+    g_assert(tag);
+    nfc_tag_set_initialized(tag);
+    nfc_target_gone(target0);
+    g_assert(!tag->present);
+    g_assert_cmpint(tag_removed, == ,4);
+    nfc_tag_unref(tag);
+
+    /* Held tag gets dropped together with the adapter */
+    nfc_target_unref(target1);
+    target1 = test_target_new_tech(NFC_TECHNOLOGY_A);
+    poll.a.nfcid1.bytes = uid;
+    poll.a.nfcid1.size = sizeof(uid);
+    tag = nfc_adapter_add_other_tag2(adapter, target1, &poll);
+    g_assert(tag);
+    nfc_tag_set_initialized(tag);
+    nfc_target_gone(target1);
+    g_assert(tag->present);
+
+    nfc_adapter_remove_all_handlers(adapter, id);
+    nfc_adapter_unref(adapter);
+    nfc_target_unref(target0);
+    nfc_target_unref(target1);
+    nfc_target_unref(target2);
+    nfc_target_unref(target3);
+    g_main_loop_unref(loop);
+}
+
 /*==========================================================================*
  * Common
  *==========================================================================*/
@@ -668,6 +816,7 @@ int main(int argc, char* argv[])
     g_test_add_func(TEST_("power"), test_power);
     g_test_add_func(TEST_("mode"), test_mode);
     g_test_add_func(TEST_("tags"), test_tags);
+    g_test_add_func(TEST_("reattach"), test_reattach);
     test_init(&test_opt, argc, argv);
     return g_test_run();
 }
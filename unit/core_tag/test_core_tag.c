@@ -64,6 +64,10 @@ test_null(
     g_assert(!nfc_tag_param(NULL));
     g_assert(!nfc_tag_add_initialized_handler(NULL, NULL, NULL));
     g_assert(!nfc_tag_add_gone_handler(NULL, NULL, NULL));
+    g_assert(!nfc_tag_add_reattached_handler(NULL, NULL, NULL));
+    g_assert(!nfc_tag_add_stage_handler(NULL, NFC_TAG_STAGE_CACHED, NULL,
+        NULL));
+    g_assert(nfc_tag_stage(NULL) == NFC_TAG_STAGE_NONE);
     nfc_tag_remove_handler(NULL, 0);
     nfc_tag_remove_handlers(NULL, NULL, 0);
     nfc_tag_unref(NULL);
@@ -103,6 +107,7 @@ test_basic(
     g_assert(init_id);
 
     g_assert(!nfc_tag_add_gone_handler(tag, NULL, NULL));
+    g_assert(!nfc_tag_add_reattached_handler(tag, NULL, NULL));
     gone_id = nfc_tag_add_gone_handler(tag, test_tag_inc, &gone_count);
     g_assert(gone_id);
 
@@ -214,6 +219,93 @@ test_basic_b(
     nfc_target_unref(target);
 }
 
+/*==========================================================================*
+ * stage
+ *==========================================================================*/
+
+static
+void
+test_stage_initialized(
+    NfcTag* tag,
+    void* user_data)
+{
+    /* NDEF is parsed by the time the tag is initialized */
+    g_assert(nfc_tag_stage(tag) == NFC_TAG_STAGE_NDEF_PARSED);
+    (*(int*)user_data)++;
+}
+
+static
+void
+test_stage(
+    void)
+{
+    NfcTag* tag = g_object_new(NFC_TYPE_TAG, NULL);
+    NfcTarget* target = test_target_new();
+    int located = 0, parsed = 0, cached = 0, init_count = 0;
+    gulong id[4];
+
+    g_assert(nfc_tag_stage(tag) == NFC_TAG_STAGE_NONE);
+    nfc_tag_init_base(tag, target, NULL);
+    nfc_tag_set_name(tag, "test");
+    g_assert(nfc_tag_stage(tag) == NFC_TAG_STAGE_IDENTIFIED);
+
+    g_assert(!nfc_tag_add_stage_handler(tag, NFC_TAG_STAGE_CACHED, NULL,
+        NULL));
+    g_assert(!nfc_tag_add_stage_handler(tag, NFC_TAG_STAGE_NONE,
+        test_tag_inc, NULL));
+    g_assert(!nfc_tag_add_stage_handler(tag, NFC_TAG_STAGE_CACHED + 1,
+        test_tag_inc, NULL));
+    id[0] = nfc_tag_add_stage_handler(tag, NFC_TAG_STAGE_NDEF_LOCATED,
+        test_tag_inc, &located);
+    id[1] = nfc_tag_add_stage_handler(tag, NFC_TAG_STAGE_NDEF_PARSED,
+        test_tag_inc, &parsed);
+    id[2] = nfc_tag_add_stage_handler(tag, NFC_TAG_STAGE_CACHED,
+        test_tag_inc, &cached);
+    id[3] = nfc_tag_add_initialized_handler(tag,
+        test_stage_initialized, &init_count);
+    g_assert(id[0]);
+    g_assert(id[1]);
+    g_assert(id[2]);
+    g_assert(id[3]);
+
+    /* Stages only move forward */
+    nfc_tag_set_stage(tag, NFC_TAG_STAGE_NDEF_LOCATED);
+    nfc_tag_set_stage(tag, NFC_TAG_STAGE_IDENTIFIED);
+    g_assert(nfc_tag_stage(tag) == NFC_TAG_STAGE_NDEF_LOCATED);
+    g_assert_cmpint(located, == ,1);
+    g_assert_cmpint(parsed, == ,0);
+
+    /* Initialization implies that NDEF has been parsed */
+    nfc_tag_set_initialized(tag);
+    g_assert(nfc_tag_stage(tag) == NFC_TAG_STAGE_NDEF_PARSED);
+    g_assert_cmpint(located, == ,1);
+    g_assert_cmpint(parsed, == ,1);
+    g_assert_cmpint(init_count, == ,1);
+    g_assert_cmpint(cached, == ,0);
+
+    nfc_tag_set_stage(tag, NFC_TAG_STAGE_CACHED);
+    nfc_tag_set_stage(tag, NFC_TAG_STAGE_CACHED);
+    g_assert_cmpint(cached, == ,1);
+    nfc_tag_remove_all_handlers(tag, id);
+    nfc_tag_unref(tag);
+
+    /* Stages which are skipped are signaled too */
+    tag = g_object_new(NFC_TYPE_TAG, NULL);
+    nfc_tag_init_base(tag, target, NULL);
+    located = parsed = 0;
+    id[0] = nfc_tag_add_stage_handler(tag, NFC_TAG_STAGE_NDEF_LOCATED,
+        test_tag_inc, &located);
+    id[1] = nfc_tag_add_stage_handler(tag, NFC_TAG_STAGE_NDEF_PARSED,
+        test_tag_inc, &parsed);
+    id[2] = id[3] = 0;
+    nfc_tag_set_initialized(tag);
+    g_assert_cmpint(located, == ,1);
+    g_assert_cmpint(parsed, == ,1);
+    nfc_tag_remove_all_handlers(tag, id);
+    nfc_tag_unref(tag);
+    nfc_target_unref(target);
+}
+
 /*==========================================================================*
  * Common
  *==========================================================================*/
@@ -230,6 +322,7 @@ int main(int argc, char* argv[])
     g_test_add_func(TEST_("basic"), test_basic);
     g_test_add_func(TEST_("basic_a"), test_basic_a);
     g_test_add_func(TEST_("basic_b"), test_basic_b);
+    g_test_add_func(TEST_("stage"), test_stage);
     test_init(&test_opt, argc, argv);
     return g_test_run();
 }
@@ -35,11 +35,14 @@
 #include "nfc_ndef.h"
 #include "nfc_tag_p.h"
 #include "nfc_tag_t2.h"
+#include "nfc_target_p.h"
 #include "nfc_target_impl.h"
 
 #include <gutil_log.h>
 #include <gutil_misc.h>
 
+#include <glib/gstdio.h>
+
 static TestOpt test_opt;
 
 #define SUPER_LONG_TIMEOUT (24*60*60) /* seconds */
@@ -359,12 +362,23 @@ typedef struct test_target {
     GUtilData data;
     const TestTargetError* read_error;
     const TestTargetError* write_error;
+    gboolean fast_read;
+    guint read_count;
+    guint write_count;
+    const GUtilData* version;
+    guint reactivate_id;
+    guint reactivate_count;
+    gboolean sector_select;
+    guint sector;
+    guint select_count;
+    guint select_nack; /* SECTOR_SELECT packet (1 or 2) to NACK once */
 } TestTarget;
 
 #define TEST_TARGET_READ_SIZE (16)
 #define TEST_TARGET_BLOCK_SIZE (4)
 #define TEST_FIRST_DATA_BLOCK (4)
 #define TEST_DATA_OFFSET (TEST_FIRST_DATA_BLOCK * TEST_TARGET_BLOCK_SIZE)
+#define TEST_SECTOR_SIZE (256 * TEST_TARGET_BLOCK_SIZE)
 G_DEFINE_TYPE(TestTarget, test_target, NFC_TYPE_TARGET)
 #define TEST_TYPE_TARGET (test_target_get_type())
 #define TEST_TARGET(obj) (G_TYPE_CHECK_INSTANCE_CAST(obj, \
@@ -381,11 +395,13 @@ typedef enum test_target_error_type {
 struct test_target_error {
     TEST_TARGET_ERROR_TYPE type;
     guint block;
+    gboolean persistent; /* Otherwise it happens only once */
 };
 
 typedef struct test_target_read {
     TestTarget* test;
     guint block;
+    guint size;
 } TestTargetRead;
 
 typedef struct test_target_write {
@@ -422,6 +438,7 @@ test_target_new(
      TestTarget* self = g_object_new(TEST_TYPE_TARGET, NULL);
 
      self->target.technology = NFC_TECHNOLOGY_A;
+     self->fast_read = TRUE; /* Test images come from NTAG chips */
      self->data.bytes = self->storage = g_memdup(bytes, size);
      self->data.size = size;
      return self;
@@ -437,20 +454,22 @@ test_target_read_done(
     NfcTarget* target = &test->target;
     const GUtilData* data = &test->data;
     NFC_TRANSMIT_STATUS status = NFC_TRANSMIT_STATUS_OK;
-    guint offset = (read->block * TEST_TARGET_BLOCK_SIZE) % data->size;
-    guint8 buf[TEST_TARGET_READ_SIZE];
-    guint len = sizeof(buf);
+    guint offset = (test->sector * TEST_SECTOR_SIZE +
+        read->block * TEST_TARGET_BLOCK_SIZE) % data->size;
+    guint8* buf = g_malloc(read->size);
+    guint len = read->size;
 
     g_assert(test->transmit_id);
     test->transmit_id = 0;
+    test->read_count++;
 
-    if ((offset + TEST_TARGET_READ_SIZE) <= data->size) {
-        memcpy(buf, data->bytes + offset, TEST_TARGET_READ_SIZE);
+    if ((offset + read->size) <= data->size) {
+        memcpy(buf, data->bytes + offset, read->size);
     } else {
-        const guint remain = (offset + TEST_TARGET_READ_SIZE) - data->size;
+        const guint remain = (offset + read->size) - data->size;
 
-        memcpy(buf, data->bytes + offset, TEST_TARGET_READ_SIZE - remain);
-        memcpy(buf + (TEST_TARGET_READ_SIZE - remain), data->bytes, remain);
+        memcpy(buf, data->bytes + offset, read->size - remain);
+        memcpy(buf + (read->size - remain), data->bytes, remain);
     }
 
     if (test->read_error && test->read_error->block == read->block) {
@@ -478,12 +497,16 @@ test_target_read_done(
             test->transmit_id = g_timeout_add_seconds(SUPER_LONG_TIMEOUT,
                 test_timeout_expired, NULL);
             /* Don't call nfc_target_transmit_done() */
+            g_free(buf);
             return G_SOURCE_REMOVE;
         }
-        test->read_error = NULL;
+        if (!test->read_error->persistent) {
+            test->read_error = NULL;
+        }
     }
 
     nfc_target_transmit_done(target, status, buf, len);
+    g_free(buf);
     return G_SOURCE_REMOVE;
 }
 
@@ -501,6 +524,7 @@ test_target_write_done(
 
     g_assert(test->transmit_id);
     test->transmit_id = 0;
+    test->write_count++;
 
     if (test->write_error && test->write_error->block == write->block) {
         switch (test->write_error->type) {
@@ -528,7 +552,8 @@ test_target_write_done(
         test->write_error = NULL;
     } else {
         const guint storage_size = test->data.size;
-        guint offset = (write->block * TEST_TARGET_BLOCK_SIZE) % storage_size;
+        guint offset = (test->sector * TEST_SECTOR_SIZE +
+            write->block * TEST_TARGET_BLOCK_SIZE) % storage_size;
         guint size = write->size;
         const guint8* src = write->data;
 
@@ -551,6 +576,58 @@ test_target_write_done(
     return G_SOURCE_REMOVE;
 }
 
+static
+gboolean
+test_target_version_done(
+    gpointer user_data)
+{
+    TestTarget* test = user_data;
+    const GUtilData* version = test->version;
+    static const guint8 nack = 0;
+
+    g_assert(test->transmit_id);
+    test->transmit_id = 0;
+    if (version) {
+        nfc_target_transmit_done(&test->target, NFC_TRANSMIT_STATUS_OK,
+            version->bytes, version->size);
+    } else {
+        /* Not supported */
+        nfc_target_transmit_done(&test->target, NFC_TRANSMIT_STATUS_NACK,
+            &nack, 1);
+    }
+    return G_SOURCE_REMOVE;
+}
+
+static
+gboolean
+test_target_select_done(
+    gpointer user_data)
+{
+    TestTarget* test = user_data;
+    static const guint8 ack = 0x0a;
+
+    g_assert(test->transmit_id);
+    test->transmit_id = 0;
+    if (test->select_nack == (test->sector_select ? 1 : 2)) {
+        static const guint8 nack = 0;
+
+        GDEBUG("NACK packet %u", test->select_nack);
+        test->select_nack = 0;
+        test->sector_select = FALSE;
+        nfc_target_transmit_done(&test->target, NFC_TRANSMIT_STATUS_NACK,
+            &nack, 1);
+    } else if (test->sector_select) {
+        /* Packet 1 is acknowledged */
+        nfc_target_transmit_done(&test->target, NFC_TRANSMIT_STATUS_OK,
+            &ack, 1);
+    } else {
+        /* Packet 2 is acknowledged passively, i.e. by silence */
+        nfc_target_transmit_done(&test->target, NFC_TRANSMIT_STATUS_ERROR,
+            NULL, 0);
+    }
+    return G_SOURCE_REMOVE;
+}
+
 static
 void
 test_target_write_free(
@@ -572,7 +649,22 @@ test_target_transmit(
     TestTarget* test = TEST_TARGET(target);
 
     g_assert(!test->transmit_id);
-    if (len > 0) {
+    if (test->sector_select) {
+        const guint8* cmd = data;
+
+        /* Second packet of SECTOR_SELECT */
+        test->sector_select = FALSE;
+        if (len == 4) {
+            if (test->select_nack != 2) {
+                test->sector = cmd[0];
+                test->select_count++;
+                GDEBUG("Select sector #%u", test->sector);
+            }
+            test->transmit_id = g_idle_add_full(G_PRIORITY_DEFAULT_IDLE,
+                test_target_select_done, test, NULL);
+            return TRUE;
+        }
+    } else if (len > 0) {
         const guint8* cmd = data;
 
         switch (cmd[0]) {
@@ -582,12 +674,42 @@ test_target_transmit(
 
                 read->test = test;
                 read->block = cmd[1];
+                read->size = TEST_TARGET_READ_SIZE;
                 GDEBUG("Read block #%u", read->block);
                 test->transmit_id = g_idle_add_full(G_PRIORITY_DEFAULT_IDLE,
                     test_target_read_done, read, g_free);
                 return TRUE;
             }
             break;
+        case 0x3a: /* FAST_READ */
+            if (len == 3 && test->fast_read && cmd[2] >= cmd[1]) {
+                TestTargetRead* read = g_new(TestTargetRead, 1);
+
+                read->test = test;
+                read->block = cmd[1];
+                read->size = (cmd[2] - cmd[1] + 1) * TEST_TARGET_BLOCK_SIZE;
+                GDEBUG("Fast read blocks #%u..%u", cmd[1], cmd[2]);
+                test->transmit_id = g_idle_add_full(G_PRIORITY_DEFAULT_IDLE,
+                    test_target_read_done, read, g_free);
+                return TRUE;
+            }
+            break;
+        case 0x60: /* GET_VERSION */
+            if (len == 1) {
+                GDEBUG("Get version");
+                test->transmit_id = g_idle_add_full(G_PRIORITY_DEFAULT_IDLE,
+                    test_target_version_done, test, NULL);
+                return TRUE;
+            }
+            break;
+        case 0xc2: /* SECTOR_SELECT */
+            if (len == 2 && cmd[1] == 0xff) {
+                test->sector_select = TRUE;
+                test->transmit_id = g_idle_add_full(G_PRIORITY_DEFAULT_IDLE,
+                    test_target_select_done, test, NULL);
+                return TRUE;
+            }
+            break;
         case 0xa2: /* WRITE */
             if (len >= 2) {
                 TestTargetWrite* write = g_new(TestTargetWrite, 1);
@@ -619,6 +741,31 @@ test_target_cancel_transmit(
     test->transmit_id = 0;
 }
 
+static
+gboolean
+test_target_reactivated(
+    gpointer user_data)
+{
+    TestTarget* test = user_data;
+
+    test->reactivate_id = 0;
+    test->reactivate_count++;
+    nfc_target_reactivated(&test->target);
+    return G_SOURCE_REMOVE;
+}
+
+static
+gboolean
+test_target_reactivate(
+    NfcTarget* target)
+{
+    TestTarget* test = TEST_TARGET(target);
+
+    g_assert(!test->reactivate_id);
+    test->reactivate_id = g_idle_add(test_target_reactivated, test);
+    return TRUE;
+}
+
 static
 void
 test_target_init(
@@ -636,6 +783,9 @@ test_target_finalize(
     if (test->transmit_id) {
         g_source_remove(test->transmit_id);
     }
+    if (test->reactivate_id) {
+        g_source_remove(test->reactivate_id);
+    }
     g_free(test->storage);
     G_OBJECT_CLASS(test_target_parent_class)->finalize(object);
 }
@@ -647,6 +797,7 @@ test_target_class_init(
 {
     klass->transmit = test_target_transmit;
     klass->cancel_transmit = test_target_cancel_transmit;
+    klass->reactivate = test_target_reactivate;
     G_OBJECT_CLASS(klass)->finalize = test_target_finalize;
 }
 
@@ -664,12 +815,20 @@ test_null(
     /* Public interfaces are NULL tolerant */
     g_assert(!nfc_tag_t2_new(NULL, NULL));
     g_assert(!nfc_tag_t2_new(target, NULL));
+    g_assert(!nfc_tag_t2_product(NULL));
+    g_assert(nfc_tag_t2_read_ahead_state(NULL) == NFC_TAG_T2_READ_AHEAD_OFF);
+    g_assert(!nfc_tag_t2_add_read_ahead_handler(NULL, NULL, NULL));
+    nfc_tag_t2_set_read_ahead(NULL, TRUE);
     g_assert(!nfc_tag_t2_read(NULL, 0, 0, NULL, NULL, NULL));
+    g_assert(!nfc_tag_t2_read_bytes(NULL, 0, 0, NULL, NULL, NULL, NULL));
     g_assert(!nfc_tag_t2_read_data(NULL, 0, 0, NULL, NULL, NULL));
     g_assert(nfc_tag_t2_read_data_sync(NULL, 0, 0, NULL) ==
         NFC_TAG_T2_IO_STATUS_FAILURE);
+    g_assert(!nfc_tag_t2_read_data_cached(NULL, 0, 0));
     g_assert(!nfc_tag_t2_write(NULL, 0, 0, NULL, NULL, NULL, NULL));
     g_assert(!nfc_tag_t2_write_data(NULL, 0, NULL, NULL, NULL, NULL));
+    g_assert(!nfc_tag_t2_write_data_seq2(NULL, 0, NULL, NULL,
+        NFC_TAG_T2_WRITE_FLAG_DIFF, NULL, NULL, NULL));
     nfc_target_unref(target);
 }
 
@@ -814,9 +973,10 @@ test_init_err1(
     GMainLoop* loop = g_main_loop_new(NULL, TRUE);
     gulong id = nfc_tag_add_initialized_handler(tag, test_init_err1_done, loop);
 
-    /* Damage CRC for the very first block */
+    /* Damage CRC for the very first block (retries don't help) */
     memset(&error, 0, sizeof(error));
     error.type = TEST_TARGET_ERROR_CRC;
+    error.persistent = TRUE;
     test->read_error = &error;
 
     test_run(&test_opt, loop);
@@ -1031,53 +1191,62 @@ test_read_data_872(
 }
 
 /*==========================================================================*
- * read_data_cached
+ * read_data_fast
  *==========================================================================*/
 
-#define TEST_READ_DATA_CACHED_OFFSET (1)
-#define TEST_READ_DATA_CACHED_SIZE (2)
+#define TEST_READ_DATA_FAST_MAX_RESP (252)
 
 static
 void
-test_read_data_cached_done(
-    NfcTagType2* t2,
-    NFC_TAG_T2_IO_STATUS status,
-    const void* data,
-    guint len,
+test_read_data_fast_start(
+    NfcTag* tag,
     void* user_data)
 {
-    g_assert(status == NFC_TAG_T2_IO_STATUS_OK);
-    g_assert(len == TEST_READ_DATA_CACHED_SIZE);
-    g_assert(!memcmp(data, test_data_empty + TEST_DATA_OFFSET +
-        TEST_READ_DATA_CACHED_OFFSET, len));
-    g_main_loop_quit((GMainLoop*)user_data);
-}
+    TestTarget* test = TEST_TARGET(tag->target);
+    NfcTagType2* t2 = NFC_TAG_T2(tag);
+    NfcNdefRec* rec = tag->ndef;
 
-static
-void
-test_read_data_cached_start(
-    NfcTag* tag,
-    void* loop)
-{
-    g_assert(nfc_tag_t2_read_data(NFC_TAG_T2(tag),
-        TEST_READ_DATA_CACHED_OFFSET, TEST_READ_DATA_CACHED_SIZE,
-        test_read_data_cached_done, test_destroy_quit_loop, loop));
+    g_assert(t2->data_size == 872);
+    g_assert(rec);
+    g_assert(NFC_IS_NDEF_REC_U(rec));
+    g_assert(!g_strcmp0(NFC_NDEF_REC_U(rec)->uri,
+        "https://www.merproject.org"));
+
+    /* FAST_READ support is inferred from the CC, TLVs are fetched
+     * by a single FAST_READ after reading the control area */
+    g_assert(t2->t2flags & NFC_TAG_T2_FLAG_FAST_READ);
+    g_assert_cmpuint(test->read_count, == ,2);
+    test->read_count = 0;
+
+    /* Note: reusing test_read_data_done callback */
+    g_assert(nfc_tag_t2_read_data(t2, 0, t2->data_size,
+        test_read_data_done, test_destroy_quit_loop, user_data /* loop */));
 }
 
 static
 void
-test_read_data_cached(
+test_read_data_fast(
     void)
 {
-    TestTarget* test = test_target_new(TEST_ARRAY_AND_SIZE(test_data_empty));
-    NfcTagType2* t2 = test_tag_new(test, 0);
-    NfcTag* tag = &t2->tag;
+    TestTarget* test = test_target_new(TEST_ARRAY_AND_SIZE(test_data_ntag216));
+    NfcTagType2* t2;
+    NfcTag* tag;
     GMainLoop* loop = g_main_loop_new(NULL, TRUE);
-    gulong init_id = nfc_tag_add_initialized_handler(tag,
-        test_read_data_cached_start, loop);
+    gulong init_id;
+
+    test->fast_read = TRUE;
+    nfc_target_set_max_response_size(&test->target,
+        TEST_READ_DATA_FAST_MAX_RESP);
+    t2 = test_tag_new(test, 0);
+    tag = &t2->tag;
+    init_id = nfc_tag_add_initialized_handler(tag,
+        test_read_data_fast_start, loop);
 
     test_run(&test_opt, loop);
 
+    /* 620 uncached bytes, up to 252 bytes per FAST_READ */
+    g_assert_cmpuint(test->read_count, == ,3);
+
     nfc_tag_remove_handler(tag, init_id);
     nfc_tag_unref(tag);
     nfc_target_unref(&test->target);
@@ -1085,38 +1254,76 @@ test_read_data_cached(
 }
 
 /*==========================================================================*
- * read_data_abort
+ * get_version
  *==========================================================================*/
 
+static const guint8 test_version_ntag216[] = {
+    0x00, 0x04, 0x04, 0x02, 0x01, 0x00, 0x13, 0x03
+};
+static const guint8 test_version_unknown[] = {
+    0x00, 0x04, 0x04, 0x7f, 0x01, 0x00, 0x13, 0x03
+};
+
 static
 void
-test_read_data_abort_start(
+test_get_version_start(
     NfcTag* tag,
     void* user_data)
 {
+    TestTarget* test = TEST_TARGET(tag->target);
     NfcTagType2* t2 = NFC_TAG_T2(tag);
+    const NfcTagType2Product* product = nfc_tag_t2_product(t2);
+    NfcNdefRec* rec = tag->ndef;
 
-    /* Submit read request */
-    g_assert(nfc_tag_t2_read_data(t2, 0, t2->data_size,
-        test_unexpected_read_completion, NULL, user_data));
+    g_assert(product);
+    g_assert_cmpstr(product->name, == ,"NTAG216");
+    g_assert(gutil_data_equal(&product->version, test->version));
+    g_assert_cmpuint(product->total_blocks, == ,231);
+    g_assert_cmpuint(product->data_blocks, == ,222);
+    g_assert_cmpuint(product->config_block, == ,0xe3);
+    g_assert(t2->t2flags & NFC_TAG_T2_FLAG_FAST_READ);
+    g_assert(rec);
+    g_assert(NFC_IS_NDEF_REC_U(rec));
 
-    /* And immediately terminate the loop */
-    g_main_loop_quit((GMainLoop*)user_data);
+    /* Control area and TLVs fetched by a single FAST_READ */
+    g_assert_cmpuint(test->read_count, == ,1);
+    g_assert(!test->reactivate_count);
+    test->read_count = 0;
+
+    /* Note: reusing test_read_data_done callback */
+    g_assert(nfc_tag_t2_read_data(t2, 0, t2->data_size,
+        test_read_data_done, test_destroy_quit_loop, user_data /* loop */));
 }
 
 static
 void
-test_read_data_abort(
+test_get_version(
     void)
 {
-    TestTarget* test = test_target_new(TEST_ARRAY_AND_SIZE(test_data_google));
-    NfcTagType2* t2 = test_tag_new(test, 0);
-    NfcTag* tag = &t2->tag;
+    GUtilData version;
+    TestTarget* test = test_target_new(TEST_ARRAY_AND_SIZE(test_data_ntag216));
+    NfcTagType2* t2;
+    NfcTag* tag;
     GMainLoop* loop = g_main_loop_new(NULL, TRUE);
-    gulong init_id = nfc_tag_add_initialized_handler(tag,
-        test_read_data_abort_start, loop);
+    gulong init_id;
+
+    TEST_BYTES_SET(version, test_version_ntag216);
+    test->version = &version;
+    test->fast_read = TRUE;
+    nfc_target_set_max_response_size(&test->target,
+        TEST_READ_DATA_FAST_MAX_RESP);
+    nfc_tag_t2_set_get_version(TRUE);
+    t2 = test_tag_new(test, 0);
+    tag = &t2->tag;
+    g_assert(!nfc_tag_t2_product(t2));
+    init_id = nfc_tag_add_initialized_handler(tag,
+        test_get_version_start, loop);
 
     test_run(&test_opt, loop);
+    nfc_tag_t2_set_get_version(FALSE);
+
+    /* 636 bytes left after the first 252 */
+    g_assert_cmpuint(test->read_count, == ,3);
 
     nfc_tag_remove_handler(tag, init_id);
     nfc_tag_unref(tag);
@@ -1125,56 +1332,47 @@ test_read_data_abort(
 }
 
 /*==========================================================================*
- * read_data_err
+ * get_version_unknown
  *==========================================================================*/
 
-#define TEST_READ_DATA_ERR_BLOCK (4)
-
 static
 void
-test_read_data_err_done(
-    NfcTagType2* t2,
-    NFC_TAG_T2_IO_STATUS status,
-    const void* data,
-    guint len,
+test_get_version_done(
+    NfcTag* tag,
     void* user_data)
 {
-    g_assert(status == NFC_TAG_T2_IO_STATUS_IO_ERROR);
-    g_assert(len == (TEST_READ_DATA_ERR_BLOCK * TEST_FIRST_DATA_BLOCK));
     g_main_loop_quit((GMainLoop*)user_data);
 }
 
 static
 void
-test_read_data_err_start(
-    NfcTag* tag,
-    void* loop)
-{
-    g_assert(nfc_tag_t2_read_data(NFC_TAG_T2(tag), 0,
-        TEST_READ_DATA_ERR_BLOCK * TEST_TARGET_BLOCK_SIZE + 1,
-        test_read_data_err_done, test_destroy_quit_loop, loop));
-}
-
-static
-void
-test_read_data_err(
+test_get_version_unknown(
     void)
 {
-    TestTarget* test = test_target_new(TEST_ARRAY_AND_SIZE(test_data_empty));
-    NfcTagType2* t2 = test_tag_new(test, 0);
-    NfcTag* tag = &t2->tag;
-    TestTargetError error;
+    GUtilData version;
+    TestTarget* test = test_target_new(TEST_ARRAY_AND_SIZE(test_data_ntag216));
+    NfcTagType2* t2;
+    NfcTag* tag;
     GMainLoop* loop = g_main_loop_new(NULL, TRUE);
-    gulong init_id = nfc_tag_add_initialized_handler(tag,
-        test_read_data_err_start, loop);
+    gulong init_id;
 
-    /* Damage CRC for data block #4 (not fetched during initialization) */
-    memset(&error, 0, sizeof(error));
-    error.block = TEST_FIRST_DATA_BLOCK + TEST_READ_DATA_ERR_BLOCK;
-    error.type = TEST_TARGET_ERROR_CRC;
-    test->read_error = &error;
+    TEST_BYTES_SET(version, test_version_unknown);
+    test->version = &version;
+    nfc_tag_t2_set_get_version(TRUE);
+    t2 = test_tag_new(test, 0);
+    tag = &t2->tag;
+    init_id = nfc_tag_add_initialized_handler(tag, test_get_version_done,
+        loop);
 
     test_run(&test_opt, loop);
+    nfc_tag_t2_set_get_version(FALSE);
+
+    /* Initialized the usual way, FAST_READ is inferred from the CC */
+    g_assert(!nfc_tag_t2_product(t2));
+    g_assert(t2->t2flags & NFC_TAG_T2_FLAG_FAST_READ);
+    g_assert(tag->ndef);
+    g_assert_cmpuint(test->read_count, == ,2);
+    g_assert(!test->reactivate_count);
 
     nfc_tag_remove_handler(tag, init_id);
     nfc_tag_unref(tag);
@@ -1183,54 +1381,74 @@ test_read_data_err(
 }
 
 /*==========================================================================*
- * read_crc_err
+ * get_version_nack
  *==========================================================================*/
 
 static
 void
-test_read_crc_err_done(
-    NfcTagType2* t2,
-    NFC_TRANSMIT_STATUS status,
-    const void* data,
-    guint len,
-    void* user_data)
+test_get_version_nack(
+    void)
 {
-    g_assert(status == NFC_TRANSMIT_STATUS_CORRUPTED);
-    g_assert(!len);
-    g_main_loop_quit((GMainLoop*)user_data);
-}
+    TestTarget* test = test_target_new(TEST_ARRAY_AND_SIZE(test_data_ntag216));
+    NfcTagType2* t2;
+    NfcTag* tag;
+    GMainLoop* loop = g_main_loop_new(NULL, TRUE);
+    gulong init_id;
 
-static
-void
-test_read_crc_err_start(
-    NfcTag* tag,
-    void* user_data)
-{
-    g_assert(nfc_tag_t2_read(NFC_TAG_T2(tag), 0, 16, test_read_crc_err_done,
-        test_destroy_quit_loop, user_data /* loop */));
+    nfc_tag_t2_set_get_version(TRUE);
+    t2 = test_tag_new(test, 0);
+    tag = &t2->tag;
+    init_id = nfc_tag_add_initialized_handler(tag, test_get_version_done,
+        loop);
+
+    test_run(&test_opt, loop);
+    nfc_tag_t2_set_get_version(FALSE);
+
+    /* The tag had to be reactivated after NACK */
+    g_assert(!nfc_tag_t2_product(t2));
+    g_assert(tag->ndef);
+    g_assert_cmpuint(test->reactivate_count, == ,1);
+
+    nfc_tag_remove_handler(tag, init_id);
+    nfc_tag_unref(tag);
+    nfc_target_unref(&test->target);
+    g_main_loop_unref(loop);
 }
 
+/*==========================================================================*
+ * get_version_off
+ *==========================================================================*/
+
 static
 void
-test_read_crc_err(
+test_get_version_off(
     void)
 {
-    TestTarget* test = test_target_new(TEST_ARRAY_AND_SIZE(test_data_empty));
-    NfcTagType2* t2 = test_tag_new(test, 0);
-    NfcTag* tag = &t2->tag;
-    TestTargetError error;
+    GUtilData version;
+    TestTarget* test = test_target_new(TEST_ARRAY_AND_SIZE(test_data_ntag216));
+    NfcTagType2* t2;
+    NfcTag* tag;
     GMainLoop* loop = g_main_loop_new(NULL, TRUE);
-    gulong init_id = nfc_tag_add_initialized_handler(tag,
-        test_read_crc_err_start, loop);
+    gulong init_id;
 
-    /* Damage CRC for block #16 (not fetched during initialization) */
-    memset(&error, 0, sizeof(error));
-    error.block = 16;
-    error.type = TEST_TARGET_ERROR_CRC;
-    test->read_error = &error;
+    /* GET_VERSION is disabled by default */
+    TEST_BYTES_SET(version, test_version_ntag216);
+    test->version = &version;
+    test->fast_read = TRUE;
+    t2 = test_tag_new(test, 0);
+    tag = &t2->tag;
+    init_id = nfc_tag_add_initialized_handler(tag, test_get_version_done,
+        loop);
 
     test_run(&test_opt, loop);
 
+    /* The chip is not identified but FAST_READ is still used */
+    g_assert(!nfc_tag_t2_product(t2));
+    g_assert(t2->t2flags & NFC_TAG_T2_FLAG_FAST_READ);
+    g_assert(tag->ndef);
+    g_assert_cmpuint(test->read_count, == ,2);
+    g_assert(!test->reactivate_count);
+
     nfc_tag_remove_handler(tag, init_id);
     nfc_tag_unref(tag);
     nfc_target_unref(&test->target);
@@ -1238,35 +1456,1020 @@ test_read_crc_err(
 }
 
 /*==========================================================================*
- * read_nack
+ * multi_sector
  *==========================================================================*/
 
+static const guint8 test_version_nt3h1201[] = {
+    0x00, 0x04, 0x04, 0x05, 0x02, 0x01, 0x15, 0x03
+};
+
+#define TEST_MULTI_SECTOR_STORAGE (2 * TEST_SECTOR_SIZE)
+#define TEST_MULTI_SECTOR_OFFSET (1000) /* Blocks 254..257 */
+#define TEST_MULTI_SECTOR_WRITE_OFFSET (1006) /* Blocks 255..257 */
+
+static const guint8 test_multi_sector_write_data[] = {
+    0xa0, 0xa1, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7
+};
+
 static
 void
-test_read_nack_done(
+test_multi_sector_write_done(
     NfcTagType2* t2,
-    NFC_TRANSMIT_STATUS status,
-    const void* data,
-    guint len,
+    NFC_TAG_T2_IO_STATUS status,
+    guint written,
     void* user_data)
 {
-    const guint8* payload = data;
+    TestTarget* test = TEST_TARGET(t2->tag.target);
+    guint8 buf[4];
 
-    g_assert(status == NFC_TRANSMIT_STATUS_NACK);
-    g_assert(len == 1);
-    g_assert(!(payload[0] & 0x0a));
-    g_main_loop_quit((GMainLoop*)user_data);
+    g_assert(status == NFC_TAG_T2_IO_STATUS_OK);
+    g_assert_cmpuint(written, == ,sizeof(test_multi_sector_write_data));
+    g_assert(!memcmp(test->storage + TEST_DATA_OFFSET +
+        TEST_MULTI_SECTOR_WRITE_OFFSET, test_multi_sector_write_data,
+        sizeof(test_multi_sector_write_data)));
+
+    /* Back to sector 0 and then again to sector 1 */
+    g_assert_cmpuint(test->select_count, == ,4);
+    g_assert_cmpuint(test->sector, == ,1);
+
+    /* Written blocks are no longer cached, the one before them is */
+    g_assert(nfc_tag_t2_read_data_sync(t2, TEST_MULTI_SECTOR_WRITE_OFFSET,
+        4, buf) == NFC_TAG_T2_IO_STATUS_NOT_CACHED);
+    g_assert(nfc_tag_t2_read_data_sync(t2, TEST_MULTI_SECTOR_OFFSET,
+        sizeof(buf), buf) == NFC_TAG_T2_IO_STATUS_OK);
+    g_assert(!memcmp(buf, test->storage + TEST_DATA_OFFSET +
+        TEST_MULTI_SECTOR_OFFSET, sizeof(buf)));
 }
 
 static
 void
-test_read_nack_start(
-    NfcTag* tag,
+test_multi_sector_read_done(
+    NfcTagType2* t2,
+    NFC_TAG_T2_IO_STATUS status,
+    const void* data,
+    guint len,
     void* user_data)
 {
-    g_assert(nfc_tag_t2_read(NFC_TAG_T2(tag), 0, 16, test_read_nack_done,
-        test_destroy_quit_loop, user_data /* loop */));
-}
+    TestTarget* test = TEST_TARGET(t2->tag.target);
+    GBytes* bytes = g_bytes_new_static
+        (TEST_ARRAY_AND_SIZE(test_multi_sector_write_data));
+    guint8 buf[16];
+
+    g_assert(status == NFC_TAG_T2_IO_STATUS_OK);
+    g_assert_cmpuint(len, == ,sizeof(buf));
+    g_assert(!memcmp(data, test->storage + TEST_DATA_OFFSET +
+        TEST_MULTI_SECTOR_OFFSET, len));
+    /* Sector 0 (the sequence didn't start right away) and sector 1 */
+    g_assert_cmpuint(test->select_count, == ,2);
+    g_assert_cmpuint(test->sector, == ,1);
+
+    /* Now the whole range is cached */
+    g_assert(nfc_tag_t2_read_data_sync(t2, TEST_MULTI_SECTOR_OFFSET,
+        sizeof(buf), buf) == NFC_TAG_T2_IO_STATUS_OK);
+    g_assert(!memcmp(buf, data, sizeof(buf)));
+
+    /* Unaligned write across the sector boundary */
+    g_assert(nfc_tag_t2_write_data(t2, TEST_MULTI_SECTOR_WRITE_OFFSET, bytes,
+        test_multi_sector_write_done, test_destroy_quit_loop, user_data));
+    g_bytes_unref(bytes);
+}
+
+static
+void
+test_multi_sector_start(
+    NfcTag* tag,
+    void* user_data)
+{
+    TestTarget* test = TEST_TARGET(tag->target);
+    NfcTagType2* t2 = NFC_TAG_T2(tag);
+    const NfcTagType2Product* product = nfc_tag_t2_product(t2);
+
+    g_assert(product);
+    g_assert_cmpstr(product->name, == ,"NT3H1201");
+    g_assert_cmpuint(t2->data_size, == ,0xea * 8);
+    g_assert(tag->ndef);
+    g_assert(!test->select_count);
+
+    /* Out of range */
+    g_assert(!nfc_tag_t2_read(t2, 2, 0, NULL, NULL, NULL));
+    g_assert(!nfc_tag_t2_read(t2, 0, 256, NULL, NULL, NULL));
+    g_assert(nfc_tag_t2_read_data_sync(t2, t2->data_size, 1, NULL) ==
+        NFC_TAG_T2_IO_STATUS_BAD_BLOCK);
+    g_assert(nfc_tag_t2_read_data_sync(t2, 0, t2->data_size + 1, NULL) ==
+        NFC_TAG_T2_IO_STATUS_BAD_SIZE);
+    g_assert(nfc_tag_t2_read_data_sync(t2, TEST_MULTI_SECTOR_OFFSET, 16,
+        NULL) == NFC_TAG_T2_IO_STATUS_NOT_CACHED);
+
+    /* Read data across the sector boundary */
+    g_assert(nfc_tag_t2_read_data(t2, TEST_MULTI_SECTOR_OFFSET, 16,
+        test_multi_sector_read_done, NULL, user_data /* loop */));
+}
+
+static
+void
+test_multi_sector(
+    void)
+{
+    static const guint8 header[] = {
+        0x04, 0xd3, 0x8f, 0xd8, 0x32, 0xc5, 0x28, 0x80,
+        0x4d, 0x48, 0x00, 0x00, 0xe1, 0x10, 0xea, 0x00,
+        0x03, 0x00, 0xfe
+    };
+    GUtilData version;
+    guint8* storage = g_malloc0(TEST_MULTI_SECTOR_STORAGE);
+    TestTarget* test;
+    NfcTagType2* t2;
+    NfcTag* tag;
+    GMainLoop* loop = g_main_loop_new(NULL, TRUE);
+    gulong init_id;
+    guint i;
+
+    memcpy(storage, header, sizeof(header));
+    for (i = 2 * TEST_DATA_OFFSET; i < TEST_MULTI_SECTOR_STORAGE; i++) {
+        storage[i] = (guint8)(i * 7);
+    }
+    test = test_target_new(storage, TEST_MULTI_SECTOR_STORAGE);
+    TEST_BYTES_SET(version, test_version_nt3h1201);
+    test->version = &version;
+    test->fast_read = TRUE;
+    nfc_tag_t2_set_get_version(TRUE);
+    t2 = test_tag_new(test, 0);
+    tag = &t2->tag;
+    init_id = nfc_tag_add_initialized_handler(tag, test_multi_sector_start,
+        loop);
+
+    test_run(&test_opt, loop);
+    nfc_tag_t2_set_get_version(FALSE);
+
+    nfc_tag_remove_handler(tag, init_id);
+    nfc_tag_unref(tag);
+    nfc_target_unref(&test->target);
+    g_main_loop_unref(loop);
+    g_free(storage);
+}
+
+/*==========================================================================*
+ * sector_select
+ *==========================================================================*/
+
+typedef struct test_sector_select {
+    GMainLoop* loop;
+    NfcTagType2* t2;
+    guint step;
+} TestSectorSelect;
+
+static
+void
+test_sector_select_next(
+    TestSectorSelect* test);
+
+static
+gboolean
+test_sector_select_idle(
+    gpointer user_data)
+{
+    test_sector_select_next(user_data);
+    return G_SOURCE_REMOVE;
+}
+
+static
+void
+test_sector_select_resp(
+    NfcTagType2* t2,
+    NFC_TRANSMIT_STATUS status,
+    const void* data,
+    guint len,
+    void* user_data)
+{
+    TestSectorSelect* test = user_data;
+    TestTarget* target = TEST_TARGET(t2->tag.target);
+
+    GDEBUG("Step %u status %d", test->step, status);
+    switch (test->step) {
+    case 1:
+    case 2:
+        /* READ must not be sent to the wrong sector */
+        g_assert_cmpint(status, == ,NFC_TRANSMIT_STATUS_ERROR);
+        g_assert_cmpuint(target->select_count, == ,0);
+        g_assert_cmpuint(target->sector, == ,0);
+        g_assert_cmpuint(target->read_count, == ,0);
+        break;
+    case 3:
+        g_assert_cmpint(status, == ,NFC_TRANSMIT_STATUS_OK);
+        g_assert_cmpuint(len, == ,TEST_TARGET_READ_SIZE);
+        g_assert(!memcmp(data, target->storage + TEST_SECTOR_SIZE, len));
+        g_assert_cmpuint(target->select_count, == ,1);
+        g_assert_cmpuint(target->sector, == ,1);
+        break;
+    default:
+        /* The target was idle and sector 1 was known to be selected */
+        g_assert_cmpint(status, == ,NFC_TRANSMIT_STATUS_OK);
+        g_assert_cmpuint(len, == ,TEST_TARGET_READ_SIZE);
+        g_assert(!memcmp(data, target->storage + TEST_SECTOR_SIZE +
+            4 * TEST_TARGET_BLOCK_SIZE, len));
+        g_assert_cmpuint(target->select_count, == ,1);
+        break;
+    }
+    /* Let the target become idle before the next step */
+    g_idle_add(test_sector_select_idle, test);
+}
+
+static
+void
+test_sector_select_next(
+    TestSectorSelect* test)
+{
+    TestTarget* target = TEST_TARGET(test->t2->tag.target);
+
+    target->read_count = 0;
+    switch (++test->step) {
+    case 1:
+    case 2:
+        /* NACK for either packet fails the READ */
+        target->select_nack = test->step;
+        g_assert(nfc_tag_t2_read(test->t2, 1, 0, test_sector_select_resp,
+            NULL, test));
+        break;
+    case 3:
+        g_assert(nfc_tag_t2_read(test->t2, 1, 0, test_sector_select_resp,
+            NULL, test));
+        break;
+    case 4:
+        g_assert(nfc_target_idle(&target->target));
+        g_assert(nfc_tag_t2_read(test->t2, 1, 4, test_sector_select_resp,
+            NULL, test));
+        break;
+    default:
+        g_main_loop_quit(test->loop);
+        break;
+    }
+}
+
+static
+void
+test_sector_select_start(
+    NfcTag* tag,
+    void* user_data)
+{
+    TestSectorSelect* test = user_data;
+
+    g_assert(nfc_tag_t2_product(test->t2));
+    g_assert_cmpuint(TEST_TARGET(tag->target)->select_count, == ,0);
+    test_sector_select_next(test);
+}
+
+static
+void
+test_sector_select(
+    void)
+{
+    static const guint8 header[] = {
+        0x04, 0xd3, 0x8f, 0xd8, 0x32, 0xc5, 0x28, 0x80,
+        0x4d, 0x48, 0x00, 0x00, 0xe1, 0x10, 0xea, 0x00,
+        0x03, 0x00, 0xfe
+    };
+    GUtilData version;
+    guint8* storage = g_malloc0(TEST_MULTI_SECTOR_STORAGE);
+    TestSectorSelect test;
+    TestTarget* target;
+    NfcTag* tag;
+    gulong init_id;
+    guint i;
+
+    memcpy(storage, header, sizeof(header));
+    for (i = 2 * TEST_DATA_OFFSET; i < TEST_MULTI_SECTOR_STORAGE; i++) {
+        storage[i] = (guint8)(i * 7);
+    }
+    memset(&test, 0, sizeof(test));
+    test.loop = g_main_loop_new(NULL, TRUE);
+    target = test_target_new(storage, TEST_MULTI_SECTOR_STORAGE);
+    TEST_BYTES_SET(version, test_version_nt3h1201);
+    target->version = &version;
+    target->fast_read = TRUE;
+    nfc_tag_t2_set_get_version(TRUE);
+    test.t2 = test_tag_new(target, 0);
+    tag = &test.t2->tag;
+    init_id = nfc_tag_add_initialized_handler(tag, test_sector_select_start,
+        &test);
+
+    test_run(&test_opt, test.loop);
+    nfc_tag_t2_set_get_version(FALSE);
+    g_assert_cmpuint(test.step, == ,5);
+
+    nfc_tag_remove_handler(tag, init_id);
+    nfc_tag_unref(tag);
+    nfc_target_unref(&target->target);
+    g_main_loop_unref(test.loop);
+    g_free(storage);
+}
+
+/*==========================================================================*
+ * read_data_cached
+ *==========================================================================*/
+
+#define TEST_READ_DATA_CACHED_OFFSET (1)
+#define TEST_READ_DATA_CACHED_SIZE (2)
+
+static
+void
+test_read_data_cached_done(
+    NfcTagType2* t2,
+    NFC_TAG_T2_IO_STATUS status,
+    const void* data,
+    guint len,
+    void* user_data)
+{
+    g_assert(status == NFC_TAG_T2_IO_STATUS_OK);
+    g_assert(len == TEST_READ_DATA_CACHED_SIZE);
+    g_assert(!memcmp(data, test_data_empty + TEST_DATA_OFFSET +
+        TEST_READ_DATA_CACHED_OFFSET, len));
+    g_main_loop_quit((GMainLoop*)user_data);
+}
+
+static
+void
+test_read_data_cached_start(
+    NfcTag* tag,
+    void* loop)
+{
+    g_assert(nfc_tag_t2_read_data(NFC_TAG_T2(tag),
+        TEST_READ_DATA_CACHED_OFFSET, TEST_READ_DATA_CACHED_SIZE,
+        test_read_data_cached_done, test_destroy_quit_loop, loop));
+}
+
+static
+void
+test_read_data_cached(
+    void)
+{
+    TestTarget* test = test_target_new(TEST_ARRAY_AND_SIZE(test_data_empty));
+    NfcTagType2* t2 = test_tag_new(test, 0);
+    NfcTag* tag = &t2->tag;
+    GMainLoop* loop = g_main_loop_new(NULL, TRUE);
+    gulong init_id = nfc_tag_add_initialized_handler(tag,
+        test_read_data_cached_start, loop);
+
+    test_run(&test_opt, loop);
+
+    nfc_tag_remove_handler(tag, init_id);
+    nfc_tag_unref(tag);
+    nfc_target_unref(&test->target);
+    g_main_loop_unref(loop);
+}
+
+/*==========================================================================*
+ * read_data_holes
+ *==========================================================================*/
+
+typedef struct test_read_data_holes {
+    gboolean fast_read;
+    guint reads; /* Number of reads to fill the holes */
+} TestReadDataHoles;
+
+static const TestReadDataHoles test_read_data_holes_data = { FALSE, 2 };
+static const TestReadDataHoles test_read_data_holes_fast_data = { TRUE, 1 };
+
+/* Data blocks 16..19 and 24..27 get cached first */
+static const guint test_read_data_holes_offset[] = { 64, 96 };
+#define TEST_READ_DATA_HOLES_OFFSET (48) /* Data blocks 12..27 */
+#define TEST_READ_DATA_HOLES_SIZE (64)
+
+typedef struct test_read_data_holes_run {
+    const TestReadDataHoles* test;
+    GMainLoop* loop;
+    guint step;
+} TestReadDataHolesRun;
+
+static
+void
+test_read_data_holes_done(
+    NfcTagType2* t2,
+    NFC_TAG_T2_IO_STATUS status,
+    const void* data,
+    guint len,
+    void* user_data)
+{
+    TestReadDataHolesRun* run = user_data;
+    TestTarget* test = TEST_TARGET(t2->tag.target);
+    const guint n = G_N_ELEMENTS(test_read_data_holes_offset);
+
+    g_assert(status == NFC_TAG_T2_IO_STATUS_OK);
+    if (run->step < n) {
+        const guint offset = test_read_data_holes_offset[run->step];
+
+        /* One READ per isolated block */
+        g_assert_cmpuint(len, == ,TEST_TARGET_BLOCK_SIZE);
+        g_assert(!memcmp(data, test->storage + TEST_DATA_OFFSET + offset,
+            len));
+        g_assert_cmpuint(test->read_count, == ,run->step + 1);
+        if (++run->step == n) {
+            /* Both holes are fetched, cached blocks aren't re-read */
+            test->read_count = 0;
+            g_assert(nfc_tag_t2_read_data(t2, TEST_READ_DATA_HOLES_OFFSET,
+                TEST_READ_DATA_HOLES_SIZE, test_read_data_holes_done, NULL,
+                run));
+        } else {
+            g_assert(nfc_tag_t2_read_data(t2,
+                test_read_data_holes_offset[run->step],
+                TEST_TARGET_BLOCK_SIZE, test_read_data_holes_done, NULL,
+                run));
+        }
+    } else {
+        g_assert_cmpuint(len, == ,TEST_READ_DATA_HOLES_SIZE);
+        g_assert(!memcmp(data, test->storage + TEST_DATA_OFFSET +
+            TEST_READ_DATA_HOLES_OFFSET, len));
+        g_assert_cmpuint(test->read_count, == ,run->test->reads);
+        g_main_loop_quit(run->loop);
+    }
+}
+
+static
+void
+test_read_data_holes_start(
+    NfcTag* tag,
+    void* user_data)
+{
+    TestReadDataHolesRun* run = user_data;
+    TestTarget* test = TEST_TARGET(tag->target);
+    NfcTagType2* t2 = NFC_TAG_T2(tag);
+
+    /* NTAG216 supports FAST_READ, whether it's identified or not */
+    g_assert(t2->t2flags & NFC_TAG_T2_FLAG_FAST_READ);
+    test->read_count = 0;
+    g_assert(nfc_tag_t2_read_data(t2, test_read_data_holes_offset[0],
+        TEST_TARGET_BLOCK_SIZE, test_read_data_holes_done, NULL, run));
+}
+
+static
+void
+test_read_data_holes(
+    gconstpointer test_data)
+{
+    TestReadDataHolesRun run;
+    GUtilData version;
+    TestTarget* test = test_target_new(TEST_ARRAY_AND_SIZE(test_data_ntag216));
+    NfcTagType2* t2;
+    NfcTag* tag;
+    gulong init_id;
+
+    memset(&run, 0, sizeof(run));
+    run.test = test_data;
+    run.loop = g_main_loop_new(NULL, TRUE);
+    if (run.test->fast_read) {
+        TEST_BYTES_SET(version, test_version_ntag216);
+        test->version = &version;
+    } else {
+        /* FAST_READ is no better than READ with such a small buffer */
+        nfc_target_set_max_response_size(&test->target,
+            TEST_TARGET_READ_SIZE);
+    }
+    nfc_tag_t2_set_get_version(run.test->fast_read);
+    t2 = test_tag_new(test, 0);
+    tag = &t2->tag;
+    init_id = nfc_tag_add_initialized_handler(tag,
+        test_read_data_holes_start, &run);
+
+    test_run(&test_opt, run.loop);
+    nfc_tag_t2_set_get_version(FALSE);
+
+    nfc_tag_remove_handler(tag, init_id);
+    nfc_tag_unref(tag);
+    nfc_target_unref(&test->target);
+    g_main_loop_unref(run.loop);
+}
+
+/*==========================================================================*
+ * read_ahead
+ *==========================================================================*/
+
+typedef struct test_read_ahead {
+    GMainLoop* loop;
+    guint active_count;
+    guint done_count;
+    guint cached_count;
+} TestReadAhead;
+
+static
+void
+test_read_ahead_cached(
+    NfcTag* tag,
+    void* user_data)
+{
+    TestReadAhead* data = user_data;
+
+    g_assert(tag->flags & NFC_TAG_FLAG_INITIALIZED);
+    data->cached_count++;
+}
+
+static
+void
+test_read_ahead_changed(
+    NfcTagType2* t2,
+    void* user_data)
+{
+    TestReadAhead* data = user_data;
+    TestTarget* test = TEST_TARGET(t2->tag.target);
+
+    switch (nfc_tag_t2_read_ahead_state(t2)) {
+    case NFC_TAG_T2_READ_AHEAD_ACTIVE:
+        data->active_count++;
+        break;
+    case NFC_TAG_T2_READ_AHEAD_DONE:
+        data->done_count++;
+        g_assert(nfc_tag_t2_read_data_sync(t2, 0, t2->data_size, NULL) ==
+            NFC_TAG_T2_IO_STATUS_OK);
+        test_read_data_done(t2, NFC_TAG_T2_IO_STATUS_OK,
+            test->storage + TEST_DATA_OFFSET, t2->data_size, NULL);
+        g_main_loop_quit(data->loop);
+        break;
+    default:
+        g_assert_not_reached();
+        break;
+    }
+}
+
+static
+void
+test_read_ahead(
+    void)
+{
+    TestReadAhead data;
+    TestTarget* test = test_target_new(TEST_ARRAY_AND_SIZE(test_data_ntag216));
+    NfcTagType2* t2 = test_tag_new(test, 0);
+    NfcTag* tag = &t2->tag;
+    gulong id, stage_id;
+
+    memset(&data, 0, sizeof(data));
+    data.loop = g_main_loop_new(NULL, TRUE);
+    id = nfc_tag_t2_add_read_ahead_handler(t2, test_read_ahead_changed,
+        &data);
+    g_assert(id);
+    stage_id = nfc_tag_add_stage_handler(tag, NFC_TAG_STAGE_CACHED,
+        test_read_ahead_cached, &data);
+    g_assert(stage_id);
+    g_assert(!nfc_tag_t2_add_read_ahead_handler(t2, NULL, NULL));
+    g_assert(nfc_tag_t2_read_ahead_state(t2) == NFC_TAG_T2_READ_AHEAD_OFF);
+    nfc_tag_t2_set_read_ahead(t2, TRUE);
+    nfc_tag_t2_set_read_ahead(t2, TRUE); /* No effect */
+    g_assert(nfc_tag_t2_read_ahead_state(t2) == NFC_TAG_T2_READ_AHEAD_OFF);
+
+    test_run(&test_opt, data.loop);
+
+    /* READ and FAST_READ during initialization, then 202 blocks
+     * left, up to 16 blocks per FAST_READ */
+    g_assert_cmpuint(data.active_count, == ,1);
+    g_assert_cmpuint(data.done_count, == ,1);
+    g_assert_cmpuint(test->read_count, == ,2 + 13);
+    g_assert(nfc_tag_t2_read_ahead_state(t2) == NFC_TAG_T2_READ_AHEAD_DONE);
+    g_assert_cmpuint(data.cached_count, == ,1);
+    g_assert(nfc_tag_stage(tag) == NFC_TAG_STAGE_CACHED);
+
+    /* Disabling it at this point doesn't change the state */
+    nfc_tag_t2_set_read_ahead(t2, FALSE);
+    g_assert(nfc_tag_t2_read_ahead_state(t2) == NFC_TAG_T2_READ_AHEAD_DONE);
+
+    nfc_tag_remove_handler(tag, stage_id);
+    nfc_tag_remove_handler(tag, id);
+    nfc_tag_unref(tag);
+    nfc_target_unref(&test->target);
+    g_main_loop_unref(data.loop);
+}
+
+/*==========================================================================*
+ * read_ahead_yield
+ *==========================================================================*/
+
+static
+void
+test_read_ahead_yield_gone(
+    NfcTagType2* t2,
+    void* user_data)
+{
+    g_assert(nfc_tag_t2_read_ahead_state(t2) ==
+        NFC_TAG_T2_READ_AHEAD_STOPPED);
+    g_assert(!t2->tag.present);
+    g_main_loop_quit((GMainLoop*)user_data);
+}
+
+static
+void
+test_read_ahead_yield_resp(
+    NfcTagType2* t2,
+    NFC_TRANSMIT_STATUS status,
+    const void* data,
+    guint len,
+    void* user_data)
+{
+    TestTarget* test = TEST_TARGET(t2->tag.target);
+
+    /* Client request didn't wait for read-ahead to finish */
+    g_assert(status == NFC_TRANSMIT_STATUS_OK);
+    g_assert_cmpuint(len, == ,TEST_TARGET_READ_SIZE);
+    g_assert(!memcmp(data, test->storage, len));
+    g_assert(nfc_tag_t2_read_ahead_state(t2) ==
+        NFC_TAG_T2_READ_AHEAD_ACTIVE);
+
+    /* Read-ahead stops when the tag goes away */
+    nfc_tag_t2_add_read_ahead_handler(t2, test_read_ahead_yield_gone,
+        user_data);
+    nfc_target_gone(&test->target);
+}
+
+static
+void
+test_read_ahead_yield_start(
+    NfcTag* tag,
+    void* user_data)
+{
+    NfcTagType2* t2 = NFC_TAG_T2(tag);
+
+    g_assert(nfc_tag_t2_read_ahead_state(t2) ==
+        NFC_TAG_T2_READ_AHEAD_ACTIVE);
+    g_assert(nfc_tag_t2_read(t2, 0, 0, test_read_ahead_yield_resp, NULL,
+        user_data));
+}
+
+static
+void
+test_read_ahead_yield(
+    void)
+{
+    TestTarget* test = test_target_new(TEST_ARRAY_AND_SIZE(test_data_ntag216));
+    NfcTagType2* t2 = test_tag_new(test, 0);
+    NfcTag* tag = &t2->tag;
+    GMainLoop* loop = g_main_loop_new(NULL, TRUE);
+    gulong id;
+
+    nfc_tag_t2_set_read_ahead(t2, TRUE);
+    id = nfc_tag_add_initialized_handler(tag, test_read_ahead_yield_start,
+        loop);
+
+    /* Initialized handler is invoked after read-ahead has started */
+    test_run(&test_opt, loop);
+
+    nfc_tag_remove_handler(tag, id);
+    nfc_tag_unref(tag);
+    nfc_target_unref(&test->target);
+    g_main_loop_unref(loop);
+}
+
+/*==========================================================================*
+ * read_data_abort
+ *==========================================================================*/
+
+static
+void
+test_read_data_abort_start(
+    NfcTag* tag,
+    void* user_data)
+{
+    NfcTagType2* t2 = NFC_TAG_T2(tag);
+
+    /* Submit read request */
+    g_assert(nfc_tag_t2_read_data(t2, 0, t2->data_size,
+        test_unexpected_read_completion, NULL, user_data));
+
+    /* And immediately terminate the loop */
+    g_main_loop_quit((GMainLoop*)user_data);
+}
+
+static
+void
+test_read_data_abort(
+    void)
+{
+    TestTarget* test = test_target_new(TEST_ARRAY_AND_SIZE(test_data_google));
+    NfcTagType2* t2 = test_tag_new(test, 0);
+    NfcTag* tag = &t2->tag;
+    GMainLoop* loop = g_main_loop_new(NULL, TRUE);
+    gulong init_id = nfc_tag_add_initialized_handler(tag,
+        test_read_data_abort_start, loop);
+
+    test_run(&test_opt, loop);
+
+    nfc_tag_remove_handler(tag, init_id);
+    nfc_tag_unref(tag);
+    nfc_target_unref(&test->target);
+    g_main_loop_unref(loop);
+}
+
+/*==========================================================================*
+ * destroy_last_ref
+ *==========================================================================*/
+
+static
+void
+test_destroy_last_ref_unref(
+    gpointer t2)
+{
+    nfc_tag_unref(NFC_TAG(t2));
+}
+
+static
+void
+test_destroy_last_ref_start(
+    NfcTag* tag,
+    void* user_data)
+{
+    g_main_loop_quit((GMainLoop*)user_data);
+}
+
+static
+void
+test_destroy_last_ref(
+    void)
+{
+    TestTarget* test = test_target_new(TEST_ARRAY_AND_SIZE(test_data_google));
+    NfcTarget* target = &test->target;
+    NfcTagType2* t2 = test_tag_new(test, 0);
+    NfcTag* tag = &t2->tag;
+    GMainLoop* loop = g_main_loop_new(NULL, TRUE);
+    gulong init_id = nfc_tag_add_initialized_handler(tag,
+        test_destroy_last_ref_start, loop);
+    guint id;
+
+    test_run(&test_opt, loop);
+    nfc_tag_remove_handler(tag, init_id);
+
+    /* The destroy callback drops the last reference to the tag */
+    id = nfc_tag_t2_read(t2, 0, 0, NULL, test_destroy_last_ref_unref, t2);
+    g_assert(id);
+
+    /* After that, the tag holds the last reference to the target */
+    nfc_target_unref(target);
+    nfc_target_gone(target);
+    g_assert(!tag->present);
+
+    /* This frees the tag and the target (ASAN would catch it otherwise) */
+    g_assert(nfc_target_cancel_transmit(target, id));
+    g_main_loop_unref(loop);
+}
+
+/*==========================================================================*
+ * read_data_err
+ *==========================================================================*/
+
+#define TEST_READ_DATA_ERR_BLOCK (4)
+
+static
+void
+test_read_data_err_done(
+    NfcTagType2* t2,
+    NFC_TAG_T2_IO_STATUS status,
+    const void* data,
+    guint len,
+    void* user_data)
+{
+    g_assert(status == NFC_TAG_T2_IO_STATUS_IO_ERROR);
+    g_assert(len == (TEST_READ_DATA_ERR_BLOCK * TEST_FIRST_DATA_BLOCK));
+    g_main_loop_quit((GMainLoop*)user_data);
+}
+
+static
+void
+test_read_data_err_start(
+    NfcTag* tag,
+    void* loop)
+{
+    g_assert(nfc_tag_t2_read_data(NFC_TAG_T2(tag), 0,
+        TEST_READ_DATA_ERR_BLOCK * TEST_TARGET_BLOCK_SIZE + 1,
+        test_read_data_err_done, test_destroy_quit_loop, loop));
+}
+
+static
+void
+test_read_data_err(
+    void)
+{
+    TestTarget* test = test_target_new(TEST_ARRAY_AND_SIZE(test_data_empty));
+    NfcTagType2* t2 = test_tag_new(test, 0);
+    NfcTag* tag = &t2->tag;
+    TestTargetError error;
+    GMainLoop* loop = g_main_loop_new(NULL, TRUE);
+    gulong init_id = nfc_tag_add_initialized_handler(tag,
+        test_read_data_err_start, loop);
+
+    /* Damage CRC for data block #4 (not fetched during initialization)
+     * for good, so that retries don't help */
+    memset(&error, 0, sizeof(error));
+    error.block = TEST_FIRST_DATA_BLOCK + TEST_READ_DATA_ERR_BLOCK;
+    error.type = TEST_TARGET_ERROR_CRC;
+    error.persistent = TRUE;
+    test->read_error = &error;
+
+    test_run(&test_opt, loop);
+
+    nfc_tag_remove_handler(tag, init_id);
+    nfc_tag_unref(tag);
+    nfc_target_unref(&test->target);
+    g_main_loop_unref(loop);
+}
+
+/*==========================================================================*
+ * read_data_retry
+ *==========================================================================*/
+
+static
+void
+test_read_data_retry_done(
+    NfcTagType2* t2,
+    NFC_TAG_T2_IO_STATUS status,
+    const void* data,
+    guint len,
+    void* user_data)
+{
+    TestTarget* test = TEST_TARGET(t2->tag.target);
+
+    /* CRC error has been retried */
+    g_assert(status == NFC_TAG_T2_IO_STATUS_OK);
+    g_assert(len == t2->data_size);
+    g_assert(!memcmp(data, test->data.bytes + TEST_DATA_OFFSET, len));
+    g_assert(!test->read_error);
+    g_main_loop_quit((GMainLoop*)user_data);
+}
+
+static
+void
+test_read_data_retry_start(
+    NfcTag* tag,
+    void* loop)
+{
+    NfcTagType2* t2 = NFC_TAG_T2(tag);
+
+    g_assert(nfc_tag_t2_read_data(t2, 0, t2->data_size,
+        test_read_data_retry_done, NULL, loop));
+}
+
+static
+void
+test_read_data_retry(
+    void)
+{
+    TestTarget* test = test_target_new(TEST_ARRAY_AND_SIZE(test_data_empty));
+    NfcTagType2* t2 = test_tag_new(test, 0);
+    NfcTag* tag = &t2->tag;
+    TestTargetError error;
+    GMainLoop* loop = g_main_loop_new(NULL, TRUE);
+    gulong init_id = nfc_tag_add_initialized_handler(tag,
+        test_read_data_retry_start, loop);
+
+    /* One-time CRC error for a block not fetched during initialization */
+    memset(&error, 0, sizeof(error));
+    error.block = TEST_FIRST_DATA_BLOCK + TEST_READ_DATA_ERR_BLOCK;
+    error.type = TEST_TARGET_ERROR_CRC;
+    test->read_error = &error;
+
+    test_run(&test_opt, loop);
+
+    nfc_tag_remove_handler(tag, init_id);
+    nfc_tag_unref(tag);
+    nfc_target_unref(&test->target);
+    g_main_loop_unref(loop);
+}
+
+/*==========================================================================*
+ * read_bytes
+ *==========================================================================*/
+
+static
+void
+test_read_bytes_done(
+    NfcTagType2* t2,
+    NFC_TRANSMIT_STATUS status,
+    GBytes* data,
+    void* user_data)
+{
+    TestTarget* test = TEST_TARGET(t2->tag.target);
+    gsize len;
+    const guint8* bytes;
+
+    g_assert(status == NFC_TRANSMIT_STATUS_OK);
+    g_assert(data);
+    bytes = g_bytes_get_data(data, &len);
+    g_assert(len == 16);
+    g_assert(!memcmp(bytes, test->data.bytes + 16 * t2->block_size, len));
+}
+
+static
+void
+test_read_bytes_start(
+    NfcTag* tag,
+    void* user_data)
+{
+    NfcTagType2* t2 = NFC_TAG_T2(tag);
+
+    /* Only sector 0 is supported */
+    g_assert(!nfc_tag_t2_read_bytes(t2, 1, 16, NULL, test_read_bytes_done,
+        NULL, NULL));
+    g_assert(nfc_tag_t2_read_bytes(t2, 0, 16, NULL, test_read_bytes_done,
+        test_destroy_quit_loop, user_data /* loop */));
+}
+
+static
+void
+test_read_bytes(
+    void)
+{
+    TestTarget* test = test_target_new(TEST_ARRAY_AND_SIZE(test_data_google));
+    NfcTagType2* t2 = test_tag_new(test, 0);
+    NfcTag* tag = &t2->tag;
+    GMainLoop* loop = g_main_loop_new(NULL, TRUE);
+    gulong init_id = nfc_tag_add_initialized_handler(tag,
+        test_read_bytes_start, loop);
+
+    test_run(&test_opt, loop);
+
+    nfc_tag_remove_handler(tag, init_id);
+    nfc_tag_unref(tag);
+    nfc_target_unref(&test->target);
+    g_main_loop_unref(loop);
+}
+
+/*==========================================================================*
+ * read_crc_err
+ *==========================================================================*/
+
+static
+void
+test_read_crc_err_done(
+    NfcTagType2* t2,
+    NFC_TRANSMIT_STATUS status,
+    const void* data,
+    guint len,
+    void* user_data)
+{
+    g_assert(status == NFC_TRANSMIT_STATUS_CORRUPTED);
+    g_assert(!len);
+    g_main_loop_quit((GMainLoop*)user_data);
+}
+
+static
+void
+test_read_crc_err_start(
+    NfcTag* tag,
+    void* user_data)
+{
+    g_assert(nfc_tag_t2_read(NFC_TAG_T2(tag), 0, 16, test_read_crc_err_done,
+        test_destroy_quit_loop, user_data /* loop */));
+}
+
+static
+void
+test_read_crc_err(
+    void)
+{
+    TestTarget* test = test_target_new(TEST_ARRAY_AND_SIZE(test_data_empty));
+    NfcTagType2* t2 = test_tag_new(test, 0);
+    NfcTag* tag = &t2->tag;
+    TestTargetError error;
+    GMainLoop* loop = g_main_loop_new(NULL, TRUE);
+    gulong init_id = nfc_tag_add_initialized_handler(tag,
+        test_read_crc_err_start, loop);
+
+    /* Damage CRC for block #16 (not fetched during initialization) */
+    memset(&error, 0, sizeof(error));
+    error.block = 16;
+    error.type = TEST_TARGET_ERROR_CRC;
+    test->read_error = &error;
+
+    test_run(&test_opt, loop);
+
+    nfc_tag_remove_handler(tag, init_id);
+    nfc_tag_unref(tag);
+    nfc_target_unref(&test->target);
+    g_main_loop_unref(loop);
+}
+
+/*==========================================================================*
+ * read_nack
+ *==========================================================================*/
+
+static
+void
+test_read_nack_done(
+    NfcTagType2* t2,
+    NFC_TRANSMIT_STATUS status,
+    const void* data,
+    guint len,
+    void* user_data)
+{
+    const guint8* payload = data;
+
+    g_assert(status == NFC_TRANSMIT_STATUS_NACK);
+    g_assert(len == 1);
+    g_assert(!(payload[0] & 0x0a));
+    g_main_loop_quit((GMainLoop*)user_data);
+}
+
+static
+void
+test_read_nack_start(
+    NfcTag* tag,
+    void* user_data)
+{
+    g_assert(nfc_tag_t2_read(NFC_TAG_T2(tag), 0, 16, test_read_nack_done,
+        test_destroy_quit_loop, user_data /* loop */));
+}
 
 static
 void
@@ -1702,6 +2905,121 @@ test_write_data3(
     g_main_loop_unref(loop);
 }
 
+/*==========================================================================*
+ * write_data_diff
+ *==========================================================================*/
+
+#define TEST_WRITE_DATA_DIFF_SIZE (40)      /* Data blocks 0..9 */
+#define TEST_WRITE_DATA_DIFF_CHANGE (20)    /* Data block 5 */
+
+typedef struct test_write_data_diff {
+    GMainLoop* loop;
+    GBytes* bytes;
+    guint step;
+    gboolean started;
+} TestWriteDataDiff;
+
+static
+void
+test_write_data_diff_done(
+    NfcTagType2* t2,
+    NFC_TAG_T2_IO_STATUS status,
+    guint written,
+    void* user_data)
+{
+    TestWriteDataDiff* diff = user_data;
+    TestTarget* test = TEST_TARGET(t2->tag.target);
+    gsize size;
+    const guint8* data = g_bytes_get_data(diff->bytes, &size);
+
+    g_assert(diff->started);
+    g_assert(status == NFC_TAG_T2_IO_STATUS_OK);
+    g_assert_cmpuint(written, == ,size);
+    g_assert(!memcmp(test->storage + TEST_DATA_OFFSET, data, size));
+
+    diff->started = FALSE;
+    switch (diff->step++) {
+    case 0:
+        /* Block 5 was written, blocks 8..11 have been read */
+        g_assert_cmpuint(test->write_count, == ,1);
+        g_assert_cmpuint(test->read_count, == ,1);
+
+        /* Write the same thing again, modified block needs to be read */
+        g_assert(nfc_tag_t2_write_data_seq2(t2, 0, diff->bytes, NULL,
+            NFC_TAG_T2_WRITE_FLAG_DIFF, test_write_data_diff_done, NULL,
+            diff));
+        diff->started = TRUE;
+        break;
+    case 1:
+        g_assert_cmpuint(test->write_count, == ,1);
+        g_assert_cmpuint(test->read_count, == ,2);
+
+        /* And once more, no RF activity this time */
+        g_assert(nfc_tag_t2_write_data_seq2(t2, 0, diff->bytes, NULL,
+            NFC_TAG_T2_WRITE_FLAG_DIFF, test_write_data_diff_done, NULL,
+            diff));
+        diff->started = TRUE;
+        break;
+    default:
+        g_assert_cmpuint(test->write_count, == ,1);
+        g_assert_cmpuint(test->read_count, == ,2);
+        g_main_loop_quit(diff->loop);
+        break;
+    }
+}
+
+static
+void
+test_write_data_diff_start(
+    NfcTag* tag,
+    void* user_data)
+{
+    TestWriteDataDiff* diff = user_data;
+    TestTarget* test = TEST_TARGET(tag->target);
+
+    /* Only the first 8 data blocks are cached */
+    test->read_count = 0;
+    g_assert(nfc_tag_t2_write_data_seq2(NFC_TAG_T2(tag), 0, diff->bytes,
+        NULL, NFC_TAG_T2_WRITE_FLAG_DIFF, test_write_data_diff_done, NULL,
+        diff));
+    diff->started = TRUE;
+}
+
+static
+void
+test_write_data_diff(
+    void)
+{
+    TestTarget* test = test_target_new(TEST_ARRAY_AND_SIZE(test_data_ntag216));
+    NfcTagType2* t2;
+    NfcTag* tag;
+    TestWriteDataDiff diff;
+    guint8 data[TEST_WRITE_DATA_DIFF_SIZE];
+    gulong id;
+
+    /* FAST_READ is no better than READ with such a small buffer */
+    nfc_target_set_max_response_size(&test->target, TEST_TARGET_READ_SIZE);
+    t2 = test_tag_new(test, 0);
+    tag = &t2->tag;
+    memcpy(data, test_data_ntag216 + TEST_DATA_OFFSET, sizeof(data));
+    data[TEST_WRITE_DATA_DIFF_CHANGE] ^= 0xff;
+
+    memset(&diff, 0, sizeof(diff));
+    diff.loop = g_main_loop_new(NULL, TRUE);
+    diff.bytes = g_bytes_new_static(data, sizeof(data));
+    id = nfc_tag_add_initialized_handler(tag, test_write_data_diff_start,
+        &diff);
+
+    test_run(&test_opt, diff.loop);
+
+    g_assert_cmpuint(diff.step, == ,3);
+    nfc_tag_remove_handler(tag, id);
+    nfc_tag_unref(tag);
+    nfc_target_unref(&test->target);
+    g_bytes_unref(diff.bytes);
+    g_main_loop_unref(diff.loop);
+}
+
 /*==========================================================================*
  * write_err1
  *==========================================================================*/
@@ -1891,6 +3209,223 @@ test_write_data_err2(
     g_main_loop_unref(loop);
 }
 
+/*==========================================================================*
+ * cache
+ *==========================================================================*/
+
+#define TEST_CACHE_KEY "049bfb4aeb2b80-9a855c80-e1106d00"
+#define TEST_CACHE_TLV_SIZE (24)
+
+static
+void
+test_cache_init_done(
+    NfcTag* tag,
+    void* loop)
+{
+    g_main_loop_quit((GMainLoop*)loop);
+}
+
+static
+void
+test_cache_write_done(
+    NfcTagType2* t2,
+    NFC_TAG_T2_IO_STATUS status,
+    guint written,
+    void* loop)
+{
+    g_assert(status == NFC_TAG_T2_IO_STATUS_OK);
+    g_main_loop_quit((GMainLoop*)loop);
+}
+
+static
+NfcTagType2*
+test_cache_tap(
+    TestTarget* test,
+    guint reads)
+{
+    NfcTagType2* t2;
+    NfcTag* tag;
+    GMainLoop* loop = g_main_loop_new(NULL, TRUE);
+    gulong id;
+    guint8 tlv[TEST_CACHE_TLV_SIZE];
+
+    /* FAST_READ is no better than READ with such a small buffer */
+    nfc_target_set_max_response_size(&test->target, TEST_TARGET_READ_SIZE);
+    t2 = test_tag_new(test, 0);
+    tag = &t2->tag;
+    id = nfc_tag_add_initialized_handler(tag, test_cache_init_done, loop);
+
+    test_run(&test_opt, loop);
+    g_assert_cmpuint(test->read_count, == ,reads);
+    g_assert(tag->ndef);
+    g_assert(nfc_tag_t2_read_data_sync(t2, 0, sizeof(tlv), tlv) ==
+        NFC_TAG_T2_IO_STATUS_OK);
+    g_assert(!memcmp(tlv, test->storage + TEST_DATA_OFFSET, sizeof(tlv)));
+
+    nfc_tag_remove_handler(tag, id);
+    g_main_loop_unref(loop);
+    return t2;
+}
+
+static
+void
+test_cache_gone(
+    NfcTagType2* t2)
+{
+    NfcTarget* target = nfc_target_ref(t2->tag.target);
+
+    nfc_target_gone(target);
+    nfc_tag_unref(&t2->tag);
+    nfc_target_unref(target);
+}
+
+static
+void
+test_cache(
+    void)
+{
+    static const guint8 junk[1000] = { 0 };
+    char* dir = g_dir_make_tmp("test_cache_XXXXXX", NULL);
+    char* path = g_build_filename(dir, TEST_CACHE_KEY, NULL);
+    char* old_path = g_build_filename(dir, "junk", NULL);
+    GMainLoop* loop = g_main_loop_new(NULL, TRUE);
+    TestTarget* test;
+    NfcTagType2* t2;
+    GBytes* bytes;
+    struct utimbuf old;
+
+    nfc_tag_t2_set_cache(dir, 0);
+
+    /* First tap reads the whole TLV sequence and stores the image */
+    test = test_target_new(TEST_ARRAY_AND_SIZE(test_data_ntag216));
+    t2 = test_cache_tap(test, 3);
+    g_assert(!g_file_test(path, G_FILE_TEST_EXISTS));
+    test_cache_gone(t2);
+    g_assert(g_file_test(path, G_FILE_TEST_IS_REGULAR));
+
+    /* Second time it reads the header and the first data blocks */
+    test = test_target_new(TEST_ARRAY_AND_SIZE(test_data_ntag216));
+    t2 = test_cache_tap(test, 2);
+
+    /* Any write invalidates the cache */
+    bytes = g_bytes_new_static(junk, 4);
+    g_assert(nfc_tag_t2_write_data(t2, 0x100, bytes, test_cache_write_done,
+        NULL, loop));
+    test_run(&test_opt, loop);
+    g_bytes_unref(bytes);
+    g_assert(!g_file_test(path, G_FILE_TEST_EXISTS));
+
+    /* The image (minus the written blocks) is stored again */
+    test_cache_gone(t2);
+    g_assert(g_file_test(path, G_FILE_TEST_IS_REGULAR));
+
+    /* The tag has been modified by someone else */
+    test = test_target_new(TEST_ARRAY_AND_SIZE(test_data_ntag216));
+    test->storage[TEST_DATA_OFFSET + 6] = 0x01; /* "http://www." */
+    t2 = test_cache_tap(test, 3);
+    g_assert(!g_file_test(path, G_FILE_TEST_EXISTS));
+    test_cache_gone(t2);
+    g_assert(g_file_test(path, G_FILE_TEST_IS_REGULAR));
+
+    /* Least recently used file gets evicted (the directory is scanned
+     * when the cache gets enabled) */
+    g_assert(g_file_set_contents(old_path, (char*)junk, sizeof(junk), NULL));
+    old.actime = old.modtime = 1000;
+    g_assert(!g_utime(old_path, &old));
+    nfc_tag_t2_set_cache(dir, 1500);
+    test = test_target_new(TEST_ARRAY_AND_SIZE(test_data_ntag216));
+    t2 = test_cache_tap(test, 3);
+    test_cache_gone(t2);
+    g_assert(g_file_test(path, G_FILE_TEST_IS_REGULAR));
+    g_assert(!g_file_test(old_path, G_FILE_TEST_EXISTS));
+
+    nfc_tag_t2_set_cache(NULL, 0);
+    g_assert(!g_unlink(path));
+    g_assert(!g_rmdir(dir));
+    g_main_loop_unref(loop);
+    g_free(old_path);
+    g_free(path);
+    g_free(dir);
+}
+
+/*==========================================================================*
+ * read_data_cached_bytes
+ *==========================================================================*/
+
+static
+void
+test_read_data_cached_bytes_done(
+    NfcTagType2* t2,
+    NFC_TAG_T2_IO_STATUS status,
+    const void* data,
+    guint len,
+    void* loop)
+{
+    g_assert(status == NFC_TAG_T2_IO_STATUS_OK);
+    g_main_loop_quit((GMainLoop*)loop);
+}
+
+static
+void
+test_read_data_cached_bytes(
+    void)
+{
+    static const guint8 new_data[] = { 0x01, 0x02, 0x03, 0x04 };
+    TestTarget* test = test_target_new(TEST_ARRAY_AND_SIZE(test_data_ntag216));
+    NfcTagType2* t2 = test_tag_new(test, 0);
+    NfcTag* tag = &t2->tag;
+    GMainLoop* loop = g_main_loop_new(NULL, TRUE);
+    gulong id = nfc_tag_add_initialized_handler(tag, test_cache_init_done,
+        loop);
+    GBytes* bytes;
+    GBytes* view;
+    GBytes* old_view;
+    const guint8* data;
+    gsize size;
+
+    /* Nothing is available until the tag is initialized */
+    g_assert(!nfc_tag_t2_read_data_cached(t2, 0, 4));
+    test_run(&test_opt, loop);
+
+    /* The TLV sequence is cached, the rest of the data isn't */
+    g_assert(!nfc_tag_t2_read_data_cached(t2, t2->data_size, 1));
+    g_assert(!nfc_tag_t2_read_data_cached(t2, 0, t2->data_size));
+    old_view = nfc_tag_t2_read_data_cached(t2, 0, TEST_CACHE_TLV_SIZE);
+    g_assert(old_view);
+    data = g_bytes_get_data(old_view, &size);
+    g_assert_cmpuint(size, == ,TEST_CACHE_TLV_SIZE);
+    g_assert(!memcmp(data, test_data_ntag216 + TEST_DATA_OFFSET, size));
+
+    /* Overwrite the first block and read it back */
+    bytes = g_bytes_new_static(TEST_ARRAY_AND_SIZE(new_data));
+    g_assert(nfc_tag_t2_write_data(t2, 0, bytes, test_cache_write_done,
+        NULL, loop));
+    test_run(&test_opt, loop);
+    g_bytes_unref(bytes);
+    g_assert(!nfc_tag_t2_read_data_cached(t2, 0, sizeof(new_data)));
+    g_assert(nfc_tag_t2_read_data(t2, 0, sizeof(new_data),
+        test_read_data_cached_bytes_done, NULL, loop));
+    test_run(&test_opt, loop);
+
+    /* The old view still has the old data */
+    view = nfc_tag_t2_read_data_cached(t2, 0, sizeof(new_data));
+    g_assert(view);
+    data = g_bytes_get_data(view, &size);
+    g_assert_cmpuint(size, == ,sizeof(new_data));
+    g_assert(!memcmp(data, new_data, size));
+    g_assert(!memcmp(g_bytes_get_data(old_view, NULL), test_data_ntag216 +
+        TEST_DATA_OFFSET, TEST_CACHE_TLV_SIZE));
+
+    /* The views may outlive the tag */
+    nfc_tag_remove_handler(tag, id);
+    nfc_tag_unref(tag);
+    nfc_target_unref(&test->target);
+    g_assert(!memcmp(g_bytes_get_data(view, NULL), new_data, size));
+    g_bytes_unref(view);
+    g_bytes_unref(old_view);
+    g_main_loop_unref(loop);
+}
+
 /*==========================================================================*
  * Common
  *==========================================================================*/
@@ -1911,9 +3446,28 @@ int main(int argc, char* argv[])
     g_test_add_func(TEST_("init_err2"), test_init_err2);
     g_test_add_func(TEST_("read_data"), test_read_data);
     g_test_add_func(TEST_("read_data_872"), test_read_data_872);
+    g_test_add_func(TEST_("read_data_fast"), test_read_data_fast);
+    g_test_add_func(TEST_("get_version"), test_get_version);
+    g_test_add_func(TEST_("get_version_unknown"), test_get_version_unknown);
+    g_test_add_func(TEST_("get_version_nack"), test_get_version_nack);
+    g_test_add_func(TEST_("get_version_off"), test_get_version_off);
+    g_test_add_func(TEST_("multi_sector"), test_multi_sector);
+    g_test_add_func(TEST_("sector_select"), test_sector_select);
     g_test_add_func(TEST_("read_data_cached"), test_read_data_cached);
+    g_test_add_data_func(TEST_("read_data_holes"),
+        &test_read_data_holes_data, test_read_data_holes);
+    g_test_add_data_func(TEST_("read_data_holes_fast"),
+        &test_read_data_holes_fast_data, test_read_data_holes);
+    g_test_add_func(TEST_("read_ahead"), test_read_ahead);
+    g_test_add_func(TEST_("read_ahead_yield"), test_read_ahead_yield);
+    g_test_add_func(TEST_("cache"), test_cache);
+    g_test_add_func(TEST_("read_data_cached_bytes"),
+        test_read_data_cached_bytes);
     g_test_add_func(TEST_("read_data_abort"), test_read_data_abort);
+    g_test_add_func(TEST_("destroy_last_ref"), test_destroy_last_ref);
     g_test_add_func(TEST_("read_data_err"), test_read_data_err);
+    g_test_add_func(TEST_("read_data_retry"), test_read_data_retry);
+    g_test_add_func(TEST_("read_bytes"), test_read_bytes);
     g_test_add_func(TEST_("read_crc_err"), test_read_crc_err);
     g_test_add_func(TEST_("read_nack"), test_read_nack);
     g_test_add_func(TEST_("read_timeout"), test_read_timeout);
@@ -1921,6 +3475,7 @@ int main(int argc, char* argv[])
     g_test_add_func(TEST_("write_data1"), test_write_data1);
     g_test_add_func(TEST_("write_data2"), test_write_data2);
     g_test_add_func(TEST_("write_data3"), test_write_data3);
+    g_test_add_func(TEST_("write_data_diff"), test_write_data_diff);
     g_test_add_func(TEST_("write_err1"), test_write_err1);
     g_test_add_func(TEST_("write_data_err1"), test_write_data_err1);
     g_test_add_func(TEST_("write_data_err2"), test_write_data_err2);
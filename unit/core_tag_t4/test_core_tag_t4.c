@@ -147,6 +147,10 @@ static const guint8 test_resp_read_ndef_len_zero[] = {
     0x00, 0x00,                               /* Data */
     0x90, 0x00                                /* SW1|SW2 */
 };
+static const guint8 test_resp_read_ndef_len_too_big[] = {
+    0x10, 0x00,                               /* Data */
+    0x90, 0x00                                /* SW1|SW2 */
+};
 static const guint8 test_resp_read_ndef_len_wrong[] = {
     0x00,                                     /* Data */
     0x90, 0x00                                /* SW1|SW2 */
@@ -173,6 +177,37 @@ static const guint8 test_resp_read_ndef_2[] = {
     0x73, 0x74, 0x20, 0x74, 0x65, 0x73, 0x74, /* Data */
     0x90, 0x00                                /* SW1|SW2 */
 };
+static const guint8 test_resp_not_supported[] = { 0x6a, 0x81 };
+static const guint8 test_cmd_read_ndef_cc_sfi[] = {
+    0x00, 0xb0, 0x83, 0x00, 0x0f              /* CLA|INS|P1|P2|Le  */
+};
+static const guint8 test_cmd_read_ndef_sfi[] = {
+    0x00, 0xb0, 0x84, 0x00, 0x3b              /* CLA|INS|P1|P2|Le  */
+};
+static const guint8 test_cmd_read_ndef_head[] = {
+    0x00, 0xb0, 0x00, 0x00, 0x3b              /* CLA|INS|P1|P2|Le  */
+};
+static const guint8 test_resp_read_ndef_head[] = {
+    0x00, 0x42,                               /* NLEN */
+    0xd1, 0x01, 0x3e, 0x54, 0x02, 0x65, 0x6e, /* Data */
+    0x54, 0x65, 0x73, 0x74, 0x20, 0x74, 0x65,
+    0x73, 0x74, 0x20, 0x74, 0x65, 0x73, 0x74,
+    0x20, 0x74, 0x65, 0x73, 0x74, 0x20, 0x74,
+    0x65, 0x73, 0x74, 0x20, 0x74, 0x65, 0x73,
+    0x74, 0x20, 0x74, 0x65, 0x73, 0x74, 0x20,
+    0x74, 0x65, 0x73, 0x74, 0x20, 0x74, 0x65,
+    0x73, 0x74, 0x20, 0x74, 0x65, 0x73, 0x74,
+    0x20,
+    0x90, 0x00                                /* SW1|SW2 */
+};
+static const guint8 test_cmd_read_ndef_tail[] = {
+    0x00, 0xb0, 0x00, 0x3b, 0x09              /* CLA|INS|P1|P2|Le  */
+};
+static const guint8 test_resp_read_ndef_tail[] = {
+    0x74, 0x65, 0x73, 0x74, 0x20, 0x74, 0x65, /* Data */
+    0x73, 0x74,
+    0x90, 0x00                                /* SW1|SW2 */
+};
 
 static
 void
@@ -332,6 +367,7 @@ typedef struct test_target2 {
     TestTarget parent;
     gboolean fail_reactivate;
     guint reactivate_id;
+    int reactivate_count;
 } TestTarget2;
 
 G_DEFINE_TYPE(TestTarget2, test_target2, TEST_TYPE_TARGET)
@@ -359,6 +395,7 @@ test_target2_reactivate(
     TestTarget2* test = TEST_TARGET2(target);
 
     g_assert(!test->reactivate_id);
+    test->reactivate_count++;
     if (test->fail_reactivate) {
         return FALSE;
     } else {
@@ -414,6 +451,13 @@ test_null(
     g_assert(!nfc_tag_t4b_new(target, NULL, NULL));
     g_assert(!nfc_isodep_transmit(NULL, 0, 0, 0, 0, NULL, 0,
         NULL, NULL, NULL, NULL));
+    g_assert(!nfc_isodep_transmit_bytes(NULL, 0, 0, 0, 0, NULL, 0,
+        NULL, NULL, NULL, NULL));
+    g_assert(!nfc_isodep_transmit_chain(NULL, 0, 0, 0, 0, NULL, 0,
+        NULL, 0, NULL, NULL, NULL));
+    g_assert(!nfc_tag_t4_write_ndef(NULL, NULL, NULL, NULL, NULL, NULL));
+    nfc_tag_t4_add_reactivate_rule(NULL, NFC_TAG_T4_REACTIVATE_ALWAYS);
+    nfc_tag_t4_clear_reactivate_rules();
     nfc_target_unref(target);
 }
 
@@ -488,6 +532,8 @@ static const GUtilData test_init_data_app_select_resp_empty[] = {
 static const GUtilData test_init_data_cc_not_found[] = {
     { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_app) },
     { TEST_ARRAY_AND_SIZE(test_resp_ok) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc_sfi) },
+    { TEST_ARRAY_AND_SIZE(test_resp_not_supported) },
     { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_cc) },
     { TEST_ARRAY_AND_SIZE(test_resp_not_found) }
 };
@@ -495,6 +541,8 @@ static const GUtilData test_init_data_cc_not_found[] = {
 static const GUtilData test_init_data_cc_select_err[] = {
     { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_app) },
     { TEST_ARRAY_AND_SIZE(test_resp_ok) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc_sfi) },
+    { TEST_ARRAY_AND_SIZE(test_resp_not_supported) },
     { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_cc) },
     { TEST_ARRAY_AND_SIZE(test_resp_err) }
 };
@@ -502,6 +550,8 @@ static const GUtilData test_init_data_cc_select_err[] = {
 static const GUtilData test_init_data_cc_select_io_err[] = {
     { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_app) },
     { TEST_ARRAY_AND_SIZE(test_resp_ok) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc_sfi) },
+    { TEST_ARRAY_AND_SIZE(test_resp_not_supported) },
     { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_cc) }
     /* Missing response becomes an I/O error */
 };
@@ -509,6 +559,8 @@ static const GUtilData test_init_data_cc_select_io_err[] = {
 static const GUtilData test_init_data_cc_short_read[] = {
     { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_app) },
     { TEST_ARRAY_AND_SIZE(test_resp_ok) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc_sfi) },
+    { TEST_ARRAY_AND_SIZE(test_resp_not_supported) },
     { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_cc) },
     { TEST_ARRAY_AND_SIZE(test_resp_ok) },
     { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc) },
@@ -518,6 +570,8 @@ static const GUtilData test_init_data_cc_short_read[] = {
 static const GUtilData test_init_data_cc_read_err[] = {
     { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_app) },
     { TEST_ARRAY_AND_SIZE(test_resp_ok) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc_sfi) },
+    { TEST_ARRAY_AND_SIZE(test_resp_not_supported) },
     { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_cc) },
     { TEST_ARRAY_AND_SIZE(test_resp_ok) },
     { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc) },
@@ -527,6 +581,8 @@ static const GUtilData test_init_data_cc_read_err[] = {
 static const GUtilData test_init_data_cc_read_io_err[] = {
     { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_app) },
     { TEST_ARRAY_AND_SIZE(test_resp_ok) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc_sfi) },
+    { TEST_ARRAY_AND_SIZE(test_resp_not_supported) },
     { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_cc) },
     { TEST_ARRAY_AND_SIZE(test_resp_ok) },
     { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc) }
@@ -536,6 +592,8 @@ static const GUtilData test_init_data_cc_read_io_err[] = {
 static const GUtilData test_init_data_cc_v3[] = {
     { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_app) },
     { TEST_ARRAY_AND_SIZE(test_resp_ok) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc_sfi) },
+    { TEST_ARRAY_AND_SIZE(test_resp_not_supported) },
     { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_cc) },
     { TEST_ARRAY_AND_SIZE(test_resp_ok) },
     { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc) },
@@ -545,6 +603,8 @@ static const GUtilData test_init_data_cc_v3[] = {
 static const GUtilData test_init_data_cc_short_mle[] = {
     { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_app) },
     { TEST_ARRAY_AND_SIZE(test_resp_ok) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc_sfi) },
+    { TEST_ARRAY_AND_SIZE(test_resp_not_supported) },
     { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_cc) },
     { TEST_ARRAY_AND_SIZE(test_resp_ok) },
     { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc) },
@@ -554,6 +614,8 @@ static const GUtilData test_init_data_cc_short_mle[] = {
 static const GUtilData test_init_data_cc_no_access[] = {
     { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_app) },
     { TEST_ARRAY_AND_SIZE(test_resp_ok) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc_sfi) },
+    { TEST_ARRAY_AND_SIZE(test_resp_not_supported) },
     { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_cc) },
     { TEST_ARRAY_AND_SIZE(test_resp_ok) },
     { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc) },
@@ -563,6 +625,8 @@ static const GUtilData test_init_data_cc_no_access[] = {
 static const GUtilData test_init_data_cc_invalid_t[] = {
     { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_app) },
     { TEST_ARRAY_AND_SIZE(test_resp_ok) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc_sfi) },
+    { TEST_ARRAY_AND_SIZE(test_resp_not_supported) },
     { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_cc) },
     { TEST_ARRAY_AND_SIZE(test_resp_ok) },
     { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc) },
@@ -572,6 +636,8 @@ static const GUtilData test_init_data_cc_invalid_t[] = {
 static const GUtilData test_init_data_cc_invalid_l[] = {
     { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_app) },
     { TEST_ARRAY_AND_SIZE(test_resp_ok) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc_sfi) },
+    { TEST_ARRAY_AND_SIZE(test_resp_not_supported) },
     { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_cc) },
     { TEST_ARRAY_AND_SIZE(test_resp_ok) },
     { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc) },
@@ -581,6 +647,8 @@ static const GUtilData test_init_data_cc_invalid_l[] = {
 static const GUtilData test_init_data_cc_invalid_fid_1[] = {
     { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_app) },
     { TEST_ARRAY_AND_SIZE(test_resp_ok) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc_sfi) },
+    { TEST_ARRAY_AND_SIZE(test_resp_not_supported) },
     { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_cc) },
     { TEST_ARRAY_AND_SIZE(test_resp_ok) },
     { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc) },
@@ -590,6 +658,8 @@ static const GUtilData test_init_data_cc_invalid_fid_1[] = {
 static const GUtilData test_init_data_cc_invalid_fid_2[] = {
     { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_app) },
     { TEST_ARRAY_AND_SIZE(test_resp_ok) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc_sfi) },
+    { TEST_ARRAY_AND_SIZE(test_resp_not_supported) },
     { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_cc) },
     { TEST_ARRAY_AND_SIZE(test_resp_ok) },
     { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc) },
@@ -599,6 +669,8 @@ static const GUtilData test_init_data_cc_invalid_fid_2[] = {
 static const GUtilData test_init_data_cc_invalid_fid_3[] = {
     { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_app) },
     { TEST_ARRAY_AND_SIZE(test_resp_ok) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc_sfi) },
+    { TEST_ARRAY_AND_SIZE(test_resp_not_supported) },
     { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_cc) },
     { TEST_ARRAY_AND_SIZE(test_resp_ok) },
     { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc) },
@@ -608,6 +680,8 @@ static const GUtilData test_init_data_cc_invalid_fid_3[] = {
 static const GUtilData test_init_data_cc_invalid_fid_4[] = {
     { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_app) },
     { TEST_ARRAY_AND_SIZE(test_resp_ok) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc_sfi) },
+    { TEST_ARRAY_AND_SIZE(test_resp_not_supported) },
     { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_cc) },
     { TEST_ARRAY_AND_SIZE(test_resp_ok) },
     { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc) },
@@ -617,6 +691,8 @@ static const GUtilData test_init_data_cc_invalid_fid_4[] = {
 static const GUtilData test_init_data_cc_invalid_fid_5[] = {
     { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_app) },
     { TEST_ARRAY_AND_SIZE(test_resp_ok) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc_sfi) },
+    { TEST_ARRAY_AND_SIZE(test_resp_not_supported) },
     { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_cc) },
     { TEST_ARRAY_AND_SIZE(test_resp_ok) },
     { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc) },
@@ -626,6 +702,8 @@ static const GUtilData test_init_data_cc_invalid_fid_5[] = {
 static const GUtilData test_init_data_ndef_not_found[] = {
     { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_app) },
     { TEST_ARRAY_AND_SIZE(test_resp_ok) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc_sfi) },
+    { TEST_ARRAY_AND_SIZE(test_resp_not_supported) },
     { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_cc) },
     { TEST_ARRAY_AND_SIZE(test_resp_ok) },
     { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc) },
@@ -637,6 +715,8 @@ static const GUtilData test_init_data_ndef_not_found[] = {
 static const GUtilData test_init_data_ndef_select_io_err[] = {
     { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_app) },
     { TEST_ARRAY_AND_SIZE(test_resp_ok) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc_sfi) },
+    { TEST_ARRAY_AND_SIZE(test_resp_not_supported) },
     { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_cc) },
     { TEST_ARRAY_AND_SIZE(test_resp_ok) },
     { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc) },
@@ -648,12 +728,16 @@ static const GUtilData test_init_data_ndef_select_io_err[] = {
 static const GUtilData test_init_data_ndef_read_len_zero[] = {
     { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_app) },
     { TEST_ARRAY_AND_SIZE(test_resp_ok) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc_sfi) },
+    { TEST_ARRAY_AND_SIZE(test_resp_not_supported) },
     { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_cc) },
     { TEST_ARRAY_AND_SIZE(test_resp_ok) },
     { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc) },
     { TEST_ARRAY_AND_SIZE(test_resp_read_ndef_cc) },
     { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_ef) },
     { TEST_ARRAY_AND_SIZE(test_resp_ok) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_head) },
+    { TEST_ARRAY_AND_SIZE(test_resp_err) },
     { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_len) },
     { TEST_ARRAY_AND_SIZE(test_resp_read_ndef_len_zero) }
 };
@@ -661,12 +745,16 @@ static const GUtilData test_init_data_ndef_read_len_zero[] = {
 static const GUtilData test_init_data_ndef_read_len_wrong[] = {
     { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_app) },
     { TEST_ARRAY_AND_SIZE(test_resp_ok) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc_sfi) },
+    { TEST_ARRAY_AND_SIZE(test_resp_not_supported) },
     { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_cc) },
     { TEST_ARRAY_AND_SIZE(test_resp_ok) },
     { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc) },
     { TEST_ARRAY_AND_SIZE(test_resp_read_ndef_cc) },
     { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_ef) },
     { TEST_ARRAY_AND_SIZE(test_resp_ok) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_head) },
+    { TEST_ARRAY_AND_SIZE(test_resp_err) },
     { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_len) },
     { TEST_ARRAY_AND_SIZE(test_resp_read_ndef_len_wrong) }
 };
@@ -674,12 +762,16 @@ static const GUtilData test_init_data_ndef_read_len_wrong[] = {
 static const GUtilData test_init_data_ndef_read_len_err[] = {
     { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_app) },
     { TEST_ARRAY_AND_SIZE(test_resp_ok) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc_sfi) },
+    { TEST_ARRAY_AND_SIZE(test_resp_not_supported) },
     { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_cc) },
     { TEST_ARRAY_AND_SIZE(test_resp_ok) },
     { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc) },
     { TEST_ARRAY_AND_SIZE(test_resp_read_ndef_cc) },
     { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_ef) },
     { TEST_ARRAY_AND_SIZE(test_resp_ok) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_head) },
+    { TEST_ARRAY_AND_SIZE(test_resp_err) },
     { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_len) },
     { TEST_ARRAY_AND_SIZE(test_resp_err) }
 };
@@ -687,12 +779,16 @@ static const GUtilData test_init_data_ndef_read_len_err[] = {
 static const GUtilData test_init_data_ndef_read_len_io_err[] = {
     { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_app) },
     { TEST_ARRAY_AND_SIZE(test_resp_ok) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc_sfi) },
+    { TEST_ARRAY_AND_SIZE(test_resp_not_supported) },
     { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_cc) },
     { TEST_ARRAY_AND_SIZE(test_resp_ok) },
     { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc) },
     { TEST_ARRAY_AND_SIZE(test_resp_read_ndef_cc) },
     { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_ef) },
     { TEST_ARRAY_AND_SIZE(test_resp_ok) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_head) },
+    { TEST_ARRAY_AND_SIZE(test_resp_err) },
     { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_len) }
     /* Missing response becomes an I/O error */
 };
@@ -700,12 +796,16 @@ static const GUtilData test_init_data_ndef_read_len_io_err[] = {
 static const GUtilData test_init_data_ndef_read_err[] = {
     { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_app) },
     { TEST_ARRAY_AND_SIZE(test_resp_ok) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc_sfi) },
+    { TEST_ARRAY_AND_SIZE(test_resp_not_supported) },
     { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_cc) },
     { TEST_ARRAY_AND_SIZE(test_resp_ok) },
     { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc) },
     { TEST_ARRAY_AND_SIZE(test_resp_read_ndef_cc) },
     { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_ef) },
     { TEST_ARRAY_AND_SIZE(test_resp_ok) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_head) },
+    { TEST_ARRAY_AND_SIZE(test_resp_err) },
     { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_len) },
     { TEST_ARRAY_AND_SIZE(test_resp_read_ndef_len) },
     { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_1) },
@@ -715,12 +815,16 @@ static const GUtilData test_init_data_ndef_read_err[] = {
 static const GUtilData test_init_data_ndef_read_io_err[] = {
     { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_app) },
     { TEST_ARRAY_AND_SIZE(test_resp_ok) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc_sfi) },
+    { TEST_ARRAY_AND_SIZE(test_resp_not_supported) },
     { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_cc) },
     { TEST_ARRAY_AND_SIZE(test_resp_ok) },
     { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc) },
     { TEST_ARRAY_AND_SIZE(test_resp_read_ndef_cc) },
     { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_ef) },
     { TEST_ARRAY_AND_SIZE(test_resp_ok) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_head) },
+    { TEST_ARRAY_AND_SIZE(test_resp_err) },
     { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_len) },
     { TEST_ARRAY_AND_SIZE(test_resp_read_ndef_len) },
     { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_1) },
@@ -730,12 +834,16 @@ static const GUtilData test_init_data_ndef_read_io_err[] = {
 static const GUtilData test_init_data_ndef_short[] = {
     { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_app) },
     { TEST_ARRAY_AND_SIZE(test_resp_ok) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc_sfi) },
+    { TEST_ARRAY_AND_SIZE(test_resp_not_supported) },
     { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_cc) },
     { TEST_ARRAY_AND_SIZE(test_resp_ok) },
     { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc) },
     { TEST_ARRAY_AND_SIZE(test_resp_read_ndef_cc) },
     { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_ef) },
     { TEST_ARRAY_AND_SIZE(test_resp_ok) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_head) },
+    { TEST_ARRAY_AND_SIZE(test_resp_err) },
     { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_len) },
     { TEST_ARRAY_AND_SIZE(test_resp_read_ndef_len) },
     { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_1) },
@@ -743,9 +851,11 @@ static const GUtilData test_init_data_ndef_short[] = {
 };
 
 #define test_init_data_app_select_submit_failure test_init_data_success
+#define test_init_data_cc_sfi_read_submit_error test_init_data_success
 #define test_init_data_cc_select_submit_error test_init_data_success
 #define test_init_data_cc_read_submit_error test_init_data_success
 #define test_init_data_ndef_select_submit_error test_init_data_success
+#define test_init_data_ndef_head_read_submit_error test_init_data_success
 #define test_init_data_ndef_read_submit_error1 test_init_data_success
 #define test_init_data_ndef_read_submit_error2 test_init_data_success
 #define test_init_data_ndef_read_submit_error3 test_init_data_success
@@ -753,12 +863,16 @@ static const GUtilData test_init_data_ndef_short[] = {
 static const GUtilData test_init_data_success[] = {
     { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_app) },
     { TEST_ARRAY_AND_SIZE(test_resp_ok) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc_sfi) },
+    { TEST_ARRAY_AND_SIZE(test_resp_not_supported) },
     { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_cc) },
     { TEST_ARRAY_AND_SIZE(test_resp_ok) },
     { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc) },
     { TEST_ARRAY_AND_SIZE(test_resp_read_ndef_cc) },
     { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_ef) },
     { TEST_ARRAY_AND_SIZE(test_resp_ok) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_head) },
+    { TEST_ARRAY_AND_SIZE(test_resp_err) },
     { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_len) },
     { TEST_ARRAY_AND_SIZE(test_resp_read_ndef_len) },
     { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_1) },
@@ -767,6 +881,98 @@ static const GUtilData test_init_data_success[] = {
     { TEST_ARRAY_AND_SIZE(test_resp_read_ndef_2) }
 };
 
+static const GUtilData test_init_data_sfi_cc_io_err[] = {
+    { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_app) },
+    { TEST_ARRAY_AND_SIZE(test_resp_ok) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc_sfi) }
+    /* Missing response becomes an I/O error */
+};
+
+static const GUtilData test_init_data_sfi_ndef_io_err[] = {
+    { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_app) },
+    { TEST_ARRAY_AND_SIZE(test_resp_ok) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc_sfi) },
+    { TEST_ARRAY_AND_SIZE(test_resp_read_ndef_cc) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_sfi) }
+    /* Missing response becomes an I/O error */
+};
+
+static const GUtilData test_init_data_sfi_ndef_short[] = {
+    { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_app) },
+    { TEST_ARRAY_AND_SIZE(test_resp_ok) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc_sfi) },
+    { TEST_ARRAY_AND_SIZE(test_resp_read_ndef_cc) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_sfi) },
+    { TEST_ARRAY_AND_SIZE(test_resp_read_ndef_len_wrong) }
+};
+
+static const GUtilData test_init_data_sfi_ndef_empty[] = {
+    { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_app) },
+    { TEST_ARRAY_AND_SIZE(test_resp_ok) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc_sfi) },
+    { TEST_ARRAY_AND_SIZE(test_resp_read_ndef_cc) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_sfi) },
+    { TEST_ARRAY_AND_SIZE(test_resp_read_ndef_len_zero) }
+};
+
+static const GUtilData test_init_data_sfi_ndef_fallback[] = {
+    { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_app) },
+    { TEST_ARRAY_AND_SIZE(test_resp_ok) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc_sfi) },
+    { TEST_ARRAY_AND_SIZE(test_resp_read_ndef_cc) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_sfi) },
+    { TEST_ARRAY_AND_SIZE(test_resp_not_supported) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_ef) },
+    { TEST_ARRAY_AND_SIZE(test_resp_ok) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_head) },
+    { TEST_ARRAY_AND_SIZE(test_resp_read_ndef_head) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_tail) },
+    { TEST_ARRAY_AND_SIZE(test_resp_read_ndef_tail) }
+};
+
+static const GUtilData test_init_data_sfi_cc_invalid[] = {
+    { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_app) },
+    { TEST_ARRAY_AND_SIZE(test_resp_ok) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc_sfi) },
+    { TEST_ARRAY_AND_SIZE(test_resp_read_ndef_cc_v3) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_cc) },
+    { TEST_ARRAY_AND_SIZE(test_resp_ok) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc) },
+    { TEST_ARRAY_AND_SIZE(test_resp_read_ndef_cc) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_ef) },
+    { TEST_ARRAY_AND_SIZE(test_resp_ok) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_head) },
+    { TEST_ARRAY_AND_SIZE(test_resp_read_ndef_head) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_tail) },
+    { TEST_ARRAY_AND_SIZE(test_resp_read_ndef_tail) }
+};
+
+static const GUtilData test_init_data_sfi_ndef_too_big[] = {
+    { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_app) },
+    { TEST_ARRAY_AND_SIZE(test_resp_ok) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc_sfi) },
+    { TEST_ARRAY_AND_SIZE(test_resp_read_ndef_cc) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_sfi) },
+    { TEST_ARRAY_AND_SIZE(test_resp_read_ndef_len_too_big) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_ef) },
+    { TEST_ARRAY_AND_SIZE(test_resp_ok) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_head) },
+    { TEST_ARRAY_AND_SIZE(test_resp_read_ndef_head) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_tail) },
+    { TEST_ARRAY_AND_SIZE(test_resp_read_ndef_tail) }
+};
+
+static const GUtilData test_init_data_success_sfi[] = {
+    { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_app) },
+    { TEST_ARRAY_AND_SIZE(test_resp_ok) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc_sfi) },
+    { TEST_ARRAY_AND_SIZE(test_resp_read_ndef_cc) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_sfi) },
+    { TEST_ARRAY_AND_SIZE(test_resp_read_ndef_head) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_tail) },
+    { TEST_ARRAY_AND_SIZE(test_resp_read_ndef_tail) }
+};
+
 static const TestInitData init_tests[] = {
 #define TEST_INIT(x,y,z) {#x, TEST_ARRAY_AND_COUNT(test_init_data_##x), y, z}
     TEST_INIT(app_not_found, 0, 0),
@@ -799,16 +1005,39 @@ static const TestInitData init_tests[] = {
     TEST_INIT(ndef_read_io_err, 0, 0),
     TEST_INIT(ndef_short, 0, 0),
     TEST_INIT(app_select_submit_failure, 1, 0),
-    TEST_INIT(cc_select_submit_error, 2, 0),
-    TEST_INIT(cc_read_submit_error, 3, 0),
-    TEST_INIT(ndef_select_submit_error, 4, 0),
-    TEST_INIT(ndef_read_submit_error1, 5, 0),
-    TEST_INIT(ndef_read_submit_error2, 6, 0),
-    TEST_INIT(ndef_read_submit_error3, 7, 0),
+    TEST_INIT(cc_sfi_read_submit_error, 2, 0),
+    TEST_INIT(cc_select_submit_error, 3, 0),
+    TEST_INIT(cc_read_submit_error, 4, 0),
+    TEST_INIT(ndef_select_submit_error, 5, 0),
+    TEST_INIT(ndef_head_read_submit_error, 6, 0),
+    TEST_INIT(ndef_read_submit_error1, 7, 0),
+    TEST_INIT(ndef_read_submit_error2, 8, 0),
+    TEST_INIT(ndef_read_submit_error3, 9, 0),
     TEST_INIT(success, 0, TEST_INIT_NDEF),
-    TEST_INIT(success_no_react, 0, TEST_INIT_NDEF | TEST_INIT_FAIL_REACT)
+    TEST_INIT(success_no_react, 0, TEST_INIT_NDEF | TEST_INIT_FAIL_REACT),
+    TEST_INIT(sfi_cc_io_err, 0, 0),
+    TEST_INIT(sfi_ndef_io_err, 0, 0),
+    TEST_INIT(sfi_ndef_short, 0, 0),
+    TEST_INIT(sfi_ndef_empty, 0, 0),
+    TEST_INIT(sfi_ndef_fallback, 0, TEST_INIT_NDEF),
+    TEST_INIT(sfi_cc_invalid, 0, TEST_INIT_NDEF),
+    TEST_INIT(sfi_ndef_too_big, 0, TEST_INIT_NDEF),
+    TEST_INIT(success_sfi, 0, TEST_INIT_NDEF)
 };
 
+static
+void
+test_init_seq_ndef_parsed(
+    NfcTag* tag,
+    void* user_data)
+{
+    const TestInitData* test = ((const TestInitData**)user_data)[0];
+
+    /* NDEF is available before reactivation completes */
+    g_assert(!tag->ndef == !(test->flags & TEST_INIT_NDEF));
+    ((const TestInitData**)user_data)[1] = test;
+}
+
 static
 void
 test_init_seq(
@@ -821,6 +1050,8 @@ test_init_seq(
     NfcParamPollB poll_b;
     NfcTagType4* t4b;
     NfcTag* tag;
+    const TestInitData* parsed[2];
+    gulong parsed_id;
     guint i;
 
     for (i = 0; i < test->count; i++) {
@@ -836,6 +1067,11 @@ test_init_seq(
     t4b = NFC_TAG_T4(nfc_tag_t4b_new(target, &poll_b, NULL));
     g_assert(NFC_IS_TAG_T4B(t4b));
     tag = &t4b->tag;
+    parsed[0] = test;
+    parsed[1] = NULL;
+    parsed_id = (nfc_tag_stage(tag) < NFC_TAG_STAGE_NDEF_PARSED) ?
+        nfc_tag_add_stage_handler(tag, NFC_TAG_STAGE_NDEF_PARSED,
+            test_init_seq_ndef_parsed, parsed) : 0;
 
     /* Run the initialization sequence if not initialized yet */
     if (!(tag->flags & NFC_TAG_FLAG_INITIALIZED)) {
@@ -853,6 +1089,254 @@ test_init_seq(
 
     /* Check if are supposed to have NDEF */
     g_assert(!tag->ndef == !(test->flags & TEST_INIT_NDEF));
+    g_assert(nfc_tag_stage(tag) == NFC_TAG_STAGE_NDEF_PARSED);
+    g_assert(parsed[1] || !parsed_id);
+
+    nfc_tag_remove_handler(tag, parsed_id);
+    nfc_tag_unref(tag);
+    nfc_target_unref(target);
+}
+
+/*==========================================================================*
+ * ext_len
+ *==========================================================================*/
+
+#define TEST_EXT_LEN_NDEF_SIZE (0x250)
+
+static const guint8 test_resp_read_ndef_cc_big_mle[] = {
+    0x00, 0x0f, 0x20, 0x04, 0x00, 0x00, 0x34, /* Data */
+    /*            ^^^^^^^^^^ MLe              */
+    0x04, 0x06, 0xe1, 0x04, 0x0f, 0xff, 0x00,
+    0xff,
+    0x90, 0x00                                /* SW1|SW2 */
+};
+static const guint8 test_cmd_read_ndef_sfi_ext[] = {
+    0x00, 0xb0, 0x84, 0x00, 0x00, 0x04, 0x00  /* CLA|INS|P1|P2|Le  */
+};
+static const guint8 test_cmd_read_ndef_sfi_short[] = {
+    0x00, 0xb0, 0x84, 0x00, 0x00              /* CLA|INS|P1|P2|Le  */
+};
+static const guint8 test_cmd_read_ndef_ext[] = {
+    0x00, 0xb0, 0x01, 0x00, 0x00, 0x01, 0x52  /* CLA|INS|P1|P2|Le  */
+};
+static const guint8 test_cmd_read_ndef_short_1[] = {
+    0x00, 0xb0, 0x01, 0x00, 0x00              /* CLA|INS|P1|P2|Le  */
+};
+static const guint8 test_cmd_read_ndef_short_2[] = {
+    0x00, 0xb0, 0x02, 0x00, 0x52              /* CLA|INS|P1|P2|Le  */
+};
+static const guint8 test_resp_wrong_length[] = { 0x67, 0x00 };
+static const guint8 test_hb_ext[] = { 0x80, 0x73, 0x00, 0x00, 0x40 };
+static const guint8 test_hb_short[] = { 0x80, 0x73, 0x00, 0x00, 0x00 };
+
+typedef struct test_ext_len_data {
+    const char* name;
+    GUtilData hb;
+    guint flags;
+
+#define TEST_EXT_LEN_DECLARED (0x01) /* Everything in one READ BINARY */
+#define TEST_EXT_LEN_PROBE (0x02)    /* Extended Le is tried */
+#define TEST_EXT_LEN_PROBE_OK (0x04) /* and accepted by the card */
+
+} TestExtLenData;
+
+static const TestExtLenData ext_len_tests[] = {
+    { "hb_ext", { TEST_ARRAY_AND_SIZE(test_hb_ext) },
+      TEST_EXT_LEN_DECLARED },
+    { "hb_short", { TEST_ARRAY_AND_SIZE(test_hb_short) }, 0 },
+    { "probe_ok", { NULL, 0 },
+      TEST_EXT_LEN_PROBE | TEST_EXT_LEN_PROBE_OK },
+    { "probe_fail", { NULL, 0 }, TEST_EXT_LEN_PROBE }
+};
+
+static
+void
+test_ext_len_add_resp(
+    TestTarget* target,
+    const void* cmd,
+    guint cmd_len,
+    const guint8* data,
+    guint len)
+{
+    guint8* resp = g_malloc(len + 2);
+
+    memcpy(resp, data, len);
+    resp[len] = 0x90;
+    resp[len + 1] = 0x00;
+    test_target_add_cmd(target, cmd, cmd_len, resp, len + 2);
+    g_free(resp);
+}
+
+static
+void
+test_ext_len(
+    gconstpointer test_data)
+{
+    const TestExtLenData* test = test_data;
+    NfcTarget* target = g_object_new(TEST_TYPE_TARGET2, NULL);
+    TestTarget* test_target = TEST_TARGET(target);
+    NfcParamIsoDepPollA iso_dep_poll_a;
+    GMainLoop* loop = g_main_loop_new(NULL, TRUE);
+    guint8 file[TEST_EXT_LEN_NDEF_SIZE + 2];
+    guint8* ndef = file + 2;
+    NfcTagType4* t4a;
+    NfcTag* tag;
+    gulong id;
+
+    /* NLEN and a single record of unknown type, without the SR flag */
+    memset(file, 0, sizeof(file));
+    file[0] = (guint8)(TEST_EXT_LEN_NDEF_SIZE >> 8);
+    file[1] = (guint8)TEST_EXT_LEN_NDEF_SIZE;
+    ndef[0] = 0xc5;
+    ndef[4] = (guint8)((TEST_EXT_LEN_NDEF_SIZE - 6) >> 8);
+    ndef[5] = (guint8)(TEST_EXT_LEN_NDEF_SIZE - 6);
+
+    test_target_add_cmd(test_target,
+        TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_app),
+        TEST_ARRAY_AND_SIZE(test_resp_ok));
+    test_target_add_cmd(test_target,
+        TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc_sfi),
+        TEST_ARRAY_AND_SIZE(test_resp_read_ndef_cc_big_mle));
+    if (test->flags & TEST_EXT_LEN_DECLARED) {
+        /* The whole thing in one go */
+        test_ext_len_add_resp(test_target,
+            TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_sfi_ext),
+            TEST_ARRAY_AND_SIZE(file));
+    } else {
+        /* Extended Le isn't probed by the first READ BINARY */
+        test_ext_len_add_resp(test_target,
+            TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_sfi_short), file, 0x100);
+        if (test->flags & TEST_EXT_LEN_PROBE_OK) {
+            test_ext_len_add_resp(test_target,
+                TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_ext), file + 0x100,
+                sizeof(file) - 0x100);
+        } else {
+            if (test->flags & TEST_EXT_LEN_PROBE) {
+                test_target_add_cmd(test_target,
+                    TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_ext),
+                    TEST_ARRAY_AND_SIZE(test_resp_wrong_length));
+            }
+            test_ext_len_add_resp(test_target,
+                TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_short_1),
+                file + 0x100, 0x100);
+            test_ext_len_add_resp(test_target,
+                TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_short_2),
+                file + 0x200, sizeof(file) - 0x200);
+        }
+    }
+
+    memset(&iso_dep_poll_a, 0, sizeof(iso_dep_poll_a));
+    iso_dep_poll_a.fsc = 64;
+    iso_dep_poll_a.t1 = test->hb;
+    t4a = NFC_TAG_T4(nfc_tag_t4a_new(target, NULL, &iso_dep_poll_a));
+    g_assert(NFC_IS_TAG_T4A(t4a));
+    tag = &t4a->tag;
+
+    id = nfc_tag_add_initialized_handler(tag, test_tag_quit_loop_cb, loop);
+    test_run(&test_opt, loop);
+    nfc_tag_remove_handler(tag, id);
+
+    g_assert(tag->flags & NFC_TAG_FLAG_INITIALIZED);
+    g_assert(tag->ndef);
+    g_assert_cmpuint(test_target->cmd_resp->len, == ,0);
+
+    nfc_tag_unref(tag);
+    nfc_target_unref(target);
+    g_main_loop_unref(loop);
+}
+
+/*==========================================================================*
+ * reactivate
+ *==========================================================================*/
+
+static const guint8 test_hb_prefix_1[] = { 0x80, 0x73 };
+static const guint8 test_hb_prefix_2[] = { 0x80, 0x31 };
+
+typedef struct test_reactivate_data {
+    const char* name;
+    GUtilData rule1;
+    NFC_TAG_T4_REACTIVATE policy1;
+    GUtilData rule2;
+    NFC_TAG_T4_REACTIVATE policy2;
+    gboolean can_reactivate;
+    int reactivate_count;
+} TestReactivateData;
+
+static const TestReactivateData reactivate_tests[] = {
+    {
+        "never_all",
+        { NULL, 0 }, NFC_TAG_T4_REACTIVATE_NEVER,
+        { NULL, 0 }, NFC_TAG_T4_REACTIVATE_NEVER,
+        FALSE, 0
+    },{
+        "never_hb",
+        { TEST_ARRAY_AND_SIZE(test_hb_prefix_1) },
+        NFC_TAG_T4_REACTIVATE_NEVER,
+        { NULL, 0 }, NFC_TAG_T4_REACTIVATE_ALWAYS,
+        TRUE, 0
+    },{
+        "other_hb",
+        { TEST_ARRAY_AND_SIZE(test_hb_prefix_2) },
+        NFC_TAG_T4_REACTIVATE_NEVER,
+        { TEST_ARRAY_AND_SIZE(test_hb_ext) },
+        NFC_TAG_T4_REACTIVATE_NEVER,
+        TRUE, 1
+    },{
+        "first_match",
+        { TEST_ARRAY_AND_SIZE(test_hb_prefix_1) },
+        NFC_TAG_T4_REACTIVATE_ALWAYS,
+        { NULL, 0 }, NFC_TAG_T4_REACTIVATE_NEVER,
+        TRUE, 1
+    }
+};
+
+static
+void
+test_reactivate(
+    gconstpointer test_data)
+{
+    const TestReactivateData* test = test_data;
+    NfcTarget* target = g_object_new(test->can_reactivate ?
+        TEST_TYPE_TARGET2 : TEST_TYPE_TARGET, NULL);
+    TestTarget* test_target = TEST_TARGET(target);
+    NfcParamIsoDepPollA iso_dep_poll_a;
+    NfcTagType4* t4a;
+    NfcTag* tag;
+    guint i;
+
+    nfc_tag_t4_add_reactivate_rule(&test->rule1, test->policy1);
+    nfc_tag_t4_add_reactivate_rule(&test->rule2, test->policy2);
+    for (i = 0; i < G_N_ELEMENTS(test_init_data_success_sfi); i++) {
+        g_ptr_array_add(test_target->cmd_resp,
+            test_clone_data(test_init_data_success_sfi + i));
+    }
+
+    memset(&iso_dep_poll_a, 0, sizeof(iso_dep_poll_a));
+    iso_dep_poll_a.fsc = 256;
+    iso_dep_poll_a.t1.bytes = test_hb_short;
+    iso_dep_poll_a.t1.size = sizeof(test_hb_short);
+    t4a = NFC_TAG_T4(nfc_tag_t4a_new(target, NULL, &iso_dep_poll_a));
+    g_assert(NFC_IS_TAG_T4A(t4a));
+    tag = &t4a->tag;
+    nfc_tag_t4_clear_reactivate_rules();
+
+    /* NDEF is read in any case */
+    if (!(tag->flags & NFC_TAG_FLAG_INITIALIZED)) {
+        GMainLoop* loop = g_main_loop_new(NULL, TRUE);
+        const gulong id = nfc_tag_add_initialized_handler(tag,
+            test_tag_quit_loop_cb, loop);
+
+        test_run(&test_opt, loop);
+        nfc_tag_remove_handler(tag, id);
+        g_main_loop_unref(loop);
+    }
+    g_assert(tag->flags & NFC_TAG_FLAG_INITIALIZED);
+    g_assert(tag->ndef);
+    g_assert_cmpuint(test_target->cmd_resp->len, == ,0);
+    if (test->can_reactivate) {
+        g_assert_cmpint(TEST_TARGET2(target)->reactivate_count, == ,
+            test->reactivate_count);
+    }
 
     nfc_tag_unref(tag);
     nfc_target_unref(target);
@@ -890,11 +1374,11 @@ static const guint8 read_256_expected[] = {
 };
 
 static const guint8 read_257_expected[] = {
-    0x00, 0xb0, 0x00, 0x00, 0x01, 0x01
+    0x00, 0xb0, 0x00, 0x00, 0x00, 0x01, 0x01
 };
 
 static const guint8 read_65536_expected[] = {
-    0x00, 0xb0, 0x00, 0x00, 0x00, 0x00
+    0x00, 0xb0, 0x00, 0x00, 0x00, 0x00, 0x00
 };
 
 static const TestApduData apdu_tests[] = {
@@ -1001,6 +1485,33 @@ test_apdu_fail_done(
     g_main_loop_quit(user_data);
 }
 
+static
+void
+test_apdu_fail_bytes_done(
+    NfcTagType4* tag,
+    guint sw,  /* 16 bits (SW1 << 8)|SW2 */
+    GBytes* data,
+    void* user_data)
+{
+    g_assert(sw == ISO_SW_IO_ERR);
+    g_assert(!data);
+    g_main_loop_quit(user_data);
+}
+
+static
+void
+test_apdu_ok_bytes_done(
+    NfcTagType4* tag,
+    guint sw,  /* 16 bits (SW1 << 8)|SW2 */
+    GBytes* data,
+    void* user_data)
+{
+    g_assert(sw == ISO_SW_OK);
+    g_assert(data);
+    g_assert(!g_bytes_get_size(data));
+    g_main_loop_quit(user_data);
+}
+
 static
 void
 test_apdu_fail(
@@ -1057,11 +1568,567 @@ test_apdu_fail(
         NULL, test_apdu_fail_done, NULL, loop));
     test_run(&test_opt, loop);
 
+    /* Same thing with GBytes response */
+    g_assert(!nfc_isodep_transmit_bytes(t4b, 0x00, 0xb0, 0x00, 0x00, NULL,
+        0x100, NULL, NULL, NULL, NULL)); /* Callback is required */
+    g_assert(nfc_isodep_transmit_bytes(t4b, 0x00, 0xb0, 0x00, 0x00, NULL,
+        0x100, NULL, test_apdu_fail_bytes_done, NULL, loop));
+    test_run(&test_opt, loop);
+    test_target_add_cmd(TEST_TARGET(tag->target),
+        TEST_ARRAY_AND_SIZE(select_mf_expected), &zero, 1);
+    g_assert(nfc_isodep_transmit_bytes(t4b, 0x00, 0xa4, 0x00, 0x00, NULL, 0,
+        NULL, test_apdu_fail_bytes_done, NULL, loop));
+    test_run(&test_opt, loop);
+    test_target_add_cmd(TEST_TARGET(tag->target),
+        TEST_ARRAY_AND_SIZE(select_mf_expected),
+        TEST_ARRAY_AND_SIZE(test_resp_ok));
+    g_assert(nfc_isodep_transmit_bytes(t4b, 0x00, 0xa4, 0x00, 0x00, NULL, 0,
+        NULL, test_apdu_ok_bytes_done, NULL, loop));
+    test_run(&test_opt, loop);
+
     nfc_tag_unref(tag);
     nfc_target_unref(target);
     g_main_loop_unref(loop);
 }
 
+/*==========================================================================*
+ * write_ndef
+ *==========================================================================*/
+
+static const guint8 test_resp_read_ndef_cc_rw[] = {
+    0x00, 0x0f, 0x20, 0x00, 0x3b, 0x00, 0x34, /* Data */
+    0x04, 0x06, 0xe1, 0x04, 0x0f, 0xff, 0x00,
+    0x00,
+    /* ^ write access granted                */
+    0x90, 0x00                                /* SW1|SW2 */
+};
+static const guint8 test_resp_read_ndef_cc_rw_small[] = {
+    0x00, 0x0f, 0x20, 0x00, 0x3b, 0x00, 0x34, /* Data */
+    0x04, 0x06, 0xe1, 0x04, 0x00, 0x04, 0x00,
+    /*                      ^^^^^^^^^^ 4 bytes */
+    0x00,
+    0x90, 0x00                                /* SW1|SW2 */
+};
+static const guint8 test_resp_read_ndef_cc_rw_no_mlc[] = {
+    0x00, 0x0f, 0x20, 0x00, 0x3b, 0x00, 0x00, /* Data */
+    /*                            ^^^^^^^^^^ MLc */
+    0x04, 0x06, 0xe1, 0x04, 0x0f, 0xff, 0x00,
+    0x00,
+    0x90, 0x00                                /* SW1|SW2 */
+};
+static const guint8 test_cmd_write_ndef_nlen_zero[] = {
+    0x00, 0xd6, 0x00, 0x00, 0x02,             /* CLA|INS|P1|P2|Lc  */
+    0x00, 0x00                                /* Data */
+};
+
+static const GUtilData test_write_ndef_not_found[] = {
+    { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_app) },
+    { TEST_ARRAY_AND_SIZE(test_resp_not_found) }
+};
+static const GUtilData test_write_ndef_select_cc_err[] = {
+    { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_app) },
+    { TEST_ARRAY_AND_SIZE(test_resp_ok) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_cc) },
+    { TEST_ARRAY_AND_SIZE(test_resp_err) }
+};
+static const GUtilData test_write_ndef_read_only[] = {
+    { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_app) },
+    { TEST_ARRAY_AND_SIZE(test_resp_ok) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_cc) },
+    { TEST_ARRAY_AND_SIZE(test_resp_ok) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc) },
+    { TEST_ARRAY_AND_SIZE(test_resp_read_ndef_cc) }
+};
+static const GUtilData test_write_ndef_invalid_cc[] = {
+    { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_app) },
+    { TEST_ARRAY_AND_SIZE(test_resp_ok) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_cc) },
+    { TEST_ARRAY_AND_SIZE(test_resp_ok) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc) },
+    { TEST_ARRAY_AND_SIZE(test_resp_read_ndef_cc_invalid_t) }
+};
+static const GUtilData test_write_ndef_no_mlc[] = {
+    { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_app) },
+    { TEST_ARRAY_AND_SIZE(test_resp_ok) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_cc) },
+    { TEST_ARRAY_AND_SIZE(test_resp_ok) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc) },
+    { TEST_ARRAY_AND_SIZE(test_resp_read_ndef_cc_rw_no_mlc) }
+};
+static const GUtilData test_write_ndef_too_big[] = {
+    { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_app) },
+    { TEST_ARRAY_AND_SIZE(test_resp_ok) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_cc) },
+    { TEST_ARRAY_AND_SIZE(test_resp_ok) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc) },
+    { TEST_ARRAY_AND_SIZE(test_resp_read_ndef_cc_rw_small) }
+};
+static const GUtilData test_write_ndef_select_ef_err[] = {
+    { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_app) },
+    { TEST_ARRAY_AND_SIZE(test_resp_ok) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_cc) },
+    { TEST_ARRAY_AND_SIZE(test_resp_ok) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc) },
+    { TEST_ARRAY_AND_SIZE(test_resp_read_ndef_cc_rw) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_ef) },
+    { TEST_ARRAY_AND_SIZE(test_resp_not_found) }
+};
+static const GUtilData test_write_ndef_clear_err[] = {
+    { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_app) },
+    { TEST_ARRAY_AND_SIZE(test_resp_ok) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_cc) },
+    { TEST_ARRAY_AND_SIZE(test_resp_ok) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc) },
+    { TEST_ARRAY_AND_SIZE(test_resp_read_ndef_cc_rw) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_ef) },
+    { TEST_ARRAY_AND_SIZE(test_resp_ok) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_write_ndef_nlen_zero) },
+    { TEST_ARRAY_AND_SIZE(test_resp_err) }
+};
+
+typedef struct test_write_ndef_data {
+    const char* name;
+    const GUtilData* cmd_resp;
+    gsize count;
+    int fail_transmit;
+    NFC_TAG_T4_IO_STATUS status;
+} TestWriteNdefData;
+
+static const TestWriteNdefData write_ndef_fail_tests[] = {
+    {
+        "not_found",
+        TEST_ARRAY_AND_COUNT(test_write_ndef_not_found), 0,
+        NFC_TAG_T4_IO_STATUS_NOT_NDEF
+    },{
+        "select_cc_err",
+        TEST_ARRAY_AND_COUNT(test_write_ndef_select_cc_err), 0,
+        NFC_TAG_T4_IO_STATUS_FAILURE
+    },{
+        "read_only",
+        TEST_ARRAY_AND_COUNT(test_write_ndef_read_only), 0,
+        NFC_TAG_T4_IO_STATUS_READ_ONLY
+    },{
+        "invalid_cc",
+        TEST_ARRAY_AND_COUNT(test_write_ndef_invalid_cc), 0,
+        NFC_TAG_T4_IO_STATUS_NOT_NDEF
+    },{
+        "no_mlc",
+        TEST_ARRAY_AND_COUNT(test_write_ndef_no_mlc), 0,
+        NFC_TAG_T4_IO_STATUS_NOT_NDEF
+    },{
+        "too_big",
+        TEST_ARRAY_AND_COUNT(test_write_ndef_too_big), 0,
+        NFC_TAG_T4_IO_STATUS_BAD_SIZE
+    },{
+        "select_ef_err",
+        TEST_ARRAY_AND_COUNT(test_write_ndef_select_ef_err), 0,
+        NFC_TAG_T4_IO_STATUS_NOT_NDEF
+    },{
+        "clear_err",
+        TEST_ARRAY_AND_COUNT(test_write_ndef_clear_err), 0,
+        NFC_TAG_T4_IO_STATUS_FAILURE
+    },{
+        "transmit_err",
+        TEST_ARRAY_AND_COUNT(test_write_ndef_select_ef_err), 4,
+        NFC_TAG_T4_IO_STATUS_IO_ERROR
+    }
+};
+
+typedef struct test_write_ndef {
+    GMainLoop* loop;
+    NFC_TAG_T4_IO_STATUS status;
+    gboolean completed;
+    gboolean destroyed;
+} TestWriteNdef;
+
+static
+void
+test_write_ndef_done(
+    NfcTagType4* tag,
+    NFC_TAG_T4_IO_STATUS status,
+    void* user_data)
+{
+    TestWriteNdef* test = user_data;
+
+    g_assert(!test->completed);
+    test->completed = TRUE;
+    test->status = status;
+}
+
+static
+void
+test_write_ndef_destroy(
+    void* user_data)
+{
+    TestWriteNdef* test = user_data;
+
+    g_assert(!test->destroyed);
+    test->destroyed = TRUE;
+    g_main_loop_quit(test->loop);
+}
+
+static
+NfcTagType4*
+test_write_ndef_tag(
+    NfcTarget* target)
+{
+    NfcParamPollB poll_b;
+    NfcTagType4* t4b;
+
+    memset(&poll_b, 0, sizeof(poll_b));
+    poll_b.fsc = 0x0b; /* i.e. 256 */
+    t4b = NFC_TAG_T4(nfc_tag_t4b_new(target, &poll_b, NULL));
+    g_assert(NFC_IS_TAG_T4B(t4b));
+
+    /* Target doesn't support reactivation, tag gets initialized right away */
+    g_assert(t4b->tag.flags & NFC_TAG_FLAG_INITIALIZED);
+    return t4b;
+}
+
+static
+void
+test_write_ndef_add_update(
+    TestTarget* target,
+    guint offset,
+    const guint8* data,
+    guint len)
+{
+    guint8* cmd = g_malloc(len + 5);
+
+    cmd[0] = 0x00;
+    cmd[1] = 0xd6;
+    cmd[2] = (guint8)(offset >> 8);
+    cmd[3] = (guint8)offset;
+    cmd[4] = (guint8)len;
+    memcpy(cmd + 5, data, len);
+    test_target_add_cmd(target, cmd, len + 5,
+        TEST_ARRAY_AND_SIZE(test_resp_ok));
+    g_free(cmd);
+}
+
+static
+void
+test_write_ndef(
+    void)
+{
+    NfcTarget* target = g_object_new(TEST_TYPE_TARGET, NULL);
+    TestTarget* test_target = TEST_TARGET(target);
+    NfcTagType4* t4b = test_write_ndef_tag(target);
+    guint8 ndef[0x60];
+    guint8 nlen[2];
+    GBytes* bytes;
+    TestWriteNdef test;
+    guint i;
+
+    memset(&test, 0, sizeof(test));
+    test.loop = g_main_loop_new(NULL, TRUE);
+    for (i = 0; i < sizeof(ndef); i++) {
+        ndef[i] = (guint8)i;
+    }
+
+    /* MLc is 0x34, the data get written in two chunks */
+    test_target_add_cmd(test_target,
+        TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_app),
+        TEST_ARRAY_AND_SIZE(test_resp_ok));
+    test_target_add_cmd(test_target,
+        TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_cc),
+        TEST_ARRAY_AND_SIZE(test_resp_ok));
+    test_target_add_cmd(test_target,
+        TEST_ARRAY_AND_SIZE(test_cmd_read_ndef_cc),
+        TEST_ARRAY_AND_SIZE(test_resp_read_ndef_cc_rw));
+    test_target_add_cmd(test_target,
+        TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_ef),
+        TEST_ARRAY_AND_SIZE(test_resp_ok));
+    test_target_add_cmd(test_target,
+        TEST_ARRAY_AND_SIZE(test_cmd_write_ndef_nlen_zero),
+        TEST_ARRAY_AND_SIZE(test_resp_ok));
+    test_write_ndef_add_update(test_target, 2, ndef, 0x34);
+    test_write_ndef_add_update(test_target, 2 + 0x34, ndef + 0x34,
+        sizeof(ndef) - 0x34);
+    nlen[0] = 0;
+    nlen[1] = sizeof(ndef);
+    test_write_ndef_add_update(test_target, 0, nlen, sizeof(nlen));
+
+    bytes = g_bytes_new(ndef, sizeof(ndef));
+    g_assert(nfc_tag_t4_write_ndef(t4b, bytes, NULL, test_write_ndef_done,
+        test_write_ndef_destroy, &test));
+    test_run(&test_opt, test.loop);
+    g_assert(test.completed);
+    g_assert(test.destroyed);
+    g_assert_cmpint(test.status, == ,NFC_TAG_T4_IO_STATUS_OK);
+    g_assert_cmpuint(test_target->cmd_resp->len, == ,0);
+
+    /* Pending write is cancelled when the tag is destroyed */
+    test.completed = test.destroyed = FALSE;
+    test_target_add_cmd(test_target,
+        TEST_ARRAY_AND_SIZE(test_cmd_select_ndef_app),
+        TEST_ARRAY_AND_SIZE(test_resp_ok));
+    g_assert(nfc_tag_t4_write_ndef(t4b, bytes, NULL, test_write_ndef_done,
+        test_write_ndef_destroy, &test));
+    nfc_tag_unref(&t4b->tag);
+    g_assert(!test.completed);
+    g_assert(test.destroyed);
+
+    g_bytes_unref(bytes);
+    nfc_target_unref(target);
+    g_main_loop_unref(test.loop);
+}
+
+static
+void
+test_write_ndef_fail(
+    gconstpointer test_data)
+{
+    const TestWriteNdefData* data = test_data;
+    NfcTarget* target = g_object_new(TEST_TYPE_TARGET, NULL);
+    TestTarget* test_target = TEST_TARGET(target);
+    NfcTagType4* t4b = test_write_ndef_tag(target);
+    static const guint8 ndef[] = { 0xd0, 0x00, 0x00 };
+    GBytes* bytes = g_bytes_new_static(ndef, sizeof(ndef));
+    TestWriteNdef test;
+    guint i;
+
+    memset(&test, 0, sizeof(test));
+    test.loop = g_main_loop_new(NULL, TRUE);
+    for (i = 0; i < data->count; i++) {
+        g_ptr_array_add(test_target->cmd_resp,
+            test_clone_data(data->cmd_resp + i));
+    }
+    test_target->fail_transmit = data->fail_transmit;
+
+    g_assert(nfc_tag_t4_write_ndef(t4b, bytes, NULL, test_write_ndef_done,
+        test_write_ndef_destroy, &test));
+    test_run(&test_opt, test.loop);
+    g_assert(test.completed);
+    g_assert(test.destroyed);
+    g_assert_cmpint(test.status, == ,data->status);
+
+    g_bytes_unref(bytes);
+    nfc_tag_unref(&t4b->tag);
+    nfc_target_unref(target);
+    g_main_loop_unref(test.loop);
+}
+
+/*==========================================================================*
+ * transmit_chain
+ *==========================================================================*/
+
+static const guint8 test_cmd_chain[] = { 0x80, 0xca, 0x9f, 0x7f, 0x00 };
+static const guint8 test_cmd_chain_le_2[] = { 0x80, 0xca, 0x9f, 0x7f, 0x02 };
+static const guint8 test_cmd_chain_le_4[] = { 0x80, 0xca, 0x9f, 0x7f, 0x04 };
+static const guint8 test_cmd_get_resp_0[] = { 0x80, 0xc0, 0x00, 0x00, 0x00 };
+static const guint8 test_cmd_get_resp_2[] = { 0x80, 0xc0, 0x00, 0x00, 0x02 };
+static const guint8 test_cmd_get_resp_3[] = { 0x80, 0xc0, 0x00, 0x00, 0x03 };
+static const guint8 test_resp_chain_more_0[] = { 0x01, 0x02, 0x61, 0x00 };
+static const guint8 test_resp_chain_more_3[] = { 0x01, 0x02, 0x61, 0x03 };
+static const guint8 test_resp_chain_more_2[] = { 0x61, 0x02 };
+static const guint8 test_resp_chain_le_2[] = { 0x6c, 0x02 };
+static const guint8 test_resp_chain_le_4[] = { 0x6c, 0x04 };
+static const guint8 test_resp_chain_le_5[] = { 0x6c, 0x05 };
+static const guint8 test_resp_chain_1[] = { 0x03, 0x90, 0x00 };
+static const guint8 test_resp_chain_3[] = { 0x03, 0x04, 0x05, 0x90, 0x00 };
+static const guint8 test_resp_chain_4[] = {
+    0x01, 0x02, 0x03, 0x04, 0x90, 0x00
+};
+static const guint8 test_chain_data_3[] = { 0x01, 0x02, 0x03 };
+static const guint8 test_chain_data_4[] = { 0x01, 0x02, 0x03, 0x04 };
+static const guint8 test_chain_data_5[] = { 0x01, 0x02, 0x03, 0x04, 0x05 };
+
+static const GUtilData test_chain_ok[] = {
+    { TEST_ARRAY_AND_SIZE(test_cmd_chain) },
+    { TEST_ARRAY_AND_SIZE(test_resp_chain_4) }
+};
+static const GUtilData test_chain_more_data[] = {
+    { TEST_ARRAY_AND_SIZE(test_cmd_chain) },
+    { TEST_ARRAY_AND_SIZE(test_resp_chain_more_3) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_get_resp_3) },
+    { TEST_ARRAY_AND_SIZE(test_resp_chain_3) }
+};
+static const GUtilData test_chain_more_data_empty[] = {
+    { TEST_ARRAY_AND_SIZE(test_cmd_chain) },
+    { TEST_ARRAY_AND_SIZE(test_resp_chain_more_2) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_get_resp_2) },
+    { TEST_ARRAY_AND_SIZE(test_resp_chain_more_2) }
+};
+static const GUtilData test_chain_more_data_io_err[] = {
+    { TEST_ARRAY_AND_SIZE(test_cmd_chain) },
+    { TEST_ARRAY_AND_SIZE(test_resp_chain_more_3) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_get_resp_3) }
+};
+static const GUtilData test_chain_wrong_le[] = {
+    { TEST_ARRAY_AND_SIZE(test_cmd_chain) },
+    { TEST_ARRAY_AND_SIZE(test_resp_chain_le_4) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_chain_le_4) },
+    { TEST_ARRAY_AND_SIZE(test_resp_chain_4) }
+};
+static const GUtilData test_chain_wrong_le_twice[] = {
+    { TEST_ARRAY_AND_SIZE(test_cmd_chain) },
+    { TEST_ARRAY_AND_SIZE(test_resp_chain_le_4) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_chain_le_4) },
+    { TEST_ARRAY_AND_SIZE(test_resp_chain_le_5) }
+};
+static const GUtilData test_chain_wrong_le_more_data[] = {
+    { TEST_ARRAY_AND_SIZE(test_cmd_chain) },
+    { TEST_ARRAY_AND_SIZE(test_resp_chain_le_2) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_chain_le_2) },
+    { TEST_ARRAY_AND_SIZE(test_resp_chain_more_0) },
+    { TEST_ARRAY_AND_SIZE(test_cmd_get_resp_0) },
+    { TEST_ARRAY_AND_SIZE(test_resp_chain_1) }
+};
+
+typedef struct test_transmit_chain_data {
+    const char* name;
+    const GUtilData* cmd_resp;
+    gsize count;
+    guint max_len;
+    guint sw;
+    GUtilData resp;
+} TestTransmitChainData;
+
+static const TestTransmitChainData transmit_chain_tests[] = {
+    {
+        "ok", TEST_ARRAY_AND_COUNT(test_chain_ok), 0,
+        ISO_SW_OK, { TEST_ARRAY_AND_SIZE(test_chain_data_4) }
+    },{
+        "more_data", TEST_ARRAY_AND_COUNT(test_chain_more_data), 0,
+        ISO_SW_OK, { TEST_ARRAY_AND_SIZE(test_chain_data_5) }
+    },{
+        "more_data_max_len", TEST_ARRAY_AND_COUNT(test_chain_more_data), 5,
+        ISO_SW_OK, { TEST_ARRAY_AND_SIZE(test_chain_data_5) }
+    },{
+        "more_data_too_long", TEST_ARRAY_AND_COUNT(test_chain_more_data), 4,
+        ISO_SW_IO_ERR, { NULL, 0 }
+    },{
+        "more_data_empty", TEST_ARRAY_AND_COUNT(test_chain_more_data_empty), 0,
+        0x6102, { NULL, 0 }
+    },{
+        "more_data_io_err", TEST_ARRAY_AND_COUNT(test_chain_more_data_io_err),
+        0, ISO_SW_IO_ERR, { NULL, 0 }
+    },{
+        "wrong_le", TEST_ARRAY_AND_COUNT(test_chain_wrong_le), 0,
+        ISO_SW_OK, { TEST_ARRAY_AND_SIZE(test_chain_data_4) }
+    },{
+        "wrong_le_twice", TEST_ARRAY_AND_COUNT(test_chain_wrong_le_twice), 0,
+        0x6c05, { NULL, 0 }
+    },{
+        "wrong_le_more_data",
+        TEST_ARRAY_AND_COUNT(test_chain_wrong_le_more_data), 0,
+        ISO_SW_OK, { TEST_ARRAY_AND_SIZE(test_chain_data_3) }
+    }
+};
+
+typedef struct test_transmit_chain {
+    const TestTransmitChainData* data;
+    GMainLoop* loop;
+    gboolean completed;
+    gboolean destroyed;
+} TestTransmitChain;
+
+static
+void
+test_transmit_chain_done(
+    NfcTagType4* tag,
+    guint sw,  /* 16 bits (SW1 << 8)|SW2 */
+    GBytes* resp,
+    void* user_data)
+{
+    TestTransmitChain* test = user_data;
+    const TestTransmitChainData* data = test->data;
+
+    g_assert(!test->completed);
+    test->completed = TRUE;
+    g_assert_cmpuint(sw, == ,data->sw);
+    if (sw == ISO_SW_IO_ERR) {
+        g_assert(!resp);
+    } else {
+        gsize len;
+        const void* bytes = g_bytes_get_data(resp, &len);
+
+        g_assert_cmpuint(len, == ,data->resp.size);
+        g_assert(!len || !memcmp(bytes, data->resp.bytes, len));
+    }
+}
+
+static
+void
+test_transmit_chain_destroy(
+    void* user_data)
+{
+    TestTransmitChain* test = user_data;
+
+    g_assert(!test->destroyed);
+    test->destroyed = TRUE;
+    g_main_loop_quit(test->loop);
+}
+
+static
+void
+test_transmit_chain(
+    gconstpointer test_data)
+{
+    const TestTransmitChainData* data = test_data;
+    NfcTarget* target = g_object_new(TEST_TYPE_TARGET, NULL);
+    TestTarget* test_target = TEST_TARGET(target);
+    NfcTagType4* t4b = test_write_ndef_tag(target);
+    TestTransmitChain test;
+    guint i;
+
+    memset(&test, 0, sizeof(test));
+    test.data = data;
+    test.loop = g_main_loop_new(NULL, TRUE);
+    for (i = 0; i < data->count; i++) {
+        g_ptr_array_add(test_target->cmd_resp,
+            test_clone_data(data->cmd_resp + i));
+    }
+
+    g_assert(nfc_isodep_transmit_chain(t4b, 0x80, 0xca, 0x9f, 0x7f, NULL,
+        0x100, NULL, data->max_len, test_transmit_chain_done,
+        test_transmit_chain_destroy, &test));
+    test_run(&test_opt, test.loop);
+    g_assert(test.completed);
+    g_assert(test.destroyed);
+    g_assert_cmpuint(test_target->cmd_resp->len, == ,0);
+
+    nfc_tag_unref(&t4b->tag);
+    nfc_target_unref(target);
+    g_main_loop_unref(test.loop);
+}
+
+static
+void
+test_transmit_chain_cancel(
+    void)
+{
+    NfcTarget* target = g_object_new(TEST_TYPE_TARGET, NULL);
+    TestTarget* test_target = TEST_TARGET(target);
+    NfcTagType4* t4b = test_write_ndef_tag(target);
+    TestTransmitChain test;
+
+    memset(&test, 0, sizeof(test));
+    test.loop = g_main_loop_new(NULL, TRUE);
+
+    /* Submit failure */
+    test_target->fail_transmit = 1;
+    g_assert(!nfc_isodep_transmit_chain(t4b, 0x80, 0xca, 0x9f, 0x7f, NULL,
+        0x100, NULL, 0, test_transmit_chain_done,
+        test_transmit_chain_destroy, &test));
+    g_assert(!test.completed);
+    g_assert(!test.destroyed);
+
+    /* Pending transfer is cancelled when the tag is destroyed */
+    test_target_add_cmd(test_target, TEST_ARRAY_AND_SIZE(test_cmd_chain),
+        TEST_ARRAY_AND_SIZE(test_resp_chain_more_3));
+    g_assert(nfc_isodep_transmit_chain(t4b, 0x80, 0xca, 0x9f, 0x7f, NULL,
+        0x100, NULL, 0, test_transmit_chain_done,
+        test_transmit_chain_destroy, &test));
+    nfc_tag_unref(&t4b->tag);
+    g_assert(!test.completed);
+    g_assert(test.destroyed);
+
+    nfc_target_unref(target);
+    g_main_loop_unref(test.loop);
+}
+
 /*==========================================================================*
  * Common
  *==========================================================================*/
@@ -1085,6 +2152,20 @@ int main(int argc, char* argv[])
         g_test_add_data_func(path, test, test_init_seq);
         g_free(path);
     }
+    for (i = 0; i < G_N_ELEMENTS(ext_len_tests); i++) {
+        const TestExtLenData* test = ext_len_tests + i;
+        char* path = g_strconcat(TEST_("ext_len/"), test->name, NULL);
+
+        g_test_add_data_func(path, test, test_ext_len);
+        g_free(path);
+    }
+    for (i = 0; i < G_N_ELEMENTS(reactivate_tests); i++) {
+        const TestReactivateData* test = reactivate_tests + i;
+        char* path = g_strconcat(TEST_("reactivate/"), test->name, NULL);
+
+        g_test_add_data_func(path, test, test_reactivate);
+        g_free(path);
+    }
     for (i = 0; i < G_N_ELEMENTS(apdu_tests); i++) {
         const TestApduData* test = apdu_tests + i;
         char* path = g_strconcat(TEST_("apdu_ok/"), test->name, NULL);
@@ -1093,6 +2174,23 @@ int main(int argc, char* argv[])
         g_free(path);
     }
     g_test_add_func(TEST_("apdu_fail"), test_apdu_fail);
+    g_test_add_func(TEST_("write_ndef/ok"), test_write_ndef);
+    for (i = 0; i < G_N_ELEMENTS(write_ndef_fail_tests); i++) {
+        const TestWriteNdefData* test = write_ndef_fail_tests + i;
+        char* path = g_strconcat(TEST_("write_ndef/"), test->name, NULL);
+
+        g_test_add_data_func(path, test, test_write_ndef_fail);
+        g_free(path);
+    }
+    for (i = 0; i < G_N_ELEMENTS(transmit_chain_tests); i++) {
+        const TestTransmitChainData* test = transmit_chain_tests + i;
+        char* path = g_strconcat(TEST_("transmit_chain/"), test->name, NULL);
+
+        g_test_add_data_func(path, test, test_transmit_chain);
+        g_free(path);
+    }
+    g_test_add_func(TEST_("transmit_chain/cancel"),
+        test_transmit_chain_cancel);
     test_init(&test_opt, argc, argv);
     return g_test_run();
 }
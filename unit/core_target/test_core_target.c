@@ -180,6 +180,8 @@ typedef struct test_target {
     NfcTarget target;
     gboolean deactivated;
     gboolean fail_transmit;
+    gboolean drop_transmit;
+    guint transmit_delay_ms;
     guint transmit_id;
     GSList* transmit_responses;
     guint succeeded;
@@ -234,9 +236,14 @@ test_target_transmit(
         /* Base class fails the call */
         return NFC_TARGET_CLASS(test_target_parent_class)->transmit
             (target, data, len);
+    } else if (self->drop_transmit) {
+        /* Pretend that the frame has been sent but never respond */
+        return TRUE;
     } else {
         g_assert(!self->transmit_id);
-        self->transmit_id = g_idle_add(test_target_transmit_cb, self);
+        self->transmit_id = self->transmit_delay_ms ?
+            g_timeout_add(self->transmit_delay_ms, test_target_transmit_cb,
+                self) : g_idle_add(test_target_transmit_cb, self);
         return TRUE;
     }
 }
@@ -383,150 +390,1355 @@ test_target2_class_init(
     klass->reactivate = test_target2_reactivate;
 }
 
-/*==========================================================================*
- * null
- *==========================================================================*/
+/*==========================================================================*
+ * Test target with transmit_bytes (echoes the data back)
+ *==========================================================================*/
+
+typedef TestTargetClass TestTarget3Class;
+typedef struct test_target3 {
+    TestTarget parent;
+    GBytes* echo;
+    guint echo_id;
+    guint transmitted;
+} TestTarget3;
+
+G_DEFINE_TYPE(TestTarget3, test_target3, TEST_TYPE_TARGET)
+#define TEST_TYPE_TARGET3 (test_target3_get_type())
+#define TEST_TARGET3(obj) (G_TYPE_CHECK_INSTANCE_CAST(obj, \
+        TEST_TYPE_TARGET3, TestTarget3))
+
+static
+TestTarget3*
+test_target3_new(
+    void)
+{
+    return g_object_new(TEST_TYPE_TARGET3, NULL);
+}
+
+static
+gboolean
+test_target3_echo(
+    gpointer user_data)
+{
+    TestTarget3* test = TEST_TARGET3(user_data);
+    GBytes* echo = test->echo;
+
+    test->echo = NULL;
+    test->echo_id = 0;
+    nfc_target_transmit_done_bytes(NFC_TARGET(test),
+        NFC_TRANSMIT_STATUS_OK, echo);
+    g_bytes_unref(echo);
+    return G_SOURCE_REMOVE;
+}
+
+static
+gboolean
+test_target3_transmit_bytes(
+    NfcTarget* target,
+    GBytes* data)
+{
+    TestTarget3* test = TEST_TARGET3(target);
+
+    g_assert(!test->echo_id);
+    test->echo = g_bytes_ref(data);
+    test->echo_id = g_idle_add(test_target3_echo, test);
+    test->transmitted++;
+    return TRUE;
+}
+
+static
+void
+test_target3_init(
+    TestTarget3* self)
+{
+}
+
+static
+void
+test_target3_finalize(
+    GObject* object)
+{
+    TestTarget3* test = TEST_TARGET3(object);
+
+    if (test->echo_id) {
+        g_source_remove(test->echo_id);
+    }
+    if (test->echo) {
+        g_bytes_unref(test->echo);
+    }
+    G_OBJECT_CLASS(test_target3_parent_class)->finalize(object);
+}
+
+static
+void
+test_target3_class_init(
+    NfcTargetClass* klass)
+{
+    G_OBJECT_CLASS(klass)->finalize = test_target3_finalize;
+    klass->transmit_bytes = test_target3_transmit_bytes;
+}
+
+/*==========================================================================*
+ * null
+ *==========================================================================*/
+
+static
+void
+test_null(
+    void)
+{
+    /* Public interfaces are NULL tolerant */
+    g_assert(!nfc_target_ref(NULL));
+    g_assert(!nfc_target_transmit(NULL, NULL, 0, NULL, NULL, NULL, NULL));
+    g_assert(!nfc_target_transmit_bytes(NULL, NULL, NULL, NULL, NULL, NULL));
+    g_assert(!nfc_target_transmit_with_deadline(NULL, NULL, 0, NULL, 0,
+        NULL, NULL, NULL));
+    g_assert(!nfc_target_set_transmit_deadline(NULL, 0, 0));
+    g_assert(!nfc_target_transmit_with_retry(NULL, NULL, 0, NULL, NULL,
+        NULL, NULL, NULL));
+    g_assert(!nfc_target_transmit_full(NULL, NULL, 0, NULL, NULL,
+        NULL, NULL, NULL));
+    g_assert(!nfc_target_transmit_bytes_full(NULL, NULL, NULL, NULL,
+        NULL, NULL, NULL));
+    g_assert(!nfc_target_transmit_batch_full(NULL, NULL, 0, NULL, NULL,
+        NULL, NULL, NULL));
+    g_assert(!nfc_target_pool_allocs(NULL));
+    nfc_target_pool_free(NULL, 0, NULL);
+    g_assert(!nfc_target_add_gone_handler(NULL, NULL, NULL));
+    g_assert(!nfc_target_add_sequence_handler(NULL, NULL, NULL));
+    nfc_target_deactivate(NULL);
+    g_assert(!nfc_target_can_reactivate(NULL));
+    g_assert(!nfc_target_reactivate(NULL, NULL, NULL));
+    nfc_target_set_reactivate_timeout(NULL, 0);
+    nfc_target_remove_handler(NULL, 0);
+    g_assert(!nfc_target_cancel_transmit(NULL, 0));
+    g_assert(!nfc_target_transmit_with_timeout(NULL, NULL, 0, NULL, 0,
+        NULL, NULL, NULL));
+    g_assert(!nfc_target_fail_transmit(NULL, 0));
+    g_assert(!nfc_target_idle(NULL));
+    nfc_target_transmit_done(NULL, NFC_TRANSMIT_STATUS_ERROR, NULL, 0);
+    nfc_target_transmit_done_bytes(NULL, NFC_TRANSMIT_STATUS_ERROR, NULL);
+    nfc_target_reactivated(NULL);
+    nfc_target_gone(NULL);
+    nfc_target_set_max_response_size(NULL, 0);
+    g_assert(!nfc_target_max_response_size(NULL));
+    nfc_target_unref(NULL);
+    g_assert(!nfc_target_sequence_new(NULL));
+    nfc_target_sequence_free(NULL);
+}
+
+/*==========================================================================*
+ * basic
+ *==========================================================================*/
+
+static
+void
+test_basic(
+    void)
+{
+    TestTarget* test = test_target_new();
+    NfcTarget* target = &test->target;
+    int n = 0;
+    gulong gone_id = nfc_target_add_gone_handler(target, test_target_inc, &n);
+
+    /* Callback is requred */
+    g_assert(!nfc_target_add_gone_handler(target, NULL, NULL));
+    g_assert(!nfc_target_add_sequence_handler(target, NULL, NULL));
+
+    /* Fail one transmit */
+    test->fail_transmit = TRUE;
+    g_assert(!nfc_target_transmit(target, NULL, 0, NULL, NULL, NULL, NULL));
+
+    /* There's nothing to cancel */
+    g_assert(!nfc_target_cancel_transmit(target, 0));
+    g_assert(!nfc_target_cancel_transmit(target, 1));
+
+    /* Reactivation is not supported by this target */
+    g_assert(!nfc_target_can_reactivate(target));
+    g_assert(!nfc_target_reactivate(target, NULL, NULL));
+    nfc_target_reactivated(target); /* Does nothing */
+
+    /* Deactivate only sets the flag */
+    nfc_target_deactivate(target);
+    g_assert(test->deactivated);
+
+    /* "Gone" signal is only issued once */
+    g_assert(gone_id);
+    nfc_target_gone(target);
+    nfc_target_gone(target);
+    g_assert(n == 1);
+    nfc_target_remove_handler(target, 0 /* ignored */);
+    nfc_target_remove_handler(target, gone_id);
+
+    /* This deactivate does nothing */
+    nfc_target_deactivate(target);
+
+    g_assert(nfc_target_ref(target) == target);
+    nfc_target_unref(target);
+    nfc_target_unref(target);
+}
+
+/*==========================================================================*
+ * transmit_ok
+ *==========================================================================*/
+
+static
+void
+test_transmit_ok_resp(
+    NfcTarget* target,
+    NFC_TRANSMIT_STATUS status,
+    const void* data,
+    guint len,
+    void* user_data)
+{
+    TestTarget* test = TEST_TARGET(target);
+    const GUtilData* expected = user_data;
+
+    GDEBUG("Status %d, %u bytes", status, len);
+    g_assert(status == NFC_TRANSMIT_STATUS_OK);
+    g_assert(len == expected->size);
+    g_assert(!memcmp(data, expected->bytes, len));
+    test->succeeded++;
+}
+
+static
+void
+test_transmit_ok(
+    void)
+{
+    static const guint8 data1[] = { 0x01 };
+    static const guint8 data2[] = { 0x01, 0x02 };
+    GUtilData resp1, resp2;
+    TestTarget* test = test_target_new();
+    NfcTarget* target = &test->target;
+    guint timeout_id = 0, id1, id2, id3;
+    GMainLoop* loop = g_main_loop_new(NULL, TRUE);
+
+    TEST_BYTES_SET(resp1, data1);
+    TEST_BYTES_SET(resp2, data2);
+    test->transmit_responses = g_slist_append(g_slist_append(
+        test->transmit_responses,
+        test_transmit_response_new_from_bytes(&resp1)),
+        test_transmit_response_new_from_bytes(&resp2));
+
+    id1 = nfc_target_transmit(target, data1, sizeof(data1), NULL,
+        test_transmit_ok_resp, test_clear_bytes, &resp1);
+    id2 = nfc_target_transmit(target, data2, sizeof(data2), NULL,
+        test_transmit_ok_resp, test_clear_bytes, &resp2);
+    id3 = nfc_target_transmit(target, NULL, 0, NULL, NULL,
+        test_quit_loop, loop);
+    g_assert(id1);
+    g_assert(id2);
+    g_assert(id3);
+
+    timeout_id = test_setup_timeout(loop);
+    g_main_loop_run(loop);
+    if (timeout_id) {
+        g_source_remove(timeout_id);
+    }
+
+    g_assert(test->succeeded == 2);
+    g_assert(!resp1.bytes);
+    g_assert(!resp2.bytes);
+
+    nfc_target_unref(target);
+    g_main_loop_unref(loop);
+}
+
+/*==========================================================================*
+ * transmit_bytes
+ *==========================================================================*/
+
+static
+void
+test_transmit_bytes_resp(
+    NfcTarget* target,
+    NFC_TRANSMIT_STATUS status,
+    GBytes* data,
+    void* user_data)
+{
+    TestTarget* test = TEST_TARGET(target);
+    GBytes* expected = user_data;
+
+    g_assert(status == NFC_TRANSMIT_STATUS_OK);
+    g_assert(data);
+    g_assert(g_bytes_equal(data, expected));
+    test->succeeded++;
+}
+
+static
+void
+test_transmit_bytes_echo_resp(
+    NfcTarget* target,
+    NFC_TRANSMIT_STATUS status,
+    GBytes* data,
+    void* user_data)
+{
+    TestTarget* test = TEST_TARGET(target);
+    GBytes* expected = user_data;
+
+    /* The very same buffer must come back, no copies */
+    g_assert(status == NFC_TRANSMIT_STATUS_OK);
+    g_assert(data);
+    g_assert(g_bytes_get_data(data, NULL) ==
+        g_bytes_get_data(expected, NULL));
+    test->succeeded++;
+}
+
+static
+void
+test_transmit_bytes_fail_resp(
+    NfcTarget* target,
+    NFC_TRANSMIT_STATUS status,
+    GBytes* data,
+    void* user_data)
+{
+    TestTarget* test = TEST_TARGET(target);
+
+    g_assert(status != NFC_TRANSMIT_STATUS_OK);
+    g_assert(!data);
+    test->failed++;
+}
+
+static
+void
+test_transmit_bytes(
+    void)
+{
+    static const guint8 data1[] = { 0x01 };
+    static const guint8 data2[] = { 0x01, 0x02 };
+    static const guint8 data3[] = { 0x01, 0x02, 0x03 };
+    GBytes* bytes1 = g_bytes_new_static(data1, sizeof(data1));
+    GBytes* bytes2 = g_bytes_new_static(data2, sizeof(data2));
+    GUtilData resp3;
+    TestTransmitResponse* fail = test_transmit_response_new_fail();
+    TestTarget* test = test_target_new();
+    NfcTarget* target = &test->target;
+    TestTarget3* test3 = test_target3_new();
+    NfcTarget* target3 = NFC_TARGET(test3);
+    guint timeout_id;
+    GMainLoop* loop = g_main_loop_new(NULL, TRUE);
+
+    /* Data is required */
+    g_assert(!nfc_target_transmit_bytes(target, NULL, NULL, NULL, NULL,
+        NULL));
+
+    /* Plain transmit and transmit_done, GBytes completion */
+    test->transmit_responses = g_slist_append(g_slist_append(
+        test->transmit_responses,
+        test_transmit_response_new_ok(data2, sizeof(data2))), fail);
+    fail->status = NFC_TRANSMIT_STATUS_ERROR;
+    g_assert(nfc_target_transmit_bytes(target, bytes1, NULL,
+        test_transmit_bytes_resp, NULL, bytes2));
+    g_assert(nfc_target_transmit_bytes(target, bytes2, NULL,
+        test_transmit_bytes_fail_resp, NULL, NULL));
+    g_assert(nfc_target_transmit_bytes(target, bytes1, NULL, NULL,
+        test_quit_loop, loop));
+
+    timeout_id = test_setup_timeout(loop);
+    g_main_loop_run(loop);
+    if (timeout_id) {
+        g_source_remove(timeout_id);
+    }
+    g_assert(test->succeeded == 1);
+    g_assert(test->failed == 1);
+
+    /* Zero-copy target, the data is echoed back */
+    TEST_BYTES_SET(resp3, data3);
+    g_assert(nfc_target_transmit_bytes(target3, bytes1, NULL,
+        test_transmit_bytes_echo_resp, NULL, bytes1));
+    g_assert(nfc_target_transmit_bytes(target3, bytes2, NULL,
+        test_transmit_bytes_echo_resp, NULL, bytes2));
+    g_assert(nfc_target_transmit(target3, data3, sizeof(data3), NULL,
+        test_transmit_ok_resp, test_clear_bytes, &resp3));
+    g_assert(nfc_target_transmit(target3, NULL, 0, NULL, NULL,
+        test_quit_loop, loop));
+
+    timeout_id = test_setup_timeout(loop);
+    g_main_loop_run(loop);
+    if (timeout_id) {
+        g_source_remove(timeout_id);
+    }
+    g_assert(test3->transmitted == 4);
+    g_assert(test3->parent.succeeded == 3);
+    g_assert(!resp3.bytes);
+
+    g_bytes_unref(bytes1);
+    g_bytes_unref(bytes2);
+    nfc_target_unref(target);
+    nfc_target_unref(target3);
+    g_main_loop_unref(loop);
+}
+
+/*==========================================================================*
+ * transmit_timeout
+ *==========================================================================*/
+
+typedef struct test_transmit_timeout_data {
+    GMainLoop* loop;
+    gint64 start;
+    gint64 elapsed;
+} TestTransmitTimeout;
+
+static
+void
+test_transmit_timeout_resp(
+    NfcTarget* target,
+    NFC_TRANSMIT_STATUS status,
+    const void* data,
+    guint len,
+    void* user_data)
+{
+    TestTransmitTimeout* test = user_data;
+
+    g_assert(status == NFC_TRANSMIT_STATUS_TIMEOUT);
+    test->elapsed = g_get_monotonic_time() - test->start;
+    GDEBUG("Timed out in %u ms", (guint)(test->elapsed / 1000));
+    g_main_loop_quit(test->loop);
+}
+
+static
+void
+test_transmit_timeout_run(
+    NfcTarget* target,
+    TestTransmitTimeout* test)
+{
+    static const guint8 cmd[] = { 0x30, 0x00 };
+
+    test->start = g_get_monotonic_time();
+    test->elapsed = 0;
+    g_assert(nfc_target_transmit(target, cmd, sizeof(cmd), NULL,
+        test_transmit_timeout_resp, NULL, test));
+    g_main_loop_run(test->loop);
+}
+
+static
+void
+test_transmit_timeout(
+    void)
+{
+    static const guint8 cmd[] = { 0x30, 0x00 };
+    TestTarget* test = test_target_new();
+    NfcTarget* target = &test->target;
+    TestTransmitTimeout timeout;
+    guint timeout_id;
+    int i;
+
+    memset(&timeout, 0, sizeof(timeout));
+    timeout.loop = g_main_loop_new(NULL, TRUE);
+    timeout_id = test_setup_timeout(timeout.loop);
+
+    /* Zero selects defaults (NULL is tolerated too) */
+    nfc_target_set_transmit_timeout(NULL, 0, 0);
+    nfc_target_set_transmit_timeout(target, 0, 0);
+
+    /* Nothing has been measured yet, ceiling applies */
+    nfc_target_set_transmit_timeout(target, 20, 100);
+    test->drop_transmit = TRUE;
+    test_transmit_timeout_run(target, &timeout);
+    g_assert(timeout.elapsed >= 99000);
+
+    /* Collect a few fast responses */
+    test->drop_transmit = FALSE;
+    for (i = 0; i < 4; i++) {
+        g_assert(nfc_target_transmit(target, cmd, sizeof(cmd), NULL,
+            NULL, NULL, NULL));
+    }
+    g_assert(nfc_target_transmit(target, NULL, 0, NULL, NULL,
+        test_quit_loop, timeout.loop));
+    g_main_loop_run(timeout.loop);
+
+    /* Now the timeout is much shorter than the ceiling */
+    test->drop_transmit = TRUE;
+    test_transmit_timeout_run(target, &timeout);
+    g_assert(timeout.elapsed >= 19000);
+    g_assert(timeout.elapsed < 100000);
+
+    /* Floor is respected */
+    nfc_target_set_transmit_timeout(target, 60, 0);
+    test_transmit_timeout_run(target, &timeout);
+    g_assert(timeout.elapsed >= 59000);
+
+    /* Zero floor makes the timeout fixed, regardless of the estimates */
+    nfc_target_set_transmit_timeout(target, 0, 100);
+    test_transmit_timeout_run(target, &timeout);
+    g_assert(timeout.elapsed >= 99000);
+
+    /* Per-request timeout overrides that */
+    timeout.start = g_get_monotonic_time();
+    g_assert(nfc_target_transmit_with_timeout(target, cmd, sizeof(cmd),
+        NULL, 30, test_transmit_timeout_resp, NULL, &timeout));
+    g_main_loop_run(timeout.loop);
+    g_assert(timeout.elapsed >= 29000);
+    g_assert(timeout.elapsed < 99000);
+
+    if (timeout_id) {
+        g_source_remove(timeout_id);
+    }
+    nfc_target_unref(target);
+    g_main_loop_unref(timeout.loop);
+}
+
+/*==========================================================================*
+ * transmit_rtt_class
+ *==========================================================================*/
+
+static
+void
+test_transmit_rtt_class_run(
+    NfcTarget* target,
+    guint rtt_class,
+    TestTransmitTimeout* test)
+{
+    NfcTargetTransmitOptions opt = NFC_TARGET_TRANSMIT_OPTIONS_INIT;
+
+    opt.rtt_class = rtt_class;
+    test->start = g_get_monotonic_time();
+    test->elapsed = 0;
+    g_assert(nfc_target_transmit_full(target, NULL, 0, NULL, &opt,
+        test_transmit_timeout_resp, NULL, test));
+    g_main_loop_run(test->loop);
+}
+
+static
+void
+test_transmit_rtt_class(
+    void)
+{
+    /* Same first byte, different classes */
+    static const guint8 cmd[] = { 0x00, 0xb0, 0x00, 0x00, 0x0f };
+    const guint slow = NFC_TARGET_RTT_CLASS(0x88);
+    const guint fast = NFC_TARGET_RTT_CLASS(0xb0);
+    TestTarget* test = test_target_new();
+    NfcTarget* target = &test->target;
+    NfcTargetTransmitOptions opt = NFC_TARGET_TRANSMIT_OPTIONS_INIT;
+    TestTransmitTimeout timeout;
+    guint timeout_id;
+    int i;
+
+    memset(&timeout, 0, sizeof(timeout));
+    timeout.loop = g_main_loop_new(NULL, TRUE);
+    timeout_id = test_setup_timeout(timeout.loop);
+    nfc_target_set_transmit_timeout(target, 10, 400);
+
+    /* Collect slow responses of one class */
+    opt.rtt_class = slow;
+    test->transmit_delay_ms = 60;
+    for (i = 0; i < 4; i++) {
+        g_assert(nfc_target_transmit_full(target, TEST_ARRAY_AND_SIZE(cmd),
+            NULL, &opt, NULL, NULL, NULL));
+    }
+    g_assert(nfc_target_transmit(target, NULL, 0, NULL, NULL,
+        test_quit_loop, timeout.loop));
+    g_main_loop_run(timeout.loop);
+
+    /* And fast ones of another */
+    opt.rtt_class = fast;
+    test->transmit_delay_ms = 0;
+    for (i = 0; i < 4; i++) {
+        g_assert(nfc_target_transmit_full(target, TEST_ARRAY_AND_SIZE(cmd),
+            NULL, &opt, NULL, NULL, NULL));
+    }
+    g_assert(nfc_target_transmit(target, NULL, 0, NULL, NULL,
+        test_quit_loop, timeout.loop));
+    g_main_loop_run(timeout.loop);
+
+    /* Each class gets its own timeout */
+    test->drop_transmit = TRUE;
+    test_transmit_rtt_class_run(target, slow, &timeout);
+    g_assert(timeout.elapsed >= 59000);
+    test_transmit_rtt_class_run(target, fast, &timeout);
+    g_assert(timeout.elapsed >= 9000);
+    g_assert(timeout.elapsed < 59000);
+
+    if (timeout_id) {
+        g_source_remove(timeout_id);
+    }
+    nfc_target_unref(target);
+    g_main_loop_unref(timeout.loop);
+}
+
+/*==========================================================================*
+ * transmit_batch
+ *==========================================================================*/
+
+static
+void
+test_transmit_batch_ok_resp(
+    NfcTarget* target,
+    NFC_TRANSMIT_STATUS status,
+    GBytes* const* resp,
+    guint count,
+    void* user_data)
+{
+    TestTarget* test = TEST_TARGET(target);
+    GBytes* const* expected = user_data;
+    guint i;
+
+    g_assert(status == NFC_TRANSMIT_STATUS_OK);
+    g_assert(count == 3);
+    for (i = 0; i < count; i++) {
+        g_assert(g_bytes_equal(resp[i], expected[i]));
+    }
+    /* Nothing else has been completed in between */
+    g_assert(!test->succeeded);
+    test->succeeded++;
+}
+
+static
+void
+test_transmit_batch_fail_resp(
+    NfcTarget* target,
+    NFC_TRANSMIT_STATUS status,
+    GBytes* const* resp,
+    guint count,
+    void* user_data)
+{
+    TestTarget* test = TEST_TARGET(target);
+    const guint8* data;
+    gsize size;
+
+    /* Second frame fails */
+    g_assert(status == NFC_TRANSMIT_STATUS_ERROR);
+    g_assert(count == 1);
+    data = g_bytes_get_data(resp[0], &size);
+    g_assert(size == 1);
+    g_assert(data[0] == 0x01);
+    test->failed++;
+}
+
+static
+void
+test_transmit_batch_after_resp(
+    NfcTarget* target,
+    NFC_TRANSMIT_STATUS status,
+    const void* data,
+    guint len,
+    void* user_data)
+{
+    TestTarget* test = TEST_TARGET(target);
+
+    /* Batch must have completed by now */
+    g_assert(test->succeeded == 1);
+    test->succeeded++;
+}
+
+static
+void
+test_transmit_batch(
+    void)
+{
+    static const guint8 data1[] = { 0x01 };
+    static const guint8 data2[] = { 0x01, 0x02 };
+    static const guint8 data3[] = { 0x01, 0x02, 0x03 };
+    GBytes* frames[3];
+    TestTransmitResponse* fail = test_transmit_response_new_fail();
+    TestTarget* test = test_target_new();
+    NfcTarget* target = &test->target;
+    GMainLoop* loop = g_main_loop_new(NULL, TRUE);
+    guint timeout_id, id;
+    int i;
+
+    frames[0] = g_bytes_new_static(data1, sizeof(data1));
+    frames[1] = g_bytes_new_static(data2, sizeof(data2));
+    frames[2] = g_bytes_new_static(data3, sizeof(data3));
+
+    /* Invalid batches */
+    g_assert(!nfc_target_transmit_batch(NULL, frames, 3, NULL, NULL, NULL,
+        NULL));
+    g_assert(!nfc_target_transmit_batch(target, NULL, 3, NULL, NULL, NULL,
+        NULL));
+    g_assert(!nfc_target_transmit_batch(target, frames, 0, NULL, NULL, NULL,
+        NULL));
+
+    /* Echo the frames back, the last request must wait for the batch */
+    for (i = 0; i < 3; i++) {
+        test->transmit_responses = g_slist_append(test->transmit_responses,
+            test_transmit_response_new_ok(g_bytes_get_data(frames[i], NULL),
+            g_bytes_get_size(frames[i])));
+    }
+    g_assert(nfc_target_transmit_batch(target, frames, 3, NULL,
+        test_transmit_batch_ok_resp, NULL, frames));
+    g_assert(nfc_target_transmit(target, NULL, 0, NULL,
+        test_transmit_batch_after_resp, test_quit_loop, loop));
+
+    timeout_id = test_setup_timeout(loop);
+    g_main_loop_run(loop);
+    if (timeout_id) {
+        g_source_remove(timeout_id);
+    }
+    g_assert(test->succeeded == 2);
+
+    /* Stop at the first failure */
+    test->transmit_responses = g_slist_append(g_slist_append(
+        test->transmit_responses, test_transmit_response_new_ok(data1,
+        sizeof(data1))), fail);
+    fail->status = NFC_TRANSMIT_STATUS_ERROR;
+    g_assert(nfc_target_transmit_batch(target, frames, 3, NULL,
+        test_transmit_batch_fail_resp, test_quit_loop, loop));
+
+    timeout_id = test_setup_timeout(loop);
+    g_main_loop_run(loop);
+    if (timeout_id) {
+        g_source_remove(timeout_id);
+    }
+    g_assert(test->failed == 1);
+
+    /* Cancel the whole thing */
+    id = nfc_target_transmit_batch(target, frames, 3, NULL,
+        test_transmit_batch_fail_resp, NULL, NULL);
+    g_assert(id);
+    g_assert(nfc_target_cancel_transmit(target, id));
+    g_assert(!nfc_target_cancel_transmit(target, id));
+    g_assert(test->failed == 1);
+
+    for (i = 0; i < 3; i++) {
+        g_bytes_unref(frames[i]);
+    }
+    nfc_target_unref(target);
+    g_main_loop_unref(loop);
+}
+
+/*==========================================================================*
+ * transmit_direct
+ *==========================================================================*/
+
+static
+void
+test_transmit_direct_nested_resp(
+    NfcTarget* target,
+    NFC_TRANSMIT_STATUS status,
+    const void* data,
+    guint len,
+    void* user_data)
+{
+    TestTarget* test = TEST_TARGET(target);
+
+    /* Completion is running, the next request must not be submitted yet */
+    g_assert(!test->transmit_id);
+    test->succeeded++;
+}
+
+static
+void
+test_transmit_direct(
+    void)
+{
+    TestTarget* test = test_target_new();
+    NfcTarget* target = &test->target;
+    GMainLoop* loop = g_main_loop_new(NULL, TRUE);
+    guint timeout_id;
+
+    /* Complete the first request by hand */
+    g_assert(nfc_target_transmit(target, NULL, 0, NULL,
+        test_transmit_direct_nested_resp, NULL, NULL));
+    g_assert(nfc_target_transmit(target, NULL, 0, NULL, NULL,
+        test_quit_loop, loop));
+    g_assert(test->transmit_id);
+    g_source_remove(test->transmit_id);
+    test->transmit_id = 0;
+    nfc_target_transmit_done(target, NFC_TRANSMIT_STATUS_OK, NULL, 0);
+    g_assert(test->succeeded == 1);
+
+    /* The second one has been submitted without a main loop hop */
+    g_assert(test->transmit_id);
+
+    timeout_id = test_setup_timeout(loop);
+    g_main_loop_run(loop);
+    if (timeout_id) {
+        g_source_remove(timeout_id);
+    }
+
+    nfc_target_unref(target);
+    g_main_loop_unref(loop);
+}
+
+/*==========================================================================*
+ * transmit_deadline
+ *==========================================================================*/
+
+static
+void
+test_transmit_deadline_resp(
+    NfcTarget* target,
+    NFC_TRANSMIT_STATUS status,
+    const void* data,
+    guint len,
+    void* user_data)
+{
+    int* result = user_data;
+
+    g_assert(*result < 0);
+    *result = status;
+}
+
+static
+void
+test_transmit_deadline(
+    void)
+{
+    TestTarget* test = test_target_new();
+    NfcTarget* target = &test->target;
+    GMainLoop* loop = g_main_loop_new(NULL, TRUE);
+    const gint64 now = g_get_monotonic_time();
+    int result[4];
+    guint timeout_id, id;
+
+    memset(result, 0xff, sizeof(result));
+
+    /* This one gets submitted right away, it's too late to expire it */
+    id = nfc_target_transmit(target, NULL, 0, NULL,
+        test_transmit_deadline_resp, NULL, result + 0);
+    g_assert(id);
+    g_assert(!nfc_target_set_transmit_deadline(target, id, now - 1));
+    g_assert(!nfc_target_set_transmit_deadline(target, id + 100, now - 1));
+
+    /* Deadline has already passed */
+    g_assert(nfc_target_transmit_with_deadline(target, NULL, 0, NULL,
+        now - 1, test_transmit_deadline_resp, NULL, result + 1));
+
+    /* This one is going to make it */
+    g_assert(nfc_target_transmit_with_deadline(target, NULL, 0, NULL,
+        now + 60 * G_USEC_PER_SEC, test_transmit_deadline_resp, NULL,
+        result + 2));
+
+    /* Deadline set after the request has been queued */
+    id = nfc_target_transmit(target, NULL, 0, NULL,
+        test_transmit_deadline_resp, NULL, result + 3);
+    g_assert(nfc_target_set_transmit_deadline(target, id, now - 1));
+
+    g_assert(nfc_target_transmit(target, NULL, 0, NULL, NULL,
+        test_quit_loop, loop));
+
+    timeout_id = test_setup_timeout(loop);
+    g_main_loop_run(loop);
+    if (timeout_id) {
+        g_source_remove(timeout_id);
+    }
+
+    g_assert(result[0] == NFC_TRANSMIT_STATUS_OK);
+    g_assert(result[1] == NFC_TRANSMIT_STATUS_EXPIRED);
+    g_assert(result[2] == NFC_TRANSMIT_STATUS_OK);
+    g_assert(result[3] == NFC_TRANSMIT_STATUS_EXPIRED);
+
+    nfc_target_unref(target);
+    g_main_loop_unref(loop);
+}
+
+/*==========================================================================*
+ * transmit_deadline_order
+ *==========================================================================*/
+
+typedef struct test_transmit_deadline_order {
+    TestTarget* test;
+    gint64 start;
+    int expired[2];
+    int count;
+} TestTransmitDeadlineOrder;
+
+typedef struct test_transmit_deadline_order_req {
+    TestTransmitDeadlineOrder* order;
+    int index;
+} TestTransmitDeadlineOrderReq;
+
+static
+void
+test_transmit_deadline_order_active_resp(
+    NfcTarget* target,
+    NFC_TRANSMIT_STATUS status,
+    const void* data,
+    guint len,
+    void* user_data)
+{
+    TestTransmitDeadlineOrder* order = user_data;
+
+    /* Both queued requests have expired by now */
+    g_assert(status == NFC_TRANSMIT_STATUS_TIMEOUT);
+    g_assert_cmpint(order->count, == ,2);
+    order->test->drop_transmit = FALSE;
+}
+
+static
+void
+test_transmit_deadline_order_resp(
+    NfcTarget* target,
+    NFC_TRANSMIT_STATUS status,
+    const void* data,
+    guint len,
+    void* user_data)
+{
+    TestTransmitDeadlineOrderReq* req = user_data;
+    TestTransmitDeadlineOrder* order = req->order;
+    const gint64 elapsed = g_get_monotonic_time() - order->start;
+
+    /* Expired while the active request was still waiting */
+    g_assert(status == NFC_TRANSMIT_STATUS_EXPIRED);
+    g_assert(elapsed < 200000);
+    g_assert_cmpint(order->count, < ,2);
+    order->expired[order->count++] = req->index;
+}
+
+static
+void
+test_transmit_deadline_order(
+    void)
+{
+    TestTarget* test = test_target_new();
+    NfcTarget* target = &test->target;
+    GMainLoop* loop = g_main_loop_new(NULL, TRUE);
+    TestTransmitDeadlineOrder order;
+    TestTransmitDeadlineOrderReq req[2];
+    guint timeout_id, id1, id2;
+
+    memset(&order, 0, sizeof(order));
+    order.test = test;
+    order.start = g_get_monotonic_time();
+    req[0].order = req[1].order = &order;
+    req[0].index = 1;
+    req[1].index = 2;
+
+    /* The active request hangs until it times out */
+    nfc_target_set_transmit_timeout(target, 200, 200);
+    test->drop_transmit = TRUE;
+    g_assert(nfc_target_transmit(target, NULL, 0, NULL,
+        test_transmit_deadline_order_active_resp, NULL, &order));
+
+    /* Deadlines are set in the reverse order */
+    id1 = nfc_target_transmit_with_deadline(target, NULL, 0, NULL,
+        order.start + 40000, test_transmit_deadline_order_resp, NULL, req);
+    id2 = nfc_target_transmit(target, NULL, 0, NULL,
+        test_transmit_deadline_order_resp, NULL, req + 1);
+    g_assert(id1);
+    g_assert(id2);
+    g_assert(nfc_target_set_transmit_deadline(target, id2,
+        order.start + 20000));
+
+    /* This one has no deadline and eventually gets sent */
+    g_assert(nfc_target_transmit(target, NULL, 0, NULL, NULL,
+        test_quit_loop, loop));
+
+    timeout_id = test_setup_timeout(loop);
+    g_main_loop_run(loop);
+    if (timeout_id) {
+        g_source_remove(timeout_id);
+    }
+
+    /* The one with the earliest deadline expires first */
+    g_assert_cmpint(order.count, == ,2);
+    g_assert_cmpint(order.expired[0], == ,2);
+    g_assert_cmpint(order.expired[1], == ,1);
+
+    nfc_target_unref(target);
+    g_main_loop_unref(loop);
+}
+
+/*==========================================================================*
+ * transmit_expired_resubmit
+ *==========================================================================*/
+
+typedef struct test_transmit_expired_resubmit {
+    TestTarget* test;
+    guint queued_id;
+    guint order[2];
+} TestTransmitExpiredResubmit;
+
+static
+void
+test_transmit_expired_resubmit_ok(
+    NfcTarget* target,
+    NFC_TRANSMIT_STATUS status,
+    const void* data,
+    guint len,
+    void* user_data)
+{
+    guint* order = user_data;
+
+    g_assert(status == NFC_TRANSMIT_STATUS_OK);
+    g_assert(!*order);
+    *order = ++(TEST_TARGET(target)->succeeded);
+}
+
+static
+void
+test_transmit_expired_resubmit_expired(
+    NfcTarget* target,
+    NFC_TRANSMIT_STATUS status,
+    const void* data,
+    guint len,
+    void* user_data)
+{
+    TestTransmitExpiredResubmit* test = user_data;
+
+    /* Resubmit from the callback, while nothing is being transmitted */
+    g_assert(status == NFC_TRANSMIT_STATUS_EXPIRED);
+    g_assert(nfc_target_transmit(target, NULL, 0, NULL,
+        test_transmit_expired_resubmit_ok, NULL, test->order + 0));
+}
+
+static
+void
+test_transmit_expired_resubmit_active(
+    NfcTarget* target,
+    NFC_TRANSMIT_STATUS status,
+    const void* data,
+    guint len,
+    void* user_data)
+{
+    TestTransmitExpiredResubmit* test = user_data;
+
+    /* The queued request expires when it's dequeued */
+    g_assert(status == NFC_TRANSMIT_STATUS_OK);
+    g_assert(nfc_target_set_transmit_deadline(target, test->queued_id, 1));
+}
+
+static
+void
+test_transmit_expired_resubmit(
+    void)
+{
+    TestTransmitExpiredResubmit test;
+    NfcTarget* target;
+    GMainLoop* loop = g_main_loop_new(NULL, TRUE);
+    guint timeout_id;
+
+    memset(&test, 0, sizeof(test));
+    test.test = test_target_new();
+    target = &test.test->target;
+
+    /* This one gets submitted right away, the rest are queued */
+    g_assert(nfc_target_transmit(target, NULL, 0, NULL,
+        test_transmit_expired_resubmit_active, NULL, &test));
+    test.queued_id = nfc_target_transmit(target, NULL, 0, NULL,
+        test_transmit_expired_resubmit_expired, NULL, &test);
+    g_assert(test.queued_id);
+    g_assert(nfc_target_transmit2(target, NULL, 0, NULL,
+        NFC_TARGET_PRIORITY_BULK, test_transmit_expired_resubmit_ok, NULL,
+        test.order + 1));
+    g_assert(nfc_target_transmit2(target, NULL, 0, NULL,
+        NFC_TARGET_PRIORITY_BULK, NULL, test_quit_loop, loop));
+
+    timeout_id = test_setup_timeout(loop);
+    g_main_loop_run(loop);
+    if (timeout_id) {
+        g_source_remove(timeout_id);
+    }
+
+    /* Resubmitted request goes first, one at a time */
+    g_assert_cmpuint(test.order[0], == ,1);
+    g_assert_cmpuint(test.order[1], == ,2);
+
+    nfc_target_unref(target);
+    g_main_loop_unref(loop);
+}
+
+/*==========================================================================*
+ * transmit_retry
+ *==========================================================================*/
+
+static
+TestTransmitResponse*
+test_transmit_retry_status(
+    NFC_TRANSMIT_STATUS status)
+{
+    TestTransmitResponse* resp = test_transmit_response_new_fail();
+
+    resp->status = status;
+    return resp;
+}
+
+static
+void
+test_transmit_retry_resp(
+    NfcTarget* target,
+    NFC_TRANSMIT_STATUS status,
+    const void* data,
+    guint len,
+    void* user_data)
+{
+    int* result = user_data;
+
+    g_assert(*result < 0);
+    *result = status;
+    if (status == NFC_TRANSMIT_STATUS_OK) {
+        g_assert(len == 2);
+        g_assert(!memcmp(data, "ok", 2));
+    }
+}
+
+static
+void
+test_transmit_retry(
+    void)
+{
+    static const guint8 ok[] = { 'o', 'k' };
+    static const guint8 cmd[] = { 0x30, 0x00 };
+    TestTarget* test = test_target_new();
+    NfcTarget* target = &test->target;
+    GMainLoop* loop = g_main_loop_new(NULL, TRUE);
+    NfcTargetRetryPolicy retry;
+    GSList* responses = NULL;
+    int result[4];
+    guint i, timeout_id;
+
+    memset(result, 0xff, sizeof(result));
+    memset(&retry, 0, sizeof(retry));
+    retry.retries = 2;
+    retry.delay_ms = 1;
+    retry.max_delay_ms = 2;
+    retry.statuses = NFC_TARGET_RETRY_STATUS(NFC_TRANSMIT_STATUS_CORRUPTED);
+
+    /* Succeeds on the last attempt */
+    responses = g_slist_append(responses,
+        test_transmit_retry_status(NFC_TRANSMIT_STATUS_CORRUPTED));
+    responses = g_slist_append(responses,
+        test_transmit_retry_status(NFC_TRANSMIT_STATUS_CORRUPTED));
+    responses = g_slist_append(responses,
+        test_transmit_response_new_ok(TEST_ARRAY_AND_SIZE(ok)));
+    g_assert(nfc_target_transmit_with_retry(target, TEST_ARRAY_AND_SIZE(cmd),
+        NULL, &retry, test_transmit_retry_resp, NULL, result + 0));
+
+    /* Runs out of retries */
+    for (i = 0; i <= retry.retries; i++) {
+        responses = g_slist_append(responses,
+            test_transmit_retry_status(NFC_TRANSMIT_STATUS_CORRUPTED));
+    }
+    g_assert(nfc_target_transmit_with_retry(target, TEST_ARRAY_AND_SIZE(cmd),
+        NULL, &retry, test_transmit_retry_resp, NULL, result + 1));
+
+    /* Status which isn't retried */
+    responses = g_slist_append(responses,
+        test_transmit_retry_status(NFC_TRANSMIT_STATUS_NACK));
+    g_assert(nfc_target_transmit_with_retry(target, TEST_ARRAY_AND_SIZE(cmd),
+        NULL, &retry, test_transmit_retry_resp, NULL, result + 2));
+
+    /* No retry policy at all */
+    responses = g_slist_append(responses,
+        test_transmit_retry_status(NFC_TRANSMIT_STATUS_CORRUPTED));
+    g_assert(nfc_target_transmit_with_retry(target, TEST_ARRAY_AND_SIZE(cmd),
+        NULL, NULL, test_transmit_retry_resp, NULL, result + 3));
+
+    test->transmit_responses = responses;
+    g_assert(nfc_target_transmit(target, NULL, 0, NULL, NULL,
+        test_quit_loop, loop));
+
+    timeout_id = test_setup_timeout(loop);
+    g_main_loop_run(loop);
+    if (timeout_id) {
+        g_source_remove(timeout_id);
+    }
+
+    /* Retries don't let anything else in, responses are used in order */
+    g_assert(result[0] == NFC_TRANSMIT_STATUS_OK);
+    g_assert(result[1] == NFC_TRANSMIT_STATUS_CORRUPTED);
+    g_assert(result[2] == NFC_TRANSMIT_STATUS_NACK);
+    g_assert(result[3] == NFC_TRANSMIT_STATUS_CORRUPTED);
+    g_assert(!test->transmit_responses);
+
+    nfc_target_unref(target);
+    g_main_loop_unref(loop);
+}
+
+/*==========================================================================*
+ * transmit_full
+ *==========================================================================*/
+
+static
+void
+test_transmit_full_bytes_resp(
+    NfcTarget* target,
+    NFC_TRANSMIT_STATUS status,
+    GBytes* data,
+    void* user_data)
+{
+    int* result = user_data;
+
+    g_assert(*result < 0);
+    *result = status;
+    g_assert(status == NFC_TRANSMIT_STATUS_OK);
+    g_assert(data);
+    g_assert_cmpuint(g_bytes_get_size(data), == ,2);
+    g_assert(!memcmp(g_bytes_get_data(data, NULL), "ok", 2));
+}
 
 static
 void
-test_null(
-    void)
+test_transmit_full_batch_resp(
+    NfcTarget* target,
+    NFC_TRANSMIT_STATUS status,
+    GBytes* const* resp,
+    guint count,
+    void* user_data)
 {
-    /* Public interfaces are NULL tolerant */
-    g_assert(!nfc_target_ref(NULL));
-    g_assert(!nfc_target_transmit(NULL, NULL, 0, NULL, NULL, NULL, NULL));
-    g_assert(!nfc_target_add_gone_handler(NULL, NULL, NULL));
-    g_assert(!nfc_target_add_sequence_handler(NULL, NULL, NULL));
-    nfc_target_deactivate(NULL);
-    g_assert(!nfc_target_can_reactivate(NULL));
-    g_assert(!nfc_target_reactivate(NULL, NULL, NULL));
-    nfc_target_set_reactivate_timeout(NULL, 0);
-    nfc_target_remove_handler(NULL, 0);
-    g_assert(!nfc_target_cancel_transmit(NULL, 0));
-    nfc_target_transmit_done(NULL, NFC_TRANSMIT_STATUS_ERROR, NULL, 0);
-    nfc_target_reactivated(NULL);
-    nfc_target_gone(NULL);
-    nfc_target_unref(NULL);
-    g_assert(!nfc_target_sequence_new(NULL));
-    nfc_target_sequence_free(NULL);
-}
+    int* result = user_data;
 
-/*==========================================================================*
- * basic
- *==========================================================================*/
+    g_assert(*result < 0);
+    g_assert(!count);
+    *result = status;
+}
 
 static
 void
-test_basic(
+test_transmit_full(
     void)
 {
+    static const guint8 ok[] = { 'o', 'k' };
+    static const guint8 cmd[] = { 0x30, 0x00 };
     TestTarget* test = test_target_new();
     NfcTarget* target = &test->target;
-    int n = 0;
-    gulong gone_id = nfc_target_add_gone_handler(target, test_target_inc, &n);
-
-    /* Callback is requred */
-    g_assert(!nfc_target_add_gone_handler(target, NULL, NULL));
-    g_assert(!nfc_target_add_sequence_handler(target, NULL, NULL));
-
-    /* Fail one transmit */
-    test->fail_transmit = TRUE;
-    g_assert(!nfc_target_transmit(target, NULL, 0, NULL, NULL, NULL, NULL));
-
-    /* There's nothing to cancel */
-    g_assert(!nfc_target_cancel_transmit(target, 0));
-    g_assert(!nfc_target_cancel_transmit(target, 1));
-
-    /* Reactivation is not supported by this target */
-    g_assert(!nfc_target_can_reactivate(target));
-    g_assert(!nfc_target_reactivate(target, NULL, NULL));
-    nfc_target_reactivated(target); /* Does nothing */
+    GMainLoop* loop = g_main_loop_new(NULL, TRUE);
+    GBytes* bytes = g_bytes_new_static(cmd, sizeof(cmd));
+    NfcTargetTransmitOptions opt = NFC_TARGET_TRANSMIT_OPTIONS_INIT;
+    NfcTargetRetryPolicy retry;
+    GSList* responses = NULL;
+    int result[4];
+    guint timeout_id;
 
-    /* Deactivate only sets the flag */
-    nfc_target_deactivate(target);
-    g_assert(test->deactivated);
+    memset(result, 0xff, sizeof(result));
+    memset(&retry, 0, sizeof(retry));
+    retry.retries = 1;
+    retry.delay_ms = 1;
+    retry.max_delay_ms = 1;
+    retry.statuses = NFC_TARGET_RETRY_STATUS(NFC_TRANSMIT_STATUS_CORRUPTED);
+
+    /* Responses in the order of transmission */
+    responses = g_slist_append(responses,
+        test_transmit_response_new_ok(TEST_ARRAY_AND_SIZE(ok)));
+    responses = g_slist_append(responses,
+        test_transmit_retry_status(NFC_TRANSMIT_STATUS_CORRUPTED));
+    responses = g_slist_append(responses,
+        test_transmit_response_new_ok(TEST_ARRAY_AND_SIZE(ok)));
+    responses = g_slist_append(responses,
+        test_transmit_retry_status(NFC_TRANSMIT_STATUS_CORRUPTED));
+
+    /* NULL options are the defaults */
+    g_assert(nfc_target_transmit_full(target, TEST_ARRAY_AND_SIZE(cmd),
+        NULL, NULL, test_transmit_retry_resp, NULL, result + 0));
+
+    /* Queued, default priority, not retried */
+    g_assert(nfc_target_transmit_full(target, TEST_ARRAY_AND_SIZE(cmd),
+        NULL, &opt, test_transmit_retry_resp, NULL, result + 1));
+
+    /* Bytes, retry and priority, overtakes the previous one */
+    opt.priority = NFC_TARGET_PRIORITY_PRESENCE;
+    opt.retry = &retry;
+    g_assert(nfc_target_transmit_bytes_full(target, bytes, NULL, &opt,
+        test_transmit_full_bytes_resp, NULL, result + 2));
+
+    /* Batch with priority and a deadline, expires without transmitting */
+    opt.priority = NFC_TARGET_PRIORITY_BULK;
+    opt.retry = NULL;
+    opt.deadline = 1;
+    g_assert(nfc_target_transmit_batch_full(target, &bytes, 1, NULL, &opt,
+        test_transmit_full_batch_resp, NULL, result + 3));
+
+    test->transmit_responses = responses;
+    g_assert(nfc_target_transmit2(target, NULL, 0, NULL,
+        NFC_TARGET_PRIORITY_BULK, NULL, test_quit_loop, loop));
 
-    /* "Gone" signal is only issued once */
-    g_assert(gone_id);
-    nfc_target_gone(target);
-    nfc_target_gone(target);
-    g_assert(n == 1);
-    nfc_target_remove_handler(target, 0 /* ignored */);
-    nfc_target_remove_handler(target, gone_id);
+    timeout_id = test_setup_timeout(loop);
+    g_main_loop_run(loop);
+    if (timeout_id) {
+        g_source_remove(timeout_id);
+    }
 
-    /* This deactivate does nothing */
-    nfc_target_deactivate(target);
+    g_assert_cmpint(result[0], == ,NFC_TRANSMIT_STATUS_OK);
+    g_assert_cmpint(result[1], == ,NFC_TRANSMIT_STATUS_CORRUPTED);
+    g_assert_cmpint(result[2], == ,NFC_TRANSMIT_STATUS_OK);
+    g_assert_cmpint(result[3], == ,NFC_TRANSMIT_STATUS_EXPIRED);
+    g_assert(!test->transmit_responses);
 
-    g_assert(nfc_target_ref(target) == target);
-    nfc_target_unref(target);
+    g_bytes_unref(bytes);
     nfc_target_unref(target);
+    g_main_loop_unref(loop);
 }
 
 /*==========================================================================*
- * transmit_ok
+ * pool
  *==========================================================================*/
 
+#define TEST_POOL_WARMUP (2)
+#define TEST_POOL_COUNT (10)
+
+typedef struct test_pool_data {
+    GMainLoop* loop;
+    guint count;
+    guint allocs;
+} TestPoolData;
+
 static
 void
-test_transmit_ok_resp(
+test_pool_resp(
     NfcTarget* target,
     NFC_TRANSMIT_STATUS status,
     const void* data,
     guint len,
     void* user_data)
 {
-    TestTarget* test = TEST_TARGET(target);
-    const GUtilData* expected = user_data;
+    static const guint8 cmd[] = { 0x30, 0x00 };
+    TestPoolData* test = user_data;
 
-    GDEBUG("Status %d, %u bytes", status, len);
     g_assert(status == NFC_TRANSMIT_STATUS_OK);
-    g_assert(len == expected->size);
-    g_assert(!memcmp(data, expected->bytes, len));
-    test->succeeded++;
+    test->count++;
+    if (test->count == TEST_POOL_WARMUP) {
+        test->allocs = nfc_target_pool_allocs(target);
+    }
+    if (test->count < TEST_POOL_COUNT) {
+        /* Submit the next one from the completion callback */
+        g_assert(nfc_target_transmit(target, TEST_ARRAY_AND_SIZE(cmd), NULL,
+            test_pool_resp, NULL, test));
+    } else {
+        g_main_loop_quit(test->loop);
+    }
 }
 
 static
 void
-test_transmit_ok(
+test_pool(
     void)
 {
-    static const guint8 data1[] = { 0x01 };
-    static const guint8 data2[] = { 0x01, 0x02 };
-    GUtilData resp1, resp2;
+    static const guint8 cmd[] = { 0x30, 0x00 };
     TestTarget* test = test_target_new();
     NfcTarget* target = &test->target;
-    guint timeout_id = 0, id1, id2, id3;
-    GMainLoop* loop = g_main_loop_new(NULL, TRUE);
-
-    TEST_BYTES_SET(resp1, data1);
-    TEST_BYTES_SET(resp2, data2);
-    test->transmit_responses = g_slist_append(g_slist_append(
-        test->transmit_responses,
-        test_transmit_response_new_from_bytes(&resp1)),
-        test_transmit_response_new_from_bytes(&resp2));
+    gpointer mem[2];
+    TestPoolData data;
+    guint timeout_id;
 
-    id1 = nfc_target_transmit(target, data1, sizeof(data1), NULL,
-        test_transmit_ok_resp, test_clear_bytes, &resp1);
-    id2 = nfc_target_transmit(target, data2, sizeof(data2), NULL,
-        test_transmit_ok_resp, test_clear_bytes, &resp2);
-    id3 = nfc_target_transmit(target, NULL, 0, NULL, NULL,
-        test_quit_loop, loop);
-    g_assert(id1);
-    g_assert(id2);
-    g_assert(id3);
+    memset(&data, 0, sizeof(data));
+    data.loop = g_main_loop_new(NULL, TRUE);
+    g_assert(nfc_target_transmit(target, TEST_ARRAY_AND_SIZE(cmd), NULL,
+        test_pool_resp, NULL, &data));
 
-    timeout_id = test_setup_timeout(loop);
-    g_main_loop_run(loop);
+    timeout_id = test_setup_timeout(data.loop);
+    g_main_loop_run(data.loop);
     if (timeout_id) {
         g_source_remove(timeout_id);
     }
 
-    g_assert(test->succeeded == 2);
-    g_assert(!resp1.bytes);
-    g_assert(!resp2.bytes);
+    /* Nothing gets allocated once the pool has warmed up */
+    g_assert(data.count == TEST_POOL_COUNT);
+    g_assert(data.allocs);
+    g_assert(nfc_target_pool_allocs(target) == data.allocs);
+
+    /* Objects of similar size share the free list */
+    mem[0] = nfc_target_pool_alloc0(target, 1);
+    mem[1] = nfc_target_pool_alloc0(target, sizeof(gpointer));
+    nfc_target_pool_free(target, 1, mem[0]);
+    nfc_target_pool_free(target, sizeof(gpointer), mem[1]);
+    data.allocs = nfc_target_pool_allocs(target);
+    mem[0] = nfc_target_pool_alloc0(target, sizeof(gpointer));
+    mem[1] = nfc_target_pool_alloc0(target, 1);
+    g_assert(nfc_target_pool_allocs(target) == data.allocs);
+    g_assert(!*((gpointer*)mem[0]));
+    nfc_target_pool_free(target, sizeof(gpointer), mem[0]);
+    nfc_target_pool_free(target, 1, mem[1]);
+
+    /* Large blocks are not pooled */
+    mem[0] = nfc_target_pool_alloc0(target, 1024);
+    nfc_target_pool_free(target, 1024, mem[0]);
+    g_assert(nfc_target_pool_allocs(target) == data.allocs + 1);
 
     nfc_target_unref(target);
-    g_main_loop_unref(loop);
+    g_main_loop_unref(data.loop);
 }
 
 /*==========================================================================*
@@ -651,6 +1863,59 @@ test_transmit_cancel(
     nfc_target_unref(target);
 }
 
+/*==========================================================================*
+ * transmit_fail_queued
+ *==========================================================================*/
+
+static
+void
+test_transmit_fail_queued_resp(
+    NfcTarget* target,
+    NFC_TRANSMIT_STATUS status,
+    const void* data,
+    guint len,
+    void* user_data)
+{
+    int* failed = user_data;
+
+    g_assert(status == NFC_TRANSMIT_STATUS_ERROR);
+    (*failed)++;
+}
+
+static
+void
+test_transmit_fail_queued(
+    void)
+{
+    static const guint8 d1[] = { 0x01 };
+    static const guint8 d2[] = { 0x01, 0x02 };
+    TestTarget* test = test_target_new();
+    NfcTarget* target = &test->target;
+    int failed = 0;
+    guint id1, id2;
+
+    g_assert(nfc_target_idle(target));
+    id1 = nfc_target_transmit(target, d1, sizeof(d1), NULL,
+        test_transmit_fail_queued_resp, NULL, &failed);
+    id2 = nfc_target_transmit(target, d2, sizeof(d2), NULL,
+        test_transmit_fail_queued_resp, NULL, &failed);
+    g_assert(id1);
+    g_assert(id2);
+    g_assert(!nfc_target_idle(target));
+
+    /* Only queued requests can be failed */
+    g_assert(!nfc_target_fail_transmit(target, 0));
+    g_assert(!nfc_target_fail_transmit(target, id1));
+    g_assert(nfc_target_fail_transmit(target, id2));
+    g_assert(!nfc_target_fail_transmit(target, id2));
+    g_assert_cmpint(failed, == ,1);
+
+    g_assert(nfc_target_cancel_transmit(target, id1));
+    g_assert(nfc_target_idle(target));
+    g_assert_cmpint(failed, == ,1);
+    nfc_target_unref(target);
+}
+
 /*==========================================================================*
  * transmit_destroy
  *==========================================================================*/
@@ -910,6 +2175,221 @@ test_sequence2(
     g_main_loop_unref(loop);
 }
 
+/*==========================================================================*
+ * sequence_cancel
+ *==========================================================================*/
+
+static
+void
+test_sequence_cancel_resp(
+    NfcTarget* target,
+    NFC_TRANSMIT_STATUS status,
+    const void* data,
+    guint len,
+    void* user_data)
+{
+    TestTarget* test = TEST_TARGET(target);
+    guint* order = user_data;
+
+    GDEBUG("Status %d, %u bytes", status, len);
+    g_assert(status == NFC_TRANSMIT_STATUS_OK);
+    g_assert(!*order);
+    *order = ++(test->succeeded);
+}
+
+static
+void
+test_sequence_cancel(
+    void)
+{
+    static const guint8 data[] = { 0x01 };
+    TestTarget* test = test_target_new();
+    NfcTarget* target = &test->target;
+    GMainLoop* loop = g_main_loop_new(NULL, TRUE);
+    NfcTargetSequence* seq1 = nfc_target_sequence_new(target);
+    NfcTargetSequence* seq2 = nfc_target_sequence_new(target);
+    guint a[3], b[2], id;
+    guint order_a[3], order_b[2];
+    guint timeout_id;
+
+    memset(order_a, 0, sizeof(order_a));
+    memset(order_b, 0, sizeof(order_b));
+
+    /* Interleave requests for two sequences */
+    a[0] = nfc_target_transmit(target, data, sizeof(data), seq1,
+        test_sequence_cancel_resp, NULL, order_a + 0);
+    b[0] = nfc_target_transmit(target, data, sizeof(data), seq2,
+        test_sequence_cancel_resp, NULL, order_b + 0);
+    a[1] = nfc_target_transmit(target, data, sizeof(data), seq1,
+        test_sequence_cancel_resp, NULL, order_a + 1);
+    b[1] = nfc_target_transmit(target, data, sizeof(data), seq2,
+        test_sequence_cancel_resp, NULL, order_b + 1);
+    a[2] = nfc_target_transmit(target, data, sizeof(data), seq1,
+        test_sequence_cancel_resp, NULL, order_a + 2);
+    id = nfc_target_transmit(target, NULL, 0, NULL, NULL,
+        test_quit_loop, loop);
+    g_assert(a[0]);
+    g_assert(a[1]);
+    g_assert(a[2]);
+    g_assert(b[0]);
+    g_assert(b[1]);
+    g_assert(id);
+
+    /* Cancel queued requests in the middle and at the head */
+    g_assert(nfc_target_cancel_transmit(target, a[1]));
+    g_assert(nfc_target_cancel_transmit(target, b[0]));
+    g_assert(!nfc_target_cancel_transmit(target, a[1]));
+    g_assert(!nfc_target_cancel_transmit(target, b[0]));
+    nfc_target_sequence_free(seq1);
+    nfc_target_sequence_free(seq2);
+
+    timeout_id = test_setup_timeout(loop);
+    g_main_loop_run(loop);
+    if (timeout_id) {
+        g_source_remove(timeout_id);
+    }
+
+    /* The first sequence completes before the second one starts */
+    g_assert(test->succeeded == 3);
+    g_assert(order_a[0] == 1);
+    g_assert(!order_a[1]);
+    g_assert(order_a[2] == 2);
+    g_assert(!order_b[0]);
+    g_assert(order_b[1] == 3);
+    g_assert(!target->sequence);
+
+    nfc_target_unref(target);
+    g_main_loop_unref(loop);
+}
+
+/*==========================================================================*
+ * priority
+ *==========================================================================*/
+
+static
+void
+test_priority(
+    void)
+{
+    TestTarget* test = test_target_new();
+    NfcTarget* target = &test->target;
+    NfcTargetSequence* seq;
+    GMainLoop* loop = g_main_loop_new(NULL, TRUE);
+    guint order[6];
+    guint timeout_id;
+
+    memset(order, 0, sizeof(order));
+    g_assert(!nfc_target_sequence_new2(NULL, NFC_TARGET_PRIORITY_BULK));
+    g_assert(!nfc_target_transmit2(NULL, NULL, 0, NULL,
+        NFC_TARGET_PRIORITY_BULK, NULL, NULL, NULL));
+
+    /* This one gets submitted right away */
+    g_assert(nfc_target_transmit(target, NULL, 0, NULL,
+        test_sequence_cancel_resp, NULL, order + 0));
+
+    /* These are queued */
+    g_assert(nfc_target_transmit2(target, NULL, 0, NULL,
+        NFC_TARGET_PRIORITY_BULK, test_sequence_cancel_resp, NULL,
+        order + 1));
+    g_assert(nfc_target_transmit2(target, NULL, 0, NULL,
+        NFC_TARGET_PRIORITY_BULK, test_sequence_cancel_resp, NULL,
+        order + 2));
+    g_assert(nfc_target_transmit2(target, NULL, 0, NULL,
+        NFC_TARGET_PRIORITY_INTERACTIVE, test_sequence_cancel_resp, NULL,
+        order + 3));
+
+    /* Bulk sequence doesn't get activated ahead of interactive request */
+    seq = nfc_target_sequence_new2(target, NFC_TARGET_PRIORITY_BULK);
+    g_assert(!target->sequence);
+    g_assert(nfc_target_transmit2(target, NULL, 0, seq,
+        NFC_TARGET_PRIORITY_PRESENCE /* ignored */,
+        test_sequence_cancel_resp, NULL, order + 4));
+    nfc_target_sequence_free(seq);
+    g_assert(nfc_target_transmit2(target, NULL, 0, NULL,
+        NFC_TARGET_PRIORITY_PRESENCE, test_sequence_cancel_resp, NULL,
+        order + 5));
+    g_assert(nfc_target_transmit2(target, NULL, 0, NULL,
+        NFC_TARGET_PRIORITY_BULK, NULL, test_quit_loop, loop));
+
+    timeout_id = test_setup_timeout(loop);
+    g_main_loop_run(loop);
+    if (timeout_id) {
+        g_source_remove(timeout_id);
+    }
+
+    /* Priority first, then the order of submission */
+    g_assert(order[0] == 1);
+    g_assert(order[5] == 2);
+    g_assert(order[3] == 3);
+    g_assert(order[1] == 4);
+    g_assert(order[2] == 5);
+    g_assert(order[4] == 6);
+    g_assert(!target->sequence);
+
+    nfc_target_unref(target);
+    g_main_loop_unref(loop);
+}
+
+/*==========================================================================*
+ * priority_wait
+ *==========================================================================*/
+
+static
+void
+test_priority_wait_started(
+    NfcTarget* target,
+    void* loop)
+{
+    if (target->sequence) {
+        g_main_loop_quit((GMainLoop*)loop);
+    }
+}
+
+static
+void
+test_priority_wait(
+    void)
+{
+    TestTarget* test = test_target_new();
+    NfcTarget* target = &test->target;
+    NfcTargetSequence* seq;
+    GMainLoop* loop = g_main_loop_new(NULL, TRUE);
+    guint order[2];
+    guint timeout_id;
+    gulong id;
+
+    memset(order, 0, sizeof(order));
+
+    /* This one gets submitted right away, the second one is queued */
+    g_assert(nfc_target_transmit(target, NULL, 0, NULL,
+        test_sequence_cancel_resp, NULL, order + 0));
+    g_assert(nfc_target_transmit2(target, NULL, 0, NULL,
+        NFC_TARGET_PRIORITY_PRESENCE, test_sequence_cancel_resp, NULL,
+        order + 1));
+
+    /* Empty sequence waits for the presence check and then gets started */
+    seq = nfc_target_sequence_new(target);
+    g_assert(!target->sequence);
+    id = nfc_target_add_sequence_handler(target,
+        test_priority_wait_started, loop);
+
+    timeout_id = test_setup_timeout(loop);
+    g_main_loop_run(loop);
+    if (timeout_id) {
+        g_source_remove(timeout_id);
+    }
+
+    g_assert(target->sequence == seq);
+    g_assert_cmpuint(order[0], == ,1);
+    g_assert_cmpuint(order[1], == ,2);
+    nfc_target_remove_handler(target, id);
+    nfc_target_sequence_free(seq);
+    g_assert(!target->sequence);
+
+    nfc_target_unref(target);
+    g_main_loop_unref(loop);
+}
+
 /*==========================================================================*
  * reactivate
  *==========================================================================*/
@@ -1045,12 +2525,29 @@ int main(int argc, char* argv[])
     g_test_add_func(TEST_("null"), test_null);
     g_test_add_func(TEST_("basic"), test_basic);
     g_test_add_func(TEST_("transmit_ok"), test_transmit_ok);
+    g_test_add_func(TEST_("transmit_bytes"), test_transmit_bytes);
+    g_test_add_func(TEST_("transmit_timeout"), test_transmit_timeout);
+    g_test_add_func(TEST_("transmit_rtt_class"), test_transmit_rtt_class);
+    g_test_add_func(TEST_("transmit_batch"), test_transmit_batch);
+    g_test_add_func(TEST_("transmit_direct"), test_transmit_direct);
+    g_test_add_func(TEST_("transmit_deadline"), test_transmit_deadline);
+    g_test_add_func(TEST_("transmit_deadline_order"),
+        test_transmit_deadline_order);
+    g_test_add_func(TEST_("transmit_expired_resubmit"),
+        test_transmit_expired_resubmit);
+    g_test_add_func(TEST_("transmit_retry"), test_transmit_retry);
+    g_test_add_func(TEST_("transmit_full"), test_transmit_full);
+    g_test_add_func(TEST_("pool"), test_pool);
     g_test_add_func(TEST_("transmit_fail"), test_transmit_fail);
     g_test_add_func(TEST_("transmit_cancel"), test_transmit_cancel);
+    g_test_add_func(TEST_("transmit_fail_queued"), test_transmit_fail_queued);
     g_test_add_func(TEST_("transmit_destroy"), test_transmit_destroy);
     g_test_add_func(TEST_("sequence_basic"), test_sequence_basic);
     g_test_add_func(TEST_("sequence_ok"), test_sequence_ok);
     g_test_add_func(TEST_("sequence2"), test_sequence2);
+    g_test_add_func(TEST_("sequence_cancel"), test_sequence_cancel);
+    g_test_add_func(TEST_("priority"), test_priority);
+    g_test_add_func(TEST_("priority_wait"), test_priority_wait);
     g_test_add_func(TEST_("reactivate"), test_reactivate);
     g_test_add_func(TEST_("reactivate_ok"), test_reactivate_ok);
     g_test_add_func(TEST_("reactivate_timeout"), test_reactivate_timeout);
@@ -249,6 +249,118 @@ test_long_len(
     g_assert(!value.size);
 }
 
+/*==========================================================================*
+ * scanner
+ *==========================================================================*/
+
+static
+void
+test_scanner(
+    void)
+{
+    static const guint8 test_tlv[] = {
+        TLV_NULL, TLV_TEST, 0x02, 0x01, 0x02,
+        TLV_TEST, 0xff, 0x00, 0x03, 0x01, 0x02, 0x03,
+        TLV_TERMINATOR, 0x00
+    };
+    NfcTlvScanner scanner;
+    guint i;
+
+    /* All at once */
+    nfc_tlv_scanner_init(&scanner, 0);
+    g_assert(scanner.need == 1);
+    g_assert(nfc_tlv_scanner_feed(&scanner, NULL, 0) ==
+        NFC_TLV_SCAN_NEED_MORE);
+    g_assert(nfc_tlv_scanner_feed(&scanner, test_tlv, sizeof(test_tlv)) ==
+        NFC_TLV_SCAN_COMPLETE);
+    g_assert(scanner.offset == sizeof(test_tlv) - 1);
+    g_assert(!scanner.need);
+
+    /* Further input is ignored */
+    g_assert(nfc_tlv_scanner_feed(&scanner, test_tlv, sizeof(test_tlv)) ==
+        NFC_TLV_SCAN_COMPLETE);
+    g_assert(scanner.offset == sizeof(test_tlv) - 1);
+
+    /* Byte by byte */
+    nfc_tlv_scanner_init(&scanner, 0);
+    for (i = 0; i < sizeof(test_tlv) - 2; i++) {
+        g_assert(nfc_tlv_scanner_feed(&scanner, test_tlv + i, 1) ==
+            NFC_TLV_SCAN_NEED_MORE);
+        g_assert(scanner.need);
+    }
+    g_assert(nfc_tlv_scanner_feed(&scanner, test_tlv + i, 2) ==
+        NFC_TLV_SCAN_COMPLETE);
+    g_assert(scanner.offset == sizeof(test_tlv) - 1);
+}
+
+/*==========================================================================*
+ * scanner_need
+ *==========================================================================*/
+
+static
+void
+test_scanner_need(
+    void)
+{
+    static const guint8 test_tlv[] = {
+        TLV_TEST, 0xff, 0x01, 0x00
+    };
+    NfcTlvScanner scanner;
+
+    nfc_tlv_scanner_init(&scanner, 0);
+    g_assert(nfc_tlv_scanner_feed(&scanner, test_tlv, 1) ==
+        NFC_TLV_SCAN_NEED_MORE);
+    g_assert(scanner.need == 2);
+    g_assert(nfc_tlv_scanner_feed(&scanner, test_tlv + 1, 1) ==
+        NFC_TLV_SCAN_NEED_MORE);
+    g_assert(scanner.need == 3);
+    g_assert(nfc_tlv_scanner_feed(&scanner, test_tlv + 2, 2) ==
+        NFC_TLV_SCAN_NEED_MORE);
+    g_assert(scanner.need == 257);
+    g_assert(nfc_tlv_scanner_feed(&scanner, test_tlv, 4) ==
+        NFC_TLV_SCAN_NEED_MORE);
+    g_assert(scanner.need == 253);
+    g_assert(scanner.offset == 8);
+}
+
+/*==========================================================================*
+ * scanner_broken
+ *==========================================================================*/
+
+static
+void
+test_scanner_broken(
+    void)
+{
+    static const guint8 reserved_len[] = {
+        TLV_TEST, 0xff, 0xff, 0xff
+    };
+    static const guint8 too_long[] = {
+        TLV_NULL, TLV_TEST, 0x10
+    };
+    NfcTlvScanner scanner;
+
+    /* Reserved length */
+    nfc_tlv_scanner_init(&scanner, 0);
+    g_assert(nfc_tlv_scanner_feed(&scanner, reserved_len,
+        sizeof(reserved_len)) == NFC_TLV_SCAN_BROKEN);
+    g_assert(!scanner.need);
+    g_assert(nfc_tlv_scanner_feed(&scanner, reserved_len,
+        sizeof(reserved_len)) == NFC_TLV_SCAN_BROKEN);
+
+    /* Value runs past the limit */
+    nfc_tlv_scanner_init(&scanner, 16);
+    g_assert(nfc_tlv_scanner_feed(&scanner, too_long, 2) ==
+        NFC_TLV_SCAN_NEED_MORE);
+    g_assert(nfc_tlv_scanner_feed(&scanner, too_long + 2, 1) ==
+        NFC_TLV_SCAN_BROKEN);
+
+    /* No room for the terminator */
+    nfc_tlv_scanner_init(&scanner, 1);
+    g_assert(nfc_tlv_scanner_feed(&scanner, too_long, 1) ==
+        NFC_TLV_SCAN_BROKEN);
+}
+
 /*==========================================================================*
  * Common
  *==========================================================================*/
@@ -266,6 +378,9 @@ int main(int argc, char* argv[])
     g_test_add_func(TEST_("missing_value"), test_missing_value);
     g_test_add_func(TEST_("short_len"), test_short_len);
     g_test_add_func(TEST_("long"), test_long_len);
+    g_test_add_func(TEST_("scanner"), test_scanner);
+    g_test_add_func(TEST_("scanner_need"), test_scanner_need);
+    g_test_add_func(TEST_("scanner_broken"), test_scanner_broken);
     test_init(&test_opt, argc, argv);
     return g_test_run();
 }
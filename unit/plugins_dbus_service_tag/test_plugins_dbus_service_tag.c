@@ -41,6 +41,7 @@
 #include "nfc_plugins.h"
 #include "nfc_adapter_p.h"
 #include "nfc_target_p.h"
+#include "nfc_target_impl.h"
 #include "nfc_tag_p.h"
 
 #include <gutil_idlepool.h>
@@ -67,29 +68,37 @@ typedef struct test_data {
 
 static
 void
-test_data_init(
-    TestData* test)
+test_data_init2(
+    TestData* test,
+    NfcTarget* target,
+    const NfcParamPoll* poll)
 {
     NfcPluginsInfo pi;
-    NfcTarget* target;
-    NfcParamPoll poll;
 
     g_assert(!test_name_watches);
     memset(test, 0, sizeof(*test));
     memset(&pi, 0, sizeof(pi));
     g_assert((test->manager = nfc_manager_new(&pi)) != NULL);
     g_assert((test->adapter = test_adapter_new()) != NULL);
-
-    target = test_target_new();
-    memset(&poll, 0, sizeof(poll));
-    g_assert(nfc_adapter_add_other_tag2(test->adapter, target, &poll));
-    nfc_target_unref(target);
-
+    g_assert(nfc_adapter_add_other_tag2(test->adapter, target, poll));
     g_assert(nfc_manager_add_adapter(test->manager, test->adapter));
     test->loop = g_main_loop_new(NULL, TRUE);
     test->pool = gutil_idle_pool_new();
 }
 
+static
+void
+test_data_init(
+    TestData* test)
+{
+    NfcTarget* target = test_target_new();
+    NfcParamPoll poll;
+
+    memset(&poll, 0, sizeof(poll));
+    test_data_init2(test, target, &poll);
+    nfc_target_unref(target);
+}
+
 static
 void
 test_data_cleanup(
@@ -990,6 +999,177 @@ test_block(
     test_dbus_free(dbus);
 }
 
+/*==========================================================================*
+ * ndef_parsed
+ *==========================================================================*/
+
+static
+void
+test_ndef_parsed_get_records_done(
+    GObject* object,
+    GAsyncResult* result,
+    gpointer user_data)
+{
+    TestData* test = user_data;
+    NfcTag* tag = test->adapter->tags[0];
+    gchar** records = NULL;
+    GVariant* var = g_dbus_connection_call_finish(G_DBUS_CONNECTION(object),
+        result, NULL);
+
+    g_assert(var);
+    g_variant_get(var, "(^ao)", &records);
+    g_assert(records);
+    GDEBUG("%u record(s)", g_strv_length(records));
+    g_assert(g_strv_length(records) == 0);
+    g_strfreev(records);
+    g_variant_unref(var);
+
+    /* GetAll is still waiting, this unblocks it */
+    g_assert(!(tag->flags & NFC_TAG_FLAG_INITIALIZED));
+    nfc_tag_set_initialized(tag);
+}
+
+static
+void
+test_ndef_parsed_continue(
+    GObject* connection,
+    GAsyncResult* result,
+    gpointer user_data)
+{
+    TestData* test = user_data;
+
+    test_complete_ok(G_DBUS_CONNECTION(connection), result);
+    /* This unblocks GetNdefRecords but not GetAll */
+    nfc_tag_set_stage(test->adapter->tags[0], NFC_TAG_STAGE_NDEF_PARSED);
+}
+
+static
+void
+test_ndef_parsed_start(
+    GDBusConnection* client,
+    GDBusConnection* server,
+    void* user_data)
+{
+    TestData* test = user_data;
+
+    g_assert(nfc_tag_stage(test->adapter->tags[0]) <
+        NFC_TAG_STAGE_NDEF_PARSED);
+
+    /* test_get_all_done() will finish the test */
+    test_start_and_get(test, client, server, "GetAll", test_get_all_done);
+    test_call_get(test, "GetNdefRecords", test_ndef_parsed_get_records_done);
+
+    /* Wait for GetInterfaceVersion to complete before continuing */
+    test_call_get(test, "GetInterfaceVersion", test_ndef_parsed_continue);
+}
+
+static
+void
+test_ndef_parsed(
+    void)
+{
+    TestData test;
+    TestDBus* dbus;
+
+    test_data_init(&test);
+    dbus = test_dbus_new(test_ndef_parsed_start, &test);
+    test_run(&test_opt, test.loop);
+    test_data_cleanup(&test);
+    test_dbus_free(dbus);
+}
+
+/*==========================================================================*
+ * stage
+ *==========================================================================*/
+
+typedef struct test_stage_data {
+    TestData test;
+    guint stage;
+} TestStageData;
+
+static
+void
+test_stage_changed(
+    GDBusConnection* connection,
+    const char* sender,
+    const char* path,
+    const char* iface,
+    const char* name,
+    GVariant* args,
+    gpointer user_data)
+{
+    TestStageData* data = user_data;
+    guint stage = 0;
+
+    g_variant_get(args, "(u)", &stage);
+    GDEBUG("Stage %u", stage);
+    g_assert_cmpuint(stage, == ,data->stage + 1);
+    data->stage = stage;
+    if (stage == NFC_TAG_STAGE_CACHED) {
+        test_quit_later(data->test.loop);
+    }
+}
+
+static
+void
+test_stage_get_done(
+    GObject* object,
+    GAsyncResult* result,
+    gpointer user_data)
+{
+    TestStageData* data = user_data;
+    NfcTag* tag = data->test.adapter->tags[0];
+    GVariant* var = g_dbus_connection_call_finish(G_DBUS_CONNECTION(object),
+        result, NULL);
+
+    g_assert(var);
+    g_variant_get(var, "(u)", &data->stage);
+    g_variant_unref(var);
+    GDEBUG("Stage %u", data->stage);
+    g_assert_cmpuint(data->stage, == ,nfc_tag_stage(tag));
+    g_assert_cmpuint(data->stage, < ,NFC_TAG_STAGE_CACHED);
+
+    /* This emits StageChanged for each stage on the way */
+    nfc_tag_set_stage(tag, NFC_TAG_STAGE_CACHED);
+}
+
+static
+void
+test_stage_start(
+    GDBusConnection* client,
+    GDBusConnection* server,
+    void* user_data)
+{
+    TestStageData* data = user_data;
+    TestData* test = &data->test;
+
+    g_object_ref(test->connection = client);
+    test->service = dbus_service_adapter_new(test->adapter, server);
+    g_assert(test->service);
+    g_assert(g_dbus_connection_signal_subscribe(client, NULL,
+        NFC_TAG_INTERFACE, "StageChanged",
+        test_tag_path(test, test->adapter->tags[0]), NULL,
+        G_DBUS_SIGNAL_FLAGS_NO_MATCH_RULE, test_stage_changed, data, NULL));
+    test_call_get(test, "GetStage", test_stage_get_done);
+}
+
+static
+void
+test_stage(
+    void)
+{
+    TestStageData data;
+    TestDBus* dbus;
+
+    test_data_init(&data.test);
+    data.stage = NFC_TAG_STAGE_NONE;
+    dbus = test_dbus_new(test_stage_start, &data);
+    test_run(&test_opt, data.test.loop);
+    g_assert_cmpuint(data.stage, == ,NFC_TAG_STAGE_CACHED);
+    test_data_cleanup(&data.test);
+    test_dbus_free(dbus);
+}
+
 /*==========================================================================*
  * deactivate
  *==========================================================================*/
@@ -1624,6 +1804,152 @@ test_lock_fail(
     test_dbus_free(dbus);
 }
 
+/*==========================================================================*
+ * reattach
+ *==========================================================================*/
+
+/* Accepts everything and never responds */
+
+typedef NfcTargetClass TestStuckTargetClass;
+typedef NfcTarget TestStuckTarget;
+
+G_DEFINE_TYPE(TestStuckTarget, test_stuck_target, NFC_TYPE_TARGET)
+#define TEST_TYPE_STUCK_TARGET (test_stuck_target_get_type())
+
+static
+gboolean
+test_stuck_target_transmit(
+    NfcTarget* target,
+    const void* data,
+    guint len)
+{
+    return TRUE;
+}
+
+static
+void
+test_stuck_target_init(
+    TestStuckTarget* self)
+{
+    self->technology = NFC_TECHNOLOGY_A;
+}
+
+static
+void
+test_stuck_target_class_init(
+    NfcTargetClass* klass)
+{
+    klass->transmit = test_stuck_target_transmit;
+}
+
+static
+void
+test_reattach_poll(
+    NfcParamPoll* poll)
+{
+    static const guint8 uid[] = { 0x04, 0x9b, 0xfb, 0x4a, 0xeb, 0x2b, 0x80 };
+
+    memset(poll, 0, sizeof(*poll));
+    poll->a.nfcid1.bytes = uid;
+    poll->a.nfcid1.size = sizeof(uid);
+}
+
+static
+void
+test_reattach_acquire_done(
+    GObject* connection,
+    GAsyncResult* result,
+    gpointer user_data)
+{
+    TestData* test = user_data;
+
+    test_complete_error(G_DBUS_CONNECTION(connection), result,
+        DBUS_SERVICE_ERROR_ABORTED);
+    GDEBUG("Acquire failed, good!");
+    test_quit_later(test->loop);
+}
+
+static
+void
+test_reattach_continue(
+    GObject* connection,
+    GAsyncResult* result,
+    gpointer user_data)
+{
+    TestData* test = user_data;
+    NfcTag* tag = test->adapter->tags[0];
+    NfcTarget* target = g_object_new(TEST_TYPE_STUCK_TARGET, NULL);
+    NfcParamPoll poll;
+
+    test_complete_ok(G_DBUS_CONNECTION(connection), result);
+
+    /* Acquire is waiting but its sequence hasn't started yet */
+    g_assert(!tag->target->sequence);
+
+    /* The tag leaves the field and comes back */
+    nfc_target_gone(tag->target);
+    g_assert(tag->present);
+    test_reattach_poll(&poll);
+    g_assert(nfc_adapter_add_other_tag2(test->adapter, target, &poll) == tag);
+    g_assert(tag->target == target);
+    nfc_target_unref(target);
+    /* And wait for test_reattach_acquire_done() to finish the test */
+}
+
+static
+void
+test_reattach_start(
+    GDBusConnection* client,
+    GDBusConnection* server,
+    void* user_data)
+{
+    static const guint8 cmd[] = { 0x30, 0x00 };
+    TestData* test = user_data;
+    NfcTarget* target = test->adapter->tags[0]->target;
+
+    test_sender = test_sender_1;
+    test->service = dbus_service_adapter_new(test->adapter, server);
+    g_assert(test->service);
+    g_object_ref(test->connection = client);
+
+    /*
+     * The first request gets stuck, the second one (of a higher priority
+     * than the lock) waits for it in the queue and keeps the sequence
+     * created by Acquire from becoming active.
+     */
+    g_assert(nfc_target_transmit_with_timeout(target, cmd, sizeof(cmd),
+        NULL, 60000, NULL, NULL, NULL));
+    g_assert(nfc_target_transmit2(target, cmd, sizeof(cmd), NULL,
+        NFC_TARGET_PRIORITY_INIT, NULL, NULL, NULL));
+    test_call_acquire(test, TRUE, test_reattach_acquire_done);
+
+    /* Wait for GetInterfaceVersion to complete before continuing */
+    test_call_get(test, "GetInterfaceVersion", test_reattach_continue);
+}
+
+static
+void
+test_reattach(
+    void)
+{
+    TestData test;
+    TestDBus* dbus;
+    NfcTarget* target = g_object_new(TEST_TYPE_STUCK_TARGET, NULL);
+    NfcParamPoll poll;
+
+    test_reattach_poll(&poll);
+    test_data_init2(&test, target, &poll);
+    nfc_target_unref(target);
+    nfc_adapter_set_reattach_window(test.adapter, 1000);
+
+    /* Only initialized tags get reattached */
+    nfc_tag_set_initialized(test.adapter->tags[0]);
+    dbus = test_dbus_new(test_reattach_start, &test);
+    test_run(&test_opt, test.loop);
+    test_data_cleanup(&test);
+    test_dbus_free(dbus);
+}
+
 /*==========================================================================*
  * Common
  *==========================================================================*/
@@ -1649,6 +1975,8 @@ int main(int argc, char* argv[])
     g_test_add_func(TEST_("early_free"), test_early_free);
     g_test_add_func(TEST_("early_free2"), test_early_free2);
     g_test_add_func(TEST_("block"), test_block);
+    g_test_add_func(TEST_("ndef_parsed"), test_ndef_parsed);
+    g_test_add_func(TEST_("stage"), test_stage);
     g_test_add_func(TEST_("deactivate"), test_deactivate);
     g_test_add_func(TEST_("lock"), test_lock);
     g_test_add_func(TEST_("lock_wait"), test_lock_wait);
@@ -1656,6 +1984,7 @@ int main(int argc, char* argv[])
     g_test_add_func(TEST_("lock_drop_wait"), test_lock_drop_wait);
     g_test_add_func(TEST_("lock_release_wait"), test_lock_release_wait);
     g_test_add_func(TEST_("lock_fail"), test_lock_fail);
+    g_test_add_func(TEST_("reattach"), test_reattach);
     test_init(&test_opt, argc, argv);
     return g_test_run();
 }